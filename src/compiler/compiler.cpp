@@ -37,11 +37,6 @@
 
 using namespace std;
 
-#define SUCCESS 0
-#define COMMAND_ERROR 1
-#define PARSE_ERROR 2
-#define CONTEXT_ERROR 3
-
 /****************************
  * Starts the compilation
  * process.
@@ -105,7 +100,8 @@ int Compile(map<const wstring, wstring> &arguments, list<wstring> &argument_opti
   result = arguments.find(L"opt");
   if(result != arguments.end()) {
     optimize = result->second;
-    if(optimize != L"s0" && optimize != L"s1" && optimize != L"s2" && optimize != L"s3") {
+    if(optimize != L"s0" && optimize != L"s1" && optimize != L"s2" && optimize != L"s3" &&
+       optimize != L"s4") {
       wcerr << usage << endl << endl;
       return COMMAND_ERROR;
     }
@@ -132,13 +128,56 @@ int Compile(map<const wstring, wstring> &arguments, list<wstring> &argument_opti
     argument_options.remove(L"debug");
   }
 
+  // check for build cache
+  wstring cache_path;
+  result = arguments.find(L"cache");
+  if(result != arguments.end()) {
+    cache_path = result->second;
+    argument_options.remove(L"cache");
+  }
+
+  // check for an execution profile
+  wstring profile_file;
+  result = arguments.find(L"profile");
+  if(result != arguments.end()) {
+    profile_file = result->second;
+    argument_options.remove(L"profile");
+  }
+
   if(argument_options.size() != 0) {
     wcerr << usage << endl << endl;
     return COMMAND_ERROR;
   }
   
+  ProgramProfile profile;
+  if(profile_file.size() > 0 && !profile.Load(profile_file)) {
+    wcerr << L"Unable to read profile: '" << profile_file << L"'" << endl;
+    return COMMAND_ERROR;
+  }
+  ProgramProfile* program_profile = profile_file.size() > 0 ? &profile : NULL;
+  
+  // incremental build, libraries are always built in full
+  if(cache_path.size() > 0 && run_string.size() == 0 && target != L"lib") {
+    IncrementalCompiler incremental(arguments[L"src"], sys_lib_path, cache_path, 
+                                    target, optimize, program_profile, is_debug, arguments[L"dest"]);
+    return incremental.Compile();
+  }
+  
+  vector<wstring> uses;
+  return CompileFiles(arguments[L"src"], run_string, sys_lib_path, uses, 
+                      target, optimize, program_profile, is_debug, arguments[L"dest"]);
+}
+
+/****************************
+ * Compiles source files into
+ * a target file
+ ****************************/
+int CompileFiles(const wstring &src_files, const wstring &run_string, const wstring &lib_path,
+                 const vector<wstring> &uses, const wstring &target, const wstring &optimize, 
+                 ProgramProfile* profile, bool is_debug, const wstring &dest)
+{
   // parse source code  
-  Parser parser(arguments[L"src"], run_string);
+  Parser parser(src_files, run_string);
   if(parser.Parse()) {
     bool is_lib = false;
     bool is_web = false;
@@ -152,16 +191,22 @@ int Compile(map<const wstring, wstring> &arguments, list<wstring> &argument_opti
   
     // analyze parse tree
     ParsedProgram* program = parser.GetProgram();
-    ContextAnalyzer analyzer(program, sys_lib_path, is_lib, is_web);
+    program->AddUses(uses);
+    ContextAnalyzer analyzer(program, lib_path, is_lib, is_web);
     if(analyzer.Analyze()) {
       // emit intermediate code
       IntermediateEmitter intermediate(program, is_lib, is_debug);
       intermediate.Translate();
       // intermediate optimizer
-      ItermediateOptimizer optimizer(intermediate.GetProgram(), intermediate.GetUnconditionalLabel(), arguments[L"opt"]);
+      ItermediateOptimizer optimizer(intermediate.GetProgram(), intermediate.GetUnconditionalLabel(), optimize, is_lib, profile);
       optimizer.Optimize();
+      // drop code that executables cannot reach, debug builds keep 
+      // everything for the debugger
+      if(!is_lib && !is_web && !is_debug) {
+        optimizer.RemoveUnusedMethods();
+      }
       // emit target code
-      TargetEmitter target(optimizer.GetProgram(), is_lib, is_debug, is_web, arguments[L"dest"]);;
+      TargetEmitter target(optimizer.GetProgram(), is_lib, is_debug, is_web, dest);
       target.Emit();
       return SUCCESS;
     }
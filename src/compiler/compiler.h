@@ -40,12 +40,22 @@
 #include "intermediate.h"
 #include "optimization.h"
 #include "target.h"
+#include "incremental.h"
 
 #include <list>
 #include <vector>
 #include <map>
 #include <string>
 
+#define SUCCESS 0
+#define COMMAND_ERROR 1
+#define PARSE_ERROR 2
+#define CONTEXT_ERROR 3
+
+int CompileFiles(const wstring &src_files, const wstring &run_string, const wstring &lib_path,
+                 const vector<wstring> &uses, const wstring &target, const wstring &optimize, 
+                 ProgramProfile* profile, bool is_debug, const wstring &dest);
+
 extern "C"
 {
   int Compile(map<const wstring, wstring> &arguments, list<wstring> &argument_options, const wstring usage);
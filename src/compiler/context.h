@@ -97,13 +97,11 @@ class LibraryMethodCallSelector {
   }
 
   ~LibraryMethodCallSelector() {
-    while(!matches.empty()) {
-      LibraryMethodCallSelection* tmp = matches.front();
-      matches.erase(matches.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+    for(size_t i = 0; i < matches.size(); ++i) {
+      delete matches[i];
+      matches[i] = NULL;
     }
+    matches.clear();
   }
 
   LibraryMethod* GetSelection() {
@@ -204,13 +202,11 @@ class MethodCallSelector {
   }
 
   ~MethodCallSelector() {
-    while(!matches.empty()) {
-      MethodCallSelection* tmp = matches.front();
-      matches.erase(matches.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+    for(size_t i = 0; i < matches.size(); ++i) {
+      delete matches[i];
+      matches[i] = NULL;
     }
+    matches.clear();
   }
 
   Method* GetSelection() {
@@ -700,10 +696,7 @@ class ContextAnalyzer {
     if(!klass) {
       klass = program->GetClass(bundle->GetName() + L"." + klass_name);
       if(!klass) {
-        vector<wstring> uses = program->GetUses();
-        for(size_t i = 0; !klass && i < uses.size(); ++i) {
-          klass = program->GetClass(uses[i] + L"." + klass_name);
-        }
+        klass = program->GetUseClass(klass_name);
       }
     }
 
@@ -716,10 +709,7 @@ class ContextAnalyzer {
     if(!eenum) {
       eenum = program->GetEnum(bundle->GetName() + L"." + eenum_name);
       if(!eenum) {
-        vector<wstring> uses = program->GetUses();
-        for(size_t i = 0; !eenum && i < uses.size(); ++i) {
-          eenum = program->GetEnum(uses[i] + L"." + eenum_name);
-        }
+        eenum = program->GetUseEnum(eenum_name);
       }
     }
 
@@ -766,10 +756,7 @@ class ContextAnalyzer {
         wstring klass_name = type->GetClassName();
         Class* klass = program->GetClass(klass_name);
         if(!klass) {
-          vector<wstring> uses = program->GetUses();
-          for(size_t i = 0; !klass && i < uses.size(); ++i) {
-            klass = program->GetClass(uses[i] + L"." + klass_name);
-          }
+          klass = program->GetUseClass(klass_name);
         }
         if(klass) {
           encoded_name += klass->GetName();
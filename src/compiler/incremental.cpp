@@ -0,0 +1,505 @@
+/***************************************************************************
+ * Incremental compilation support.
+ *
+ * Copyright (c) 2008-2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#include "compiler.h"
+#include "../shared/version.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdio.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+using namespace std;
+
+static wstring ToHash(unsigned long long hash)
+{
+  wostringstream str;
+  str << hex << setw(16) << setfill(L'0') << hash;
+  return str.str();
+}
+
+static unsigned long long HashString(unsigned long long hash, const wstring &value)
+{
+  for(size_t i = 0; i < value.size(); ++i) {
+    hash ^= (unsigned long long)value[i];
+    hash *= FNV_PRIME;
+  }
+  // separator
+  hash ^= 0xff;
+  hash *= FNV_PRIME;
+
+  return hash;
+}
+
+/****************************
+ * Starts the incremental build
+ ****************************/
+int IncrementalCompiler::Compile()
+{
+  if(!MakeCacheDirectory()) {
+    wcerr << L"Unable to create cache directory: '" << cache_path << L"'" << endl;
+    return COMMAND_ERROR;
+  }
+
+  // scan source files
+  size_t offset = 0;
+  while(offset <= src_files.size()) {
+    size_t index = src_files.find(',', offset);
+    if(index == wstring::npos) {
+      index = src_files.size();
+    }
+
+    SourceFile file;
+    file.name = src_files.substr(offset, index - offset);
+    file.has_entry = false;
+    if(file.name.size() > 0) {
+      if(!ScanFile(file)) {
+        wcerr << L"Unable to open source file: '" << file.name << L"'" << endl;
+        return PARSE_ERROR;
+      }
+      files.push_back(file);
+    }
+    offset = index + 1;
+  }
+
+  FindDependencies();
+  FindUnits();
+
+  // options and system libraries invalidate all units
+  unsigned long long options_hash = HashString(FNV_OFFSET, VERSION_STRING);
+  options_hash = HashString(options_hash, target + L"," + optimize + (is_debug ? L",debug" : L""));
+  size_t lib_offset = 0;
+  while(lib_offset <= sys_lib_path.size()) {
+    size_t index = sys_lib_path.find(',', lib_offset);
+    if(index == wstring::npos) {
+      index = sys_lib_path.size();
+    }
+    const wstring lib_name = sys_lib_path.substr(lib_offset, index - lib_offset);
+    options_hash = HashString(options_hash, lib_name);
+    options_hash = HashString(options_hash, HashFile(lib_name));
+    lib_offset = index + 1;
+  }
+
+  // build units in dependency order
+  int num_libs = 0;
+  int num_cached = 0;
+  wstring program_lib_path = sys_lib_path;
+  for(size_t i = 0; i < units.size(); ++i) {
+    CompileUnit &unit = units[i];
+    set<size_t> unit_ids;
+    CollectDependencies(i, unit_ids);
+    const vector<wstring> uses = GetUses(unit_ids);
+
+    unsigned long long hash = options_hash;
+    for(size_t j = 0; j < unit.files.size(); ++j) {
+      hash = HashString(hash, files[unit.files[j]].name);
+      hash = HashString(hash, files[unit.files[j]].hash);
+    }
+    for(size_t j = 0; j < uses.size(); ++j) {
+      hash = HashString(hash, uses[j]);
+    }
+    for(size_t j = 0; j < unit.depends.size(); ++j) {
+      hash = HashString(hash, units[unit.depends[j]].key);
+    }
+    unit.key = ToHash(hash);
+
+    if(unit.is_program) {
+      continue;
+    }
+
+    // compile library
+    num_libs++;
+    unit.lib_path = cache_path + L"/" + unit.key + L".obl";
+    const string lib_file(unit.lib_path.begin(), unit.lib_path.end());
+    ifstream in(lib_file.c_str(), ios_base::in | ios_base::binary);
+    const bool is_cached = in.good();
+    in.close();
+    if(is_cached) {
+      num_cached++;
+    }
+    else {
+      wstring lib_path = sys_lib_path;
+      for(size_t j = 0; j < i; ++j) {
+        if(unit_ids.find(j) != unit_ids.end()) {
+          lib_path += L"," + units[j].lib_path;
+        }
+      }
+
+      // write to temporary file, so failed builds are not cached
+      const wstring tmp_path = cache_path + L"/" + unit.key + L".tmp.obl";
+      const string tmp_file(tmp_path.begin(), tmp_path.end());
+      const int status = CompileFiles(GetSourceFiles(unit), L"", lib_path, uses, L"lib", optimize, NULL, is_debug, tmp_path);
+      if(status != SUCCESS) {
+        remove(tmp_file.c_str());
+        return status;
+      }
+
+      if(rename(tmp_file.c_str(), lib_file.c_str()) != 0) {
+        wcerr << L"Unable to write file: '" << unit.lib_path << L"'" << endl;
+        remove(tmp_file.c_str());
+        return COMMAND_ERROR;
+      }
+    }
+    program_lib_path += L"," + unit.lib_path;
+  }
+  wcout << L"Reused " << num_cached << L" of " << num_libs << L" cached libraries." << endl;
+
+  // compile program, keeping the original file order
+  wstring program_files;
+  set<size_t> unit_ids;
+  for(size_t i = 0; i < units.size(); ++i) {
+    unit_ids.insert(i);
+  }
+  for(size_t i = 0; i < files.size(); ++i) {
+    bool found = false;
+    for(size_t j = 0; !found && j < units.size(); ++j) {
+      if(units[j].is_program && find(units[j].files.begin(), units[j].files.end(), i) != units[j].files.end()) {
+        found = true;
+      }
+    }
+
+    if(found) {
+      if(program_files.size() > 0) {
+        program_files += L",";
+      }
+      program_files += files[i].name;
+    }
+  }
+
+  return CompileFiles(program_files, L"", program_lib_path, GetUses(unit_ids), target, optimize, profile, is_debug, dest);
+}
+
+/****************************
+ * Collects the names a source
+ * file declares and references
+ ****************************/
+bool IncrementalCompiler::ScanFile(SourceFile &file)
+{
+  file.hash = HashFile(file.name);
+  if(file.hash.size() == 0) {
+    return false;
+  }
+
+  Scanner scanner(file.name);
+  scanner.NextToken();
+  while(scanner.GetToken()->GetType() != TOKEN_END_OF_STREAM) {
+    const ScannerTokenType type = scanner.GetToken()->GetType();
+    switch(type) {
+    case TOKEN_BUNDLE_ID:
+    case TOKEN_USE_ID: {
+      scanner.NextToken();
+      wstring name;
+      while(scanner.GetToken()->GetType() == TOKEN_IDENT) {
+        name += scanner.GetToken()->GetIdentifier();
+        scanner.NextToken();
+        if(scanner.GetToken()->GetType() == TOKEN_PERIOD) {
+          name += L'.';
+          scanner.NextToken();
+        }
+      }
+
+      if(type == TOKEN_USE_ID) {
+        file.uses.push_back(name);
+      }
+      else if(name != DEFAULT_BUNDLE_NAME) {
+        file.bundles.push_back(name);
+        file.uses.push_back(name);
+      }
+    }
+      break;
+
+    case TOKEN_CLASS_ID:
+    case TOKEN_INTERFACE_ID:
+    case TOKEN_ENUM_ID:
+      scanner.NextToken();
+      if(scanner.GetToken()->GetType() == TOKEN_IDENT) {
+        file.declarations.insert(scanner.GetToken()->GetIdentifier());
+        scanner.NextToken();
+      }
+      break;
+
+    case TOKEN_IDENT: {
+      const wstring &ident = scanner.GetToken()->GetIdentifier();
+      if(ident == L"Main" || (target == L"web" && ident == L"Request")) {
+        file.has_entry = true;
+      }
+      file.identifiers.insert(ident);
+      scanner.NextToken();
+    }
+      break;
+
+    default:
+      scanner.NextToken();
+      break;
+    }
+  }
+
+  for(size_t i = 0; i < file.uses.size(); ++i) {
+    if(find(all_uses.begin(), all_uses.end(), file.uses[i]) == all_uses.end()) {
+      all_uses.push_back(file.uses[i]);
+    }
+  }
+
+  return true;
+}
+
+/****************************
+ * A file depends on another file
+ * if it references one of the
+ * types the other file declares
+ ****************************/
+void IncrementalCompiler::FindDependencies()
+{
+  map<const wstring, vector<size_t> > declared;
+  for(size_t i = 0; i < files.size(); ++i) {
+    set<wstring>::iterator iter;
+    for(iter = files[i].declarations.begin(); iter != files[i].declarations.end(); ++iter) {
+      declared[*iter].push_back(i);
+    }
+  }
+
+  for(size_t i = 0; i < files.size(); ++i) {
+    set<size_t> depends;
+    set<wstring>::iterator iter;
+    for(iter = files[i].identifiers.begin(); iter != files[i].identifiers.end(); ++iter) {
+      map<const wstring, vector<size_t> >::iterator found = declared.find(*iter);
+      if(found != declared.end()) {
+        for(size_t j = 0; j < found->second.size(); ++j) {
+          if(found->second[j] != i) {
+            depends.insert(found->second[j]);
+          }
+        }
+      }
+    }
+    files[i].depends.assign(depends.begin(), depends.end());
+  }
+}
+
+/****************************
+ * Groups mutually dependent files
+ * into units (Tarjan's algorithm).
+ * Units are found in dependency
+ * order.
+ ****************************/
+void IncrementalCompiler::FindUnits()
+{
+  vector<int> indexes(files.size(), -1);
+  vector<int> low_links(files.size(), -1);
+  vector<bool> on_stack(files.size(), false);
+  vector<size_t> stack;
+  int next_index = 0;
+
+  for(size_t i = 0; i < files.size(); ++i) {
+    if(indexes[i] < 0) {
+      StrongConnect(i, indexes, low_links, on_stack, stack, next_index);
+    }
+  }
+
+  // map files to units
+  vector<size_t> file_units(files.size());
+  for(size_t i = 0; i < units.size(); ++i) {
+    sort(units[i].files.begin(), units[i].files.end());
+    for(size_t j = 0; j < units[i].files.size(); ++j) {
+      file_units[units[i].files[j]] = i;
+    }
+  }
+
+  // units that define an entry point, or depend on one, are part of the program
+  for(size_t i = 0; i < units.size(); ++i) {
+    CompileUnit &unit = units[i];
+    set<size_t> depends;
+    unit.is_program = false;
+    for(size_t j = 0; j < unit.files.size(); ++j) {
+      const SourceFile &file = files[unit.files[j]];
+      if(file.has_entry) {
+        unit.is_program = true;
+      }
+      for(size_t k = 0; k < file.depends.size(); ++k) {
+        const size_t depend = file_units[file.depends[k]];
+        if(depend != i) {
+          depends.insert(depend);
+          if(units[depend].is_program) {
+            unit.is_program = true;
+          }
+        }
+      }
+    }
+    unit.depends.assign(depends.begin(), depends.end());
+  }
+}
+
+void IncrementalCompiler::StrongConnect(size_t index, vector<int> &indexes, vector<int> &low_links,
+                                        vector<bool> &on_stack, vector<size_t> &stack, int &next_index)
+{
+  indexes[index] = low_links[index] = next_index++;
+  stack.push_back(index);
+  on_stack[index] = true;
+
+  const vector<size_t> &depends = files[index].depends;
+  for(size_t i = 0; i < depends.size(); ++i) {
+    const size_t depend = depends[i];
+    if(indexes[depend] < 0) {
+      StrongConnect(depend, indexes, low_links, on_stack, stack, next_index);
+      low_links[index] = min(low_links[index], low_links[depend]);
+    }
+    else if(on_stack[depend]) {
+      low_links[index] = min(low_links[index], indexes[depend]);
+    }
+  }
+
+  // root of a unit
+  if(low_links[index] == indexes[index]) {
+    CompileUnit unit;
+    size_t file_id;
+    do {
+      file_id = stack.back();
+      stack.pop_back();
+      on_stack[file_id] = false;
+      unit.files.push_back(file_id);
+    }
+    while(file_id != index);
+    units.push_back(unit);
+  }
+}
+
+/****************************
+ * Finds all units that a unit
+ * depends on, including itself
+ ****************************/
+void IncrementalCompiler::CollectDependencies(size_t unit_id, set<size_t> &found)
+{
+  if(found.insert(unit_id).second) {
+    const vector<size_t> &depends = units[unit_id].depends;
+    for(size_t i = 0; i < depends.size(); ++i) {
+      CollectDependencies(depends[i], found);
+    }
+  }
+}
+
+/****************************
+ * Uses are shared by all files in a
+ * program. Bundles declared outside
+ * of the given units are left out
+ * since they are not visible.
+ ****************************/
+vector<wstring> IncrementalCompiler::GetUses(const set<size_t> &unit_ids)
+{
+  set<wstring> declared;
+  set<wstring> visible;
+  for(size_t i = 0; i < units.size(); ++i) {
+    for(size_t j = 0; j < units[i].files.size(); ++j) {
+      const vector<wstring> &bundles = files[units[i].files[j]].bundles;
+      declared.insert(bundles.begin(), bundles.end());
+      if(unit_ids.find(i) != unit_ids.end()) {
+        visible.insert(bundles.begin(), bundles.end());
+      }
+    }
+  }
+
+  vector<wstring> uses;
+  for(size_t i = 0; i < all_uses.size(); ++i) {
+    const wstring &use = all_uses[i];
+    if(declared.find(use) == declared.end() || visible.find(use) != visible.end()) {
+      uses.push_back(use);
+    }
+  }
+
+  return uses;
+}
+
+wstring IncrementalCompiler::GetSourceFiles(const CompileUnit &unit)
+{
+  wstring source_files;
+  for(size_t i = 0; i < unit.files.size(); ++i) {
+    if(i > 0) {
+      source_files += L",";
+    }
+    source_files += files[unit.files[i]].name;
+  }
+
+  return source_files;
+}
+
+/****************************
+ * Hashes the contents of a file
+ ****************************/
+wstring IncrementalCompiler::HashFile(const wstring &file_name)
+{
+  const string open_filename(file_name.begin(), file_name.end());
+  ifstream in(open_filename.c_str(), ios_base::in | ios_base::binary);
+  if(!in.good()) {
+    return L"";
+  }
+
+  unsigned long long hash = FNV_OFFSET;
+  char buffer[8192];
+  while(in.good()) {
+    in.read(buffer, sizeof(buffer));
+    const streamsize read = in.gcount();
+    for(streamsize i = 0; i < read; ++i) {
+      hash ^= (unsigned char)buffer[i];
+      hash *= FNV_PRIME;
+    }
+  }
+  in.close();
+
+  return ToHash(hash);
+}
+
+bool IncrementalCompiler::MakeCacheDirectory()
+{
+  const string path(cache_path.begin(), cache_path.end());
+#ifdef _WIN32
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0777);
+#endif
+
+  // verify the directory is writable
+  const string test_file = path + "/.obc";
+  ofstream out(test_file.c_str(), ofstream::binary);
+  if(!out.is_open()) {
+    return false;
+  }
+  out.close();
+  remove(test_file.c_str());
+
+  return true;
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ * Incremental compilation support.
+ *
+ * Copyright (c) 2008-2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+using namespace std;
+
+/****************************
+ * Names declared and referenced
+ * by a source file
+ ****************************/
+struct SourceFile {
+  wstring name;
+  wstring hash;
+  vector<wstring> bundles;
+  vector<wstring> uses;
+  set<wstring> declarations;
+  set<wstring> identifiers;
+  bool has_entry;
+  vector<size_t> depends;
+};
+
+/****************************
+ * A group of source files that
+ * reference each other and are
+ * compiled as one library
+ ****************************/
+struct CompileUnit {
+  vector<size_t> files;
+  vector<size_t> depends;
+  wstring key;
+  wstring lib_path;
+  bool is_program;
+};
+
+/****************************
+ * Compiles source files into a
+ * cache of per-unit libraries.
+ * Units are keyed by a hash of
+ * their source and the keys of
+ * the units they depend on, so
+ * only changed files and their
+ * dependents are recompiled.
+ * Files that define the entry
+ * point, and their dependents,
+ * are compiled with the cached
+ * libraries into the target.
+ * A profile is only applied 
+ * when compiling the target.
+ ****************************/
+class IncrementalCompiler {
+  wstring src_files;
+  wstring sys_lib_path;
+  wstring cache_path;
+  wstring target;
+  wstring optimize;
+  ProgramProfile* profile;
+  bool is_debug;
+  wstring dest;
+  vector<SourceFile> files;
+  vector<CompileUnit> units;
+  vector<wstring> all_uses;
+
+  bool ScanFile(SourceFile &file);
+  void FindDependencies();
+  void FindUnits();
+  void StrongConnect(size_t index, vector<int> &indexes, vector<int> &low_links,
+                     vector<bool> &on_stack, vector<size_t> &stack, int &next_index);
+  void CollectDependencies(size_t unit_id, set<size_t> &found);
+  vector<wstring> GetUses(const set<size_t> &unit_ids);
+  wstring GetSourceFiles(const CompileUnit &unit);
+  wstring HashFile(const wstring &file_name);
+  bool MakeCacheDirectory();
+
+ public:
+  IncrementalCompiler(const wstring &s, const wstring &l, const wstring &c,
+                      const wstring &t, const wstring &o, ProgramProfile* p, bool g, const wstring &d) {
+    src_files = s;
+    sys_lib_path = l;
+    cache_path = c;
+    target = t;
+    optimize = o;
+    profile = p;
+    is_debug = g;
+    dest = d;
+  }
+
+  ~IncrementalCompiler() {
+  }
+
+  int Compile();
+};
+
+#endif
@@ -39,6 +39,12 @@
 using namespace frontend;
 using namespace backend;
 
+// 'select' statements with at least SELECT_TABLE_MIN labels whose 
+// values span no more than SELECT_TABLE_DENSITY times the number 
+// of labels are translated into jump tables, others into search trees
+#define SELECT_TABLE_MIN 4
+#define SELECT_TABLE_DENSITY 2
+
 class IntermediateEmitter;
 
 /****************************
@@ -192,6 +198,7 @@ class IntermediateEmitter {
   void EmitDoWhile(DoWhile* do_while_stmt);
   void EmitWhile(While* while_stmt);
   void EmitSelect(Select* select_stmt);
+  void EmitSelectTable(Select* select_stmt);
   void EmitFor(For* for_stmt);
   void EmitCriticalSection(CriticalSection* critical_stmt);
   void EmitIndices(ExpressionList* indices);
@@ -297,10 +304,7 @@ class IntermediateEmitter {
     if(!klass) {
       klass = parsed_program->GetClass(parsed_bundle->GetName() + L"." + klass_name);
       if(!klass) {
-        vector<wstring> uses = parsed_program->GetUses();
-        for(size_t i = 0; !klass && i < uses.size(); ++i) {
-          klass = parsed_program->GetClass(uses[i] + L"." + klass_name);
-        }
+        klass = parsed_program->GetUseClass(klass_name);
       }
     }
 
@@ -312,10 +316,7 @@ class IntermediateEmitter {
     if(!eenum) {
       eenum = parsed_program->GetEnum(parsed_bundle->GetName() + L"." + eenum_name);
       if(!eenum) {
-        vector<wstring> uses = parsed_program->GetUses();
-        for(size_t i = 0; !eenum && i < uses.size(); ++i) {
-          eenum = parsed_program->GetEnum(uses[i] + L"." + eenum_name);
-        }
+        eenum = parsed_program->GetUseEnum(eenum_name);
       }
     }
 
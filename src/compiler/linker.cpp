@@ -35,6 +35,48 @@
 
 using namespace instructions;
 
+/****************************
+ * Indexes classes, enums and bundles
+ * of all loaded libraries
+ ****************************/
+void Linker::BuildIndexes()
+{
+  all_classes.clear();
+  all_enums.clear();
+  class_index.clear();
+  enum_index.clear();
+  bundle_index.clear();
+  class_names.clear();
+  enum_names.clear();
+  
+  map<const wstring, Library*>::iterator lib_iter;
+  for(lib_iter = libraries.begin(); lib_iter != libraries.end(); ++lib_iter) {
+    vector<LibraryClass*> classes = lib_iter->second->GetClasses();
+    for(size_t i = 0; i < classes.size(); ++i) {
+      // first match wins
+      const wstring &name = classes[i]->GetName();
+      if(class_index.insert(pair<wstring, size_t>(name, all_classes.size())).second) {
+        class_names[name.substr(name.find_last_of(L'.') + 1)].push_back(all_classes.size());
+      }
+      all_classes.push_back(classes[i]);
+    }
+    
+    vector<LibraryEnum*> enums = lib_iter->second->GetEnums();
+    for(size_t i = 0; i < enums.size(); ++i) {
+      const wstring &name = enums[i]->GetName();
+      if(enum_index.insert(pair<wstring, size_t>(name, all_enums.size())).second) {
+        enum_names[name.substr(name.find_last_of(L'.') + 1)].push_back(all_enums.size());
+      }
+      all_enums.push_back(enums[i]);
+    }
+    
+    vector<wstring> bundle_names = lib_iter->second->GetBundleNames();
+    for(size_t i = 0; i < bundle_names.size(); ++i) {
+      bundle_index[bundle_names[i]] = true;
+    }
+  }
+}
+
 /****************************
  * Creates associations with instructions
  * that reference library classes
@@ -580,6 +622,18 @@ void Library::LoadStatements(LibraryMethod* method, bool is_debug)
     }
       break;
 
+    case TBL_SWITCH: {
+      INT_VALUE low = ReadInt();
+      INT_VALUE other = ReadInt();
+      const int size = ReadInt();
+      vector<int> table;
+      for(int i = 0; i < size; ++i) {
+        table.push_back(ReadInt());
+      }
+      instrs.push_back(new LibraryInstr(line_num, TBL_SWITCH, low, other, table));
+    }
+      break;
+
     case MTHD_CALL: {
       int cls_id = ReadInt();
       int mthd_id = ReadInt();
@@ -717,7 +771,7 @@ void Library::LoadStatements(LibraryMethod* method, bool is_debug)
 
     case TRAP_RTRN: {
       const int id = instrs.back()->GetOperand();
-      if(id == instructions::CPY_CHAR_STR_ARY) {
+      if(id == instructions::CPY_CHAR_STR_ARY || id == instructions::LOAD_CHAR_STR_ARY) {
         LibraryInstr* cpy_instr = instrs[instrs.size() - 2];
         CharStringInstruction* str_instr = char_strings[cpy_instr->GetOperand()];
         str_instr->instrs.push_back(cpy_instr);
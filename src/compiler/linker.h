@@ -47,6 +47,15 @@
 #include "../shared/instrs.h"
 #include "../shared/sys.h"
 
+#if defined(_WIN32) || defined(_OSX) || __cplusplus >= 201103L
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+namespace std {
+  using namespace tr1;
+}
+#endif
+
 using namespace std;
 
 class Library;
@@ -64,6 +73,7 @@ class LibraryInstr {
   double operand4;
   wstring operand5;
   wstring operand6;
+  vector<int> table;
   int line_num;
 
  public:
@@ -101,6 +111,14 @@ class LibraryInstr {
     operand3 = o3;
   }
 
+  LibraryInstr(int l, instructions::InstructionType t, int o, int o2, vector<int> tbl) {
+    line_num = l;
+    type = t;
+    operand = o;
+    operand2 = o2;
+    table = tbl;
+  }
+
   LibraryInstr(int l, instructions::InstructionType t, wstring o5) {
     line_num = l;
     type = t;
@@ -165,6 +183,10 @@ class LibraryInstr {
   const wstring& GetOperand6() const {
     return operand6;
   }
+
+  vector<int> GetTable() {
+    return table;
+  }
 };
 
 /******************************
@@ -365,13 +387,11 @@ class LibraryMethod {
 
   ~LibraryMethod() {
     // clean up
-    while(!instrs.empty()) {
-      LibraryInstr* tmp = instrs.front();
-      instrs.erase(instrs.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+    for(size_t i = 0; i < instrs.size(); ++i) {
+      delete instrs[i];
+      instrs[i] = NULL;
     }
+    instrs.clear();
   }
 
   int GetId() {
@@ -533,7 +553,8 @@ class LibraryClass {
   int cls_space;
   int inst_space;
   map<const wstring, LibraryMethod*> methods;
-  multimap<const wstring, LibraryMethod*> unqualified_methods;
+  unordered_map<wstring, LibraryMethod*> method_index;
+  unordered_map<wstring, vector<LibraryMethod*> > unqualified_methods;
   backend::IntermediateDeclarations* cls_entries;
   backend::IntermediateDeclarations* inst_entries;
   bool is_interface;
@@ -549,6 +570,8 @@ class LibraryClass {
   LibraryClass(const wstring &n, const wstring &p, vector<wstring> in, bool is_inf, bool is_vrtl, int cs, int is, 
 	       backend::IntermediateDeclarations* ce, backend::IntermediateDeclarations* ie, Library* l, 
 	       const wstring &fn, bool d) {
+    // assigned when linked
+    id = -1;
     name = n;
     parent_name = p;
     interface_names = in;
@@ -674,25 +697,22 @@ class LibraryClass {
   }
   
   LibraryMethod* GetMethod(const wstring &name) {
-    map<const wstring, LibraryMethod*>::iterator result = methods.find(name);
-    if(result != methods.end()) {
+    unordered_map<wstring, LibraryMethod*>::iterator result = method_index.find(name);
+    if(result != method_index.end()) {
       return result->second;
     }
 
     return NULL;
   }
 
+  // overloads are returned in the order they were loaded
   vector<LibraryMethod*> GetUnqualifiedMethods(const wstring &n) {
-    vector<LibraryMethod*> results;
-    pair<multimap<const wstring, LibraryMethod*>::iterator, 
-      multimap<const wstring, LibraryMethod*>::iterator> result;
-    result = unqualified_methods.equal_range(n);
-    multimap<const wstring, LibraryMethod*>::iterator iter = result.first;
-    for(iter = result.first; iter != result.second; ++iter) {
-      results.push_back(iter->second);
+    unordered_map<wstring, vector<LibraryMethod*> >::iterator result = unqualified_methods.find(n);
+    if(result != unqualified_methods.end()) {
+      return result->second;
     }
       
-    return results;
+    return vector<LibraryMethod*>();
   }
 
   map<const wstring, LibraryMethod*> GetMethods() {
@@ -702,6 +722,7 @@ class LibraryClass {
   void AddMethod(LibraryMethod* method) {
     const wstring &encoded_name = method->GetName();
     methods.insert(pair<const wstring, LibraryMethod*>(encoded_name, method));
+    method_index.insert(pair<wstring, LibraryMethod*>(encoded_name, method));
     
     // add to unqualified names to list
     const int start = encoded_name.find(':');
@@ -709,7 +730,7 @@ class LibraryClass {
       const int end = encoded_name.find(':', start + 1);
       if(end > -1) {
 	const wstring &unqualified_name = encoded_name.substr(start + 1, end - start - 1);
-	unqualified_methods.insert(pair<wstring, LibraryMethod*>(unqualified_name, method));
+	unqualified_methods[unqualified_name].push_back(method);
       }
       else {
 	delete method;
@@ -902,29 +923,23 @@ class Library {
     named_classes.clear();
     class_list.clear();
 
-    while(!char_strings.empty()) {
-      CharStringInstruction* tmp = char_strings.front();
-      char_strings.erase(char_strings.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+    for(size_t i = 0; i < char_strings.size(); ++i) {
+      delete char_strings[i];
+      char_strings[i] = NULL;
     }
+    char_strings.clear();
 
-    while(!int_strings.empty()) {
-      IntStringInstruction* tmp = int_strings.front();
-      int_strings.erase(int_strings.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+    for(size_t i = 0; i < int_strings.size(); ++i) {
+      delete int_strings[i];
+      int_strings[i] = NULL;
     }
+    int_strings.clear();
 
-    while(!float_strings.empty()) {
-      FloatStringInstruction* tmp = float_strings.front();
-      float_strings.erase(float_strings.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+    for(size_t i = 0; i < float_strings.size(); ++i) {
+      delete float_strings[i];
+      float_strings[i] = NULL;
     }
+    float_strings.clear();
 
     if(alloc_buffer) {
       delete[] alloc_buffer;
@@ -949,6 +964,10 @@ class Library {
     return found != bundle_names.end();
   }
 
+  vector<wstring> GetBundleNames() {
+    return bundle_names;
+  }
+
   LibraryClass* GetClass(const wstring &name) {
     map<const wstring, LibraryClass*>::iterator result = named_classes.find(name);
     if(result != named_classes.end()) {
@@ -1001,6 +1020,30 @@ class Linker {
   map<const wstring, Library*> libraries;
   wstring master_path;
   vector<wstring> paths;
+  // lookup indexes across all libraries, classes and enums map to 
+  // their first position so duplicates resolve as a linear scan would
+  vector<LibraryClass*> all_classes;
+  vector<LibraryEnum*> all_enums;
+  unordered_map<wstring, size_t> class_index;
+  unordered_map<wstring, size_t> enum_index;
+  unordered_map<wstring, bool> bundle_index;
+  // positions by name without bundle qualifiers, in load order
+  unordered_map<wstring, vector<size_t> > class_names;
+  unordered_map<wstring, vector<size_t> > enum_names;
+
+  void BuildIndexes();
+
+  // true if 'full_name' is 'n' qualified by a bundle in use
+  bool IsUseName(const wstring &full_name, const wstring &n, const vector<wstring> &uses) {
+    const size_t offset = full_name.size() - n.size() - 1;
+    if(full_name.size() > n.size() + 1 && full_name[offset] == L'.' && 
+       full_name.compare(offset + 1, n.size(), n) == 0) {
+      const wstring bundle_name = full_name.substr(0, offset);
+      return find(uses.begin(), uses.end(), bundle_name) != uses.end();
+    }
+
+    return false;
+  }
 
  public:
   static void Show(const wstring &msg, const int line_num, int depth) {
@@ -1059,70 +1102,42 @@ class Linker {
 
   // returns all classes including duplicates
   vector<LibraryClass*> GetAllClasses() {
-    vector<LibraryClass*> all_libraries;
-
-    map<const wstring, Library*>::iterator iter;
-    for(iter = libraries.begin(); iter != libraries.end(); ++iter) {
-      vector<LibraryClass*> classes = iter->second->GetClasses();
-      for(size_t i = 0; i < classes.size(); ++i) {
-        all_libraries.push_back(classes[i]);
-      }
-    }
-
-    return all_libraries;
+    return all_classes;
   }
 
   // returns all enums including duplicates
   vector<LibraryEnum*> GetAllEnums() {
-    vector<LibraryEnum*> all_libraries;
-
-    map<const wstring, Library*>::iterator iter;
-    for(iter = libraries.begin(); iter != libraries.end(); ++iter) {
-      vector<LibraryEnum*> enums = iter->second->GetEnums();
-      for(size_t i = 0; i < enums.size(); ++i) {
-        all_libraries.push_back(enums[i]);
-      }
-    }
-
-    return all_libraries;
+    return all_enums;
   }
 
-  // TODO: finds the first class match; note multiple matches may exist
+  // finds the first class match; note multiple matches may exist
   LibraryClass* SearchClassLibraries(const wstring &name) {
-    vector<LibraryClass*> classes = GetAllClasses();
-    for(size_t i = 0; i < classes.size(); ++i) {
-      if(classes[i]->GetName() == name) {
-        return classes[i];
-      }
+    unordered_map<wstring, size_t>::iterator result = class_index.find(name);
+    if(result != class_index.end()) {
+      return all_classes[result->second];
     }
 
     return NULL;
   }
 
   bool HasBundleName(const wstring& name) {
-    map<const wstring, Library*>::iterator iter;
-    for(iter = libraries.begin(); iter != libraries.end(); ++iter) {
-      if(iter->second->HasBundleName(name)) {
-        return true;
-      }
-    }
-
-    return false;
+    return bundle_index.find(name) != bundle_index.end();
   }
 
-  // TODO: finds the first class match; note multiple matches may exist
-  LibraryClass* SearchClassLibraries(const wstring &name, vector<wstring> uses) {
-    vector<LibraryClass*> classes = GetAllClasses();
-    for(size_t i = 0; i < classes.size(); ++i) {
-      if(classes[i]->GetName() == name) {
-        return classes[i];
-      }
+  // finds the first class match; note multiple matches may exist
+  LibraryClass* SearchClassLibraries(const wstring &name, const vector<wstring> &uses) {
+    LibraryClass* klass = SearchClassLibraries(name);
+    if(klass) {
+      return klass;
     }
 
-    for(size_t i = 0; i < classes.size(); ++i) {
-      for(size_t j = 0; j < uses.size(); ++j) {
-        if(classes[i]->GetName() == uses[j] + L"." + name) {
-          return classes[i];
+    // prefer the earliest loaded class among the bundles in use
+    unordered_map<wstring, vector<size_t> >::iterator result = class_names.find(name.substr(name.find_last_of(L'.') + 1));
+    if(result != class_names.end()) {
+      const vector<size_t> &positions = result->second;
+      for(size_t i = 0; i < positions.size(); ++i) {
+        if(IsUseName(all_classes[positions[i]]->GetName(), name, uses)) {
+          return all_classes[positions[i]];
         }
       }
     }
@@ -1130,19 +1145,19 @@ class Linker {
     return NULL;
   }
 
-  // TODO: finds the first enum match; note multiple matches may exist
-  LibraryEnum* SearchEnumLibraries(const wstring &name, vector<wstring> uses) {
-    vector<LibraryEnum*> enums = GetAllEnums();
-    for(size_t i = 0; i < enums.size(); ++i) {
-      if(enums[i]->GetName() == name) {
-        return enums[i];
-      }
+  // finds the first enum match; note multiple matches may exist
+  LibraryEnum* SearchEnumLibraries(const wstring &name, const vector<wstring> &uses) {
+    unordered_map<wstring, size_t>::iterator result = enum_index.find(name);
+    if(result != enum_index.end()) {
+      return all_enums[result->second];
     }
 
-    for(size_t i = 0; i < enums.size(); ++i) {
-      for(size_t j = 0; j < uses.size(); j++) {
-        if(enums[i]->GetName() == uses[j] + L"." + name) {
-          return enums[i];
+    unordered_map<wstring, vector<size_t> >::iterator names = enum_names.find(name.substr(name.find_last_of(L'.') + 1));
+    if(names != enum_names.end()) {
+      const vector<size_t> &positions = names->second;
+      for(size_t i = 0; i < positions.size(); ++i) {
+        if(IsUseName(all_enums[positions[i]]->GetName(), name, uses)) {
+          return all_enums[positions[i]];
         }
       }
     }
@@ -1199,6 +1214,7 @@ class Linker {
       library->Load();
       libraries.insert(pair<wstring, Library*>(file_path, library));
       paths.push_back(file_path);
+      BuildIndexes();
 #ifdef _DEBUG
       wcout << L"--------- End Linking ---------" << endl;
 #endif
@@ -30,15 +30,97 @@
  ***************************************************************************/
 
 #include "optimization.h"
+#include <algorithm>
+#include <fstream>
 
 using namespace backend;
 
+/****************************
+ * Reads a profile written by
+ * 'obr -profile'
+ ****************************/
+bool ProgramProfile::Load(const wstring &file_name)
+{
+  const string open_name(file_name.begin(), file_name.end());
+  ifstream in(open_name.c_str());
+  if(!in.is_open()) {
+    return false;
+  }
+  
+  ProfileMethod* method = NULL;
+  string line;
+  while(getline(in, line)) {
+    istringstream tokens(line);
+    string kind;
+    tokens >> kind;
+    // counts follow their method
+    if(kind == "method") {
+      string name;
+      long invocations = 0;
+      tokens >> name >> invocations;
+      method = &methods[BytesToUnicode(name)];
+      method->invocations += invocations;
+    }
+    else if(method && kind == "branch") {
+      int label = -1;
+      long taken = 0, not_taken = 0;
+      tokens >> label >> taken >> not_taken;
+      pair<long, long> &counts = method->branches[label];
+      counts.first += taken;
+      counts.second += not_taken;
+    }
+    else if(method && kind == "call") {
+      string name;
+      long count = 0, other = 0;
+      tokens >> name >> count >> other;
+      ProfileCall &call = method->calls[BytesToUnicode(name)];
+      call.count += count;
+      
+      string cls_name;
+      long cls_count = 0;
+      while(tokens >> cls_name >> cls_count) {
+	call.receivers[BytesToUnicode(cls_name)] += cls_count;
+      }
+    }
+  }
+  in.close();
+  
+  return true;
+}
+
+long ProgramProfile::GetWork(const wstring &name)
+{
+  ProfileMethod* method = GetMethod(name);
+  if(!method) {
+    return 0;
+  }
+  
+  long work = method->invocations;
+  map<int, pair<long, long> >::iterator branch;
+  for(branch = method->branches.begin(); branch != method->branches.end(); ++branch) {
+    work += branch->second.first + branch->second.second;
+  }
+  
+  return work;
+}
+
 void ItermediateOptimizer::Optimize()
 {
 #ifdef _DEBUG
   wcout << L"\n--------- Optimizing Code ---------" << endl;
 #endif
 
+  // hot methods are chosen before calls are guarded, since 
+  // native code does not keep operands across guards
+  if(profile) {
+    MarkNativeMethods();
+  }
+  
+  // all classes are known when linking an executable
+  if(optimization_level > 2 && !is_lib) {
+    DevirtualizeMethods();
+  }
+
   // classes...
   vector<IntermediateClass*> klasses = program->GetClasses();
   for(size_t i = 0; i < klasses.size(); ++i) {
@@ -60,871 +142,4095 @@ void ItermediateOptimizer::Optimize()
       current_method->SetBlocks(InlineMethod(current_method->GetBlocks()));
     }
   }
-}
-
-vector<IntermediateBlock*> ItermediateOptimizer::InlineMethod(vector<IntermediateBlock*> inputs)
-{
-  if(optimization_level > 2) {
-    // inline methods
-#ifdef _DEBUG
-    wcout << L"  Method inlining..." << endl;
-#endif
-    vector<IntermediateBlock*> outputs;
-    while(!inputs.empty()) {
-      IntermediateBlock* tmp = inputs.front();
-      outputs.push_back(InlineMethod(tmp));
-      // delete old block
-      inputs.erase(inputs.begin());
-      delete tmp;
-      tmp = NULL;
+  
+  if(profile) {
+    // lay out branches after inlining, such that new labels do 
+    // not conflict with the labels of inlined code
+    if(optimization_level > 2) {
+      for(size_t i = 0; i < klasses.size(); ++i) {
+	vector<IntermediateMethod*> methods = klasses[i]->GetMethods();
+	for(size_t j = 0; j < methods.size(); j++) {
+	  current_method = methods[j];
+	  vector<IntermediateBlock*> inputs = current_method->GetBlocks();
+	  
+	  // new labels follow the method's labels
+	  int label = -1;
+	  for(size_t k = 0; k < inputs.size(); ++k) {
+	    vector<IntermediateInstruction*> instrs = inputs[k]->GetInstructions();
+	    for(size_t l = 0; l < instrs.size(); ++l) {
+	      if(instrs[l]->GetType() == LBL && instrs[l]->GetOperand() > label) {
+		label = instrs[l]->GetOperand();
+	      }
+	    }
+	  }
+	  
+	  vector<IntermediateBlock*> outputs;
+	  while(!inputs.empty()) {
+	    IntermediateBlock* tmp = inputs.front();
+	    outputs.push_back(LayoutBranches(tmp, label));
+	    // delete old block
+	    inputs.erase(inputs.begin());
+	    delete tmp;
+	    tmp = NULL;
+	  }
+	  current_method->SetBlocks(outputs);
+	}
+      }
     }
-
-    return outputs;
-  }
-  else {
-    return inputs;
+    
+    VerifyNativeMethods();
   }
 }
 
-vector<IntermediateBlock*> ItermediateOptimizer::OptimizeMethod(vector<IntermediateBlock*> inputs)
+/****************************
+ * Binds virtual method calls to
+ * their implementations, calls with 
+ * a few implementations are guarded
+ * by type checks
+ ****************************/
+void ItermediateOptimizer::DevirtualizeMethods()
 {
-  // clean up jump addresses
 #ifdef _DEBUG
-  wcout << L"  Clean up jumps..." << endl;
+  wcout << L"  Devirtualizing calls..." << endl;
 #endif
 
-  vector<IntermediateBlock*> jump_blocks;
-  // clean up jumps
-  while(!inputs.empty()) {
-    IntermediateBlock* tmp = inputs.front();
-    jump_blocks.push_back(CleanJumps(tmp));
-    // delete old block
-    inputs.erase(inputs.begin());
-    delete tmp;
-    tmp = NULL;
-  }
-  
-  vector<IntermediateBlock*> useless_instrs_blocks;
-  // remove useless instructions
-#ifdef _DEBUG
-  wcout << L"  Clean up Instructions..." << endl;
-#endif
-  while(!jump_blocks.empty()) {
-    IntermediateBlock* tmp = jump_blocks.front();
-    useless_instrs_blocks.push_back(RemoveUselessInstructions(tmp));
-    // delete old block
-    jump_blocks.erase(jump_blocks.begin());
-    delete tmp;
-    tmp = NULL;
-  }
+  IndexClasses();
   
-  vector<IntermediateBlock*> folded_float_blocks;
-  if(optimization_level > 0) {
-    vector<IntermediateBlock*> getter_setter_blocks;
-    // getter/setter inlining
-#ifdef _DEBUG
-    wcout << L"  Getter/setter inlining..." << endl;
-#endif
-    while(!useless_instrs_blocks.empty()) {
-      IntermediateBlock* tmp = useless_instrs_blocks.front();
-      getter_setter_blocks.push_back(InlineSettersGetters(tmp));
-      // delete old block
-      useless_instrs_blocks.erase(useless_instrs_blocks.begin());
-      delete tmp;
-      tmp = NULL;
-    }
-        
-    // fold integers
-#ifdef _DEBUG
-    wcout << L"  Folding integers..." << endl;
-#endif
-    vector<IntermediateBlock*> folded_int_blocks;
-    while(!getter_setter_blocks.empty()) {
-      IntermediateBlock* tmp = getter_setter_blocks.front();
-      folded_int_blocks.push_back(FoldIntConstants(tmp));
-      // delete old block
-      getter_setter_blocks.erase(getter_setter_blocks.begin());
-      delete tmp;
-      tmp = NULL;
-    }
-    
-    // fold floats
-#ifdef _DEBUG
-    wcout << L"  Folding floats..." << endl;
-#endif
-    while(!folded_int_blocks.empty()) {
-      IntermediateBlock* tmp = folded_int_blocks.front();
-      folded_float_blocks.push_back(FoldFloatConstants(tmp));
-      // delete old block
-      folded_int_blocks.erase(folded_int_blocks.begin());
-      delete tmp;
-      tmp = NULL;
+  int sites = 0;
+  vector<IntermediateClass*> klasses = program->GetClasses();
+  int bound = 0;
+  int guarded = 0;
+  for(size_t i = 0; i < klasses.size(); ++i) {
+    vector<IntermediateMethod*> methods = klasses[i]->GetMethods();
+    for(size_t j = 0; j < methods.size(); j++) {
+      current_method = methods[j];
+      vector<IntermediateBlock*> inputs = current_method->GetBlocks();
+      
+      // new labels follow the method's labels
+      int label = -1;
+      for(size_t k = 0; k < inputs.size(); ++k) {
+	vector<IntermediateInstruction*> instrs = inputs[k]->GetInstructions();
+	for(size_t l = 0; l < instrs.size(); ++l) {
+	  if(instrs[l]->GetType() == LBL && instrs[l]->GetOperand() > label) {
+	    label = instrs[l]->GetOperand();
+	  }
+	}
+      }
+      
+      int guard_local = -1;
+      vector<IntermediateBlock*> outputs;
+      while(!inputs.empty()) {
+	IntermediateBlock* tmp = inputs.front();
+	outputs.push_back(DevirtualizeCalls(tmp, label, guard_local, sites, bound, guarded));
+	// delete old block
+	inputs.erase(inputs.begin());
+	delete tmp;
+	tmp = NULL;
+      }
+      current_method->SetBlocks(outputs);
     }
-  } 
-  else {
-    return useless_instrs_blocks;
   }
-
-  vector<IntermediateBlock*> strength_reduced_blocks;
-  if(optimization_level > 1) {
-    // reduce strength
-#ifdef _DEBUG
-    wcout << L"  Strength reduction..." << endl;
-#endif
-    while(!folded_float_blocks.empty()) {
-      IntermediateBlock* tmp = folded_float_blocks.front();
-      strength_reduced_blocks.push_back(StrengthReduction(tmp));
-      // delete old block
-      folded_float_blocks.erase(folded_float_blocks.begin());
-      delete tmp;
-      tmp = NULL;
-    }
-  } 
-  else {
-    return folded_float_blocks;
+  
+  if(bound + guarded > 0) {
+    wcout << L"Devirtualized " << bound + guarded << L" of " << sites 
+	  << L" virtual call site(s): direct=" << bound << L", guarded=" << guarded << endl;
   }
+}
 
-  vector<IntermediateBlock*> instruction_replaced_blocks;
-  if(optimization_level > 2) {
-    // instruction replacement
-#ifdef _DEBUG
-    wcout << L"  Instruction replacement..." << endl;
-#endif
-    while(!strength_reduced_blocks.empty()) {
-      IntermediateBlock* tmp = strength_reduced_blocks.front();
-      instruction_replaced_blocks.push_back(InstructionReplacement(tmp));
-      // delete old block
-      strength_reduced_blocks.erase(strength_reduced_blocks.begin());
-      delete tmp;
-      tmp = NULL;
+void ItermediateOptimizer::IndexClasses()
+{
+  if(class_ids.empty()) {
+    vector<IntermediateClass*> klasses = program->GetClasses();
+    for(size_t i = 0; i < klasses.size(); ++i) {
+      class_names[klasses[i]->GetName()] = klasses[i];
+      class_ids[klasses[i]->GetId()] = klasses[i];
     }
-  } 
-  else {
-    return strength_reduced_blocks;
   }
-  
-  return instruction_replaced_blocks;
 }
 
-IntermediateBlock* ItermediateOptimizer::RemoveUselessInstructions(IntermediateBlock* inputs)
+IntermediateBlock* ItermediateOptimizer::DevirtualizeCalls(IntermediateBlock* inputs, int &label, int &guard_local, 
+							   int &sites, int &bound, int &guarded)
 {
   IntermediateBlock* outputs = new IntermediateBlock;
-  deque<IntermediateInstruction*> working_stack;
   
   vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
   for(size_t i = 0; i < input_instrs.size(); ++i) {
     IntermediateInstruction* instr = input_instrs[i];
-
-    switch(instr->GetType()) {
-    case LOAD_INT_VAR:
-      if(instr->GetOperand2() == LOCL) {
-	working_stack.push_front(instr);
+    if(instr->GetType() != MTHD_CALL) {
+      outputs->AddInstruction(instr);
+      continue;
+    }
+    
+    IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+    if(!mthd_called->IsVirtual()) {
+      outputs->AddInstruction(instr);
+      continue;
+    }
+    sites++;
+    
+    vector<IntermediateMethod*> targets = GetVirtualTargets(mthd_called);
+    // single implementation
+    if(targets.size() == 1) {
+      IntermediateMethod* target = targets.front();
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, MTHD_CALL, target->GetClass()->GetId(), 
+									       target->GetId(), target->IsNative()));
+      bound++;
+      continue;
+    }
+    
+    // profiled sites check the most frequent implementations first, sites with 
+    // many implementations check the frequent ones and fall back to the virtual call
+    bool is_complete = true;
+    if(profile && targets.size() > 1) {
+      vector<IntermediateMethod*> profiled = GetProfiledTargets(mthd_called, targets, is_complete);
+      if(!profiled.empty()) {
+	targets = profiled;
       }
-      else {
-	while(!working_stack.empty()) {
-	  outputs->AddInstruction(working_stack.back());
-	  working_stack.pop_back();
-	}
+    }
+    
+    // type checks walk the class hierarchy, which is only linked for program classes, 
+    // and the JIT does not carry operands across branches
+    if((is_complete && (targets.size() < 2 || targets.size() > VIRTUAL_GUARD_MAX)) || 
+       mthd_called->GetClass()->IsLibrary() || current_method->IsNative()) {
+      outputs->AddInstruction(instr);
+      continue;
+    }
+    
+    if(guard_local < 0) {
+      guard_local = AddGuardLocal();
+      if(guard_local < 0) {
 	outputs->AddInstruction(instr);
+	continue;
       }
-      break;
-      
-    case STOR_INT_VAR:
-      if(instr->GetOperand2() == LOCL && !working_stack.empty() && 
-	 working_stack.front()->GetType() == LOAD_INT_VAR) {
-	if(instr->GetOperand() == working_stack.front()->GetOperand()) {
-	  working_stack.pop_front();
-	}
-	else {
-	  while(!working_stack.empty()) {
-	    outputs->AddInstruction(working_stack.back());
-	    working_stack.pop_back();
-	  }
-	  outputs->AddInstruction(instr);
-	}
+    }
+    
+    // check the most derived implementations first, unchecked receivers 
+    // call the last implementation or make the virtual call
+    const size_t checks = is_complete ? targets.size() - 1 : targets.size();
+    const int end_label = ++label;
+    const int first_label = label + 1;
+    label += (int)checks;
+    
+    outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, STOR_INT_VAR, guard_local, LOCL));
+    for(size_t j = 0; j < checks; ++j) {
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_VAR, guard_local, LOCL));
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, OBJ_TYPE_OF, targets[j]->GetClass()->GetId()));
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, JMP, first_label + (int)j, 1));
+    }
+    
+    outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_VAR, guard_local, LOCL));
+    if(is_complete) {
+      IntermediateMethod* target = targets.back();
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, MTHD_CALL, target->GetClass()->GetId(), 
+									       target->GetId(), target->IsNative()));
+    }
+    else {
+      outputs->AddInstruction(instr);
+    }
+    outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, JMP, end_label, -1));
+    
+    for(size_t j = checks; j > 0; --j) {
+      IntermediateMethod* target = targets[j - 1];
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LBL, first_label + (int)j - 1));
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_VAR, guard_local, LOCL));
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, MTHD_CALL, target->GetClass()->GetId(), 
+									       target->GetId(), target->IsNative()));
+      if(j > 1) {
+	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, JMP, end_label, -1));
       }
-      else {
-	while(!working_stack.empty()) {
-	  outputs->AddInstruction(working_stack.back());
-	  working_stack.pop_back();
-	}
-	outputs->AddInstruction(instr);
+    }
+    outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LBL, end_label));
+    guarded++;
+  }
+  
+  return outputs;
+}
+
+vector<IntermediateMethod*> ItermediateOptimizer::GetVirtualTargets(IntermediateMethod* mthd)
+{
+  map<IntermediateMethod*, vector<IntermediateMethod*> >::iterator result = virtual_targets.find(mthd);
+  if(result != virtual_targets.end()) {
+    return result->second;
+  }
+  
+  // resolve the implementation for each concrete class
+  const wstring &mthd_name = mthd->GetName();
+  const wstring ending = mthd_name.substr(mthd_name.find(L':'));
+  IntermediateClass* base = mthd->GetClass();
+  
+  vector<IntermediateMethod*> targets;
+  bool is_bound = true;
+  vector<IntermediateClass*> klasses = program->GetClasses();
+  for(size_t i = 0; is_bound && i < klasses.size(); ++i) {
+    IntermediateClass* klass = klasses[i];
+    if(!klass->IsVirtual() && !klass->IsInterface() && IsSubclass(klass, base)) {
+      IntermediateMethod* impl = ResolveVirtualMethod(klass, ending);
+      if(!impl || impl->IsVirtual()) {
+	is_bound = false;
       }
-      break;
-     
-    default:
-      while(!working_stack.empty()) {
-	outputs->AddInstruction(working_stack.back());
-	working_stack.pop_back();
+      else if(find(targets.begin(), targets.end(), impl) == targets.end()) {
+	targets.push_back(impl);
       }
-      outputs->AddInstruction(instr);
-      break;
     }
   }
   
-  return outputs; 
+  if(!is_bound) {
+    targets.clear();
+  }
+  
+  // most derived classes first
+  for(size_t i = 1; i < targets.size(); ++i) {
+    for(size_t j = i; j > 0 && GetClassDepth(targets[j]->GetClass()) > GetClassDepth(targets[j - 1]->GetClass()); --j) {
+      IntermediateMethod* tmp = targets[j];
+      targets[j] = targets[j - 1];
+      targets[j - 1] = tmp;
+    }
+  }
+  virtual_targets[mthd] = targets;
+  
+  return targets;
 }
 
-IntermediateBlock* ItermediateOptimizer::CleanJumps(IntermediateBlock* inputs)
+IntermediateMethod* ItermediateOptimizer::ResolveVirtualMethod(IntermediateClass* klass, const wstring &ending)
 {
-  IntermediateBlock* outputs = new IntermediateBlock;
-  deque<IntermediateInstruction*> working_stack;
-
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-
-    switch(instr->GetType()) {
-    case JMP:
-      working_stack.push_front(instr);
-      break;
+  // same binding as the VM
+  while(klass) {
+    IntermediateMethod* impl = klass->GetMethod(klass->GetName() + ending);
+    if(impl) {
+      return impl;
+    }
+    klass = GetParentClass(klass);
+  }
+  
+  return NULL;
+}
 
-    case LBL:
-      // ignore jump to next instruction
-      if(!working_stack.empty() && working_stack.front()->GetType() == JMP && 
-	 working_stack.front()->GetOperand() == instr->GetOperand()) {
-        working_stack.pop_front();
-      }
-      // add back in reverse order
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
-      }
-      outputs->AddInstruction(instr);
-      break;
+IntermediateClass* ItermediateOptimizer::GetParentClass(IntermediateClass* klass)
+{
+  map<const wstring, IntermediateClass*>::iterator result = class_names.find(klass->GetParentName());
+  if(result != class_names.end() && result->second != klass) {
+    return result->second;
+  }
+  
+  return NULL;
+}
 
-    default:
-      // add back in reverse order
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
+bool ItermediateOptimizer::IsSubclass(IntermediateClass* klass, IntermediateClass* base)
+{
+  while(klass) {
+    if(klass == base) {
+      return true;
+    }
+    
+    vector<int> interface_ids = klass->GetInterfaceIds();
+    for(size_t i = 0; i < interface_ids.size(); ++i) {
+      if(interface_ids[i] == base->GetId()) {
+	return true;
       }
-      outputs->AddInstruction(instr);
-      break;
     }
+    klass = GetParentClass(klass);
   }
-  // order matters...
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
-  }
+  
+  return false;
+}
 
-  return outputs;
+int ItermediateOptimizer::GetClassDepth(IntermediateClass* klass)
+{
+  int depth = 0;
+  while((klass = GetParentClass(klass))) {
+    depth++;
+  }
+  
+  return depth;
 }
 
-IntermediateBlock* ItermediateOptimizer::InlineSettersGetters(IntermediateBlock* inputs)
+int ItermediateOptimizer::AddGuardLocal()
 {
-  IntermediateBlock* outputs = new IntermediateBlock;
+  IntermediateDeclarations* entries = current_method->GetEntries();
+  if(!entries) {
+    return -1;
+  }
   
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-    if(instr->GetType() == MTHD_CALL) {
-      IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
-      int status = CanInlineSetterGetter(mthd_called);
-      //  getter instance pattern
-      if(status == 0) {
-	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
-	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
-	outputs->AddInstruction(instrs[1]);
-      }
-      // getter instance pattern
-      else if(status == 1) {
-	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
-	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
-	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, POP_INT));
-	outputs->AddInstruction(instrs[0]);
-      }
-      // character print pattern
-      else if(status == 2) {
-	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
-	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
-	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, POP_INT));
-	outputs->AddInstruction(instrs[2]);
-	outputs->AddInstruction(instrs[3]);
-      }
-      else if(status == 3) {
-	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
-	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
-	outputs->AddInstruction(instrs[3]);
-      }
-      else {
-	outputs->AddInstruction(instr);
-      }
+  // the collector walks interpreted frames by declaration
+  int local = 0;
+  vector<IntermediateDeclaration*> declarations = entries->GetParameters();
+  for(size_t i = 0; i < declarations.size(); ++i) {
+    const ParamType type = declarations[i]->GetType();
+    if(type == FLOAT_PARM || type == FUNC_PARM) {
+      local += 2;
     }
     else {
-      outputs->AddInstruction(instr);
+      local++;
     }
   }
   
-  return outputs;
+  // give up if there are undeclared locals
+  vector<IntermediateBlock*> blocks = current_method->GetBlocks();
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    vector<IntermediateInstruction*> instrs = blocks[i]->GetInstructions();
+    for(size_t j = 0; j < instrs.size(); ++j) {
+      IntermediateInstruction* instr = instrs[j];
+      switch(instr->GetType()) {
+      case LOAD_INT_VAR:
+      case STOR_INT_VAR:
+      case COPY_INT_VAR:
+      case LOAD_FLOAT_VAR:
+      case STOR_FLOAT_VAR:
+      case COPY_FLOAT_VAR:
+      case LOAD_FUNC_VAR:
+      case STOR_FUNC_VAR:
+      case COPY_FUNC_VAR:
+	if(instr->GetOperand2() == LOCL && instr->GetOperand() >= local) {
+	  return -1;
+	}
+	break;
+	
+      default:
+	break;
+      }
+    }
+  }
+  
+  if(local + 1 > LOCAL_SIZE / (int)sizeof(INT_VALUE)) {
+    return -1;
+  }
+  
+  wostringstream name;
+  name << current_method->GetName() << L":#tmp_" << local;
+  entries->AddParameter(new IntermediateDeclaration(name.str(), OBJ_PARM));
+  if((local + 1) * (int)sizeof(INT_VALUE) > current_method->GetSpace()) {
+    current_method->SetSpace((local + 1) * sizeof(INT_VALUE));
+  }
+  
+  return local;
 }
 
-
-IntermediateBlock* ItermediateOptimizer::InstructionReplacement(IntermediateBlock* inputs)
+/****************************
+ * Orders a call site's 
+ * implementations by their 
+ * profiled calls, an 
+ * implementation is checked
+ * after the ones that override
+ * it
+ ****************************/
+vector<IntermediateMethod*> ItermediateOptimizer::GetProfiledTargets(IntermediateMethod* mthd_called, 
+								     vector<IntermediateMethod*> &targets, bool &is_complete)
 {
-  IntermediateBlock* outputs = new IntermediateBlock;
-  deque<IntermediateInstruction*> working_stack;
-
-  size_t i = 0;
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-  while(i < input_instrs.size() && (input_instrs[i]->GetType() == STOR_INT_VAR ||
-                                    input_instrs[i]->GetType() == STOR_FLOAT_VAR)) {
-    outputs->AddInstruction(input_instrs[i++]);
-  }
-
-  for(; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-
-    switch(instr->GetType()) {
-    case LOAD_INT_VAR:
-    case LOAD_FLOAT_VAR:
-      ReplacementInstruction(instr, working_stack, outputs);
-      break;
-
-    case STOR_INT_VAR:
-    case STOR_FLOAT_VAR:
-      if(!working_stack.empty() && working_stack.front()->GetType() == STOR_INT_VAR) {
-	// order matters...
-	while(!working_stack.empty()) {
-	  outputs->AddInstruction(working_stack.back());
-	  working_stack.pop_back();
+  is_complete = true;
+  vector<IntermediateMethod*> ordered;
+  
+  // receivers are counted by class, guarded calls are counted as direct calls
+  const wstring &caller_name = current_method->GetName();
+  const wstring &mthd_name = mthd_called->GetName();
+  const wstring ending = mthd_name.substr(mthd_name.find(L':'));
+  map<IntermediateMethod*, long> counts;
+  long total = 0;
+  
+  ProfileCall* call = profile->GetCall(caller_name, mthd_name);
+  if(call) {
+    total += call->count;
+    map<wstring, long>::iterator receiver;
+    for(receiver = call->receivers.begin(); receiver != call->receivers.end(); ++receiver) {
+      map<const wstring, IntermediateClass*>::iterator klass = class_names.find(receiver->first);
+      if(klass != class_names.end()) {
+	IntermediateMethod* impl = ResolveVirtualMethod(klass->second, ending);
+	if(impl) {
+	  counts[impl] += receiver->second;
 	}
-	outputs->AddInstruction(instr);
       }
-      else {
-	working_stack.push_front(instr);
+    }
+  }
+  
+  for(size_t i = 0; i < targets.size(); ++i) {
+    ProfileCall* direct = profile->GetCall(caller_name, targets[i]->GetName());
+    if(direct) {
+      counts[targets[i]] += direct->count;
+      total += direct->count;
+    }
+  }
+  
+  if(total == 0) {
+    return ordered;
+  }
+  
+  vector<IntermediateMethod*> remaining = targets;
+  while(!remaining.empty()) {
+    int best = -1;
+    for(size_t i = 0; i < remaining.size(); ++i) {
+      bool is_ready = true;
+      for(size_t j = 0; is_ready && j < remaining.size(); ++j) {
+	if(i != j && IsSubclass(remaining[j]->GetClass(), remaining[i]->GetClass())) {
+	  is_ready = false;
+	}
       }
-      break;
       
-    default:
-      // order matters...
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
+      if(is_ready && (best < 0 || counts[remaining[i]] > counts[remaining[best]])) {
+	best = (int)i;
       }
-      outputs->AddInstruction(instr);
-      break;
     }
+    
+    if(best < 0) {
+      ordered.clear();
+      return ordered;
+    }
+    ordered.push_back(remaining[best]);
+    remaining.erase(remaining.begin() + best);
   }
-  // order matters...
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
+  
+  if(ordered.size() <= VIRTUAL_GUARD_MAX) {
+    return ordered;
   }
-
-  return outputs;
+  
+  // check the frequent implementations if they make most of the calls
+  long covered = 0;
+  size_t checks = 0;
+  while(checks < VIRTUAL_GUARD_MAX && counts[ordered[checks]] > 0 && 
+	covered * 100 < total * PROFILE_GUARD_MIN) {
+    covered += counts[ordered[checks]];
+    checks++;
+  }
+  
+  if(covered * 100 < total * PROFILE_GUARD_MIN) {
+    ordered.clear();
+    return ordered;
+  }
+  
+  is_complete = false;
+  ordered.resize(checks);
+  return ordered;
 }
 
-void ItermediateOptimizer::ReplacementInstruction(IntermediateInstruction* instr,
-						  deque<IntermediateInstruction*> &working_stack,
-						  IntermediateBlock* outputs)
+/****************************
+ * Moves the code of if/else 
+ * statements, such that the
+ * more frequent path falls 
+ * through the conditional jump
+ ****************************/
+IntermediateBlock* ItermediateOptimizer::LayoutBranches(IntermediateBlock* inputs, int &label)
 {
-  if(!working_stack.empty()) {
-    IntermediateInstruction* top_instr = working_stack.front();
-    if(top_instr->GetType() == STOR_INT_VAR && instr->GetType() == LOAD_INT_VAR &&
-       instr->GetOperand() == top_instr->GetOperand() &&
-       instr->GetOperand2() == top_instr->GetOperand2()) {
-      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, COPY_INT_VAR, top_instr->GetOperand(), top_instr->GetOperand2()));
-      working_stack.pop_front();
-    } 
-    else if(top_instr->GetType() == STOR_FLOAT_VAR && instr->GetType() == LOAD_FLOAT_VAR &&
-	    instr->GetOperand() == top_instr->GetOperand() &&
-	    instr->GetOperand2() == top_instr->GetOperand2()) {
-      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, COPY_FLOAT_VAR, top_instr->GetOperand(), top_instr->GetOperand2()));
-      working_stack.pop_front();
-    } 
-    else {
-      // order matters...
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
-      }
-      outputs->AddInstruction(instr);
+  IntermediateBlock* outputs = new IntermediateBlock;
+  vector<IntermediateInstruction*> instrs = inputs->GetInstructions();
+  
+  ProfileMethod* counts = profile->GetMethod(current_method->GetName());
+  for(size_t i = 1; counts && i < instrs.size(); ++i) {
+    // 'cond; JMP C,v; A; JMP E,-1; LBL C; B; LBL E' where 'JMP C,v' is mostly taken
+    IntermediateInstruction* instr = instrs[i];
+    if(instr->GetType() != JMP || instr->GetOperand2() < 0 || instr->GetOperand2() > 1 ||
+       !IsCompareInstruction(instrs[i - 1])) {
+      continue;
     }
-  } 
-  else {
-    outputs->AddInstruction(instr);
+    
+    map<int, pair<long, long> >::iterator branch = counts->branches.find(instr->GetOperand());
+    if(branch == counts->branches.end() || branch->second.first <= branch->second.second) {
+      continue;
+    }
+    
+    size_t else_pos = i + 2;
+    while(else_pos < instrs.size() && !(instrs[else_pos]->GetType() == LBL && 
+					instrs[else_pos]->GetOperand() == instr->GetOperand())) {
+      else_pos++;
+    }
+    if(else_pos >= instrs.size()) {
+      continue;
+    }
+    
+    IntermediateInstruction* end_jmp = instrs[else_pos - 1];
+    if(end_jmp->GetType() != JMP || end_jmp->GetOperand2() != -1) {
+      continue;
+    }
+    
+    size_t end_pos = else_pos + 1;
+    while(end_pos < instrs.size() && !(instrs[end_pos]->GetType() == LBL && 
+				       instrs[end_pos]->GetOperand() == end_jmp->GetOperand())) {
+      end_pos++;
+    }
+    if(end_pos >= instrs.size()) {
+      continue;
+    }
+    
+    // 'cond; JMP A,!v; LBL C; B; JMP E,-1; LBL A; A; LBL E'
+    const int then_label = ++label;
+    vector<IntermediateInstruction*> layout(instrs.begin(), instrs.begin() + i);
+    layout.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, JMP, then_label, 1 - instr->GetOperand2()));
+    layout.insert(layout.end(), instrs.begin() + else_pos, instrs.begin() + end_pos);
+    layout.push_back(end_jmp);
+    layout.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LBL, then_label));
+    layout.insert(layout.end(), instrs.begin() + i + 1, instrs.begin() + else_pos - 1);
+    layout.insert(layout.end(), instrs.begin() + end_pos, instrs.end());
+    instrs = layout;
+  }
+  
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    outputs->AddInstruction(instrs[i]);
   }
+  
+  return outputs;
 }
 
-IntermediateBlock* ItermediateOptimizer::StrengthReduction(IntermediateBlock* inputs)
+bool ItermediateOptimizer::IsCompareInstruction(IntermediateInstruction* instr)
 {
-  IntermediateBlock* outputs = new IntermediateBlock;
-  deque<IntermediateInstruction*> working_stack;
-
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-    switch(instr->GetType()) {
-    case LOAD_INT_LIT:
-      working_stack.push_front(instr);
-      break;
-
-    case LOAD_INT_VAR:
-      working_stack.push_front(instr);
-      break;
-
-    case MUL_INT:
-    case DIV_INT:
-      CalculateReduction(instr, working_stack, outputs);
-      break;
+  switch(instr->GetType()) {
+  case LES_INT:
+  case GTR_INT:
+  case LES_EQL_INT:
+  case GTR_EQL_INT:
+  case EQL_INT:
+  case NEQL_INT:
+  case LES_FLOAT:
+  case GTR_FLOAT:
+  case LES_EQL_FLOAT:
+  case GTR_EQL_FLOAT:
+  case EQL_FLOAT:
+  case NEQL_FLOAT:
+    return true;
+    
+  default:
+    return false;
+  }
+}
 
-    default:
-      // order matters...
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
+/****************************
+ * Marks frequently run methods
+ * as native, such that they are 
+ * compiled by the JIT
+ ****************************/
+void ItermediateOptimizer::MarkNativeMethods()
+{
+  vector<IntermediateClass*> klasses = program->GetClasses();
+  for(size_t i = 0; i < klasses.size(); ++i) {
+    vector<IntermediateMethod*> methods = klasses[i]->GetMethods();
+    for(size_t j = 0; j < methods.size(); j++) {
+      IntermediateMethod* mthd = methods[j];
+      const wstring &mthd_name = mthd->GetName();
+      // start methods are not called through the JIT
+      if(!mthd->IsVirtual() && !mthd->IsNative() && !mthd->IsLibrary() &&
+	 mthd_name.find(L":Main:o.System.String*,") == wstring::npos &&
+	 profile->GetWork(mthd_name) >= PROFILE_NATIVE_MIN && CanCompileNative(mthd)) {
+	mthd->SetNative(true);
+	native_methods.insert(mthd);
       }
-      outputs->AddInstruction(instr);
-      break;
     }
   }
-  // order matters...
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
-  }
-
-  return outputs;
 }
 
-void ItermediateOptimizer::CalculateReduction(IntermediateInstruction* instr,
-					      deque<IntermediateInstruction*> &working_stack,
-					      IntermediateBlock* outputs)
+/****************************
+ * Unmarks methods that no longer 
+ * can be compiled after they were
+ * optimized and updates the 
+ * calls to marked methods
+ ****************************/
+void ItermediateOptimizer::VerifyNativeMethods()
+{
+  if(native_methods.empty()) {
+    return;
+  }
+  
+  int marked = 0;
+  set<IntermediateMethod*>::iterator iter;
+  for(iter = native_methods.begin(); iter != native_methods.end(); ++iter) {
+    if(CanCompileNative(*iter)) {
+      marked++;
+    }
+    else {
+      (*iter)->SetNative(false);
+    }
+  }
+  
+  vector<IntermediateClass*> klasses = program->GetClasses();
+  for(size_t i = 0; i < klasses.size(); ++i) {
+    vector<IntermediateMethod*> methods = klasses[i]->GetMethods();
+    for(size_t j = 0; j < methods.size(); j++) {
+      vector<IntermediateBlock*> blocks = methods[j]->GetBlocks();
+      for(size_t k = 0; k < blocks.size(); ++k) {
+	vector<IntermediateInstruction*> instrs = blocks[k]->GetInstructions();
+	for(size_t l = 0; l < instrs.size(); ++l) {
+	  IntermediateInstruction* instr = instrs[l];
+	  if(instr->GetType() == MTHD_CALL) {
+	    IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+	    if(native_methods.find(mthd_called) != native_methods.end()) {
+	      instr->SetOperand3(mthd_called->IsNative());
+	    }
+	  }
+	}
+      }
+    }
+  }
+  
+  if(marked > 0) {
+    wcout << L"Marked " << marked << L" profiled method(s) as native" << endl;
+  }
+}
+
+/****************************
+ * Checks that a method only has
+ * instructions supported by the 
+ * JIT and that no operands are
+ * left on the stack at jumps
+ * and labels
+ ****************************/
+bool ItermediateOptimizer::CanCompileNative(IntermediateMethod* mthd)
+{
+  int depth = mthd->GetNumParams();
+  vector<IntermediateBlock*> blocks = mthd->GetBlocks();
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    vector<IntermediateInstruction*> instrs = blocks[i]->GetInstructions();
+    for(size_t j = 0; j < instrs.size(); ++j) {
+      IntermediateInstruction* instr = instrs[j];
+      switch(instr->GetType()) {
+      case LOAD_INT_LIT:
+      case LOAD_CHAR_LIT:
+      case LOAD_FLOAT_LIT:
+      case LOAD_INST_MEM:
+      case LOAD_CLS_MEM:
+      case NEW_OBJ_INST:
+	depth++;
+	break;
+	
+      case LOAD_INT_VAR:
+      case LOAD_FLOAT_VAR:
+	if(instr->GetOperand2() == LOCL) {
+	  depth++;
+	}
+	break;
+	
+      case STOR_INT_VAR:
+      case STOR_FLOAT_VAR:
+	depth -= instr->GetOperand2() == LOCL ? 1 : 2;
+	break;
+	
+      case COPY_INT_VAR:
+      case COPY_FLOAT_VAR:
+	if(instr->GetOperand2() != LOCL) {
+	  depth--;
+	}
+	break;
+	
+      case ADD_INT:
+      case SUB_INT:
+      case MUL_INT:
+      case DIV_INT:
+      case MOD_INT:
+      case BIT_AND_INT:
+      case BIT_OR_INT:
+      case BIT_XOR_INT:
+      case SHL_INT:
+      case SHR_INT:
+      case AND_INT:
+      case OR_INT:
+      case LES_INT:
+      case GTR_INT:
+      case LES_EQL_INT:
+      case GTR_EQL_INT:
+      case EQL_INT:
+      case NEQL_INT:
+      case ADD_FLOAT:
+      case SUB_FLOAT:
+      case MUL_FLOAT:
+      case DIV_FLOAT:
+      case LES_FLOAT:
+      case GTR_FLOAT:
+      case LES_EQL_FLOAT:
+      case GTR_EQL_FLOAT:
+      case EQL_FLOAT:
+      case NEQL_FLOAT:
+      case POP_INT:
+      case POP_FLOAT:
+	depth--;
+	break;
+	
+      case I2F:
+      case F2I:
+      case FLOR_FLOAT:
+      case CEIL_FLOAT:
+      case SWAP_INT:
+      case OBJ_TYPE_OF:
+      case OBJ_INST_CAST:
+	break;
+	
+      case LOAD_BYTE_ARY_ELM:
+      case LOAD_CHAR_ARY_ELM:
+      case LOAD_INT_ARY_ELM:
+      case LOAD_FLOAT_ARY_ELM:
+	depth -= instr->GetOperand();
+	break;
+	
+      case STOR_BYTE_ARY_ELM:
+      case STOR_CHAR_ARY_ELM:
+      case STOR_INT_ARY_ELM:
+      case STOR_FLOAT_ARY_ELM:
+	depth -= instr->GetOperand() + 2;
+	break;
+	
+      case NEW_BYTE_ARY:
+      case NEW_CHAR_ARY:
+      case NEW_INT_ARY:
+      case NEW_FLOAT_ARY:
+	depth += 1 - instr->GetOperand();
+	break;
+	
+      case MTHD_CALL: {
+	// functions are returned as two values
+	IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+	const wstring rtrn_name = mthd_called->GetEncodedReturn();
+	if(rtrn_name.size() > 0 && rtrn_name[0] == L'm') {
+	  return false;
+	}
+	depth -= mthd_called->GetNumParams() + 1;
+	if(rtrn_name != L"n") {
+	  depth++;
+	}
+      }
+	break;
+	
+      case JMP:
+	if(instr->GetOperand2() > -1) {
+	  depth--;
+	}
+	if(depth != 0) {
+	  return false;
+	}
+	break;
+	
+      case TBL_SWITCH:
+	if(--depth != 0) {
+	  return false;
+	}
+	break;
+	
+      case LBL:
+	if(depth != 0) {
+	  return false;
+	}
+	break;
+	
+	// code after a return is only reached through labels
+      case RTRN:
+	depth = 0;
+	break;
+	
+      default:
+	return false;
+      }
+      
+      if(depth < 0) {
+	return false;
+      }
+    }
+  }
+  
+  return true;
+}
+
+/****************************
+ * Marks methods that cannot be 
+ * reached from the start method, 
+ * their code is not written
+ ****************************/
+void ItermediateOptimizer::RemoveUnusedMethods()
+{
+  IndexClasses();
+  
+  map<int, IntermediateClass*>::iterator start = class_ids.find(program->GetStartClassId());
+  if(start == class_ids.end()) {
+    return;
+  }
+  
+  IntermediateMethod* start_method = FindMethod(program->GetStartClassId(), program->GetStartMethodId());
+  if(!start_method) {
+    return;
+  }
+  
+  set<IntermediateMethod*> used;
+  vector<IntermediateMethod*> work;
+  AddUsedMethod(start_method, used, work);
+  
+  bool is_async = false;
+  bool is_new_by_name = false;
+  while(!work.empty()) {
+    IntermediateMethod* mthd = work.back();
+    work.pop_back();
+    
+    vector<IntermediateBlock*> blocks = mthd->GetBlocks();
+    for(size_t i = 0; i < blocks.size(); ++i) {
+      vector<IntermediateInstruction*> instrs = blocks[i]->GetInstructions();
+      for(size_t j = 0; j < instrs.size(); ++j) {
+	IntermediateInstruction* instr = instrs[j];
+	switch(instr->GetType()) {
+	case MTHD_CALL: {
+	  IntermediateMethod* called = FindMethod(instr->GetOperand(), instr->GetOperand2());
+	  if(called) {
+	    AddUsedMethod(called, used, work);
+	  }
+	}
+	  break;
+	  
+	case LOAD_INT_LIT:
+	  // introspection and native libraries may call any method
+	  if(instr->GetOperand() == instructions::LOAD_CLS_BY_INST) {
+	    return;
+	  }
+	  // classes created by name are constructed with 'New()'
+	  else if(instr->GetOperand() == instructions::LOAD_NEW_OBJ_INST && !is_new_by_name) {
+	    is_new_by_name = true;
+	    vector<IntermediateClass*> klasses = program->GetClasses();
+	    for(size_t k = 0; k < klasses.size(); ++k) {
+	      IntermediateMethod* ctor = klasses[k]->GetMethod(klasses[k]->GetName() + L":New:");
+	      if(ctor) {
+		AddUsedMethod(ctor, used, work);
+	      }
+	    }
+	  }
+	  // function references are pairs of method and class ids
+	  else if(j + 1 < instrs.size() && instrs[j + 1]->GetType() == LOAD_INT_LIT) {
+	    IntermediateMethod* func = FindMethod(instrs[j + 1]->GetOperand(), instr->GetOperand());
+	    if(func) {
+	      AddUsedMethod(func, used, work);
+	    }
+	  }
+	  break;
+	  
+	  // threads start by calling 'Run(param)'
+	case ASYNC_MTHD_CALL:
+	  if(!is_async) {
+	    is_async = true;
+	    vector<IntermediateClass*> klasses = program->GetClasses();
+	    for(size_t k = 0; k < klasses.size(); ++k) {
+	      IntermediateMethod* run = klasses[k]->GetMethod(klasses[k]->GetName() + L":Run:o.System.Base,");
+	      if(run) {
+		AddUsedMethod(run, used, work);
+	      }
+	    }
+	  }
+	  break;
+	  
+	case DLL_LOAD:
+	case DLL_UNLOAD:
+	case DLL_FUNC_CALL:
+	  return;
+	  
+	default:
+	  break;
+	}
+      }
+    }
+  }
+  
+  int removed = 0;
+  int total = 0;
+  vector<IntermediateClass*> klasses = program->GetClasses();
+  for(size_t i = 0; i < klasses.size(); ++i) {
+    vector<IntermediateMethod*> methods = klasses[i]->GetMethods();
+    for(size_t j = 0; j < methods.size(); ++j) {
+      if(used.find(methods[j]) == used.end()) {
+	methods[j]->SetUnused(true);
+	removed++;
+      }
+      total++;
+    }
+  }
+  
+  if(removed > 0) {
+    wcout << L"Removed " << removed << L" of " << total << L" unreachable method(s)." << endl;
+  }
+}
+
+IntermediateMethod* ItermediateOptimizer::FindMethod(int cls_id, int mthd_id)
+{
+  map<int, IntermediateClass*>::iterator result = class_ids.find(cls_id);
+  if(result == class_ids.end()) {
+    return NULL;
+  }
+  
+  vector<IntermediateMethod*> methods = result->second->GetMethods();
+  for(size_t i = 0; i < methods.size(); ++i) {
+    if(methods[i]->GetId() == mthd_id) {
+      return methods[i];
+    }
+  }
+  
+  return NULL;
+}
+
+void ItermediateOptimizer::AddUsedMethod(IntermediateMethod* mthd, set<IntermediateMethod*> &used, 
+					 vector<IntermediateMethod*> &work)
+{
+  if(!used.insert(mthd).second) {
+    return;
+  }
+  work.push_back(mthd);
+  
+  // virtual calls reach the implementation of every subclass
+  if(mthd->IsVirtual()) {
+    const wstring &mthd_name = mthd->GetName();
+    const wstring ending = mthd_name.substr(mthd_name.find(L':'));
+    vector<IntermediateClass*> klasses = program->GetClasses();
+    for(size_t i = 0; i < klasses.size(); ++i) {
+      if(IsSubclass(klasses[i], mthd->GetClass())) {
+	IntermediateMethod* impl = ResolveVirtualMethod(klasses[i], ending);
+	if(impl) {
+	  AddUsedMethod(impl, used, work);
+	}
+      }
+    }
+  }
+}
+
+vector<IntermediateBlock*> ItermediateOptimizer::InlineMethod(vector<IntermediateBlock*> inputs)
+{
+  if(optimization_level > 2) {
+    // inline methods
+#ifdef _DEBUG
+    wcout << L"  Method inlining..." << endl;
+#endif
+    vector<IntermediateBlock*> outputs;
+    while(!inputs.empty()) {
+      IntermediateBlock* tmp = inputs.front();
+      outputs.push_back(InlineMethod(tmp));
+      // delete old block
+      inputs.erase(inputs.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+
+    return outputs;
+  }
+  else {
+    return inputs;
+  }
+}
+
+vector<IntermediateBlock*> ItermediateOptimizer::OptimizeMethod(vector<IntermediateBlock*> inputs)
+{
+  // clean up jump addresses
+#ifdef _DEBUG
+  wcout << L"  Clean up jumps..." << endl;
+#endif
+
+  vector<IntermediateBlock*> jump_blocks;
+  // clean up jumps
+  while(!inputs.empty()) {
+    IntermediateBlock* tmp = inputs.front();
+    jump_blocks.push_back(CleanJumps(tmp));
+    // delete old block
+    inputs.erase(inputs.begin());
+    delete tmp;
+    tmp = NULL;
+  }
+  
+  vector<IntermediateBlock*> useless_instrs_blocks;
+  // remove useless instructions
+#ifdef _DEBUG
+  wcout << L"  Clean up Instructions..." << endl;
+#endif
+  while(!jump_blocks.empty()) {
+    IntermediateBlock* tmp = jump_blocks.front();
+    useless_instrs_blocks.push_back(RemoveUselessInstructions(tmp));
+    // delete old block
+    jump_blocks.erase(jump_blocks.begin());
+    delete tmp;
+    tmp = NULL;
+  }
+  
+  vector<IntermediateBlock*> folded_float_blocks;
+  if(optimization_level > 0) {
+    vector<IntermediateBlock*> getter_setter_blocks;
+    // getter/setter inlining
+#ifdef _DEBUG
+    wcout << L"  Getter/setter inlining..." << endl;
+#endif
+    while(!useless_instrs_blocks.empty()) {
+      IntermediateBlock* tmp = useless_instrs_blocks.front();
+      getter_setter_blocks.push_back(InlineSettersGetters(tmp));
+      // delete old block
+      useless_instrs_blocks.erase(useless_instrs_blocks.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+        
+    // fold integers
+#ifdef _DEBUG
+    wcout << L"  Folding integers..." << endl;
+#endif
+    vector<IntermediateBlock*> folded_int_blocks;
+    while(!getter_setter_blocks.empty()) {
+      IntermediateBlock* tmp = getter_setter_blocks.front();
+      folded_int_blocks.push_back(FoldIntConstants(tmp));
+      // delete old block
+      getter_setter_blocks.erase(getter_setter_blocks.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+    
+    // fold floats
+#ifdef _DEBUG
+    wcout << L"  Folding floats..." << endl;
+#endif
+    while(!folded_int_blocks.empty()) {
+      IntermediateBlock* tmp = folded_int_blocks.front();
+      folded_float_blocks.push_back(FoldFloatConstants(tmp));
+      // delete old block
+      folded_int_blocks.erase(folded_int_blocks.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+  } 
+  else {
+    return useless_instrs_blocks;
+  }
+
+  vector<IntermediateBlock*> strength_reduced_blocks;
+  if(optimization_level > 1) {
+    // reduce strength
+#ifdef _DEBUG
+    wcout << L"  Strength reduction..." << endl;
+#endif
+    while(!folded_float_blocks.empty()) {
+      IntermediateBlock* tmp = folded_float_blocks.front();
+      strength_reduced_blocks.push_back(StrengthReduction(tmp));
+      // delete old block
+      folded_float_blocks.erase(folded_float_blocks.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+  } 
+  else {
+    return folded_float_blocks;
+  }
+
+  if(optimization_level > 3 && strength_reduced_blocks.size() == 1) {
+    // global optimizations
+#ifdef _DEBUG
+    wcout << L"  Global optimizations..." << endl;
+#endif
+    IntermediateBlock* tmp = strength_reduced_blocks.front();
+    strength_reduced_blocks[0] = GlobalOptimization(tmp);
+    // delete old block
+    delete tmp;
+    tmp = NULL;
+  }
+
+  vector<IntermediateBlock*> instruction_replaced_blocks;
+  if(optimization_level > 2) {
+    // instruction replacement
+#ifdef _DEBUG
+    wcout << L"  Instruction replacement..." << endl;
+#endif
+    while(!strength_reduced_blocks.empty()) {
+      IntermediateBlock* tmp = strength_reduced_blocks.front();
+      instruction_replaced_blocks.push_back(InstructionReplacement(tmp));
+      // delete old block
+      strength_reduced_blocks.erase(strength_reduced_blocks.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+  } 
+  else {
+    return strength_reduced_blocks;
+  }
+  
+  return instruction_replaced_blocks;
+}
+
+IntermediateBlock* ItermediateOptimizer::RemoveUselessInstructions(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  deque<IntermediateInstruction*> working_stack;
+  
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+      if(instr->GetOperand2() == LOCL) {
+	working_stack.push_front(instr);
+      }
+      else {
+	while(!working_stack.empty()) {
+	  outputs->AddInstruction(working_stack.back());
+	  working_stack.pop_back();
+	}
+	outputs->AddInstruction(instr);
+      }
+      break;
+      
+    case STOR_INT_VAR:
+      if(instr->GetOperand2() == LOCL && !working_stack.empty() && 
+	 working_stack.front()->GetType() == LOAD_INT_VAR) {
+	if(instr->GetOperand() == working_stack.front()->GetOperand()) {
+	  working_stack.pop_front();
+	}
+	else {
+	  while(!working_stack.empty()) {
+	    outputs->AddInstruction(working_stack.back());
+	    working_stack.pop_back();
+	  }
+	  outputs->AddInstruction(instr);
+	}
+      }
+      else {
+	while(!working_stack.empty()) {
+	  outputs->AddInstruction(working_stack.back());
+	  working_stack.pop_back();
+	}
+	outputs->AddInstruction(instr);
+      }
+      break;
+     
+    default:
+      while(!working_stack.empty()) {
+	outputs->AddInstruction(working_stack.back());
+	working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+    }
+  }
+  
+  return outputs; 
+}
+
+IntermediateBlock* ItermediateOptimizer::CleanJumps(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  deque<IntermediateInstruction*> working_stack;
+
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+
+    switch(instr->GetType()) {
+    case JMP:
+      working_stack.push_front(instr);
+      break;
+
+    case LBL:
+      // ignore jump to next instruction
+      if(!working_stack.empty() && working_stack.front()->GetType() == JMP && 
+	 working_stack.front()->GetOperand() == instr->GetOperand()) {
+        working_stack.pop_front();
+      }
+      // add back in reverse order
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+
+    default:
+      // add back in reverse order
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+    }
+  }
+  // order matters...
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+
+  return outputs;
+}
+
+IntermediateBlock* ItermediateOptimizer::InlineSettersGetters(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+    if(instr->GetType() == MTHD_CALL) {
+      IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+      int status = CanInlineSetterGetter(mthd_called);
+      //  getter instance pattern
+      if(status == 0) {
+	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
+	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
+	outputs->AddInstruction(instrs[1]);
+      }
+      // getter instance pattern
+      else if(status == 1) {
+	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
+	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
+	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, POP_INT));
+	outputs->AddInstruction(instrs[0]);
+      }
+      // character print pattern
+      else if(status == 2) {
+	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
+	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
+	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, POP_INT));
+	outputs->AddInstruction(instrs[2]);
+	outputs->AddInstruction(instrs[3]);
+      }
+      else if(status == 3) {
+	vector<IntermediateBlock*> blocks = mthd_called->GetBlocks();
+	vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
+	outputs->AddInstruction(instrs[3]);
+      }
+      else {
+	outputs->AddInstruction(instr);
+      }
+    }
+    else {
+      outputs->AddInstruction(instr);
+    }
+  }
+  
+  return outputs;
+}
+
+
+IntermediateBlock* ItermediateOptimizer::InstructionReplacement(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  deque<IntermediateInstruction*> working_stack;
+
+  size_t i = 0;
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  while(i < input_instrs.size() && (input_instrs[i]->GetType() == STOR_INT_VAR ||
+                                    input_instrs[i]->GetType() == STOR_FLOAT_VAR)) {
+    outputs->AddInstruction(input_instrs[i++]);
+  }
+
+  for(; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case LOAD_FLOAT_VAR:
+      ReplacementInstruction(instr, working_stack, outputs);
+      break;
+
+    case STOR_INT_VAR:
+    case STOR_FLOAT_VAR:
+      if(!working_stack.empty() && working_stack.front()->GetType() == STOR_INT_VAR) {
+	// order matters...
+	while(!working_stack.empty()) {
+	  outputs->AddInstruction(working_stack.back());
+	  working_stack.pop_back();
+	}
+	outputs->AddInstruction(instr);
+      }
+      else {
+	working_stack.push_front(instr);
+      }
+      break;
+      
+    default:
+      // order matters...
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+    }
+  }
+  // order matters...
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+
+  return outputs;
+}
+
+void ItermediateOptimizer::ReplacementInstruction(IntermediateInstruction* instr,
+						  deque<IntermediateInstruction*> &working_stack,
+						  IntermediateBlock* outputs)
+{
+  if(!working_stack.empty()) {
+    IntermediateInstruction* top_instr = working_stack.front();
+    if(top_instr->GetType() == STOR_INT_VAR && instr->GetType() == LOAD_INT_VAR &&
+       instr->GetOperand() == top_instr->GetOperand() &&
+       instr->GetOperand2() == top_instr->GetOperand2()) {
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, COPY_INT_VAR, top_instr->GetOperand(), top_instr->GetOperand2()));
+      working_stack.pop_front();
+    } 
+    else if(top_instr->GetType() == STOR_FLOAT_VAR && instr->GetType() == LOAD_FLOAT_VAR &&
+	    instr->GetOperand() == top_instr->GetOperand() &&
+	    instr->GetOperand2() == top_instr->GetOperand2()) {
+      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, COPY_FLOAT_VAR, top_instr->GetOperand(), top_instr->GetOperand2()));
+      working_stack.pop_front();
+    } 
+    else {
+      // order matters...
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+    }
+  } 
+  else {
+    outputs->AddInstruction(instr);
+  }
+}
+
+IntermediateBlock* ItermediateOptimizer::StrengthReduction(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  deque<IntermediateInstruction*> working_stack;
+
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_LIT:
+      working_stack.push_front(instr);
+      break;
+
+    case LOAD_INT_VAR:
+      working_stack.push_front(instr);
+      break;
+
+    case MUL_INT:
+    case DIV_INT:
+      CalculateReduction(instr, working_stack, outputs);
+      break;
+
+    default:
+      // order matters...
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+    }
+  }
+  // order matters...
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+
+  return outputs;
+}
+
+void ItermediateOptimizer::CalculateReduction(IntermediateInstruction* instr,
+					      deque<IntermediateInstruction*> &working_stack,
+					      IntermediateBlock* outputs)
 {
   if(working_stack.size() > 1) {
     IntermediateInstruction* top_instr = working_stack.front();
     working_stack.pop_front();
-    if(top_instr->GetType() == LOAD_INT_LIT) {
-      if(working_stack.front()->GetType() == LOAD_INT_VAR) {
-        ApplyReduction(top_instr, instr, top_instr, working_stack, outputs);
-      } 
+    if(top_instr->GetType() == LOAD_INT_LIT) {
+      if(working_stack.front()->GetType() == LOAD_INT_VAR) {
+        ApplyReduction(top_instr, instr, top_instr, working_stack, outputs);
+      } 
+      else {
+        AddBackReduction(instr, top_instr, working_stack, outputs);
+      }
+    } 
+    else if(working_stack.front()->GetType() == LOAD_INT_LIT) {
+      if(top_instr->GetType() == LOAD_INT_VAR) {
+        ApplyReduction(working_stack.front(), instr, top_instr, working_stack, outputs);
+      } 
+      else {
+        AddBackReduction(instr, top_instr, working_stack, outputs);
+      }
+    } 
+    else {
+      AddBackReduction(instr, top_instr, working_stack, outputs);
+    }
+  } 
+  else {
+    // order matters...
+    while(!working_stack.empty()) {
+      outputs->AddInstruction(working_stack.back());
+      working_stack.pop_back();
+    }
+    outputs->AddInstruction(instr);
+  }
+}
+
+void ItermediateOptimizer::ApplyReduction(IntermediateInstruction* test, 
+					  IntermediateInstruction* instr, 
+					  IntermediateInstruction* top_instr,
+					  deque<IntermediateInstruction*> &working_stack, 
+					  IntermediateBlock* outputs)
+{
+  int shift = 0;
+  switch(test->GetOperand()) {
+  case 2:
+    shift = 1;
+    break;
+
+  case 4:
+    shift = 2;
+    break;
+
+  case 8:
+    shift = 3;
+    break;
+
+  case 16:
+    shift = 4;
+    break;
+
+  case 32:
+    shift = 5;
+    break;
+
+  case 64:
+    shift = 6;
+    break;
+
+  case 128:
+    shift = 7;
+    break;
+
+  case 256:
+    shift = 8;
+    break;
+
+  default:
+    AddBackReduction(instr, top_instr, working_stack, outputs);
+    break;
+  }
+
+  deque<IntermediateInstruction*> rewrite_instrs;
+  if(shift) {
+    rewrite_instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, shift));
+    // exclude literal
+    if(working_stack.front()->GetType() != LOAD_INT_LIT) {
+      rewrite_instrs.push_back(working_stack.front());
+    }
+    if(top_instr->GetType() != LOAD_INT_LIT) {
+      rewrite_instrs.push_back(top_instr);
+    }
+    working_stack.pop_front();
+    // shift left or right
+    if(instr->GetType() == MUL_INT) {
+      rewrite_instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, SHL_INT, shift));
+    } 
+    else {
+      rewrite_instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, SHR_INT, shift));
+    }
+  }
+  
+  // add original instructions
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+  
+  // add rewritten instructions
+  for(size_t i = 0; i < rewrite_instrs.size(); ++i) {
+    outputs->AddInstruction(rewrite_instrs[i]);
+  }
+}
+
+void ItermediateOptimizer::AddBackReduction(IntermediateInstruction* instr, IntermediateInstruction* top_instr,
+					    deque<IntermediateInstruction*> &working_stack, IntermediateBlock* outputs)
+{
+  // order matters...
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+  outputs->AddInstruction(top_instr);
+  outputs->AddInstruction(instr);
+}
+
+IntermediateBlock* ItermediateOptimizer::InlineMethod(IntermediateBlock* inputs)
+{
+  set<IntermediateMethod*> inlined_mthds;
+  IntermediateBlock* outputs = new IntermediateBlock;
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+
+  set<int> lbl_jmp_offsets;
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+    switch(instr->GetType()) {
+    case LBL:
+    case JMP:
+      lbl_jmp_offsets.insert(instr->GetOperand());
+      break;
+
+    default:
+      break;
+    }
+  }
+  lbl_jmp_offsets.insert(unconditional_label + 1);
+  
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+
+    if(instr->GetType() == MTHD_CALL) {
+      IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+      // frequent calls may inline larger methods
+      int space_max = LOCL_INLINE_MEM_MAX;
+      if(profile) {
+	ProfileCall* call = profile->GetCall(current_method->GetName(), mthd_called->GetName());
+	if(call && call->count >= PROFILE_HOT_MIN) {
+	  space_max = PROFILE_INLINE_MEM_MAX;
+	}
+      }
+      
+      // checked called method to determine if it can be inlined
+      if(CanInlineMethod(mthd_called, inlined_mthds, lbl_jmp_offsets, space_max)) {
+	// calculate local offset, +2 in case last variable is a double 
+	int local_instr_offset = GetLastLocalOffset(current_method) + 2;
+	
+	// ajust local space
+	current_method->SetSpace(current_method->GetSpace() + sizeof(INT_VALUE) * 2 + mthd_called->GetSpace());
+	
+	// fetch inline instructions for called method
+	// vector<IntermediateBlock*> mthd_called_blocks = OptimizeMethod(mthd_called->GetBlocks());
+	vector<IntermediateBlock*> mthd_called_blocks = mthd_called->GetBlocks();
+	vector<IntermediateInstruction*> mthd_called_instrs = mthd_called_blocks[0]->GetInstructions();
+	
+	// handle the storing of local instance
+	// TODO: might be a better way to do this given the constrains
+	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, STOR_INT_VAR,
+										 local_instr_offset, LOCL));
+	
+	// inline instructions
+	// TODO: inline methods with multiple return values
+	// bool found_rtrn = false;
+	// int end = ++unconditional_label;
+	for(size_t j = 0; j < mthd_called_instrs.size() - 1; j++) {
+	  IntermediateInstruction* mthd_called_instr = mthd_called_instrs[j];
+	  switch(mthd_called_instr->GetType()) {
+	  case LOAD_INT_VAR:
+	  case STOR_INT_VAR:
+	  case COPY_INT_VAR:
+	  case LOAD_FLOAT_VAR:
+	  case STOR_FLOAT_VAR:
+	  case COPY_FLOAT_VAR:
+	    if(mthd_called_instr->GetOperand2() == LOCL) {
+	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, mthd_called_instr->GetType(),
+										       mthd_called_instr->GetOperand() + local_instr_offset + 1,  
+										       LOCL));
+	    }
+	    else if(mthd_called_instr->GetOperand2() == INST) {
+	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, mthd_called_instr->GetType(),
+										       mthd_called_instr->GetOperand(), INST));	      
+	    }
+	    else {
+	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, mthd_called_instr->GetType(),
+										       mthd_called_instr->GetOperand(), CLS));
+	    }
+	    break;
+
+	  case LOAD_INST_MEM:
+	    outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_VAR, local_instr_offset, LOCL));
+	    break;
+	    
+	    /*
+	      case RTRN:
+	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, JMP, end, -1));
+	      found_rtrn = true;
+	      break;
+	    */
+
+	  default:
+	    outputs->AddInstruction(mthd_called_instr);
+	    break;
+	  }
+	}
+	/*
+	  if(found_rtrn) {
+	  outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LBL, end));
+	  }
+	*/
+	inlined_mthds.insert(mthd_called);
+      }	
+      else {
+	outputs->AddInstruction(instr);
+      }
+    }
+    else {
+      outputs->AddInstruction(instr);
+    }
+  }
+  
+  return outputs;
+}
+
+IntermediateBlock* ItermediateOptimizer::FoldIntConstants(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  deque<IntermediateInstruction*> working_stack;
+
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+
+    switch(instr->GetType()) {
+    case LOAD_INT_LIT:
+      working_stack.push_front(instr);
+      break;
+
+    case ADD_INT:
+    case SUB_INT:
+    case MUL_INT:
+    case DIV_INT:
+    case MOD_INT:
+    case BIT_AND_INT:
+    case BIT_OR_INT:
+    case BIT_XOR_INT:
+      CalculateIntFold(instr, working_stack, outputs);
+      break;
+
+    default:
+      // add back in reverse order
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+    }
+  }
+  // order matters...
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+
+  return outputs;
+}
+
+void ItermediateOptimizer::CalculateIntFold(IntermediateInstruction* instr,
+					    deque<IntermediateInstruction*> &working_stack,
+					    IntermediateBlock* outputs)
+{
+  if(working_stack.size() == 1) {
+    outputs->AddInstruction(working_stack.front());
+    working_stack.pop_front();
+    outputs->AddInstruction(instr);
+  } else if(working_stack.size() > 1) {
+    IntermediateInstruction* left = working_stack.front();
+    working_stack.pop_front();
+
+    IntermediateInstruction* right = working_stack.front();
+    working_stack.pop_front();
+
+    // leave division by zero for the runtime
+    if((instr->GetType() == DIV_INT || instr->GetType() == MOD_INT) && right->GetOperand() == 0) {
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(right);
+      outputs->AddInstruction(left);
+      outputs->AddInstruction(instr);
+      return;
+    }
+
+    switch(instr->GetType()) {
+    case ADD_INT: {
+      INT_VALUE value = left->GetOperand() + right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    case SUB_INT: {
+      INT_VALUE value = left->GetOperand() - right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    case MUL_INT: {
+      INT_VALUE value = left->GetOperand() * right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    case DIV_INT: {
+      INT_VALUE value = left->GetOperand() / right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    case MOD_INT: {
+      INT_VALUE value = left->GetOperand() % right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+      
+    case BIT_AND_INT: {
+      INT_VALUE value = left->GetOperand() & right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    case BIT_OR_INT: {
+      INT_VALUE value = left->GetOperand() | right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    case BIT_XOR_INT: {
+      INT_VALUE value = left->GetOperand() ^ right->GetOperand();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    }
+      break;
+
+    default:
+      break;
+    }
+  } 
+  else {
+    outputs->AddInstruction(instr);
+  }
+}
+
+IntermediateBlock* ItermediateOptimizer::FoldFloatConstants(IntermediateBlock* inputs)
+{
+  IntermediateBlock* outputs = new IntermediateBlock;
+  deque<IntermediateInstruction*> working_stack;
+
+  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+
+    switch(instr->GetType()) {
+    case LOAD_FLOAT_LIT:
+      working_stack.push_front(instr);
+      break;
+
+    case ADD_FLOAT:
+    case SUB_FLOAT:
+    case MUL_FLOAT:
+    case DIV_FLOAT:
+      CalculateFloatFold(instr, working_stack, outputs);
+      break;
+
+    default:
+      // add back in reverse order
+      while(!working_stack.empty()) {
+        outputs->AddInstruction(working_stack.back());
+        working_stack.pop_back();
+      }
+      outputs->AddInstruction(instr);
+      break;
+    }
+  }
+  // order matters...
+  while(!working_stack.empty()) {
+    outputs->AddInstruction(working_stack.back());
+    working_stack.pop_back();
+  }
+
+  return outputs;
+}
+
+void ItermediateOptimizer::CalculateFloatFold(IntermediateInstruction* instr,
+					      deque<IntermediateInstruction*> &working_stack,
+					      IntermediateBlock* outputs)
+{
+  if(working_stack.size() == 1) {
+    outputs->AddInstruction(working_stack.front());
+    working_stack.pop_front();
+    outputs->AddInstruction(instr);
+  } 
+  else if(working_stack.size() > 1) {
+    IntermediateInstruction* left = working_stack.front();
+    working_stack.pop_front();
+
+    IntermediateInstruction* right = working_stack.front();
+    working_stack.pop_front();
+
+    switch(instr->GetType()) {
+    case ADD_FLOAT: {
+      FLOAT_VALUE value = left->GetOperand4() + right->GetOperand4();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+    }
+      break;
+
+    case SUB_FLOAT: {
+      FLOAT_VALUE value = left->GetOperand4() - right->GetOperand4();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+    }
+      break;
+
+    case MUL_FLOAT: {
+      FLOAT_VALUE value = left->GetOperand4() * right->GetOperand4();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+    }
+      break;
+    
+    case DIV_FLOAT: {
+      FLOAT_VALUE value = left->GetOperand4() / right->GetOperand4();
+      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+    }
+      break;
+      
+    default:
+      break;
+    }
+  } 
+  else {
+    outputs->AddInstruction(instr);
+  }
+}
+
+/****************************
+ * Global optimizations over an
+ * SSA control-flow graph. Each
+ * pass rebuilds the graph from
+ * the previous pass's output.
+ ****************************/
+IntermediateBlock* ItermediateOptimizer::GlobalOptimization(IntermediateBlock* inputs)
+{
+  vector<IntermediateInstruction*> instrs = inputs->GetInstructions();
+  
+  // temporaries are allocated after the method's variables
+  int next_local = GetLastLocalOffset(current_method) + 2;
+  const int first_local = next_local;
+  const int space_local = current_method->GetSpace() / (int)sizeof(INT_VALUE);
+  if(space_local > next_local) {
+    next_local = space_local;
+  }
+  const int max_local = LOCAL_SIZE / (int)sizeof(INT_VALUE);
+  
+  // replace objects that do not escape
+  const int replaced = ReplaceAllocations(instrs, next_local, max_local);
+  if(replaced > 0) {
+    int allocations = replaced;
+    for(size_t i = 0; i < instrs.size(); ++i) {
+      if(instrs[i]->GetType() == NEW_OBJ_INST) {
+	allocations++;
+      }
+    }
+    wcout << L"Scalar replaced " << replaced << L" of " << allocations 
+	  << L" allocation(s): method='" << current_method->GetName() << L"'" << endl;
+  }
+  
+  bool changed = true;
+  for(int i = 0; changed && i < GLOBAL_OPT_PASSES; ++i) {
+    changed = false;
+    for(int j = 0; j < 4; ++j) {
+      FlowGraph graph(instrs, next_local, max_local);
+      if(!graph.Build()) {
+	changed = false;
+	break;
+      }
+      
+      bool is_changed;
+      switch(j) {
+	// constant and copy propagation
+      case 0:
+	is_changed = graph.PropagateValues();
+	break;
+	
+	// dead stores
+      case 1:
+	is_changed = graph.RemoveDeadStores();
+	break;
+	
+	// common subexpressions
+      case 2:
+	is_changed = graph.EliminateExpressions();
+	break;
+	
+	// loop invariants
+      default:
+	is_changed = graph.HoistInvariants();
+	break;
+      }
+      instrs = graph.Lower(is_changed);
+      next_local = graph.GetNextLocal();
+      
+      if(SimplifyInstructions(instrs)) {
+	is_changed = true;
+      }
+      FoldInstructions(instrs);
+      
+      if(is_changed) {
+	changed = true;
+      }
+    }
+  }
+  
+  // ajust local space for temporaries
+  if(next_local * (int)sizeof(INT_VALUE) > current_method->GetSpace()) {
+    current_method->SetSpace(next_local * sizeof(INT_VALUE));
+  }
+  
+  // declare temporaries, the JIT packs referenced locals 
+  // by id and the collector walks its frames by declaration
+  map<int, bool> temps;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+      if(instr->GetOperand2() == LOCL && instr->GetOperand() >= first_local) {
+	temps[instr->GetOperand()] = false;
+      }
+      break;
+
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+      if(instr->GetOperand2() == LOCL && instr->GetOperand() >= first_local) {
+	temps[instr->GetOperand()] = true;
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+  
+  IntermediateDeclarations* entries = current_method->GetEntries();
+  for(map<int, bool>::iterator iter = temps.begin(); iter != temps.end(); ++iter) {
+    wostringstream name;
+    name << current_method->GetName() << L":#tmp_" << iter->first;
+    entries->AddParameter(new IntermediateDeclaration(name.str(), iter->second ? FLOAT_PARM : INT_PARM));
+  }
+  
+  IntermediateBlock* outputs = new IntermediateBlock;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    outputs->AddInstruction(instrs[i]);
+  }
+  
+  return outputs;
+}
+
+/****************************
+ * Scalar replacement of objects
+ * that do not escape a method.
+ * An object qualifies if it's
+ * held by a single local that
+ * is only used to access its
+ * fields and its constructor
+ * can be inlined. Fields are
+ * moved into locals.
+ ****************************/
+int ItermediateOptimizer::ReplaceAllocations(vector<IntermediateInstruction*> &instrs, int &next_local, 
+					     const int max_local)
+{
+  FlowGraph graph(instrs, next_local, max_local);
+  if(!graph.Build()) {
+    return 0;
+  }
+  
+  // references to local variables
+  map<int, vector<size_t> > stores;
+  map<int, vector<size_t> > loads;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+      if(instr->GetOperand2() == LOCL) {
+	loads[instr->GetOperand()].push_back(i);
+      }
+      break;
+      
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+    case LOAD_FUNC_VAR:
+    case STOR_FUNC_VAR:
+      if(instr->GetOperand2() == LOCL) {
+	stores[instr->GetOperand()].push_back(i);
+      }
+      break;
+      
+    default:
+      break;
+    }
+  }
+  
+  // find allocations that do not escape
+  map<size_t, int> replaced_locals;
+  map<int, map<int, int> > field_slots;
+  map<int, int> ctor_slots;
+  set<int> float_slots;
+  for(size_t i = 0; i + 2 < instrs.size(); ++i) {
+    IntermediateInstruction* alloc = instrs[i];
+    IntermediateInstruction* call = instrs[i + 1];
+    IntermediateInstruction* store = instrs[i + 2];
+    if(alloc->GetType() != NEW_OBJ_INST || call->GetType() != MTHD_CALL || 
+       call->GetOperand() != alloc->GetOperand() || store->GetType() != STOR_INT_VAR || 
+       store->GetOperand2() != LOCL) {
+      continue;
+    }
+    
+    // single definition
+    const int local = store->GetOperand();
+    if(stores[local].size() != 1) {
+      continue;
+    }
+    
+    // fields set by the constructor
+    IntermediateClass* klass = program->GetClass(alloc->GetOperand());
+    IntermediateMethod* ctor = klass->GetMethod(call->GetOperand2());
+    set<int> fields;
+    int ctor_space = 0;
+    if(!CanReplaceConstructor(ctor, fields, ctor_space, 0)) {
+      continue;
+    }
+    
+    // fields accessed by uses
+    bool escapes = false;
+    vector<size_t> &uses = loads[local];
+    for(size_t j = 0; !escapes && j < uses.size(); ++j) {
+      const size_t use = uses[j];
+      if(use + 1 >= instrs.size() || !graph.DominatesInstruction(i + 2, use)) {
+	escapes = true;
+      }
       else {
-        AddBackReduction(instr, top_instr, working_stack, outputs);
+	IntermediateInstruction* access = instrs[use + 1];
+	if(IsFieldAccess(access)) {
+	  fields.insert(access->GetOperand());
+	}
+	else {
+	  escapes = true;
+	}
+      }
+    }
+    
+    // references held in locals would be hidden from the collector
+    map<int, ParamType> field_types;
+    GetMemoryTypes(klass->GetInstanceEntries(), field_types);
+    for(set<int>::iterator iter = fields.begin(); !escapes && iter != fields.end(); ++iter) {
+      map<int, ParamType>::iterator result = field_types.find(*iter);
+      if(result == field_types.end() || !IsScalarType(result->second)) {
+	escapes = true;
+      }
+    }
+    
+    if(escapes || next_local + (int)fields.size() * 2 + ctor_space > max_local) {
+      continue;
+    }
+    
+    // assign locals to fields and constructor variables
+    map<int, int> &slots = field_slots[local];
+    for(set<int>::iterator iter = fields.begin(); iter != fields.end(); ++iter) {
+      slots[*iter] = next_local;
+      if(field_types[*iter] == FLOAT_PARM) {
+	float_slots.insert(next_local);
+      }
+      next_local += 2;
+    }
+    ctor_slots[local] = next_local;
+    next_local += ctor_space;
+    
+    replaced_locals[i] = local;
+  }
+  
+  if(replaced_locals.empty()) {
+    return 0;
+  }
+  
+  // rewrite allocations and field accesses
+  vector<IntermediateInstruction*> outputs;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    const int line_num = instr->GetLineNumber();
+    
+    map<size_t, int>::iterator replaced = replaced_locals.find(i);
+    if(replaced != replaced_locals.end()) {
+      const int local = replaced->second;
+      map<int, int> &slots = field_slots[local];
+      
+      // fields start out zeroed
+      for(map<int, int>::iterator iter = slots.begin(); iter != slots.end(); ++iter) {
+	if(float_slots.find(iter->second) != float_slots.end()) {
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, LOAD_FLOAT_LIT, (FLOAT_VALUE)0.0));
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, STOR_FLOAT_VAR, iter->second, LOCL));
+	}
+	else {
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, LOAD_INT_LIT, 0));
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, STOR_INT_VAR, iter->second, LOCL));
+	}
+      }
+      
+      IntermediateInstruction* call = instrs[i + 1];
+      int ctor_base = ctor_slots[local];
+      InlineConstructor(program->GetClass(call->GetOperand())->GetMethod(call->GetOperand2()), 
+			slots, ctor_base, line_num, outputs);
+      
+      // keep the variable referenced for frame layout
+      outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, LOAD_INT_LIT, 0));
+      outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, STOR_INT_VAR, local, LOCL));
+      i += 2;
+    }
+    else if(instr->GetType() == LOAD_INT_VAR && instr->GetOperand2() == LOCL && 
+	    field_slots.find(instr->GetOperand()) != field_slots.end()) {
+      IntermediateInstruction* access = instrs[++i];
+      outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(access->GetLineNumber(), access->GetType(), 
+									 field_slots[instr->GetOperand()][access->GetOperand()], LOCL));
+    }
+    else {
+      outputs.push_back(instr);
+    }
+  }
+  instrs = outputs;
+  
+  return (int)replaced_locals.size();
+}
+
+/****************************
+ * Checks if a constructor only
+ * initializes its own fields,
+ * parent constructors are
+ * checked in turn
+ ****************************/
+bool ItermediateOptimizer::CanReplaceConstructor(IntermediateMethod* mthd, set<int> &fields, int &space, int depth)
+{
+  vector<IntermediateBlock*> blocks = mthd->GetBlocks();
+  if(depth > LOCL_INLINE_CTOR_MAX || blocks.size() != 1) {
+    return false;
+  }
+  
+  vector<IntermediateInstruction*> instrs = blocks[0]->GetInstructions();
+  if(instrs.size() < 2 || instrs[instrs.size() - 1]->GetType() != RTRN || 
+     instrs[instrs.size() - 2]->GetType() != LOAD_INST_MEM) {
+    return false;
+  }
+  
+  // variables must be visible to the collector
+  map<int, ParamType> types;
+  GetMemoryTypes(mthd->GetEntries(), types);
+  for(map<int, ParamType>::iterator iter = types.begin(); iter != types.end(); ++iter) {
+    if(!IsScalarType(iter->second)) {
+      return false;
+    }
+  }
+  
+  int local_space = 0;
+  for(size_t i = 0; i + 2 < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    switch(instr->GetType()) {
+    case LBL:
+    case JMP:
+    case TBL_SWITCH:
+    case RTRN:
+    case LOAD_FUNC_VAR:
+    case STOR_FUNC_VAR:
+      return false;
+      
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+      if(instr->GetOperand2() == LOCL && instr->GetOperand() + 2 > local_space) {
+	local_space = instr->GetOperand() + 2;
+      }
+      break;
+      
+    case LOAD_INST_MEM: {
+      IntermediateInstruction* next = instrs[i + 1];
+      // field access
+      if(IsFieldAccess(next)) {
+	fields.insert(next->GetOperand());
+	i++;
+      }
+      // parent constructor
+      else if(next->GetType() == MTHD_CALL && i + 3 < instrs.size() && instrs[i + 2]->GetType() == POP_INT) {
+	IntermediateMethod* parent = program->GetClass(next->GetOperand())->GetMethod(next->GetOperand2());
+	if(parent->GetName().find(L":New:") == wstring::npos || 
+	   !CanReplaceConstructor(parent, fields, space, depth + 1)) {
+	  return false;
+	}
+	i += 2;
+      }
+      else {
+	return false;
+      }
+    }
+      break;
+      
+    default:
+      break;
+    }
+  }
+  space += local_space;
+  
+  return true;
+}
+
+/****************************
+ * Inlines a constructor using
+ * locals in place of fields
+ ****************************/
+void ItermediateOptimizer::InlineConstructor(IntermediateMethod* mthd, map<int, int> &slots, int &base, 
+					     const int line_num, vector<IntermediateInstruction*> &outputs)
+{
+  vector<IntermediateInstruction*> instrs = mthd->GetBlocks()[0]->GetInstructions();
+  
+  // parent constructors follow this constructor's variables
+  const int local_base = base;
+  for(size_t i = 0; i + 2 < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+      if(instr->GetOperand2() == LOCL && local_base + instr->GetOperand() + 2 > base) {
+	base = local_base + instr->GetOperand() + 2;
+      }
+      break;
+      
+    default:
+      break;
+    }
+  }
+  
+  for(size_t i = 0; i + 2 < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+      if(instr->GetOperand2() == LOCL) {
+	outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, instr->GetType(), 
+									   local_base + instr->GetOperand(), LOCL));
+      }
+      else {
+	outputs.push_back(instr);
+      }
+      break;
+      
+    case LOAD_INST_MEM: {
+      IntermediateInstruction* next = instrs[++i];
+      if(next->GetType() == MTHD_CALL) {
+	InlineConstructor(program->GetClass(next->GetOperand())->GetMethod(next->GetOperand2()), 
+			  slots, base, line_num, outputs);
+	// skip the instance pop
+	i++;
+      }
+      else {
+	outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, next->GetType(), 
+									   slots[next->GetOperand()], LOCL));
+      }
+    }
+      break;
+      
+    default:
+      outputs.push_back(instr);
+      break;
+    }
+  }
+}
+
+/****************************
+ * Checks for an instance field
+ * load or store
+ ****************************/
+bool ItermediateOptimizer::IsFieldAccess(IntermediateInstruction* instr)
+{
+  switch(instr->GetType()) {
+  case LOAD_INT_VAR:
+  case STOR_INT_VAR:
+  case COPY_INT_VAR:
+  case LOAD_FLOAT_VAR:
+  case STOR_FLOAT_VAR:
+  case COPY_FLOAT_VAR:
+    return instr->GetOperand2() == INST;
+    
+  default:
+    return false;
+  }
+}
+
+/****************************
+ * Checks for types that can be
+ * held by temporaries
+ ****************************/
+bool ItermediateOptimizer::IsScalarType(ParamType type)
+{
+  switch(type) {
+  case CHAR_PARM:
+  case INT_PARM:
+  case FLOAT_PARM:
+    return true;
+    
+  default:
+    return false;
+  }
+}
+
+/****************************
+ * Maps variable ids to their
+ * declared types
+ ****************************/
+void ItermediateOptimizer::GetMemoryTypes(IntermediateDeclarations* entries, map<int, ParamType> &types)
+{
+  if(!entries) {
+    return;
+  }
+  
+  int id = 0;
+  vector<IntermediateDeclaration*> declarations = entries->GetParameters();
+  for(size_t i = 0; i < declarations.size(); ++i) {
+    const ParamType type = declarations[i]->GetType();
+    types[id] = type;
+    if(type == FLOAT_PARM || type == FUNC_PARM) {
+      id += 2;
+    }
+    else {
+      id++;
+    }
+  }
+}
+
+void ItermediateOptimizer::FoldInstructions(vector<IntermediateInstruction*> &instrs)
+{
+  IntermediateBlock* inputs = new IntermediateBlock;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    inputs->AddInstruction(instrs[i]);
+  }
+  
+  IntermediateBlock* folded_ints = FoldIntConstants(inputs);
+  IntermediateBlock* folded_floats = FoldFloatConstants(folded_ints);
+  instrs = folded_floats->GetInstructions();
+  
+  delete inputs;
+  inputs = NULL;
+  
+  delete folded_ints;
+  folded_ints = NULL;
+  
+  delete folded_floats;
+  folded_floats = NULL;
+}
+
+/****************************
+ * Peephole clean up after the
+ * global passes: folds compares
+ * and branches on literals and
+ * removes values that are only
+ * popped
+ ****************************/
+bool ItermediateOptimizer::SimplifyInstructions(vector<IntermediateInstruction*> &instrs)
+{
+  map<int, int> ref_counts;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    IntermediateInstruction* instr = instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+      if(instr->GetOperand2() == LOCL) {
+	ref_counts[instr->GetOperand()]++;
+      }
+      break;
+      
+    default:
+      break;
+    }
+  }
+  
+  bool changed = false;
+  vector<IntermediateInstruction*> outputs;
+  deque<IntermediateInstruction*> pending;
+  for(size_t i = 0; i < instrs.size(); ++i) {
+    pending.push_back(instrs[i]);
+    while(!pending.empty()) {
+      IntermediateInstruction* instr = pending.front();
+      pending.pop_front();
+      
+      IntermediateInstruction* top = outputs.empty() ? NULL : outputs.back();
+      IntermediateInstruction* next = outputs.size() < 2 ? NULL : outputs[outputs.size() - 2];
+      const int line_num = instr->GetLineNumber();
+      bool is_simplified = false;
+      
+      switch(instr->GetType()) {
+      case POP_INT:
+      case POP_FLOAT:
+	if(!top) {
+	  break;
+	}
+	switch(top->GetType()) {
+	case LOAD_INT_LIT:
+	case LOAD_FLOAT_LIT:
+	  outputs.pop_back();
+	  is_simplified = true;
+	  break;
+	  
+	case LOAD_INT_VAR:
+	case LOAD_FLOAT_VAR:
+	  if(top->GetOperand2() == LOCL && ref_counts[top->GetOperand()] > 1) {
+	    ref_counts[top->GetOperand()]--;
+	    outputs.pop_back();
+	    is_simplified = true;
+	  }
+	  break;
+	  
+	case COPY_INT_VAR:
+	  outputs.pop_back();
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, STOR_INT_VAR, top->GetOperand(), top->GetOperand2()));
+	  is_simplified = true;
+	  break;
+	  
+	case COPY_FLOAT_VAR:
+	  outputs.pop_back();
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, STOR_FLOAT_VAR, top->GetOperand(), top->GetOperand2()));
+	  is_simplified = true;
+	  break;
+	  
+	  // pop the operands instead
+	case EQL_INT:
+	case NEQL_INT:
+	case LES_INT:
+	case GTR_INT:
+	case LES_EQL_INT:
+	case GTR_EQL_INT:
+	case AND_INT:
+	case OR_INT:
+	case ADD_INT:
+	case SUB_INT:
+	case MUL_INT:
+	case BIT_AND_INT:
+	case BIT_OR_INT:
+	case BIT_XOR_INT:
+	case SHL_INT:
+	case SHR_INT:
+	  outputs.pop_back();
+	  pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_INT));
+	  pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_INT));
+	  is_simplified = true;
+	  break;
+	  
+	case EQL_FLOAT:
+	case NEQL_FLOAT:
+	case LES_FLOAT:
+	case GTR_FLOAT:
+	case LES_EQL_FLOAT:
+	case GTR_EQL_FLOAT:
+	case ADD_FLOAT:
+	case SUB_FLOAT:
+	case MUL_FLOAT:
+	case DIV_FLOAT:
+	case POW_FLOAT:
+	  outputs.pop_back();
+	  pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_FLOAT));
+	  pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_FLOAT));
+	  is_simplified = true;
+	  break;
+	  
+	case FLOR_FLOAT:
+	case CEIL_FLOAT:
+	case SIN_FLOAT:
+	case COS_FLOAT:
+	case TAN_FLOAT:
+	case ASIN_FLOAT:
+	case ACOS_FLOAT:
+	case ATAN_FLOAT:
+	case LOG_FLOAT:
+	case SQRT_FLOAT:
+	case F2I:
+	  outputs.pop_back();
+	  pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_FLOAT));
+	  is_simplified = true;
+	  break;
+	  
+	case I2F:
+	  outputs.pop_back();
+	  pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_INT));
+	  is_simplified = true;
+	  break;
+	  
+	default:
+	  break;
+	}
+	break;
+	
+	// compares of literals, top of stack is the left-hand value
+      case EQL_INT:
+      case NEQL_INT:
+      case LES_INT:
+      case GTR_INT:
+      case LES_EQL_INT:
+      case GTR_EQL_INT:
+      case AND_INT:
+      case OR_INT:
+	if(top && next && top->GetType() == LOAD_INT_LIT && next->GetType() == LOAD_INT_LIT) {
+	  const INT_VALUE left = top->GetOperand();
+	  const INT_VALUE right = next->GetOperand();
+	  INT_VALUE value;
+	  switch(instr->GetType()) {
+	  case EQL_INT:
+	    value = left == right;
+	    break;
+	    
+	  case NEQL_INT:
+	    value = left != right;
+	    break;
+	    
+	  case LES_INT:
+	    value = left < right;
+	    break;
+	    
+	  case GTR_INT:
+	    value = left > right;
+	    break;
+	    
+	  case LES_EQL_INT:
+	    value = left <= right;
+	    break;
+	    
+	  case GTR_EQL_INT:
+	    value = left >= right;
+	    break;
+	    
+	  case AND_INT:
+	    value = left && right;
+	    break;
+	    
+	  default:
+	    value = left || right;
+	    break;
+	  }
+	  outputs.pop_back();
+	  outputs.pop_back();
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, LOAD_INT_LIT, value));
+	  is_simplified = true;
+	}
+	break;
+	
+      case EQL_FLOAT:
+      case NEQL_FLOAT:
+      case LES_FLOAT:
+      case GTR_FLOAT:
+      case LES_EQL_FLOAT:
+      case GTR_EQL_FLOAT:
+	if(top && next && top->GetType() == LOAD_FLOAT_LIT && next->GetType() == LOAD_FLOAT_LIT) {
+	  const FLOAT_VALUE left = top->GetOperand4();
+	  const FLOAT_VALUE right = next->GetOperand4();
+	  INT_VALUE value;
+	  switch(instr->GetType()) {
+	  case EQL_FLOAT:
+	    value = left == right;
+	    break;
+	    
+	  case NEQL_FLOAT:
+	    value = left != right;
+	    break;
+	    
+	  case LES_FLOAT:
+	    value = left < right;
+	    break;
+	    
+	  case GTR_FLOAT:
+	    value = left > right;
+	    break;
+	    
+	  case LES_EQL_FLOAT:
+	    value = left <= right;
+	    break;
+	    
+	  default:
+	    value = left >= right;
+	    break;
+	  }
+	  outputs.pop_back();
+	  outputs.pop_back();
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, LOAD_INT_LIT, value));
+	  is_simplified = true;
+	}
+	break;
+	
+      case I2F:
+	if(top && top->GetType() == LOAD_INT_LIT) {
+	  const FLOAT_VALUE value = top->GetOperand();
+	  outputs.pop_back();
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, LOAD_FLOAT_LIT, value));
+	  is_simplified = true;
+	}
+	break;
+	
+	// branches on literals
+      case JMP:
+	if(instr->GetOperand2() > -1 && top && top->GetType() == LOAD_INT_LIT) {
+	  outputs.pop_back();
+	  if(top->GetOperand() == instr->GetOperand2()) {
+	    outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, JMP, instr->GetOperand(), -1));
+	  }
+	  is_simplified = true;
+	}
+	break;
+	
+	// table branches on literals
+      case TBL_SWITCH:
+	if(top && top->GetType() == LOAD_INT_LIT) {
+	  vector<int> table = instr->GetTable();
+	  const unsigned int index = (unsigned int)top->GetOperand() - (unsigned int)instr->GetOperand();
+	  outputs.pop_back();
+	  outputs.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, JMP, 
+									     index < table.size() ? table[index] : instr->GetOperand2(), -1));
+	  is_simplified = true;
+	}
+	break;
+	
+	// jumps to the next instruction
+      case LBL:
+	if(top && top->GetType() == JMP && top->GetOperand() == instr->GetOperand()) {
+	  outputs.pop_back();
+	  pending.push_front(instr);
+	  if(top->GetOperand2() > -1) {
+	    pending.push_front(IntermediateFactory::Instance()->MakeInstruction(line_num, POP_INT));
+	  }
+	  is_simplified = true;
+	}
+	break;
+	
+      default:
+	break;
+      }
+      
+      if(is_simplified) {
+	changed = true;
       }
-    } 
-    else if(working_stack.front()->GetType() == LOAD_INT_LIT) {
-      if(top_instr->GetType() == LOAD_INT_VAR) {
-        ApplyReduction(working_stack.front(), instr, top_instr, working_stack, outputs);
-      } 
       else {
-        AddBackReduction(instr, top_instr, working_stack, outputs);
+	outputs.push_back(instr);
       }
-    } 
-    else {
-      AddBackReduction(instr, top_instr, working_stack, outputs);
     }
-  } 
-  else {
-    // order matters...
-    while(!working_stack.empty()) {
-      outputs->AddInstruction(working_stack.back());
-      working_stack.pop_back();
+  }
+  instrs = outputs;
+  
+  return changed;
+}
+
+/****************************
+ * FlowGraph class
+ ****************************/
+bool FlowGraph::IsLocal(IntermediateInstruction* instr)
+{
+  switch(instr->GetType()) {
+  case LOAD_INT_VAR:
+  case STOR_INT_VAR:
+  case COPY_INT_VAR:
+  case LOAD_FLOAT_VAR:
+  case STOR_FLOAT_VAR:
+  case COPY_FLOAT_VAR:
+    return instr->GetOperand2() == LOCL && instr->GetOperand() > -1;
+    
+  default:
+    return false;
+  }
+}
+
+bool FlowGraph::IsLoad(IntermediateInstruction* instr)
+{
+  return (instr->GetType() == LOAD_INT_VAR || instr->GetType() == LOAD_FLOAT_VAR) && IsLocal(instr);
+}
+
+bool FlowGraph::IsStore(IntermediateInstruction* instr)
+{
+  switch(instr->GetType()) {
+  case STOR_INT_VAR:
+  case COPY_INT_VAR:
+  case STOR_FLOAT_VAR:
+  case COPY_FLOAT_VAR:
+    return IsLocal(instr);
+    
+  default:
+    return false;
+  }
+}
+
+// the last reference to a variable is never removed, since
+// the JIT lays out the stack frame from referenced variables
+bool FlowGraph::RemoveReference(IntermediateInstruction* instr)
+{
+  if(!IsLocal(instr)) {
+    return true;
+  }
+  
+  const int slot = instr->GetOperand();
+  if(ref_counts[slot] < 2) {
+    return false;
+  }
+  ref_counts[slot]--;
+  
+  return true;
+}
+
+void FlowGraph::AddReference(IntermediateInstruction* instr)
+{
+  if(IsLocal(instr)) {
+    const int slot = instr->GetOperand();
+    if(slot >= (int)ref_counts.size()) {
+      ref_counts.resize(slot + 1, 0);
     }
-    outputs->AddInstruction(instr);
+    ref_counts[slot]++;
   }
 }
 
-void ItermediateOptimizer::ApplyReduction(IntermediateInstruction* test, 
-					  IntermediateInstruction* instr, 
-					  IntermediateInstruction* top_instr,
-					  deque<IntermediateInstruction*> &working_stack, 
-					  IntermediateBlock* outputs)
+int FlowGraph::GetArity(IntermediateInstruction* instr)
 {
-  int shift = 0;
-  switch(test->GetOperand()) {
-  case 2:
-    shift = 1;
-    break;
+  switch(instr->GetType()) {
+  case LOAD_INT_LIT:
+  case LOAD_FLOAT_LIT:
+    return 0;
+    
+  case I2F:
+  case F2I:
+  case FLOR_FLOAT:
+  case CEIL_FLOAT:
+  case SIN_FLOAT:
+  case COS_FLOAT:
+  case TAN_FLOAT:
+  case ASIN_FLOAT:
+  case ACOS_FLOAT:
+  case ATAN_FLOAT:
+  case LOG_FLOAT:
+  case SQRT_FLOAT:
+    return 1;
+    
+  case EQL_INT:
+  case NEQL_INT:
+  case LES_INT:
+  case GTR_INT:
+  case LES_EQL_INT:
+  case GTR_EQL_INT:
+  case EQL_FLOAT:
+  case NEQL_FLOAT:
+  case LES_FLOAT:
+  case GTR_FLOAT:
+  case LES_EQL_FLOAT:
+  case GTR_EQL_FLOAT:
+  case AND_INT:
+  case OR_INT:
+  case ADD_INT:
+  case SUB_INT:
+  case MUL_INT:
+  case DIV_INT:
+  case MOD_INT:
+  case BIT_AND_INT:
+  case BIT_OR_INT:
+  case BIT_XOR_INT:
+  case SHL_INT:
+  case SHR_INT:
+  case ADD_FLOAT:
+  case SUB_FLOAT:
+  case MUL_FLOAT:
+  case DIV_FLOAT:
+  case POW_FLOAT:
+    return 2;
+    
+  default:
+    return -1;
+  }
+}
 
-  case 4:
-    shift = 2;
-    break;
+bool FlowGraph::IsFloatResult(IntermediateInstruction* instr)
+{
+  switch(instr->GetType()) {
+  case LOAD_FLOAT_LIT:
+  case LOAD_FLOAT_VAR:
+  case I2F:
+  case FLOR_FLOAT:
+  case CEIL_FLOAT:
+  case SIN_FLOAT:
+  case COS_FLOAT:
+  case TAN_FLOAT:
+  case ASIN_FLOAT:
+  case ACOS_FLOAT:
+  case ATAN_FLOAT:
+  case LOG_FLOAT:
+  case SQRT_FLOAT:
+  case ADD_FLOAT:
+  case SUB_FLOAT:
+  case MUL_FLOAT:
+  case DIV_FLOAT:
+  case POW_FLOAT:
+    return true;
+    
+  default:
+    return false;
+  }
+}
 
-  case 8:
-    shift = 3;
-    break;
+int FlowGraph::NewValue(int slot, int block, SsaValueKind kind)
+{
+  SsaValue value;
+  value.slot = slot;
+  value.block = block;
+  value.kind = kind;
+  value.source = -1;
+  value.state = kind == SSA_ENTRY ? SSA_BOTTOM : SSA_TOP;
+  value.int_value = 0;
+  value.float_value = 0.0;
+  values.push_back(value);
+  
+  return (int)values.size() - 1;
+}
 
-  case 16:
-    shift = 4;
-    break;
+int FlowGraph::NewLocal(bool is_float)
+{
+  // floats take two slots
+  const int size = is_float ? 2 : 1;
+  if(next_local + size > max_local) {
+    return -1;
+  }
+  
+  const int local = next_local;
+  next_local += size;
+  
+  return local;
+}
 
-  case 32:
-    shift = 5;
-    break;
+bool FlowGraph::Build()
+{
+  // find variables that are only accessed as a single scalar type
+  int max_id = 0;
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+    case LOAD_FUNC_VAR:
+    case STOR_FUNC_VAR:
+    case COPY_FUNC_VAR:
+      if(instr->GetOperand2() == LOCL && instr->GetOperand() + 2 > max_id) {
+	max_id = instr->GetOperand() + 2;
+      }
+      break;
+      
+    default:
+      break;
+    }
+  }
+  slot_types.assign(max_id + 1, SLOT_NONE);
+  ref_counts.assign(max_id + 1, 0);
+  
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+    const int slot = instr->GetOperand();
+    switch(instr->GetType()) {
+    case LOAD_INT_VAR:
+    case STOR_INT_VAR:
+    case COPY_INT_VAR:
+      if(instr->GetOperand2() != LOCL || slot < 0) {
+	break;
+      }
+      slot_types[slot] = slot_types[slot] == SLOT_NONE || slot_types[slot] == SLOT_INT ? SLOT_INT : SLOT_MIXED;
+      ref_counts[slot]++;
+      break;
+      
+    case LOAD_FLOAT_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_FLOAT_VAR:
+      if(instr->GetOperand2() != LOCL || slot < 0) {
+	break;
+      }
+      slot_types[slot] = slot_types[slot] == SLOT_NONE || slot_types[slot] == SLOT_FLOAT ? SLOT_FLOAT : SLOT_MIXED;
+      ref_counts[slot]++;
+      break;
+      
+    case LOAD_FUNC_VAR:
+    case STOR_FUNC_VAR:
+    case COPY_FUNC_VAR:
+      if(instr->GetOperand2() != LOCL || slot < 0) {
+	break;
+      }
+      slot_types[slot] = SLOT_MIXED;
+      slot_types[slot + 1] = SLOT_MIXED;
+      break;
+      
+    default:
+      break;
+    }
+  }
+  
+  // floats overlap the next slot
+  for(size_t i = 0; i + 1 < slot_types.size(); ++i) {
+    if(slot_types[i] == SLOT_FLOAT && slot_types[i + 1] != SLOT_NONE) {
+      slot_types[i] = SLOT_MIXED;
+      slot_types[i + 1] = SLOT_MIXED;
+    }
+  }
+  
+  // parameter stores must lead the method
+  protect = 0;
+  while(protect < input_instrs.size() && (input_instrs[protect]->GetType() == STOR_INT_VAR ||
+					   input_instrs[protect]->GetType() == STOR_FLOAT_VAR ||
+					   input_instrs[protect]->GetType() == STOR_FUNC_VAR)) {
+    protect++;
+  }
+  
+  if(!BuildBlocks()) {
+    return false;
+  }
+  CalculateDominators();
+  PlacePhis();
+  
+  // rename variables
+  slot_stacks.assign(slot_types.size(), vector<int>());
+  for(size_t i = 0; i < slot_types.size(); ++i) {
+    if(slot_types[i] == SLOT_INT || slot_types[i] == SLOT_FLOAT) {
+      slot_stacks[i].push_back(NewValue(i, -1, SSA_ENTRY));
+    }
+  }
+  Rename(0);
+  
+  return true;
+}
 
-  case 64:
-    shift = 6;
-    break;
+bool FlowGraph::BuildBlocks()
+{
+  // split instructions at labels, jumps and returns
+  FlowBlock* block = NULL;
+  for(size_t i = 0; i < input_instrs.size(); ++i) {
+    IntermediateInstruction* instr = input_instrs[i];
+    if(!block || (instr->GetType() == LBL && !block->instrs.empty())) {
+      block = new FlowBlock;
+      block->start = i;
+      block->label = -1;
+      block->idom = -1;
+      block->order = -1;
+      block->is_reachable = false;
+      block->is_executable = false;
+      blocks.push_back(block);
+    }
+    
+    if(instr->GetType() == LBL) {
+      if(labels.find(instr->GetOperand()) != labels.end()) {
+	return false;
+      }
+      labels[instr->GetOperand()] = (int)blocks.size() - 1;
+      block->label = instr->GetOperand();
+    }
+    block->instrs.push_back(instr);
+    block->versions.push_back(-1);
+    
+    if(instr->GetType() == JMP || instr->GetType() == TBL_SWITCH || instr->GetType() == RTRN) {
+      block = NULL;
+    }
+  }
+  
+  if(blocks.empty()) {
+    return false;
+  }
+  
+  // successors, jump target first
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    block = blocks[i];
+    IntermediateInstruction* last = block->instrs.back();
+    if(last->GetType() == JMP) {
+      map<int, int>::iterator result = labels.find(last->GetOperand());
+      if(result == labels.end()) {
+	return false;
+      }
+      block->succs.push_back(result->second);
+      if(last->GetOperand2() > -1 && i + 1 < blocks.size()) {
+	block->succs.push_back(i + 1);
+      }
+    }
+    else if(last->GetType() == TBL_SWITCH) {
+      vector<int> targets = last->GetTable();
+      targets.push_back(last->GetOperand2());
+      for(size_t j = 0; j < targets.size(); ++j) {
+	map<int, int>::iterator result = labels.find(targets[j]);
+	if(result == labels.end()) {
+	  return false;
+	}
+	if(find(block->succs.begin(), block->succs.end(), result->second) == block->succs.end()) {
+	  block->succs.push_back(result->second);
+	}
+      }
+    }
+    else if(last->GetType() != RTRN && i + 1 < blocks.size()) {
+      block->succs.push_back(i + 1);
+    }
+  }
+  
+  // reverse post order of reachable blocks
+  vector<int> post_order;
+  vector<size_t> next_succs(blocks.size(), 0);
+  vector<int> work;
+  blocks[0]->is_reachable = true;
+  work.push_back(0);
+  while(!work.empty()) {
+    block = blocks[work.back()];
+    if(next_succs[work.back()] < block->succs.size()) {
+      const int succ = block->succs[next_succs[work.back()]++];
+      if(!blocks[succ]->is_reachable) {
+	blocks[succ]->is_reachable = true;
+	work.push_back(succ);
+      }
+    }
+    else {
+      post_order.push_back(work.back());
+      work.pop_back();
+    }
+  }
+  rpo.assign(post_order.rbegin(), post_order.rend());
+  
+  for(size_t i = 0; i < rpo.size(); ++i) {
+    block = blocks[rpo[i]];
+    block->order = i;
+    block->is_executable = true;
+  }
+  
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    if(blocks[i]->is_reachable) {
+      for(size_t j = 0; j < blocks[i]->succs.size(); ++j) {
+	blocks[blocks[i]->succs[j]]->preds.push_back(i);
+      }
+    }
+  }
+  
+  return true;
+}
 
-  case 128:
-    shift = 7;
-    break;
+int FlowGraph::Intersect(int b1, int b2)
+{
+  while(b1 != b2) {
+    while(blocks[b1]->order > blocks[b2]->order) {
+      b1 = blocks[b1]->idom;
+    }
+    while(blocks[b2]->order > blocks[b1]->order) {
+      b2 = blocks[b2]->idom;
+    }
+  }
+  
+  return b1;
+}
 
-  case 256:
-    shift = 8;
-    break;
+void FlowGraph::CalculateDominators()
+{
+  blocks[0]->idom = 0;
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(size_t i = 1; i < rpo.size(); ++i) {
+      FlowBlock* block = blocks[rpo[i]];
+      int idom = -1;
+      for(size_t j = 0; j < block->preds.size(); ++j) {
+	const int pred = block->preds[j];
+	if(blocks[pred]->idom > -1) {
+	  idom = idom < 0 ? pred : Intersect(pred, idom);
+	}
+      }
+      
+      if(block->idom != idom) {
+	block->idom = idom;
+	changed = true;
+      }
+    }
+  }
+  
+  // dominator tree and frontiers
+  for(size_t i = 1; i < rpo.size(); ++i) {
+    blocks[blocks[rpo[i]]->idom]->children.push_back(rpo[i]);
+  }
+  
+  for(size_t i = 0; i < rpo.size(); ++i) {
+    FlowBlock* block = blocks[rpo[i]];
+    if(block->preds.size() > 1) {
+      for(size_t j = 0; j < block->preds.size(); ++j) {
+	int runner = block->preds[j];
+	while(runner != block->idom) {
+	  vector<int> &frontier = blocks[runner]->frontier;
+	  if(find(frontier.begin(), frontier.end(), rpo[i]) == frontier.end()) {
+	    frontier.push_back(rpo[i]);
+	  }
+	  // entry block
+	  if(runner == blocks[runner]->idom) {
+	    break;
+	  }
+	  runner = blocks[runner]->idom;
+	}
+      }
+    }
+  }
+}
 
-  default:
-    AddBackReduction(instr, top_instr, working_stack, outputs);
-    break;
+void FlowGraph::PlacePhis()
+{
+  // blocks that define variables
+  vector< vector<int> > def_blocks(slot_types.size());
+  for(size_t i = 0; i < rpo.size(); ++i) {
+    FlowBlock* block = blocks[rpo[i]];
+    for(size_t j = 0; j < block->instrs.size(); ++j) {
+      IntermediateInstruction* instr = block->instrs[j];
+      if(IsStore(instr)) {
+	vector<int> &defs = def_blocks[instr->GetOperand()];
+	if(defs.empty() || defs.back() != rpo[i]) {
+	  defs.push_back(rpo[i]);
+	}
+      }
+    }
+  }
+  
+  for(size_t i = 0; i < slot_types.size(); ++i) {
+    if((slot_types[i] != SLOT_INT && slot_types[i] != SLOT_FLOAT) || def_blocks[i].empty()) {
+      continue;
+    }
+    
+    vector<bool> has_phi(blocks.size(), false);
+    vector<bool> is_queued(blocks.size(), false);
+    vector<int> work = def_blocks[i];
+    for(size_t j = 0; j < work.size(); ++j) {
+      is_queued[work[j]] = true;
+    }
+    
+    while(!work.empty()) {
+      const int b = work.back();
+      work.pop_back();
+      
+      vector<int> &frontier = blocks[b]->frontier;
+      for(size_t j = 0; j < frontier.size(); ++j) {
+	const int y = frontier[j];
+	if(!has_phi[y]) {
+	  has_phi[y] = true;
+	  const int v = NewValue(i, y, SSA_PHI);
+	  values[v].args.assign(blocks[y]->preds.size(), -1);
+	  blocks[y]->phis[i] = v;
+	  if(!is_queued[y]) {
+	    is_queued[y] = true;
+	    work.push_back(y);
+	  }
+	}
+      }
+    }
+  }
+}
+
+void FlowGraph::Rename(int b)
+{
+  FlowBlock* block = blocks[b];
+  vector<int> pushed;
+  
+  for(map<int, int>::iterator iter = block->phis.begin(); iter != block->phis.end(); ++iter) {
+    slot_stacks[iter->first].push_back(iter->second);
+    pushed.push_back(iter->first);
+  }
+  
+  for(size_t i = 0; i < block->instrs.size(); ++i) {
+    IntermediateInstruction* instr = block->instrs[i];
+    if(!IsLocal(instr)) {
+      continue;
+    }
+    
+    const int slot = instr->GetOperand();
+    if(slot_types[slot] != SLOT_INT && slot_types[slot] != SLOT_FLOAT) {
+      continue;
+    }
+    
+    if(IsLoad(instr)) {
+      int version = slot_stacks[slot].back();
+      
+      // copy propagation, the source must still be held by its variable
+      int source = version;
+      while(values[source].kind == SSA_COPY) {
+	const int next = values[source].source;
+	if(slot_stacks[values[next].slot].back() != next) {
+	  break;
+	}
+	source = next;
+      }
+      
+      if(source != version && values[source].slot != slot && RemoveReference(instr)) {
+	IntermediateInstruction* load = IntermediateFactory::Instance()->MakeInstruction(instr->GetLineNumber(), instr->GetType(),
+											 values[source].slot, LOCL);
+	AddReference(load);
+	block->instrs[i] = load;
+	version = source;
+      }
+      block->versions[i] = version;
+    }
+    else {
+      // store or copy, value kind given by the instruction that pushed it
+      SsaValueKind kind = SSA_OTHER;
+      int source = -1;
+      if(i > 0) {
+	IntermediateInstruction* prev = block->instrs[i - 1];
+	if(prev->GetType() == LOAD_INT_LIT && slot_types[slot] == SLOT_INT) {
+	  kind = SSA_INT_CONST;
+	}
+	else if(prev->GetType() == LOAD_FLOAT_LIT && slot_types[slot] == SLOT_FLOAT) {
+	  kind = SSA_FLOAT_CONST;
+	}
+	else if((IsLoad(prev) || prev->GetType() == COPY_INT_VAR || prev->GetType() == COPY_FLOAT_VAR) && 
+		block->versions[i - 1] > -1 && slot_types[prev->GetOperand()] == slot_types[slot]) {
+	  kind = SSA_COPY;
+	  source = block->versions[i - 1];
+	}
+      }
+      
+      const int version = NewValue(slot, b, kind);
+      if(kind == SSA_INT_CONST) {
+	values[version].int_value = block->instrs[i - 1]->GetOperand();
+      }
+      else if(kind == SSA_FLOAT_CONST) {
+	values[version].float_value = block->instrs[i - 1]->GetOperand4();
+      }
+      values[version].source = source;
+      
+      slot_stacks[slot].push_back(version);
+      pushed.push_back(slot);
+      block->versions[i] = version;
+    }
+  }
+  
+  // phi arguments of successors
+  for(size_t i = 0; i < block->succs.size(); ++i) {
+    FlowBlock* succ = blocks[block->succs[i]];
+    for(size_t j = 0; j < succ->preds.size(); ++j) {
+      if(succ->preds[j] == b) {
+	for(map<int, int>::iterator iter = succ->phis.begin(); iter != succ->phis.end(); ++iter) {
+	  values[iter->second].args[j] = slot_stacks[iter->first].back();
+	}
+      }
+    }
+  }
+  
+  for(size_t i = 0; i < block->children.size(); ++i) {
+    Rename(block->children[i]);
+  }
+  
+  for(size_t i = 0; i < pushed.size(); ++i) {
+    slot_stacks[pushed[i]].pop_back();
   }
+}
 
-  deque<IntermediateInstruction*> rewrite_instrs;
-  if(shift) {
-    rewrite_instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, shift));
-    // exclude literal
-    if(working_stack.front()->GetType() != LOAD_INT_LIT) {
-      rewrite_instrs.push_back(working_stack.front());
+bool FlowGraph::Dominates(int a, int b)
+{
+  while(b != a) {
+    // entry block
+    if(b == blocks[b]->idom) {
+      return false;
     }
-    if(top_instr->GetType() != LOAD_INT_LIT) {
-      rewrite_instrs.push_back(top_instr);
+    b = blocks[b]->idom;
+  }
+  
+  return true;
+}
+
+/****************************
+ * Checks if an instruction is
+ * always executed before another
+ ****************************/
+bool FlowGraph::DominatesInstruction(size_t from, size_t to)
+{
+  int from_block = 0;
+  int to_block = 0;
+  for(size_t i = 1; i < blocks.size(); ++i) {
+    if(blocks[i]->start <= (int)from) {
+      from_block = i;
     }
-    working_stack.pop_front();
-    // shift left or right
-    if(instr->GetType() == MUL_INT) {
-      rewrite_instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, SHL_INT, shift));
-    } 
-    else {
-      rewrite_instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, SHR_INT, shift));
+    if(blocks[i]->start <= (int)to) {
+      to_block = i;
     }
   }
   
-  // add original instructions
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
+  if(!blocks[to_block]->is_reachable) {
+    return true;
   }
   
-  // add rewritten instructions
-  for(size_t i = 0; i < rewrite_instrs.size(); ++i) {
-    outputs->AddInstruction(rewrite_instrs[i]);
+  if(!blocks[from_block]->is_reachable) {
+    return false;
+  }
+  
+  if(from_block == to_block) {
+    return from < to;
   }
+  
+  return Dominates(from_block, to_block);
 }
 
-void ItermediateOptimizer::AddBackReduction(IntermediateInstruction* instr, IntermediateInstruction* top_instr,
-					    deque<IntermediateInstruction*> &working_stack, IntermediateBlock* outputs)
+/****************************
+ * Constant and copy propagation,
+ * branches are only followed
+ * when their condition is not
+ * constant
+ ****************************/
+void FlowGraph::MeetValue(SsaValue &value, SsaState state, INT_VALUE i, FLOAT_VALUE f)
 {
-  // order matters...
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
+  if(value.state == SSA_BOTTOM || state == SSA_TOP) {
+    return;
+  }
+  
+  if(state == SSA_BOTTOM) {
+    value.state = SSA_BOTTOM;
+  }
+  else if(value.state == SSA_TOP) {
+    value.state = SSA_CONST;
+    value.int_value = i;
+    value.float_value = f;
+  }
+  else if(slot_types[value.slot] == SLOT_FLOAT) {
+    if(memcmp(&value.float_value, &f, sizeof(FLOAT_VALUE))) {
+      value.state = SSA_BOTTOM;
+    }
+  }
+  else if(value.int_value != i) {
+    value.state = SSA_BOTTOM;
   }
-  outputs->AddInstruction(top_instr);
-  outputs->AddInstruction(instr);
 }
 
-IntermediateBlock* ItermediateOptimizer::InlineMethod(IntermediateBlock* inputs)
+void FlowGraph::EvaluateValue(int v)
 {
-  set<IntermediateMethod*> inlined_mthds;
-  IntermediateBlock* outputs = new IntermediateBlock;
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-
-  set<int> lbl_jmp_offsets;
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-    switch(instr->GetType()) {
-    case LBL:
-    case JMP:
-      lbl_jmp_offsets.insert(instr->GetOperand());
-      break;
+  SsaValue &value = values[v];
+  switch(value.kind) {
+  case SSA_INT_CONST:
+  case SSA_FLOAT_CONST:
+    MeetValue(value, SSA_CONST, value.int_value, value.float_value);
+    break;
+    
+  case SSA_COPY: {
+    SsaValue &source = values[value.source];
+    MeetValue(value, source.state, source.int_value, source.float_value);
+  }
+    break;
+    
+  default:
+    value.state = SSA_BOTTOM;
+    break;
+  }
+}
 
-    default:
-      break;
-    }
+SsaState FlowGraph::GetCondition(FlowBlock* block, INT_VALUE &value)
+{
+  const size_t size = block->instrs.size();
+  if(size < 2) {
+    return SSA_BOTTOM;
   }
-  lbl_jmp_offsets.insert(unconditional_label + 1);
   
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
+  IntermediateInstruction* instr = block->instrs[size - 2];
+  if(instr->GetType() == LOAD_INT_LIT) {
+    value = instr->GetOperand();
+    return SSA_CONST;
+  }
+  
+  const int version = block->versions[size - 2];
+  if(instr->GetType() == LOAD_INT_VAR && version > -1) {
+    value = values[version].int_value;
+    return values[version].state;
+  }
+  
+  return SSA_BOTTOM;
+}
 
-    if(instr->GetType() == MTHD_CALL) {
-      IntermediateMethod* mthd_called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
-      // checked called method to determine if it can be inlined
-      if(CanInlineMethod(mthd_called, inlined_mthds, lbl_jmp_offsets)) {
-	// calculate local offset, +2 in case last variable is a double 
-	int local_instr_offset = GetLastLocalOffset(current_method) + 2;
-	
-	// ajust local space
-	current_method->SetSpace(current_method->GetSpace() + sizeof(INT_VALUE) * 2 + mthd_called->GetSpace());
-	
-	// fetch inline instructions for called method
-	// vector<IntermediateBlock*> mthd_called_blocks = OptimizeMethod(mthd_called->GetBlocks());
-	vector<IntermediateBlock*> mthd_called_blocks = mthd_called->GetBlocks();
-	vector<IntermediateInstruction*> mthd_called_instrs = mthd_called_blocks[0]->GetInstructions();
-	
-	// handle the storing of local instance
-	// TODO: might be a better way to do this given the constrains
-	outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, STOR_INT_VAR,
-										 local_instr_offset, LOCL));
+bool FlowGraph::PropagateValues()
+{
+  vector< vector<bool> > edges(blocks.size());
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    edges[i].assign(blocks[i]->preds.size(), false);
+    blocks[i]->is_executable = false;
+  }
+  blocks[0]->is_executable = true;
+  
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(size_t i = 0; i < rpo.size(); ++i) {
+      const int b = rpo[i];
+      FlowBlock* block = blocks[b];
+      if(!block->is_executable) {
+	continue;
+      }
+      
+      // phi values from executable edges
+      for(map<int, int>::iterator iter = block->phis.begin(); iter != block->phis.end(); ++iter) {
+	SsaValue &value = values[iter->second];
+	const SsaState state = value.state;
+	for(size_t j = 0; j < value.args.size(); ++j) {
+	  if(edges[b][j] && value.args[j] > -1) {
+	    SsaValue &arg = values[value.args[j]];
+	    MeetValue(value, arg.state, arg.int_value, arg.float_value);
+	  }
+	}
+	if(value.state != state) {
+	  changed = true;
+	}
+      }
+      
+      // stored values
+      for(size_t j = 0; j < block->instrs.size(); ++j) {
+	const int version = block->versions[j];
+	if(version > -1 && IsStore(block->instrs[j])) {
+	  const SsaState state = values[version].state;
+	  EvaluateValue(version);
+	  if(values[version].state != state) {
+	    changed = true;
+	  }
+	}
+      }
+      
+      // executable edges
+      IntermediateInstruction* last = block->instrs.back();
+      for(size_t j = 0; j < block->succs.size(); ++j) {
+	bool is_taken = true;
+	if(last->GetType() == JMP && last->GetOperand2() > -1) {
+	  INT_VALUE value = 0;
+	  const SsaState state = GetCondition(block, value);
+	  if(state == SSA_TOP) {
+	    is_taken = false;
+	  }
+	  else if(state == SSA_CONST) {
+	    const bool is_jump = value == last->GetOperand2();
+	    is_taken = j == 0 ? is_jump : !is_jump;
+	  }
+	}
 	
-	// inline instructions
-	// TODO: inline methods with multiple return values
-	// bool found_rtrn = false;
-	// int end = ++unconditional_label;
-	for(size_t j = 0; j < mthd_called_instrs.size() - 1; j++) {
-	  IntermediateInstruction* mthd_called_instr = mthd_called_instrs[j];
-	  switch(mthd_called_instr->GetType()) {
-	  case LOAD_INT_VAR:
-	  case STOR_INT_VAR:
-	  case COPY_INT_VAR:
-	  case LOAD_FLOAT_VAR:
-	  case STOR_FLOAT_VAR:
-	  case COPY_FLOAT_VAR:
-	    if(mthd_called_instr->GetOperand2() == LOCL) {
-	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, mthd_called_instr->GetType(),
-										       mthd_called_instr->GetOperand() + local_instr_offset + 1,  
-										       LOCL));
-	    }
-	    else if(mthd_called_instr->GetOperand2() == INST) {
-	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, mthd_called_instr->GetType(),
-										       mthd_called_instr->GetOperand(), INST));	      
-	    }
-	    else {
-	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, mthd_called_instr->GetType(),
-										       mthd_called_instr->GetOperand(), CLS));
+	if(is_taken) {
+	  const int s = block->succs[j];
+	  FlowBlock* succ = blocks[s];
+	  for(size_t k = 0; k < succ->preds.size(); ++k) {
+	    if(succ->preds[k] == b && !edges[s][k]) {
+	      edges[s][k] = true;
+	      succ->is_executable = true;
+	      changed = true;
 	    }
-	    break;
-
-	  case LOAD_INST_MEM:
-	    outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_VAR, local_instr_offset, LOCL));
-	    break;
-	    
-	    /*
-	      case RTRN:
-	      outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, JMP, end, -1));
-	      found_rtrn = true;
-	      break;
-	    */
-
-	  default:
-	    outputs->AddInstruction(mthd_called_instr);
-	    break;
 	  }
 	}
-	/*
-	  if(found_rtrn) {
-	  outputs->AddInstruction(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LBL, end));
-	  }
-	*/
-	inlined_mthds.insert(mthd_called);
-      }	
-      else {
-	outputs->AddInstruction(instr);
       }
     }
-    else {
-      outputs->AddInstruction(instr);
+  }
+  
+  // rewrite constant loads and branches
+  changed = false;
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    FlowBlock* block = blocks[i];
+    if(!block->is_executable) {
+      continue;
+    }
+    
+    for(size_t j = 0; j < block->instrs.size(); ++j) {
+      IntermediateInstruction* instr = block->instrs[j];
+      const int version = block->versions[j];
+      if(IsLoad(instr) && version > -1 && values[version].state == SSA_CONST) {
+	IntermediateInstruction* literal;
+	if(slot_types[values[version].slot] == SLOT_FLOAT) {
+	  literal = IntermediateFactory::Instance()->MakeInstruction(instr->GetLineNumber(), LOAD_FLOAT_LIT, 
+								     values[version].float_value);
+	}
+	else {
+	  literal = IntermediateFactory::Instance()->MakeInstruction(instr->GetLineNumber(), LOAD_INT_LIT, 
+								     (int)values[version].int_value);
+	}
+	
+	if(RemoveReference(instr)) {
+	  block->instrs[j] = literal;
+	  block->versions[j] = -1;
+	  changed = true;
+	}
+      }
+    }
+    
+    const size_t size = block->instrs.size();
+    IntermediateInstruction* last = block->instrs.back();
+    if(size > 1 && last->GetType() == JMP && last->GetOperand2() > -1 && 
+       block->instrs[size - 2]->GetType() == LOAD_INT_LIT) {
+      const bool is_jump = block->instrs[size - 2]->GetOperand() == last->GetOperand2();
+      block->instrs.resize(size - 2);
+      block->versions.resize(size - 2);
+      if(is_jump) {
+	block->instrs.push_back(IntermediateFactory::Instance()->MakeInstruction(last->GetLineNumber(), JMP, last->GetOperand(), -1));
+	block->versions.push_back(-1);
+      }
+      changed = true;
     }
   }
   
-  return outputs;
+  return changed;
 }
 
-IntermediateBlock* ItermediateOptimizer::FoldIntConstants(IntermediateBlock* inputs)
+/****************************
+ * Removes stores of values that
+ * are never loaded
+ ****************************/
+bool FlowGraph::RemoveDeadStores()
 {
-  IntermediateBlock* outputs = new IntermediateBlock;
-  deque<IntermediateInstruction*> working_stack;
-
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-
-    switch(instr->GetType()) {
-    case LOAD_INT_LIT:
-      working_stack.push_front(instr);
-      break;
-
-    case ADD_INT:
-    case SUB_INT:
-    case MUL_INT:
-    case DIV_INT:
-    case MOD_INT:
-    case BIT_AND_INT:
-    case BIT_OR_INT:
-    case BIT_XOR_INT:
-      CalculateIntFold(instr, working_stack, outputs);
-      break;
-
-    default:
-      // add back in reverse order
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
+  vector<bool> is_live(values.size(), false);
+  vector<int> work;
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    FlowBlock* block = blocks[i];
+    for(size_t j = 0; j < block->instrs.size(); ++j) {
+      const int version = block->versions[j];
+      if(version > -1 && IsLoad(block->instrs[j]) && !is_live[version]) {
+	is_live[version] = true;
+	work.push_back(version);
       }
-      outputs->AddInstruction(instr);
-      break;
     }
   }
-  // order matters...
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
+  
+  while(!work.empty()) {
+    SsaValue &value = values[work.back()];
+    work.pop_back();
+    for(size_t i = 0; i < value.args.size(); ++i) {
+      const int arg = value.args[i];
+      if(arg > -1 && !is_live[arg]) {
+	is_live[arg] = true;
+	work.push_back(arg);
+      }
+    }
+  }
+  
+  bool changed = false;
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    FlowBlock* block = blocks[i];
+    for(int j = (int)block->instrs.size() - 1; j > -1; --j) {
+      IntermediateInstruction* instr = block->instrs[j];
+      const int version = block->versions[j];
+      if(version < 0 || !IsStore(instr) || is_live[version] || (i == 0 && j < (int)protect)) {
+	continue;
+      }
+      
+      if(RemoveReference(instr)) {
+	switch(instr->GetType()) {
+	case STOR_INT_VAR:
+	  block->instrs[j] = IntermediateFactory::Instance()->MakeInstruction(instr->GetLineNumber(), POP_INT);
+	  block->versions[j] = -1;
+	  break;
+	  
+	case STOR_FLOAT_VAR:
+	  block->instrs[j] = IntermediateFactory::Instance()->MakeInstruction(instr->GetLineNumber(), POP_FLOAT);
+	  block->versions[j] = -1;
+	  break;
+	  
+	default:
+	  block->instrs.erase(block->instrs.begin() + j);
+	  block->versions.erase(block->versions.begin() + j);
+	  break;
+	}
+	changed = true;
+      }
+    }
+  }
+  
+  return changed;
+}
+
+/****************************
+ * Expression windows, pure
+ * instruction sequences that
+ * push a single value
+ ****************************/
+int FlowGraph::GetWindowStart(FlowBlock* block, int end)
+{
+  const int arity = GetArity(block->instrs[end]);
+  if(arity < 1) {
+    return -1;
+  }
+  
+  int needed = arity;
+  int start = end;
+  while(needed > 0) {
+    --start;
+    if(start < 0 || end - start > GLOBAL_WINDOW_MAX) {
+      return -1;
+    }
+    
+    IntermediateInstruction* instr = block->instrs[start];
+    if(IsLoad(instr)) {
+      if(block->versions[start] < 0) {
+	return -1;
+      }
+      needed--;
+    }
+    else {
+      const int instr_arity = GetArity(instr);
+      if(instr_arity < 0) {
+	return -1;
+      }
+      needed += instr_arity - 1;
+    }
   }
-
-  return outputs;
+  
+  return start;
 }
 
-void ItermediateOptimizer::CalculateIntFold(IntermediateInstruction* instr,
-					    deque<IntermediateInstruction*> &working_stack,
-					    IntermediateBlock* outputs)
+void FlowGraph::GetWindowKey(FlowBlock* block, int start, int end, vector<int> &key)
 {
-  if(working_stack.size() == 1) {
-    outputs->AddInstruction(working_stack.front());
-    working_stack.pop_front();
-    outputs->AddInstruction(instr);
-  } else if(working_stack.size() > 1) {
-    IntermediateInstruction* left = working_stack.front();
-    working_stack.pop_front();
-
-    IntermediateInstruction* right = working_stack.front();
-    working_stack.pop_front();
-
-    switch(instr->GetType()) {
-    case ADD_INT: {
-      INT_VALUE value = left->GetOperand() + right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+  for(int i = start; i <= end; ++i) {
+    IntermediateInstruction* instr = block->instrs[i];
+    key.push_back(instr->GetType());
+    if(instr->GetType() == LOAD_INT_LIT) {
+      key.push_back(instr->GetOperand());
     }
-      break;
-
-    case SUB_INT: {
-      INT_VALUE value = left->GetOperand() - right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    else if(instr->GetType() == LOAD_FLOAT_LIT) {
+      const FLOAT_VALUE value = instr->GetOperand4();
+      int parts[sizeof(FLOAT_VALUE) / sizeof(int)];
+      memcpy(parts, &value, sizeof(FLOAT_VALUE));
+      for(size_t j = 0; j < sizeof(FLOAT_VALUE) / sizeof(int); ++j) {
+	key.push_back(parts[j]);
+      }
     }
-      break;
-
-    case MUL_INT: {
-      INT_VALUE value = left->GetOperand() * right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    else if(IsLoad(instr)) {
+      key.push_back(block->versions[i]);
     }
-      break;
+  }
+}
 
-    case DIV_INT: {
-      INT_VALUE value = left->GetOperand() / right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+/****************************
+ * Common subexpressions, an
+ * expression is reused when an
+ * earlier one dominates it
+ ****************************/
+void FlowGraph::FindExpressions(int b, int lo, int hi, map<vector<int>, int> &scope, vector< vector<int> > &added,
+				vector<FlowExpression> &entries, vector<FlowExpression> &uses)
+{
+  FlowBlock* block = blocks[b];
+  
+  // largest expressions, from the last instruction
+  vector< pair<int, int> > windows;
+  for(int end = hi; end >= lo; ) {
+    const int start = GetWindowStart(block, end);
+    if(start >= lo && end - start > 1) {
+      windows.push_back(pair<int, int>(start, end));
+      end = start - 1;
     }
-      break;
-
-    case MOD_INT: {
-      INT_VALUE value = left->GetOperand() % right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    else {
+      end--;
     }
-      break;
+  }
+  
+  for(int i = (int)windows.size() - 1; i > -1; --i) {
+    const int start = windows[i].first;
+    const int end = windows[i].second;
+    
+    vector<int> key;
+    GetWindowKey(block, start, end, key);
+    map<vector<int>, int>::iterator result = scope.find(key);
+    if(result != scope.end()) {
+      FlowExpression &entry = entries[result->second];
+      if(entry.temp < 0) {
+	entry.temp = NewLocal(entry.is_float);
+      }
       
-    case BIT_AND_INT: {
-      INT_VALUE value = left->GetOperand() & right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+      if(entry.temp > -1) {
+	FlowExpression use;
+	use.block = b;
+	use.start = start;
+	use.end = end;
+	use.temp = entry.temp;
+	use.is_float = entry.is_float;
+	uses.push_back(use);
+	continue;
+      }
     }
-      break;
-
-    case BIT_OR_INT: {
-      INT_VALUE value = left->GetOperand() | right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
+    
+    // nested expressions
+    FindExpressions(b, start, end - 1, scope, added, entries, uses);
+    
+    if(result == scope.end()) {
+      FlowExpression entry;
+      entry.block = b;
+      entry.start = start;
+      entry.end = end;
+      entry.temp = -1;
+      entry.is_float = IsFloatResult(block->instrs[end]);
+      scope[key] = entries.size();
+      entries.push_back(entry);
+      added.push_back(key);
     }
-      break;
+  }
+}
 
-    case BIT_XOR_INT: {
-      INT_VALUE value = left->GetOperand() ^ right->GetOperand();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_INT_LIT, value));
-    }
-      break;
+void FlowGraph::CommonExpressions(int b, map<vector<int>, int> &scope,
+				  vector<FlowExpression> &entries, vector<FlowExpression> &uses)
+{
+  vector< vector<int> > added;
+  FlowBlock* block = blocks[b];
+  FindExpressions(b, 0, (int)block->instrs.size() - 1, scope, added, entries, uses);
+  
+  for(size_t i = 0; i < block->children.size(); ++i) {
+    CommonExpressions(block->children[i], scope, entries, uses);
+  }
+  
+  for(size_t i = 0; i < added.size(); ++i) {
+    scope.erase(added[i]);
+  }
+}
 
-    default:
-      break;
+bool FlowGraph::EliminateExpressions()
+{
+  map<vector<int>, int> scope;
+  vector<FlowExpression> entries;
+  vector<FlowExpression> uses;
+  CommonExpressions(0, scope, entries, uses);
+  if(uses.empty()) {
+    return false;
+  }
+  
+  // copies after the first expression, loads replace the others
+  vector< map<int, FlowExpression> > copies(blocks.size());
+  vector< map<int, FlowExpression> > loads(blocks.size());
+  for(size_t i = 0; i < entries.size(); ++i) {
+    if(entries[i].temp > -1) {
+      copies[entries[i].block][entries[i].end] = entries[i];
     }
-  } 
-  else {
-    outputs->AddInstruction(instr);
   }
+  for(size_t i = 0; i < uses.size(); ++i) {
+    loads[uses[i].block][uses[i].start] = uses[i];
+  }
+  
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    if(copies[i].empty() && loads[i].empty()) {
+      continue;
+    }
+    
+    FlowBlock* block = blocks[i];
+    vector<IntermediateInstruction*> instrs;
+    vector<int> versions;
+    for(int j = 0; j < (int)block->instrs.size(); ) {
+      map<int, FlowExpression>::iterator load = loads[i].find(j);
+      if(load != loads[i].end()) {
+	const FlowExpression &use = load->second;
+	for(int k = use.start; k <= use.end; ++k) {
+	  RemoveReference(block->instrs[k]);
+	}
+	IntermediateInstruction* instr = IntermediateFactory::Instance()->MakeInstruction(block->instrs[use.end]->GetLineNumber(), 
+											  use.is_float ? LOAD_FLOAT_VAR : LOAD_INT_VAR, 
+											  use.temp, LOCL);
+	AddReference(instr);
+	instrs.push_back(instr);
+	versions.push_back(-1);
+	j = use.end + 1;
+	continue;
+      }
+      
+      instrs.push_back(block->instrs[j]);
+      versions.push_back(block->versions[j]);
+      
+      map<int, FlowExpression>::iterator copy = copies[i].find(j);
+      if(copy != copies[i].end()) {
+	const FlowExpression &entry = copy->second;
+	IntermediateInstruction* instr = IntermediateFactory::Instance()->MakeInstruction(block->instrs[j]->GetLineNumber(), 
+											  entry.is_float ? COPY_FLOAT_VAR : COPY_INT_VAR, 
+											  entry.temp, LOCL);
+	AddReference(instr);
+	instrs.push_back(instr);
+	versions.push_back(-1);
+      }
+      ++j;
+    }
+    block->instrs = instrs;
+    block->versions = versions;
+  }
+  
+  return true;
 }
 
-IntermediateBlock* ItermediateOptimizer::FoldFloatConstants(IntermediateBlock* inputs)
+/****************************
+ * Loop invariant code motion,
+ * invariant expressions are
+ * computed before the loop's
+ * header
+ ****************************/
+bool FlowGraph::IsInvariant(FlowBlock* block, int start, int end, vector<bool> &body)
 {
-  IntermediateBlock* outputs = new IntermediateBlock;
-  deque<IntermediateInstruction*> working_stack;
-
-  vector<IntermediateInstruction*> input_instrs = inputs->GetInstructions();
-  for(size_t i = 0; i < input_instrs.size(); ++i) {
-    IntermediateInstruction* instr = input_instrs[i];
-
-    switch(instr->GetType()) {
-    case LOAD_FLOAT_LIT:
-      working_stack.push_front(instr);
-      break;
-
-    case ADD_FLOAT:
-    case SUB_FLOAT:
-    case MUL_FLOAT:
-    case DIV_FLOAT:
-      CalculateFloatFold(instr, working_stack, outputs);
-      break;
-
-    default:
-      // add back in reverse order
-      while(!working_stack.empty()) {
-        outputs->AddInstruction(working_stack.back());
-        working_stack.pop_back();
+  bool has_load = false;
+  for(int i = start; i <= end; ++i) {
+    IntermediateInstruction* instr = block->instrs[i];
+    // may trap
+    if(instr->GetType() == DIV_INT || instr->GetType() == MOD_INT) {
+      return false;
+    }
+    
+    if(IsLoad(instr)) {
+      const int version = block->versions[i];
+      if(version < 0 || (values[version].block > -1 && body[values[version].block])) {
+	return false;
       }
-      outputs->AddInstruction(instr);
-      break;
+      has_load = true;
     }
   }
-  // order matters...
-  while(!working_stack.empty()) {
-    outputs->AddInstruction(working_stack.back());
-    working_stack.pop_back();
-  }
-
-  return outputs;
+  
+  return has_load;
 }
 
-void ItermediateOptimizer::CalculateFloatFold(IntermediateInstruction* instr,
-					      deque<IntermediateInstruction*> &working_stack,
-					      IntermediateBlock* outputs)
+void FlowGraph::FindInvariants(int b, int lo, int hi, vector<bool> &body, vector< pair<int, int> > &windows)
 {
-  if(working_stack.size() == 1) {
-    outputs->AddInstruction(working_stack.front());
-    working_stack.pop_front();
-    outputs->AddInstruction(instr);
-  } 
-  else if(working_stack.size() > 1) {
-    IntermediateInstruction* left = working_stack.front();
-    working_stack.pop_front();
-
-    IntermediateInstruction* right = working_stack.front();
-    working_stack.pop_front();
-
-    switch(instr->GetType()) {
-    case ADD_FLOAT: {
-      FLOAT_VALUE value = left->GetOperand4() + right->GetOperand4();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+  FlowBlock* block = blocks[b];
+  for(int end = hi; end >= lo; ) {
+    const int start = GetWindowStart(block, end);
+    if(start >= lo && end - start > 1) {
+      if(IsInvariant(block, start, end, body)) {
+	windows.push_back(pair<int, int>(start, end));
+      }
+      else {
+	FindInvariants(b, start, end - 1, body, windows);
+      }
+      end = start - 1;
     }
-      break;
-
-    case SUB_FLOAT: {
-      FLOAT_VALUE value = left->GetOperand4() - right->GetOperand4();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+    else {
+      end--;
     }
-      break;
+  }
+}
 
-    case MUL_FLOAT: {
-      FLOAT_VALUE value = left->GetOperand4() * right->GetOperand4();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+bool FlowGraph::HoistInvariants()
+{
+  // natural loops, merged by header
+  map<int, vector<bool> > loops;
+  for(size_t i = 0; i < rpo.size(); ++i) {
+    const int b = rpo[i];
+    FlowBlock* block = blocks[b];
+    for(size_t j = 0; j < block->succs.size(); ++j) {
+      const int header = block->succs[j];
+      if(!Dominates(header, b)) {
+	continue;
+      }
+      
+      vector<bool> &body = loops[header];
+      if(body.empty()) {
+	body.assign(blocks.size(), false);
+	body[header] = true;
+      }
+      
+      vector<int> work;
+      if(!body[b]) {
+	body[b] = true;
+	work.push_back(b);
+      }
+      while(!work.empty()) {
+	FlowBlock* member = blocks[work.back()];
+	work.pop_back();
+	for(size_t k = 0; k < member->preds.size(); ++k) {
+	  const int pred = member->preds[k];
+	  if(!body[pred]) {
+	    body[pred] = true;
+	    work.push_back(pred);
+	  }
+	}
+      }
     }
-      break;
+  }
+  
+  // inner loops first
+  vector< pair<int, int> > headers;
+  for(map<int, vector<bool> >::iterator iter = loops.begin(); iter != loops.end(); ++iter) {
+    headers.push_back(pair<int, int>(count(iter->second.begin(), iter->second.end(), true), iter->first));
+  }
+  sort(headers.begin(), headers.end());
+  
+  bool changed = false;
+  for(size_t i = 0; i < headers.size(); ++i) {
+    const int h = headers[i].second;
+    vector<bool> &body = loops[h];
+    FlowBlock* header = blocks[h];
     
-    case DIV_FLOAT: {
-      FLOAT_VALUE value = left->GetOperand4() / right->GetOperand4();
-      working_stack.push_front(IntermediateFactory::Instance()->MakeInstruction(cur_line_num, LOAD_FLOAT_LIT, value));
+    // the loop must be entered by falling into its header
+    int outside = -1;
+    bool is_entered = true;
+    for(size_t j = 0; j < header->preds.size(); ++j) {
+      const int pred = header->preds[j];
+      if(!body[pred]) {
+	if(outside > -1 && outside != pred) {
+	  is_entered = false;
+	}
+	outside = pred;
+      }
     }
-      break;
+    
+    if(outside < 0) {
+      if(h != 0 || protect > 0) {
+	is_entered = false;
+      }
+    }
+    else if(outside != h - 1) {
+      is_entered = false;
+    }
+    else {
+      vector<IntermediateInstruction*> &pred_instrs = blocks[outside]->instrs;
+      for(size_t j = 0; j < pred_instrs.size(); ++j) {
+	if((pred_instrs[j]->GetType() == JMP && pred_instrs[j]->GetOperand() == header->label) || 
+	   pred_instrs[j]->GetType() == TBL_SWITCH) {
+	  is_entered = false;
+	}
+      }
+    }
+    
+    if(!is_entered) {
+      continue;
+    }
+    
+    // replace invariant expressions with temporaries
+    map<vector<int>, int> temps;
+    vector<IntermediateInstruction*> hoisted;
+    vector<int> hoisted_versions;
+    for(size_t j = 0; j < blocks.size(); ++j) {
+      if(!body[j]) {
+	continue;
+      }
       
-    default:
-      break;
+      FlowBlock* block = blocks[j];
+      vector< pair<int, int> > windows;
+      FindInvariants(j, 0, (int)block->instrs.size() - 1, body, windows);
+      
+      // positions are in decreasing order
+      for(size_t k = 0; k < windows.size(); ++k) {
+	const int start = windows[k].first;
+	const int end = windows[k].second;
+	const bool is_float = IsFloatResult(block->instrs[end]);
+	const int line_num = block->instrs[end]->GetLineNumber();
+	
+	vector<int> key;
+	GetWindowKey(block, start, end, key);
+	int temp;
+	map<vector<int>, int>::iterator result = temps.find(key);
+	if(result == temps.end()) {
+	  temp = NewLocal(is_float);
+	  if(temp < 0) {
+	    continue;
+	  }
+	  temps[key] = temp;
+	  
+	  for(int l = start; l <= end; ++l) {
+	    hoisted.push_back(block->instrs[l]);
+	    hoisted_versions.push_back(block->versions[l]);
+	  }
+	  hoisted.push_back(IntermediateFactory::Instance()->MakeInstruction(line_num, is_float ? STOR_FLOAT_VAR : STOR_INT_VAR, 
+									     temp, LOCL));
+	  hoisted_versions.push_back(-1);
+	}
+	else {
+	  temp = result->second;
+	}
+	
+	block->instrs.erase(block->instrs.begin() + start, block->instrs.begin() + end + 1);
+	block->versions.erase(block->versions.begin() + start, block->versions.begin() + end + 1);
+	block->instrs.insert(block->instrs.begin() + start, 
+			     IntermediateFactory::Instance()->MakeInstruction(line_num, is_float ? LOAD_FLOAT_VAR : LOAD_INT_VAR, 
+									      temp, LOCL));
+	block->versions.insert(block->versions.begin() + start, -1);
+	changed = true;
+      }
     }
-  } 
-  else {
-    outputs->AddInstruction(instr);
+    
+    // insert before the header
+    if(!hoisted.empty()) {
+      if(outside < 0) {
+	header->instrs.insert(header->instrs.begin(), hoisted.begin(), hoisted.end());
+	header->versions.insert(header->versions.begin(), hoisted_versions.begin(), hoisted_versions.end());
+      }
+      else {
+	FlowBlock* preheader = blocks[outside];
+	preheader->instrs.insert(preheader->instrs.end(), hoisted.begin(), hoisted.end());
+	preheader->versions.insert(preheader->versions.end(), hoisted_versions.begin(), hoisted_versions.end());
+      }
+    }
+  }
+  
+  return changed;
+}
+
+/****************************
+ * Lowers the graph back to
+ * stack code, dropping blocks
+ * that are never executed
+ ****************************/
+vector<IntermediateInstruction*> FlowGraph::Lower(bool &changed)
+{
+  vector<bool> keep(blocks.size(), false);
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    keep[i] = blocks[i]->is_reachable && blocks[i]->is_executable;
   }
+  
+  bool is_kept = true;
+  while(is_kept) {
+    is_kept = false;
+    
+    // blocks that are jumped or fallen into
+    vector<int> counts(slot_types.size() + (next_local > 0 ? next_local : 0), 0);
+    for(size_t i = 0; i < blocks.size(); ++i) {
+      if(!keep[i]) {
+	continue;
+      }
+      
+      FlowBlock* block = blocks[i];
+      for(size_t j = 0; j < block->instrs.size(); ++j) {
+	IntermediateInstruction* instr = block->instrs[j];
+	if(instr->GetType() == JMP) {
+	  map<int, int>::iterator result = labels.find(instr->GetOperand());
+	  if(result != labels.end() && !keep[result->second]) {
+	    keep[result->second] = true;
+	    is_kept = true;
+	  }
+	}
+	else if(instr->GetType() == TBL_SWITCH) {
+	  vector<int> targets = instr->GetTable();
+	  targets.push_back(instr->GetOperand2());
+	  for(size_t k = 0; k < targets.size(); ++k) {
+	    map<int, int>::iterator result = labels.find(targets[k]);
+	    if(result != labels.end() && !keep[result->second]) {
+	      keep[result->second] = true;
+	      is_kept = true;
+	    }
+	  }
+	}
+	else if(IsLocal(instr) && instr->GetOperand() < (int)counts.size()) {
+	  counts[instr->GetOperand()]++;
+	}
+      }
+      
+      IntermediateInstruction* last = block->instrs.empty() ? NULL : block->instrs.back();
+      const bool is_falling = !last || (last->GetType() != RTRN && last->GetType() != TBL_SWITCH && 
+					(last->GetType() != JMP || last->GetOperand2() > -1));
+      if(is_falling && i + 1 < blocks.size() && !keep[i + 1]) {
+	keep[i + 1] = true;
+	is_kept = true;
+      }
+    }
+    
+    // variables only referenced by dropped blocks
+    for(size_t i = 0; i < blocks.size(); ++i) {
+      if(keep[i]) {
+	continue;
+      }
+      
+      FlowBlock* block = blocks[i];
+      bool is_needed = false;
+      for(size_t j = 0; !is_needed && j < block->instrs.size(); ++j) {
+	IntermediateInstruction* instr = block->instrs[j];
+	if(IsLocal(instr) && instr->GetOperand() < (int)counts.size() && counts[instr->GetOperand()] == 0) {
+	  is_needed = true;
+	}
+      }
+      
+      if(is_needed) {
+	keep[i] = true;
+	is_kept = true;
+	for(size_t j = 0; j < block->instrs.size(); ++j) {
+	  IntermediateInstruction* instr = block->instrs[j];
+	  if(IsLocal(instr) && instr->GetOperand() < (int)counts.size()) {
+	    counts[instr->GetOperand()]++;
+	  }
+	}
+      }
+    }
+  }
+  
+  vector<IntermediateInstruction*> outputs;
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    if(keep[i]) {
+      FlowBlock* block = blocks[i];
+      outputs.insert(outputs.end(), block->instrs.begin(), block->instrs.end());
+    }
+    else {
+      changed = true;
+    }
+  }
+  
+  return outputs;
 }
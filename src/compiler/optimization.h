@@ -34,20 +34,273 @@
 
 #include "target.h"
 #include <deque>
+#include <map>
+#include <set>
 
 using namespace backend;
 
 #define LOCL_INLINE_MEM_MAX 128
+#define LOCL_INLINE_CTOR_MAX 4
+#define GLOBAL_OPT_PASSES 4
+#define GLOBAL_WINDOW_MAX 32
+#define VIRTUAL_GUARD_MAX 3
+#define PROFILE_HOT_MIN 1000
+#define PROFILE_INLINE_MEM_MAX 160
+#define PROFILE_NATIVE_MIN 10000
+#define PROFILE_GUARD_MIN 90
+
+/****************************
+ * Calls from a method to a
+ * called method, virtual calls
+ * are counted by the class of
+ * the receiver
+ ****************************/
+struct ProfileCall {
+  long count;
+  map<wstring, long> receivers;
+
+  ProfileCall() {
+    count = 0;
+  }
+};
+
+/****************************
+ * Counts for a method, branches
+ * are keyed by jump label and
+ * calls by the called method
+ ****************************/
+struct ProfileMethod {
+  long invocations;
+  map<int, pair<long, long> > branches;
+  map<wstring, ProfileCall> calls;
+
+  ProfileMethod() {
+    invocations = 0;
+  }
+};
+
+/****************************
+ * Execution profile written by
+ * 'obr -profile'. Counts only
+ * guide optimizations, so a
+ * stale profile may slow code
+ * down but never changes what
+ * it does.
+ ****************************/
+class ProgramProfile {
+  map<wstring, ProfileMethod> methods;
+
+ public:
+  ProgramProfile() {
+  }
+
+  ~ProgramProfile() {
+  }
+
+  bool Load(const wstring &file_name);
+
+  ProfileMethod* GetMethod(const wstring &name) {
+    map<wstring, ProfileMethod>::iterator result = methods.find(name);
+    if(result != methods.end()) {
+      return &result->second;
+    }
+
+    return NULL;
+  }
+
+  ProfileCall* GetCall(const wstring &caller, const wstring &called) {
+    ProfileMethod* method = GetMethod(caller);
+    if(method) {
+      map<wstring, ProfileCall>::iterator result = method->calls.find(called);
+      if(result != method->calls.end()) {
+	return &result->second;
+      }
+    }
+
+    return NULL;
+  }
+
+  // invocations and executed branches
+  long GetWork(const wstring &name);
+};
+
+/****************************
+ * SSA value kinds and lattice
+ * states
+ ****************************/
+enum SsaValueKind {
+  SSA_ENTRY = -7000,
+  SSA_OTHER,
+  SSA_INT_CONST,
+  SSA_FLOAT_CONST,
+  SSA_COPY,
+  SSA_PHI
+};
+
+enum SsaState {
+  SSA_TOP = -7100,
+  SSA_CONST,
+  SSA_BOTTOM
+};
+
+enum SlotType {
+  SLOT_NONE = -7200,
+  SLOT_INT,
+  SLOT_FLOAT,
+  SLOT_MIXED
+};
+
+/****************************
+ * Value of a local variable in
+ * SSA form. Values are defined
+ * by stores, copies and phi
+ * functions.
+ ****************************/
+struct SsaValue {
+  int slot;
+  int block;
+  SsaValueKind kind;
+  int source;
+  vector<int> args;
+  SsaState state;
+  INT_VALUE int_value;
+  FLOAT_VALUE float_value;
+};
+
+/****************************
+ * Basic block, instructions are
+ * paired with the SSA value that
+ * they define or use
+ ****************************/
+struct FlowBlock {
+  vector<IntermediateInstruction*> instrs;
+  vector<int> versions;
+  vector<int> succs;
+  vector<int> preds;
+  vector<int> children;
+  vector<int> frontier;
+  map<int, int> phis;
+  int start;
+  int label;
+  int idom;
+  int order;
+  bool is_reachable;
+  bool is_executable;
+};
+
+/****************************
+ * Expression window that is
+ * computed once and reused
+ ****************************/
+struct FlowExpression {
+  int block;
+  int start;
+  int end;
+  int temp;
+  bool is_float;
+};
+
+/****************************
+ * Control-flow graph in SSA
+ * form over a method's
+ * instructions. SSA values
+ * are an overlay on the stack
+ * code, rewrites are made in
+ * place so lowering only drops
+ * unreachable blocks.
+ ****************************/
+class FlowGraph {
+  vector<IntermediateInstruction*> input_instrs;
+  vector<FlowBlock*> blocks;
+  map<int, int> labels;
+  vector<SsaValue> values;
+  vector<int> slot_types;
+  vector<int> ref_counts;
+  vector< vector<int> > slot_stacks;
+  vector<int> rpo;
+  size_t protect;
+  int next_local;
+  int max_local;
+
+  // graph construction
+  bool BuildBlocks();
+  void CalculateDominators();
+  int Intersect(int b1, int b2);
+  bool Dominates(int a, int b);
+  void PlacePhis();
+  void Rename(int b);
+  int NewValue(int slot, int block, SsaValueKind kind);
+
+  // value propagation
+  void EvaluateValue(int v);
+  void MeetValue(SsaValue &value, SsaState state, INT_VALUE i, FLOAT_VALUE f);
+  SsaState GetCondition(FlowBlock* block, INT_VALUE &value);
+
+  // expression windows
+  int GetWindowStart(FlowBlock* block, int end);
+  void GetWindowKey(FlowBlock* block, int start, int end, vector<int> &key);
+  void FindExpressions(int b, int lo, int hi, map<vector<int>, int> &scope, vector< vector<int> > &added,
+                       vector<FlowExpression> &entries, vector<FlowExpression> &uses);
+  void CommonExpressions(int b, map<vector<int>, int> &scope,
+                         vector<FlowExpression> &entries, vector<FlowExpression> &uses);
+  bool IsInvariant(FlowBlock* block, int start, int end, vector<bool> &body);
+  void FindInvariants(int b, int lo, int hi, vector<bool> &body, vector< pair<int, int> > &windows);
+  int NewLocal(bool is_float);
+
+  // local slot references
+  bool IsLocal(IntermediateInstruction* instr);
+  bool IsLoad(IntermediateInstruction* instr);
+  bool IsStore(IntermediateInstruction* instr);
+  bool RemoveReference(IntermediateInstruction* instr);
+  void AddReference(IntermediateInstruction* instr);
+
+ public:
+  FlowGraph(const vector<IntermediateInstruction*> &i, int n, int m) {
+    input_instrs = i;
+    protect = 0;
+    next_local = n;
+    max_local = m;
+  }
+
+  ~FlowGraph() {
+    while(!blocks.empty()) {
+      FlowBlock* tmp = blocks.front();
+      blocks.erase(blocks.begin());
+      delete tmp;
+      tmp = NULL;
+    }
+  }
+
+  static int GetArity(IntermediateInstruction* instr);
+  static bool IsFloatResult(IntermediateInstruction* instr);
+
+  bool Build();
+  bool PropagateValues();
+  bool RemoveDeadStores();
+  bool EliminateExpressions();
+  bool HoistInvariants();
+  vector<IntermediateInstruction*> Lower(bool &changed);
+  bool DominatesInstruction(size_t from, size_t to);
+
+  int GetNextLocal() {
+    return next_local;
+  }
+};
 
 /****************************
  * Performs optimizations on
  * intermediate code.
  *
- * Order of 4 optimizations:
+ * Order of 5 optimizations:
  * 0 - clean up jumps and other unneeded instructions (always happens)
  * 1 - setter and getter inlining / advanced method inlining / constant folding
  * 2 - strength reduction
- * 3 - replace store/load with copy instruction
+ * 3 - replace store/load with copy instruction, whole-program binding
+ *     of virtual method calls using class hierarchy analysis
+ * 4 - scalar replacement of objects that do not escape, global constant
+ *     and copy propagation, dead store and dead code elimination, common
+ *     subexpression elimination and loop invariant code motion over an
+ *     SSA control-flow graph
  ****************************/
 class ItermediateOptimizer {
   IntermediateProgram* program;
@@ -56,6 +309,12 @@ class ItermediateOptimizer {
   IntermediateMethod* current_method;
   bool merge_blocks;
   int cur_line_num;
+  bool is_lib;
+  ProgramProfile* profile;
+  set<IntermediateMethod*> native_methods;
+  map<const wstring, IntermediateClass*> class_names;
+  map<int, IntermediateClass*> class_ids;
+  map<IntermediateMethod*, vector<IntermediateMethod*> > virtual_targets;
   
   vector<IntermediateBlock*> OptimizeMethod(vector<IntermediateBlock*> input);
   vector<IntermediateBlock*> InlineMethod(vector<IntermediateBlock*> inputs);
@@ -91,16 +350,53 @@ class ItermediateOptimizer {
                         IntermediateBlock* outputs);
   // instruction replacement
   IntermediateBlock* InstructionReplacement(IntermediateBlock* inputs);
+
+  // global optimizations
+  IntermediateBlock* GlobalOptimization(IntermediateBlock* inputs);
+  bool SimplifyInstructions(vector<IntermediateInstruction*> &instrs);
+  void FoldInstructions(vector<IntermediateInstruction*> &instrs);
+  // escape analysis and scalar replacement
+  int ReplaceAllocations(vector<IntermediateInstruction*> &instrs, int &next_local, const int max_local);
+  bool CanReplaceConstructor(IntermediateMethod* mthd, set<int> &fields, int &space, int depth);
+  void InlineConstructor(IntermediateMethod* mthd, map<int, int> &slots, int &base, 
+                         const int line_num, vector<IntermediateInstruction*> &outputs);
+  bool IsFieldAccess(IntermediateInstruction* instr);
+  bool IsScalarType(ParamType type);
+  void GetMemoryTypes(IntermediateDeclarations* entries, map<int, ParamType> &types);
   void ReplacementInstruction(IntermediateInstruction* instr,
                               deque<IntermediateInstruction*> &calc_stack,
                               IntermediateBlock* outputs);
+  // class hierarchy analysis
+  void IndexClasses();
+  void DevirtualizeMethods();
+  IntermediateBlock* DevirtualizeCalls(IntermediateBlock* inputs, int &label, int &guard_local, 
+                                       int &sites, int &bound, int &guarded);
+  vector<IntermediateMethod*> GetVirtualTargets(IntermediateMethod* mthd);
+  IntermediateMethod* ResolveVirtualMethod(IntermediateClass* klass, const wstring &ending);
+  IntermediateClass* GetParentClass(IntermediateClass* klass);
+  bool IsSubclass(IntermediateClass* klass, IntermediateClass* base);
+  int GetClassDepth(IntermediateClass* klass);
+  int AddGuardLocal();
+  vector<IntermediateMethod*> GetProfiledTargets(IntermediateMethod* mthd_called, 
+                                                 vector<IntermediateMethod*> &targets, bool &is_complete);
+  // profile-guided layout and native code
+  IntermediateBlock* LayoutBranches(IntermediateBlock* inputs, int &label);
+  bool IsCompareInstruction(IntermediateInstruction* instr);
+  void MarkNativeMethods();
+  void VerifyNativeMethods();
+  bool CanCompileNative(IntermediateMethod* mthd);
+  // method reachability
+  IntermediateMethod* FindMethod(int cls_id, int mthd_id);
+  void AddUsedMethod(IntermediateMethod* mthd, set<IntermediateMethod*> &used, 
+                     vector<IntermediateMethod*> &work);
 
 
   //
   // TOOD: need final method identifier
   //
   // TODO: ensure we don't have duplicate labels, including the label we're adding
-  bool CanInlineMethod(IntermediateMethod* mthd_called, set<IntermediateMethod*> &inlined_mthds, set<int> &lbl_jmp_offsets) {
+  bool CanInlineMethod(IntermediateMethod* mthd_called, set<IntermediateMethod*> &inlined_mthds, set<int> &lbl_jmp_offsets,
+                       int space_max) {
     // don't inline the same method more then once, since you'll have label/jump conflicts
     set<IntermediateMethod*>::iterator found = inlined_mthds.find(mthd_called);
     if(found != inlined_mthds.end()) {
@@ -124,7 +420,7 @@ class ItermediateOptimizer {
       return false;
     }
 
-    if(current_method->GetSpace() + mthd_called->GetSpace() > LOCL_INLINE_MEM_MAX) {
+    if(current_method->GetSpace() + mthd_called->GetSpace() > space_max) {
       return false;
     }
     
@@ -321,11 +617,13 @@ class ItermediateOptimizer {
   }
   
  public:
-  ItermediateOptimizer(IntermediateProgram* p, int u, wstring o) {
+  ItermediateOptimizer(IntermediateProgram* p, int u, wstring o, bool l, ProgramProfile* f) {
     program = p;
     cur_line_num = -1;
     merge_blocks = false;
     unconditional_label = u; 
+    is_lib = l;
+    profile = f;
 
     if(o == L"s1") {
       optimization_level = 1;
@@ -336,6 +634,9 @@ class ItermediateOptimizer {
     else if(o == L"s3") {
       optimization_level = 3;
     } 
+    else if(o == L"s4") {
+      optimization_level = 4;
+    } 
     else {
       optimization_level = 0;
     }
@@ -345,6 +646,7 @@ class ItermediateOptimizer {
   }
 
   void Optimize();
+  void RemoveUnusedMethods();
 
   IntermediateProgram* GetProgram() {
     return program;
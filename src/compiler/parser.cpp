@@ -152,17 +152,17 @@ bool Parser::Parse()
 
   // parses source path
   if(src_path.size() > 0) {
+    vector<wstring> file_names;
     size_t offset = 0;
     size_t index = src_path.find(',');
     while(index != wstring::npos) {
-      const wstring &file_name = src_path.substr(offset, index - offset);
-      ParseFile(file_name);
+      file_names.push_back(src_path.substr(offset, index - offset));
       // update
       offset = index + 1;
       index = src_path.find(',', offset);
     }
-    const wstring &file_name = src_path.substr(offset, src_path.size());
-    ParseFile(file_name);
+    file_names.push_back(src_path.substr(offset, src_path.size()));
+    ParseFiles(file_names);
   }
   else if(run_prgm.size() > 0) {
     ParseProgram();
@@ -171,6 +171,135 @@ bool Parser::Parse()
   return CheckErrors();
 }
 
+/****************************
+ * Parses source files in parallel,
+ * results are added to the program
+ * in source order.
+ ****************************/
+void Parser::ParseFiles(const vector<wstring> &file_names)
+{
+  vector<Parser*> parsers;
+  for(size_t i = 0; i < file_names.size(); ++i) {
+    parsers.push_back(new Parser(file_names[i], i));
+  }
+  
+  // created before threads start
+  TreeFactory::Instance();
+  TypeFactory::Instance();
+  
+  const size_t num_threads = GetParseThreads(file_names.size());
+  ParseTask tasks[MAX_PARSE_THREADS];
+  for(size_t i = 0; i < num_threads; ++i) {
+    tasks[i].parsers = &parsers;
+    tasks[i].start = i;
+    tasks[i].stride = num_threads;
+  }
+  
+  // the calling thread parses the first set of files
+#ifdef _WIN32
+  HANDLE threads[MAX_PARSE_THREADS];
+  for(size_t i = 1; i < num_threads; ++i) {
+    threads[i] = (HANDLE)_beginthreadex(NULL, 0, RunParseTask, &tasks[i], 0, NULL);
+    if(!threads[i]) {
+      RunParseTask(&tasks[i]);
+    }
+  }
+  RunParseTask(&tasks[0]);
+  for(size_t i = 1; i < num_threads; ++i) {
+    if(threads[i]) {
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+    }
+  }
+#else
+  pthread_t threads[MAX_PARSE_THREADS];
+  bool is_started[MAX_PARSE_THREADS];
+  for(size_t i = 1; i < num_threads; ++i) {
+    is_started[i] = pthread_create(&threads[i], NULL, RunParseTask, (void*)&tasks[i]) == 0;
+    if(!is_started[i]) {
+      RunParseTask(&tasks[i]);
+    }
+  }
+  RunParseTask(&tasks[0]);
+  for(size_t i = 1; i < num_threads; ++i) {
+    if(is_started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+#endif
+  
+  for(size_t i = 0; i < parsers.size(); ++i) {
+    AddParsed(parsers[i]);
+    delete parsers[i];
+    parsers[i] = NULL;
+  }
+}
+
+/****************************
+ * Parses a thread's share of
+ * source files
+ ****************************/
+#ifdef _WIN32
+unsigned int __stdcall Parser::RunParseTask(void* arg)
+#else
+void* Parser::RunParseTask(void* arg)
+#endif
+{
+  ParseTask* task = (ParseTask*)arg;
+  vector<Parser*> &parsers = *task->parsers;
+  for(size_t i = task->start; i < parsers.size(); i += task->stride) {
+    parsers[i]->ParseFile(parsers[i]->src_path);
+  }
+  
+  return 0;
+}
+
+/****************************
+ * Number of threads used to
+ * parse source files
+ ****************************/
+size_t Parser::GetParseThreads(size_t num_files)
+{
+#ifdef _DEBUG
+  // keeps debug output in order
+  return 1;
+#else
+#ifdef _WIN32
+  SYSTEM_INFO sys_info;
+  GetSystemInfo(&sys_info);
+  long num_cores = sys_info.dwNumberOfProcessors;
+#else
+  long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  size_t num_threads = num_cores > 0 ? (size_t)num_cores : 1;
+  if(num_threads > num_files) {
+    num_threads = num_files;
+  }
+  if(num_threads > MAX_PARSE_THREADS) {
+    num_threads = MAX_PARSE_THREADS;
+  }
+  
+  return num_threads;
+#endif
+}
+
+/****************************
+ * Adds parsed bundles, uses 
+ * and errors to the program
+ ****************************/
+void Parser::AddParsed(Parser* parser)
+{
+  for(size_t i = 0; i < parser->parsed_bundles.size(); ++i) {
+    program->AddBundle(parser->parsed_bundles[i]);
+  }
+  program->AddUses(parser->parsed_uses);
+  
+  // first error for a line wins, as if parsed in sequence
+  if(parser != this) {
+    errors.insert(parser->errors.begin(), parser->errors.end());
+  }
+}
+
 /****************************
  * Parses a file.
  ****************************/
@@ -192,6 +321,7 @@ void Parser::ParseProgram()
   scanner = new Scanner(run_prgm, true);
   NextToken();
   ParseBundle(0);
+  AddParsed(this);
   // clean up
   delete scanner;
   scanner = NULL;
@@ -265,14 +395,14 @@ void Parser::ParseBundle(int depth)
       }
       NextToken();
 
-      program->AddBundle(bundle);
+      parsed_bundles.push_back(bundle);
     }
 
     // detect stray characters
     if(!Match(TOKEN_END_OF_STREAM)) {
       ProcessError(L"Unexpected tokens (likely related to other errors)");
     }
-    program->AddUses(uses);
+    parsed_uses.insert(parsed_uses.end(), uses.begin(), uses.end());
   }
   // parse class
   else if(Match(TOKEN_CLASS_ID) || Match(TOKEN_ENUM_ID) || Match(TOKEN_INTERFACE_ID)) {
@@ -301,13 +431,13 @@ void Parser::ParseBundle(int depth)
         NextToken();
       }
     }
-    program->AddBundle(bundle);
+    parsed_bundles.push_back(bundle);
 
     // detect stray characters
     if(!Match(TOKEN_END_OF_STREAM)) {
       ProcessError(L"Unexpected tokens (likely related to other errors)");
     }
-    program->AddUses(uses);
+    parsed_uses.insert(parsed_uses.end(), uses.begin(), uses.end());
   }
   // error
   else {
@@ -894,6 +1024,33 @@ Statement* Parser::ParseStatement(int depth)
       break;
     }
   }
+  // function call on a basic type (i.e. 'Int->Fill(a, 0)')
+  else if(IsBasicType(GetToken()) && Match(TOKEN_ASSESSOR, SECOND_INDEX)) {
+    wstring ident;
+    switch(GetToken()) {
+    case TOKEN_BOOLEAN_ID:
+      ident = BOOL_CLASS_ID;
+      break;
+
+    case TOKEN_BYTE_ID:
+      ident = BYTE_CLASS_ID;
+      break;
+
+    case TOKEN_INT_ID:
+      ident = INT_CLASS_ID;
+      break;
+
+    case TOKEN_FLOAT_ID:
+      ident = FLOAT_CLASS_ID;
+      break;
+
+    default:
+      ident = CHAR_CLASS_ID;
+      break;
+    }
+    NextToken();
+    statement = ParseMethodCall(ident, depth + 1);
+  }
   // other
   else {
     switch(GetToken()) { 
@@ -1441,6 +1598,54 @@ Statement* Parser::ParseStatement(int depth)
       NextToken();
       break;
 
+    case FILE_IN_LINE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_IN_LINE);
+      NextToken();
+      break;
+
+    case FILE_MAP_OPEN:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_OPEN);
+      NextToken();
+      break;
+
+    case FILE_MAP_CLOSE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_CLOSE);
+      NextToken();
+      break;
+
+    case FILE_MAP_IN_BYTE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_IN_BYTE);
+      NextToken();
+      break;
+
+    case FILE_MAP_IN_BYTE_ARY:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_IN_BYTE_ARY);
+      NextToken();
+      break;
+
+    case FILE_MAP_IN_LINE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_IN_LINE);
+      NextToken();
+      break;
+
+    case FILE_MAP_IN_STRING:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_IN_STRING);
+      NextToken();
+      break;
+
+    case FILE_MAP_SLICE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FILE_MAP_SLICE);
+      NextToken();
+      break;
+
     case DIR_CREATE:
       statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
                                                                instructions::DIR_CREATE);
@@ -1716,6 +1921,258 @@ Statement* Parser::ParseStatement(int depth)
                                                                instructions::DESERL_FLOAT_ARY);
       NextToken();
       break;
+
+    case SERL_OBJ_FILE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::SERL_OBJ_FILE);
+      NextToken();
+      break;
+
+    case SERL_OBJ_SOCK:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::SERL_OBJ_SOCK);
+      NextToken();
+      break;
+
+    case DESERL_OBJ_FILE:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::DESERL_OBJ_FILE);
+      NextToken();
+      break;
+
+    case DESERL_OBJ_SOCK:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::DESERL_OBJ_SOCK);
+      NextToken();
+      break;
+
+    case INT_ARY_SORT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::INT_ARY_SORT);
+      NextToken();
+      break;
+
+    case INT_ARY_SEARCH:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::INT_ARY_SEARCH);
+      NextToken();
+      break;
+
+    case INT_ARY_FILL:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::INT_ARY_FILL);
+      NextToken();
+      break;
+
+    case INT_ARY_MIN:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::INT_ARY_MIN);
+      NextToken();
+      break;
+
+    case INT_ARY_MAX:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::INT_ARY_MAX);
+      NextToken();
+      break;
+
+    case INT_ARY_SUM:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::INT_ARY_SUM);
+      NextToken();
+      break;
+
+    case FLOAT_ARY_SORT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FLOAT_ARY_SORT);
+      NextToken();
+      break;
+
+    case FLOAT_ARY_SEARCH:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FLOAT_ARY_SEARCH);
+      NextToken();
+      break;
+
+    case FLOAT_ARY_FILL:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FLOAT_ARY_FILL);
+      NextToken();
+      break;
+
+    case FLOAT_ARY_MIN:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FLOAT_ARY_MIN);
+      NextToken();
+      break;
+
+    case FLOAT_ARY_MAX:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FLOAT_ARY_MAX);
+      NextToken();
+      break;
+
+    case FLOAT_ARY_SUM:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::FLOAT_ARY_SUM);
+      NextToken();
+      break;
+
+    case BYTE_ARY_SORT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_SORT);
+      NextToken();
+      break;
+
+    case BYTE_ARY_SEARCH:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_SEARCH);
+      NextToken();
+      break;
+
+    case BYTE_ARY_FILL:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_FILL);
+      NextToken();
+      break;
+
+    case BYTE_ARY_MIN:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_MIN);
+      NextToken();
+      break;
+
+    case BYTE_ARY_MAX:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_MAX);
+      NextToken();
+      break;
+
+    case BYTE_ARY_SUM:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_SUM);
+      NextToken();
+      break;
+
+    case CHAR_ARY_SORT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_SORT);
+      NextToken();
+      break;
+
+    case CHAR_ARY_SEARCH:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_SEARCH);
+      NextToken();
+      break;
+
+    case CHAR_ARY_FILL:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_FILL);
+      NextToken();
+      break;
+
+    case CHAR_ARY_MIN:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_MIN);
+      NextToken();
+      break;
+
+    case CHAR_ARY_MAX:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_MAX);
+      NextToken();
+      break;
+
+    case CHAR_ARY_SUM:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_SUM);
+      NextToken();
+      break;
+
+    case BYTE_ARY_IS_UTF8:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_IS_UTF8);
+      NextToken();
+      break;
+
+    case CHAR_ARY_FIND:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_FIND);
+      NextToken();
+      break;
+
+    case CHAR_ARY_FIND_LAST:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_FIND_LAST);
+      NextToken();
+      break;
+
+    case CHAR_ARY_FIND_ARY:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_FIND_ARY);
+      NextToken();
+      break;
+
+    case CHAR_ARY_CMP:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_CMP);
+      NextToken();
+      break;
+
+    case CHAR_ARY_UPPER:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_UPPER);
+      NextToken();
+      break;
+
+    case CHAR_ARY_LOWER:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_LOWER);
+      NextToken();
+      break;
+
+    case CHAR_ARY_TO_BASE64:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_TO_BASE64);
+      NextToken();
+      break;
+
+    case CHAR_ARY_FROM_BASE64:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_FROM_BASE64);
+      NextToken();
+      break;
+
+    case CHAR_ARY_APPEND_INT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_APPEND_INT);
+      NextToken();
+      break;
+
+    case CHAR_ARY_APPEND_FLOAT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::CHAR_ARY_APPEND_FLOAT);
+      NextToken();
+      break;
+
+    case BYTE_ARY_APPEND_INT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_APPEND_INT);
+      NextToken();
+      break;
+
+    case BYTE_ARY_APPEND_FLOAT:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_APPEND_FLOAT);
+      NextToken();
+      break;
+
+    case BYTE_ARY_APPEND_CHARS:
+      statement = TreeFactory::Instance()->MakeSystemStatement(file_name, line_num,
+                                                               instructions::BYTE_ARY_APPEND_CHARS);
+      NextToken();
+      break;
 #endif
 
     default:
@@ -2835,8 +3292,12 @@ void Parser::ParseAnonymousClass(MethodCall* method_call, int depth)
     return;
   }
   
-  const wstring cls_name = method_call->GetVariableName() + L".#Anonymous." + 
-    ToString(anonymous_class_id++) + L'#';
+  // ids are unique within a file, so that files can be parsed independently
+  wstring cls_name = method_call->GetVariableName() + L".#Anonymous.";
+  if(file_id > 0) {
+    cls_name += ToString(file_id) + L'.';
+  }
+  cls_name += ToString(anonymous_class_id++) + L'#';
   
   vector<wstring> interface_names;
   if(Match(TOKEN_IMPLEMENTS_ID)) {
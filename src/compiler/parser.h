@@ -33,12 +33,31 @@
 #define __PARSER_H__
 
 #include "scanner.h"
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 using namespace frontend;
 
 #define SECOND_INDEX 1
 #define THIRD_INDEX 2
 #define DEFAULT_BUNDLE_NAME L"Default"
+#define MAX_PARSE_THREADS 64
+
+class Parser;
+
+/****************************
+ * Source files parsed by a
+ * thread
+ ****************************/
+struct ParseTask {
+  vector<Parser*>* parsers;
+  size_t start;
+  size_t stride;
+};
 
 /****************************
  * Parsers source files.
@@ -56,6 +75,10 @@ class Parser {
   wstring src_path;
   wstring run_prgm;
   unsigned int anonymous_class_id;
+  size_t file_id;
+  // bundles and uses in parsed order
+  vector<ParsedBundle*> parsed_bundles;
+  vector<wstring> parsed_uses;
   
   inline void NextToken() {
     scanner->NextToken();
@@ -150,8 +173,16 @@ class Parser {
   bool CheckErrors();
 
   // parsing operations
+  void ParseFiles(const vector<wstring> &file_names);
   void ParseFile(const wstring& file_name);
   void ParseProgram();
+  void AddParsed(Parser* parser);
+#ifdef _WIN32
+  static unsigned int __stdcall RunParseTask(void* arg);
+#else
+  static void* RunParseTask(void* arg);
+#endif
+  static size_t GetParseThreads(size_t num_files);
   void ParseBundle(int depth);
   wstring ParseBundleName(int depth);
   Class* ParseClass(const wstring &bundle_id, int depth);
@@ -199,6 +230,18 @@ class Parser {
     current_class = NULL;
     current_method = prev_method = NULL;
     anonymous_class_id = 0;
+    file_id = 0;
+  }
+
+  // parses a single source file
+  Parser(const wstring &f, size_t i) {
+    src_path = f;
+    program = NULL;
+    LoadErrorCodes();
+    current_class = NULL;
+    current_method = prev_method = NULL;
+    anonymous_class_id = 0;
+    file_id = i;
   }
 
   ~Parser() {
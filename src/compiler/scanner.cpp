@@ -197,6 +197,14 @@ void Scanner::LoadKeywords()
   ident_map[L"FILE_IS_OPEN"] = FILE_IS_OPEN;
   ident_map[L"FILE_DELETE"] = FILE_DELETE;
   ident_map[L"FILE_RENAME"] = FILE_RENAME;
+  ident_map[L"FILE_IN_LINE"] = FILE_IN_LINE;
+  ident_map[L"FILE_MAP_OPEN"] = FILE_MAP_OPEN;
+  ident_map[L"FILE_MAP_CLOSE"] = FILE_MAP_CLOSE;
+  ident_map[L"FILE_MAP_IN_BYTE"] = FILE_MAP_IN_BYTE;
+  ident_map[L"FILE_MAP_IN_BYTE_ARY"] = FILE_MAP_IN_BYTE_ARY;
+  ident_map[L"FILE_MAP_IN_LINE"] = FILE_MAP_IN_LINE;
+  ident_map[L"FILE_MAP_IN_STRING"] = FILE_MAP_IN_STRING;
+  ident_map[L"FILE_MAP_SLICE"] = FILE_MAP_SLICE;
   ident_map[L"DIR_CREATE"] = DIR_CREATE;
   ident_map[L"DIR_EXISTS"] = DIR_EXISTS;
   ident_map[L"DIR_LIST"] = DIR_LIST;
@@ -268,6 +276,48 @@ void Scanner::LoadKeywords()
   ident_map[L"DESERL_CHAR"] = DESERL_CHAR;
   ident_map[L"DESERL_INT_ARY"] = DESERL_INT_ARY;
   ident_map[L"DESERL_FLOAT_ARY"] = DESERL_FLOAT_ARY;
+  ident_map[L"SERL_OBJ_FILE"] = SERL_OBJ_FILE;
+  ident_map[L"SERL_OBJ_SOCK"] = SERL_OBJ_SOCK;
+  ident_map[L"DESERL_OBJ_FILE"] = DESERL_OBJ_FILE;
+  ident_map[L"DESERL_OBJ_SOCK"] = DESERL_OBJ_SOCK;
+  ident_map[L"INT_ARY_SORT"] = INT_ARY_SORT;
+  ident_map[L"INT_ARY_SEARCH"] = INT_ARY_SEARCH;
+  ident_map[L"INT_ARY_FILL"] = INT_ARY_FILL;
+  ident_map[L"INT_ARY_MIN"] = INT_ARY_MIN;
+  ident_map[L"INT_ARY_MAX"] = INT_ARY_MAX;
+  ident_map[L"INT_ARY_SUM"] = INT_ARY_SUM;
+  ident_map[L"FLOAT_ARY_SORT"] = FLOAT_ARY_SORT;
+  ident_map[L"FLOAT_ARY_SEARCH"] = FLOAT_ARY_SEARCH;
+  ident_map[L"FLOAT_ARY_FILL"] = FLOAT_ARY_FILL;
+  ident_map[L"FLOAT_ARY_MIN"] = FLOAT_ARY_MIN;
+  ident_map[L"FLOAT_ARY_MAX"] = FLOAT_ARY_MAX;
+  ident_map[L"FLOAT_ARY_SUM"] = FLOAT_ARY_SUM;
+  ident_map[L"BYTE_ARY_SORT"] = BYTE_ARY_SORT;
+  ident_map[L"BYTE_ARY_SEARCH"] = BYTE_ARY_SEARCH;
+  ident_map[L"BYTE_ARY_FILL"] = BYTE_ARY_FILL;
+  ident_map[L"BYTE_ARY_MIN"] = BYTE_ARY_MIN;
+  ident_map[L"BYTE_ARY_MAX"] = BYTE_ARY_MAX;
+  ident_map[L"BYTE_ARY_SUM"] = BYTE_ARY_SUM;
+  ident_map[L"CHAR_ARY_SORT"] = CHAR_ARY_SORT;
+  ident_map[L"CHAR_ARY_SEARCH"] = CHAR_ARY_SEARCH;
+  ident_map[L"CHAR_ARY_FILL"] = CHAR_ARY_FILL;
+  ident_map[L"CHAR_ARY_MIN"] = CHAR_ARY_MIN;
+  ident_map[L"CHAR_ARY_MAX"] = CHAR_ARY_MAX;
+  ident_map[L"CHAR_ARY_SUM"] = CHAR_ARY_SUM;
+  ident_map[L"BYTE_ARY_IS_UTF8"] = BYTE_ARY_IS_UTF8;
+  ident_map[L"CHAR_ARY_FIND"] = CHAR_ARY_FIND;
+  ident_map[L"CHAR_ARY_FIND_LAST"] = CHAR_ARY_FIND_LAST;
+  ident_map[L"CHAR_ARY_FIND_ARY"] = CHAR_ARY_FIND_ARY;
+  ident_map[L"CHAR_ARY_CMP"] = CHAR_ARY_CMP;
+  ident_map[L"CHAR_ARY_UPPER"] = CHAR_ARY_UPPER;
+  ident_map[L"CHAR_ARY_LOWER"] = CHAR_ARY_LOWER;
+  ident_map[L"CHAR_ARY_TO_BASE64"] = CHAR_ARY_TO_BASE64;
+  ident_map[L"CHAR_ARY_FROM_BASE64"] = CHAR_ARY_FROM_BASE64;
+  ident_map[L"CHAR_ARY_APPEND_INT"] = CHAR_ARY_APPEND_INT;
+  ident_map[L"CHAR_ARY_APPEND_FLOAT"] = CHAR_ARY_APPEND_FLOAT;
+  ident_map[L"BYTE_ARY_APPEND_INT"] = BYTE_ARY_APPEND_INT;
+  ident_map[L"BYTE_ARY_APPEND_FLOAT"] = BYTE_ARY_APPEND_FLOAT;
+  ident_map[L"BYTE_ARY_APPEND_CHARS"] = BYTE_ARY_APPEND_CHARS;
 #endif
 }
 
@@ -280,7 +330,7 @@ void Scanner::CheckIdentifier(int index)
   try {
     // copy string
     const int length = end_pos - start_pos;
-    wstring ident(buffer, start_pos, length);
+    wstring ident(buffer + start_pos, length);
     // check string
     ScannerTokenType ident_type = ident_map[ident];
     switch(ident_type) {
@@ -384,6 +434,14 @@ void Scanner::CheckIdentifier(int index)
     case FILE_IS_OPEN:
     case FILE_DELETE:
     case FILE_RENAME:
+    case FILE_IN_LINE:
+    case FILE_MAP_OPEN:
+    case FILE_MAP_CLOSE:
+    case FILE_MAP_IN_BYTE:
+    case FILE_MAP_IN_BYTE_ARY:
+    case FILE_MAP_IN_LINE:
+    case FILE_MAP_IN_STRING:
+    case FILE_MAP_SLICE:
     case DIR_CREATE:
     case DIR_EXISTS:
     case DIR_LIST:
@@ -455,6 +513,48 @@ void Scanner::CheckIdentifier(int index)
     case DESERL_CHAR:
     case DESERL_INT_ARY:
     case DESERL_FLOAT_ARY:
+    case SERL_OBJ_FILE:
+    case SERL_OBJ_SOCK:
+    case DESERL_OBJ_FILE:
+    case DESERL_OBJ_SOCK:
+    case INT_ARY_SORT:
+    case INT_ARY_SEARCH:
+    case INT_ARY_FILL:
+    case INT_ARY_MIN:
+    case INT_ARY_MAX:
+    case INT_ARY_SUM:
+    case FLOAT_ARY_SORT:
+    case FLOAT_ARY_SEARCH:
+    case FLOAT_ARY_FILL:
+    case FLOAT_ARY_MIN:
+    case FLOAT_ARY_MAX:
+    case FLOAT_ARY_SUM:
+    case BYTE_ARY_SORT:
+    case BYTE_ARY_SEARCH:
+    case BYTE_ARY_FILL:
+    case BYTE_ARY_MIN:
+    case BYTE_ARY_MAX:
+    case BYTE_ARY_SUM:
+    case CHAR_ARY_SORT:
+    case CHAR_ARY_SEARCH:
+    case CHAR_ARY_FILL:
+    case CHAR_ARY_MIN:
+    case CHAR_ARY_MAX:
+    case CHAR_ARY_SUM:
+    case BYTE_ARY_IS_UTF8:
+    case CHAR_ARY_FIND:
+    case CHAR_ARY_FIND_LAST:
+    case CHAR_ARY_FIND_ARY:
+    case CHAR_ARY_CMP:
+    case CHAR_ARY_UPPER:
+    case CHAR_ARY_LOWER:
+    case CHAR_ARY_TO_BASE64:
+    case CHAR_ARY_FROM_BASE64:
+    case CHAR_ARY_APPEND_INT:
+    case CHAR_ARY_APPEND_FLOAT:
+    case BYTE_ARY_APPEND_INT:
+    case BYTE_ARY_APPEND_FLOAT:
+    case BYTE_ARY_APPEND_CHARS:
 #endif
       tokens[index]->SetType(ident_type);
       break;
@@ -196,6 +196,15 @@ enum ScannerTokenType {
   FILE_OUT_BYTE,
   FILE_OUT_BYTE_ARY,
   FILE_OUT_STRING,
+  // large file-in
+  FILE_IN_LINE,
+  FILE_MAP_OPEN,
+  FILE_MAP_CLOSE,
+  FILE_MAP_IN_BYTE,
+  FILE_MAP_IN_BYTE_ARY,
+  FILE_MAP_IN_LINE,
+  FILE_MAP_IN_STRING,
+  FILE_MAP_SLICE,
   // file-operations
   FILE_EXISTS,
   FILE_IS_OPEN,
@@ -259,6 +268,50 @@ enum ScannerTokenType {
   DESERL_CHAR_ARY,
   DESERL_INT_ARY,
   DESERL_FLOAT_ARY,
+  SERL_OBJ_FILE,
+  SERL_OBJ_SOCK,
+  DESERL_OBJ_FILE,
+  DESERL_OBJ_SOCK,
+  // array operations
+  INT_ARY_SORT,
+  INT_ARY_SEARCH,
+  INT_ARY_FILL,
+  INT_ARY_MIN,
+  INT_ARY_MAX,
+  INT_ARY_SUM,
+  FLOAT_ARY_SORT,
+  FLOAT_ARY_SEARCH,
+  FLOAT_ARY_FILL,
+  FLOAT_ARY_MIN,
+  FLOAT_ARY_MAX,
+  FLOAT_ARY_SUM,
+  BYTE_ARY_SORT,
+  BYTE_ARY_SEARCH,
+  BYTE_ARY_FILL,
+  BYTE_ARY_MIN,
+  BYTE_ARY_MAX,
+  BYTE_ARY_SUM,
+  CHAR_ARY_SORT,
+  CHAR_ARY_SEARCH,
+  CHAR_ARY_FILL,
+  CHAR_ARY_MIN,
+  CHAR_ARY_MAX,
+  CHAR_ARY_SUM,
+  // string operations
+  BYTE_ARY_IS_UTF8,
+  CHAR_ARY_FIND,
+  CHAR_ARY_FIND_LAST,
+  CHAR_ARY_FIND_ARY,
+  CHAR_ARY_CMP,
+  CHAR_ARY_UPPER,
+  CHAR_ARY_LOWER,
+  CHAR_ARY_TO_BASE64,
+  CHAR_ARY_FROM_BASE64,
+  CHAR_ARY_APPEND_INT,
+  CHAR_ARY_APPEND_FLOAT,
+  BYTE_ARY_APPEND_INT,
+  BYTE_ARY_APPEND_FLOAT,
+  BYTE_ARY_APPEND_CHARS,
   // shared library support
   DLL_LOAD,
   DLL_UNLOAD,
@@ -445,6 +498,21 @@ class Scanner {
       exit(1);
     }
 
+    // ASCII fast path
+    size_t i = 0;
+    while(i < buffer_size && buffer[i] && !(buffer[i] & 0x80)) {
+      i++;
+    }
+    if(i == buffer_size) {
+      wchar_t* wbuffer = new wchar_t[buffer_size + 1];
+      for(i = 0; i < buffer_size; i++) {
+        wbuffer[i] = buffer[i];
+      }
+      wbuffer[buffer_size] = L'\0';
+      free(buffer);
+      return wbuffer;
+    }
+
     // convert unicode
 #ifdef _WIN32
     int wsize = MultiByteToWideChar(CP_UTF8, 0, buffer, -1, NULL, 0);
@@ -484,7 +552,7 @@ class Scanner {
   inline void CheckString(int index, bool is_valid) {
     // copy string
     const int length = end_pos - start_pos;
-    wstring char_string(buffer, start_pos, length);
+    wstring char_string(buffer + start_pos, length);
     // set string
     if(is_valid) {
       tokens[index]->SetType(TOKEN_CHAR_STRING_LIT);
@@ -501,7 +569,7 @@ class Scanner {
   inline void ParseInteger(int index, int base = 0) {
     // copy string
     int length = end_pos - start_pos;
-    wstring ident(buffer, start_pos, length);
+    wstring ident(buffer + start_pos, length);
 
     // set token
     wchar_t* end;
@@ -515,7 +583,7 @@ class Scanner {
   inline void ParseDouble(int index) {
     // copy string
     const int length = end_pos - start_pos;
-    wstring ident(buffer, start_pos, length);
+    wstring ident(buffer + start_pos, length);
     // set token
     tokens[index]->SetType(TOKEN_FLOAT_LIT);
     tokens[index]->SetFloatLit(wcstod(ident.c_str(), NULL));
@@ -528,7 +596,7 @@ class Scanner {
     // copy string
     const int length = end_pos - start_pos;
     if(length < 5) {
-      wstring ident(buffer, start_pos, length);
+      wstring ident(buffer + start_pos, length);
       // set token
       tokens[index]->SetType(TOKEN_CHAR_LIT);
       tokens[index]->SetCharLit((wchar_t)wcstol(ident.c_str(), NULL, 16));
@@ -110,6 +110,7 @@ namespace backend {
     FLOAT_VALUE operand4;
     wstring operand5;
     wstring operand6;
+    vector<int> table;
     int line_num;
 
     IntermediateInstruction(int l, InstructionType t) {
@@ -138,6 +139,14 @@ namespace backend {
       operand3 = o3;
     }
 
+    IntermediateInstruction(int l, InstructionType t, int o1, int o2, vector<int> tbl) {
+      line_num = l;
+      type = t;
+      operand = o1;
+      operand2 = o2;
+      table = tbl;
+    }
+
     IntermediateInstruction(int l, InstructionType t, FLOAT_VALUE o4) {
       line_num = l;
       type = t;
@@ -167,6 +176,7 @@ namespace backend {
       operand4 = lib_instr->GetOperand4();
       operand5 = lib_instr->GetOperand5();
       operand6 = lib_instr->GetOperand6();
+      table = lib_instr->GetTable();
     }
 
     ~IntermediateInstruction() {
@@ -189,10 +199,18 @@ namespace backend {
       return operand4;
     }
 
+    vector<int> GetTable() {
+      return table;
+    }
+
     void SetOperand3(int o3) {
       operand3 = o3;
     }
 
+    int GetLineNumber() {
+      return line_num;
+    }
+
     void Write(bool is_debug, ofstream* file_out) {
       WriteByte((int)type, file_out);
       if(is_debug) {
@@ -271,6 +289,15 @@ namespace backend {
         WriteInt(operand, file_out);
         break;
 
+      case TBL_SWITCH:
+        WriteInt(operand, file_out);
+        WriteInt(operand2, file_out);
+        WriteInt(table.size(), file_out);
+        for(size_t i = 0; i < table.size(); ++i) {
+          WriteInt(table[i], file_out);
+        }
+        break;
+
       default:
         break;
       }
@@ -701,6 +728,11 @@ namespace backend {
         wcout << L"TRAP_RTRN: args=" << operand << endl;
         break;
 
+      case TBL_SWITCH:
+        wcout << L"TBL_SWITCH: low=" << operand << L", other=" << operand2 
+          << L", size=" << table.size() << endl;
+        break;
+
       default:
         break;
       }
@@ -719,13 +751,11 @@ namespace backend {
     static IntermediateFactory* Instance();
 
     void Clear() {
-      while(!instructions.empty()) {
-        IntermediateInstruction* tmp = instructions.front();
-        instructions.erase(instructions.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < instructions.size(); ++i) {
+        delete instructions[i];
+        instructions[i] = NULL;
       }
+      instructions.clear();
 
       delete instance;
       instance = NULL;
@@ -755,6 +785,12 @@ namespace backend {
       return tmp;
     }
 
+    IntermediateInstruction* MakeInstruction(int l, InstructionType t, int o1, int o2, vector<int> tbl) {
+      IntermediateInstruction* tmp = new IntermediateInstruction(l, t, o1, o2, tbl);
+      instructions.push_back(tmp);
+      return tmp;
+    }
+
     IntermediateInstruction* MakeInstruction(int l, InstructionType t, FLOAT_VALUE o4) {
       IntermediateInstruction* tmp = new IntermediateInstruction(l, t, o4);
       instructions.push_back(tmp);
@@ -844,6 +880,7 @@ namespace backend {
     bool is_lib;
     bool is_virtual;
     bool has_and_or;
+    bool is_unused;
     int instr_count;
     vector<IntermediateBlock*> blocks;
     IntermediateDeclarations* entries;
@@ -866,6 +903,7 @@ namespace backend {
         params = p;
         entries = e;
         is_lib = false;
+        is_unused = false;
         klass = k;
         instr_count = 0;
     }
@@ -884,6 +922,7 @@ namespace backend {
       params = lib_method->GetNumParams();
       entries = lib_method->GetEntries();
       is_lib = true;
+      is_unused = false;
       instr_count = 0;
       klass = k;
       // process instructions
@@ -897,13 +936,11 @@ namespace backend {
 
     ~IntermediateMethod() {
       // clean up
-      while(!blocks.empty()) {
-        IntermediateBlock* tmp = blocks.front();
-        blocks.erase(blocks.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < blocks.size(); ++i) {
+        delete blocks[i];
+        blocks[i] = NULL;
       }
+      blocks.clear();
 
       if(entries) {
         delete entries;
@@ -935,6 +972,26 @@ namespace backend {
       return is_virtual;
     }
 
+    bool IsNative() {
+      return is_native;
+    }
+
+    void SetNative(bool n) {
+      is_native = n;
+    }
+
+    wstring GetEncodedReturn() {
+      return rtrn_name;
+    }
+
+    bool IsUnused() {
+      return is_unused;
+    }
+
+    void SetUnused(bool u) {
+      is_unused = u;
+    }
+
     bool IsLibrary() {
       return is_lib;
     }
@@ -952,6 +1009,10 @@ namespace backend {
       return params;
     }
 
+    IntermediateDeclarations* GetEntries() {
+      return entries;
+    }
+
     vector<IntermediateBlock*> GetBlocks() {
       return blocks;
     }
@@ -973,6 +1034,13 @@ namespace backend {
 
       // write local space size
       WriteInt(params, file_out);
+      // unreachable methods are kept for their ids and names
+      if(is_unused) {
+        WriteInt(0, file_out);
+        WriteInt(0, file_out);
+        WriteByte(END_STMTS, file_out);
+        return;
+      }
       WriteInt(space, file_out);
       entries->Write(is_debug, file_out);
 
@@ -1073,21 +1141,17 @@ namespace backend {
 
     ~IntermediateClass() {
       // clean up
-      while(!blocks.empty()) {
-        IntermediateBlock* tmp = blocks.front();
-        blocks.erase(blocks.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < blocks.size(); ++i) {
+        delete blocks[i];
+        blocks[i] = NULL;
       }
+      blocks.clear();
       // clean up
-      while(!methods.empty()) {
-        IntermediateMethod* tmp = methods.front();
-        methods.erase(methods.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < methods.size(); ++i) {
+        delete methods[i];
+        methods[i] = NULL;
       }
+      methods.clear();
 
       // clean up
       if(cls_entries) {
@@ -1113,10 +1177,30 @@ namespace backend {
       return is_lib;
     }
 
+    bool IsInterface() {
+      return is_interface;
+    }
+
+    bool IsVirtual() {
+      return is_virtual;
+    }
+
+    const wstring& GetParentName() {
+      return parent_name;
+    }
+
+    vector<int> GetInterfaceIds() {
+      return interface_ids;
+    }
+
     int GetInstanceSpace() {
       return inst_space;
     }
 
+    IntermediateDeclarations* GetInstanceEntries() {
+      return inst_entries;
+    }
+
     void SetInstanceSpace(int s) {
       inst_space = s;
     }
@@ -1146,6 +1230,16 @@ namespace backend {
       return result->second;
     }
 
+    IntermediateMethod* GetMethod(const wstring &n) {
+      for(size_t i = 0; i < methods.size(); ++i) {
+        if(methods[i]->GetName() == n) {
+          return methods[i];
+        }
+      }
+
+      return NULL;
+    }
+
     vector<IntermediateMethod*> GetMethods() {
       return methods;
     }
@@ -1182,9 +1276,13 @@ namespace backend {
       cls_entries->Write(is_debug, file_out);
       inst_entries->Write(is_debug, file_out);
 
-      // write methods
-      WriteInt((int)methods.size(), file_out);
-      for(size_t i = 0; i < methods.size(); ++i) {
+      // write methods, none if they are all unreachable
+      bool is_used = false;
+      for(size_t i = 0; !is_used && i < methods.size(); ++i) {
+        is_used = !methods[i]->IsUnused();
+      }
+      WriteInt(is_used ? (int)methods.size() : 0, file_out);
+      for(size_t i = 0; is_used && i < methods.size(); ++i) {
         methods[i]->Write(is_debug, file_out);
       }
     }
@@ -1271,13 +1369,11 @@ namespace backend {
     }
 
     ~IntermediateEnum() {
-      while(!items.empty()) {
-        IntermediateEnumItem* tmp = items.front();
-        items.erase(items.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < items.size(); ++i) {
+        delete items[i];
+        items[i] = NULL;
       }
+      items.clear();
     }
 
     void AddItem(IntermediateEnumItem* i) {
@@ -1330,41 +1426,37 @@ namespace backend {
 
     ~IntermediateProgram() {
       // clean up
-      while(!enums.empty()) {
-        IntermediateEnum* tmp = enums.front();
-        enums.erase(enums.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < enums.size(); ++i) {
+        delete enums[i];
+        enums[i] = NULL;
       }
+      enums.clear();
 
-      while(!classes.empty()) {
-        IntermediateClass* tmp = classes.front();
-        classes.erase(classes.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < classes.size(); ++i) {
+        delete classes[i];
+        classes[i] = NULL;
       }
+      classes.clear();
 
-      while(!int_strings.empty()) {
-        frontend::IntStringHolder* tmp = int_strings.front();
+      for(size_t i = 0; i < int_strings.size(); ++i) {
+        frontend::IntStringHolder* tmp = int_strings[i];
         delete[] tmp->value;
         tmp->value = NULL;
-        int_strings.erase(int_strings.begin());
         // delete
         delete tmp;
         tmp = NULL;
       }
+      int_strings.clear();
 
-      while(!float_strings.empty()) {
-        frontend::FloatStringHolder* tmp = float_strings.front();
+      for(size_t i = 0; i < float_strings.size(); ++i) {
+        frontend::FloatStringHolder* tmp = float_strings[i];
         delete[] tmp->value;
         tmp->value = NULL;
-        float_strings.erase(float_strings.begin());
         // delete
         delete tmp;
         tmp = NULL;
       }
+      float_strings.clear();
 
       IntermediateFactory::Instance()->Clear();
     }
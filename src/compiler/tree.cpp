@@ -125,10 +125,7 @@ wstring Method::EncodeType(Type* type, ParsedProgram* program, Linker* linker)
       wstring klass_name = type->GetClassName();
       Class* klass = program->GetClass(klass_name);
       if(!klass) {
-        vector<wstring> uses = program->GetUses();
-        for(size_t i = 0; !klass && i < uses.size(); ++i) {
-          klass = program->GetClass(uses[i] + L"." + klass_name);
-        }
+        klass = program->GetUseClass(klass_name);
       }
       if(klass) {
         name += klass->GetName();
@@ -180,13 +180,11 @@ namespace frontend {
 
     ~ScopeTable() {
       // clean up
-      while(!children.empty()) {
-        ScopeTable* tmp = children.front();
-        children.erase(children.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < children.size(); ++i) {
+        delete children[i];
+        children[i] = NULL;
       }
+      children.clear();
     }
 
     vector<SymbolEntry*> GetEntries() {
@@ -803,13 +801,11 @@ namespace frontend {
     }
 
     ~CharacterString() {      
-      while(!segments.empty()) {
-        CharacterStringSegment* tmp = segments.front();
-        segments.erase(segments.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < segments.size(); ++i) {
+        delete segments[i];
+        segments[i] = NULL;
       }
+      segments.clear();
     }
 
   public:
@@ -2514,81 +2510,96 @@ namespace frontend {
     vector<MethodCall*> calls;
     vector<SymbolEntry*> entries;
     vector<Declaration*> declarations;
+    // source files are parsed in parallel
+#ifdef _WIN32
+    CRITICAL_SECTION nodes_cs;
+#else
+    pthread_mutex_t nodes_mutex;
+#endif
 
     TreeFactory() {
+#ifdef _WIN32
+      InitializeCriticalSection(&nodes_cs);
+#else
+      pthread_mutex_init(&nodes_mutex, NULL);
+#endif
     }
 
     ~TreeFactory() {
+#ifdef _WIN32
+      DeleteCriticalSection(&nodes_cs);
+#else
+      pthread_mutex_destroy(&nodes_mutex);
+#endif
+    }
+
+    template<class T, class N> N* AddNode(vector<T*> &list, N* tmp) {
+#ifdef _WIN32
+      EnterCriticalSection(&nodes_cs);
+#else
+      pthread_mutex_lock(&nodes_mutex);
+#endif
+      list.push_back(tmp);
+#ifdef _WIN32
+      LeaveCriticalSection(&nodes_cs);
+#else
+      pthread_mutex_unlock(&nodes_mutex);
+#endif
+      return tmp;
     }
 
   public:
     static TreeFactory* Instance();
 
     void Clear() {
-      while(!nodes.empty()) {
-        ParseNode* tmp = nodes.front();
-        nodes.erase(nodes.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < nodes.size(); ++i) {
+        delete nodes[i];
+        nodes[i] = NULL;
       }
+      nodes.clear();
 
-      while(!expressions.empty()) {
-        Expression* tmp = expressions.front();
-        expressions.erase(expressions.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < expressions.size(); ++i) {
+        delete expressions[i];
+        expressions[i] = NULL;
       }
+      expressions.clear();
 
-      while(!statements.empty()) {
-        Statement* tmp = statements.front();
-        statements.erase(statements.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < statements.size(); ++i) {
+        delete statements[i];
+        statements[i] = NULL;
       }
+      statements.clear();
 
-      while(!declaration_lists.empty()) {
-        DeclarationList* tmp = declaration_lists.front();
-        declaration_lists.erase(declaration_lists.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < declaration_lists.size(); ++i) {
+        delete declaration_lists[i];
+        declaration_lists[i] = NULL;
       }
       declaration_lists.clear();
+      declaration_lists.clear();
 
-      while(!statement_lists.empty()) {
-        StatementList* tmp = statement_lists.front();
-        statement_lists.erase(statement_lists.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < statement_lists.size(); ++i) {
+        delete statement_lists[i];
+        statement_lists[i] = NULL;
       }
+      statement_lists.clear();
 
-      while(!expression_lists.empty()) {
-        ExpressionList* tmp = expression_lists.front();
-        expression_lists.erase(expression_lists.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < expression_lists.size(); ++i) {
+        delete expression_lists[i];
+        expression_lists[i] = NULL;
       }
+      expression_lists.clear();
 
-      while(!calls.empty()) {
-        MethodCall* tmp = calls.front();
-        calls.erase(calls.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < calls.size(); ++i) {
+        delete calls[i];
+        calls[i] = NULL;
       }
+      calls.clear();
 
-      while(!entries.empty()) {
-        SymbolEntry* tmp = entries.front();
-        entries.erase(entries.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < entries.size(); ++i) {
+        delete entries[i];
+        entries[i] = NULL;
       }
+      entries.clear();
 
       delete instance;
       instance = NULL;
@@ -2596,207 +2607,174 @@ namespace frontend {
 
     Enum* MakeEnum(const wstring &file_name, const int line_num, wstring &name, int offset) {
       Enum* tmp = new Enum(file_name, line_num, name, offset);
-      nodes.push_back(tmp);
-      return tmp;
+      return AddNode(nodes, tmp);
     }
 
     EnumItem* MakeEnumItem(const wstring &file_name, const int line_num, const wstring &name, Enum* e) {
       EnumItem* tmp = new EnumItem(file_name, line_num, name, e);
-      nodes.push_back(tmp);
-      return tmp;
+      return AddNode(nodes, tmp);
     }
 
     Class* MakeClass(const wstring &file_name, const int line_num, const wstring &name, 
       const wstring &parent_name, vector<wstring> enforces, 
       bool is_interface) {
         Class* tmp = new Class(file_name, line_num, name, parent_name, enforces, is_interface);
-        nodes.push_back(tmp);
-        return tmp;
+        return AddNode(nodes, tmp);
     }
 
     Method* MakeMethod(const wstring &file_name, const int line_num, const wstring &name, MethodType type, bool is_function, bool is_native) {
       Method* tmp = new Method(file_name, line_num, name, type, is_function, is_native);
-      nodes.push_back(tmp);
-      return tmp;
+      return AddNode(nodes, tmp);
     }
 
     StatementList* MakeStatementList() {
       StatementList* tmp = new StatementList;
-      statement_lists.push_back(tmp);
-      return tmp;
+      return AddNode(statement_lists, tmp);
     }
 
     DeclarationList* MakeDeclarationList() {
       DeclarationList* tmp = new DeclarationList;
-      declaration_lists.push_back(tmp);
-      return tmp;
+      return AddNode(declaration_lists, tmp);
     }
 
     ExpressionList* MakeExpressionList() {
       ExpressionList* tmp = new ExpressionList;
-      expression_lists.push_back(tmp);
-      return tmp;
+      return AddNode(expression_lists, tmp);
     }
 
     SystemStatement* MakeSystemStatement(const wstring &file_name, const int line_num, instructions::InstructionType instr) {
       SystemStatement* tmp = new SystemStatement(file_name, line_num, instr);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     SystemStatement* MakeSystemStatement(const wstring &file_name, const int line_num, instructions::Traps trap) {
       SystemStatement* tmp = new SystemStatement(file_name, line_num, trap);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     SimpleStatement* MakeSimpleStatement(const wstring &file_name, const int line_num, Expression* expression) {
       SimpleStatement* tmp = new SimpleStatement(file_name, line_num, expression);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     EmptyStatement* MakeEmptyStatement(const wstring &file_name, const int line_num) {
       EmptyStatement*  tmp = new EmptyStatement(file_name, line_num);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
     
     Variable* MakeVariable(const wstring &file_name, int line_num, const wstring &name) {
       Variable* tmp = new Variable(file_name, line_num, name);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     Cond* MakeCond(const wstring &f, const int l, Expression* c, Expression* s, Expression* e) {
       Cond* tmp = new Cond(f, l, c, s, e);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     StaticArray* MakeStaticArray(const wstring &file_name, int line_num, ExpressionList* exprs) {
       StaticArray* tmp = new StaticArray(file_name, line_num, exprs);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     Declaration* MakeDeclaration(const wstring &file_name, const int line_num, SymbolEntry* entry, Assignment* assign) {
       Declaration* tmp = new Declaration(file_name, line_num, entry, assign);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     Declaration* MakeDeclaration(const wstring &file_name, const int line_num, SymbolEntry* entry) {
       Declaration* tmp = new Declaration(file_name, line_num, entry);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     CalculatedExpression* MakeCalculatedExpression(const wstring &file_name, int line_num, ExpressionType type) {
       CalculatedExpression* tmp = new CalculatedExpression(file_name, line_num, type);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     IntegerLiteral* MakeIntegerLiteral(const wstring &file_name, const int line_num, INT_VALUE value) {
       IntegerLiteral* tmp = new IntegerLiteral(file_name, line_num, value);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     FloatLiteral* MakeFloatLiteral(const wstring &file_name, const int line_num, FLOAT_VALUE value) {
       FloatLiteral* tmp = new FloatLiteral(file_name, line_num, value);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     CharacterLiteral* MakeCharacterLiteral(const wstring &file_name, const int line_num, wchar_t value) {
       CharacterLiteral* tmp = new CharacterLiteral(file_name, line_num, value);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     CharacterString* MakeCharacterString(const wstring &file_name, const int line_num, const wstring &char_string) {
       CharacterString* tmp = new CharacterString(file_name, line_num, char_string);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     NilLiteral* MakeNilLiteral(const wstring &file_name, const int line_num) {
       NilLiteral* tmp = new NilLiteral(file_name, line_num);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     BooleanLiteral* MakeBooleanLiteral(const wstring &file_name, const int line_num, bool boolean) {
       BooleanLiteral* tmp = new BooleanLiteral(file_name, line_num, boolean);
-      expressions.push_back(tmp);
-      return tmp;
+      return AddNode(expressions, tmp);
     }
 
     MethodCall* MakeMethodCall(const wstring &file_name, const int line_num, MethodCallType type,
       const wstring &value, ExpressionList* exprs) {
         MethodCall* tmp = new MethodCall(file_name, line_num, type, value, exprs);
-        calls.push_back(tmp);
-        return tmp;
+        return AddNode(calls, tmp);
     }
 
     MethodCall* MakeMethodCall(const wstring &f, const int l, const wstring &v, const wstring &m, ExpressionList* e) {
       MethodCall* tmp = new MethodCall(f, l, v, m, e);
-      calls.push_back(tmp);
-      return tmp;
+      return AddNode(calls, tmp);
     }
 
     MethodCall* MakeMethodCall(const wstring &f, const int l, const wstring &v, const wstring &m) {
       MethodCall* tmp = new MethodCall(f, l, v, m);
-      calls.push_back(tmp);
-      return tmp;
+      return AddNode(calls, tmp);
     }
 
     MethodCall* MakeMethodCall(const wstring &f, const int l, Variable* v, const wstring &m, ExpressionList* e) {
       MethodCall* tmp = new MethodCall(f, l, v, m, e);
-      calls.push_back(tmp);
-      return tmp;
+      return AddNode(calls, tmp);
     }
 
     If* MakeIf(const wstring &file_name, const int line_num, Expression* expression,
       StatementList* if_statements, If* next = NULL) {
         If* tmp = new If(file_name, line_num, expression, if_statements, next);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     Break* MakeBreak(const wstring &file_name, const int line_num) {
       Break* tmp = new Break(file_name, line_num);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     DoWhile* MakeDoWhile(const wstring &file_name, const int line_num,
       Expression* expression, StatementList* stmts) {
         DoWhile* tmp = new DoWhile(file_name, line_num, expression, stmts);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     While* MakeWhile(const wstring &file_name, const int line_num,
       Expression* expression, StatementList* stmts) {
         While* tmp = new While(file_name, line_num, expression, stmts);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     For* MakeFor(const wstring &file_name, const int line_num, Statement* pre_stmt, Expression* cond_expr,
       Statement* update_stmt, StatementList* stmts) {
         For* tmp = new For(file_name, line_num, pre_stmt, cond_expr, update_stmt, stmts);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     CriticalSection* MakeCriticalSection(const wstring &file_name, const int line_num, Variable* var, StatementList* stmts) {
       CriticalSection* tmp = new CriticalSection(file_name, line_num, var, stmts);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     Select* MakeSelect(const wstring &file_name, const int line_num, Expression* eval_expression,
@@ -2804,21 +2782,18 @@ namespace frontend {
       vector<StatementList*> statement_lists, StatementList* other) {
         Select* tmp = new Select(file_name, line_num, eval_expression, 
           statement_map, statement_lists, other);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     Return* MakeReturn(const wstring &file_name, const int line_num, Expression* expression) {
       Return* tmp = new Return(file_name, line_num, expression);
-      statements.push_back(tmp);
-      return tmp;
+      return AddNode(statements, tmp);
     }
 
     Assignment* MakeAssignment(const wstring &file_name, const int line_num,
       Variable* variable, Expression* expression) {
         Assignment* tmp = new Assignment(file_name, line_num, variable, expression);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     OperationAssignment* MakeOperationAssignment(const wstring &file_name, const int line_num,
@@ -2826,15 +2801,13 @@ namespace frontend {
       StatementType stmt_type) {
         OperationAssignment* tmp = new OperationAssignment(file_name, line_num, variable, 
           expression, stmt_type);
-        statements.push_back(tmp);
-        return tmp;
+        return AddNode(statements, tmp);
     }
 
     SymbolEntry* MakeSymbolEntry(const wstring &f, int l, const wstring &n,
       Type* t, bool s, bool c, bool e = false) {
         SymbolEntry* tmp = new SymbolEntry(f, l, n, t, s, c, e);
-        entries.push_back(tmp);
-        return tmp;
+        return AddNode(entries, tmp);
     }
   };
 
@@ -2953,43 +2926,85 @@ namespace frontend {
     vector<wstring> uses;
     vector<ParsedBundle*> bundles;
     vector<wstring> bundle_names;
+    unordered_map<wstring, size_t> use_index;
+    unordered_map<wstring, Class*> class_index;
+    unordered_map<wstring, Enum*> enum_index;
+    // indexed by name without bundle qualifiers
+    unordered_map<wstring, vector<Class*> > class_names;
+    unordered_map<wstring, vector<Enum*> > enum_names;
+    bool is_indexed;
     Class* start_class;
     Method* start_method;
     Linker* linker; // deleted elsewhere
 
+    // first bundle match wins
+    void BuildIndexes() {
+      class_index.clear();
+      enum_index.clear();
+      class_names.clear();
+      enum_names.clear();
+      for(size_t i = 0; i < bundles.size(); ++i) {
+        const vector<Class*> classes = bundles[i]->GetClasses();
+        for(size_t j = 0; j < classes.size(); ++j) {
+          const wstring &name = classes[j]->GetName();
+          if(class_index.insert(pair<wstring, Class*>(name, classes[j])).second) {
+            class_names[name.substr(name.find_last_of(L'.') + 1)].push_back(classes[j]);
+          }
+        }
+        
+        const vector<Enum*> enums = bundles[i]->GetEnums();
+        for(size_t j = 0; j < enums.size(); ++j) {
+          const wstring &name = enums[j]->GetName();
+          if(enum_index.insert(pair<wstring, Enum*>(name, enums[j])).second) {
+            enum_names[name.substr(name.find_last_of(L'.') + 1)].push_back(enums[j]);
+          }
+        }
+      }
+      is_indexed = true;
+    }
+
+    // position of the use that qualifies 'n' as 'full_name'
+    size_t GetUsePosition(const wstring &full_name, const wstring &n) {
+      const size_t offset = full_name.size() - n.size() - 1;
+      if(full_name.size() > n.size() + 1 && full_name[offset] == L'.' && 
+         full_name.compare(offset + 1, n.size(), n) == 0) {
+        unordered_map<wstring, size_t>::iterator result = use_index.find(full_name.substr(0, offset));
+        if(result != use_index.end()) {
+          return result->second;
+        }
+      }
+
+      return uses.size();
+    }
+
   public:
     ParsedProgram() {
       linker = NULL;
       start_class = NULL;
       start_method = NULL;
+      is_indexed = false;
     }
 
     ~ParsedProgram() {
       // clean up
-      while(!bundles.empty()) {
-        ParsedBundle* tmp = bundles.front();
-        bundles.erase(bundles.begin());
-        // delete
-        delete tmp;
-        tmp = NULL;
+      for(size_t i = 0; i < bundles.size(); ++i) {
+        delete bundles[i];
+        bundles[i] = NULL;
       }
+      bundles.clear();
 
       /*
-      while(!int_strings.empty()) {
-      IntStringHolder* tmp = int_strings.front();
-      int_strings.erase(int_strings.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+      for(size_t i = 0; i < int_strings.size(); ++i) {
+      delete int_strings[i];
+      int_strings[i] = NULL;
       }
+      int_strings.clear();
 
-      while(!float_strings.empty()) {
-      FloatStringHolder* tmp = float_strings.front();
-      float_strings.erase(float_strings.begin());
-      // delete
-      delete tmp;
-      tmp = NULL;
+      for(size_t i = 0; i < float_strings.size(); ++i) {
+      delete float_strings[i];
+      float_strings[i] = NULL;
       }
+      float_strings.clear();
       */
 
       if(linker) {
@@ -3002,10 +3017,9 @@ namespace frontend {
       TypeFactory::Instance()->Clear();
     }
 
-    void AddUses(vector<wstring> u) {
+    void AddUses(const vector<wstring> &u) {
       for(size_t i = 0; i < u.size(); ++i) {
-        vector<wstring>::iterator found = find(uses.begin(), uses.end(), u[i]);
-        if(found == uses.end()) {
+        if(use_index.insert(pair<wstring, size_t>(u[i], uses.size())).second) {
           uses.push_back(u[i]);
         }
       }
@@ -3016,13 +3030,14 @@ namespace frontend {
       return found != bundle_names.end();
     }
 
-    const vector<wstring> GetUses() {
+    const vector<wstring>& GetUses() {
       return uses;
     }
 
     void AddBundle(ParsedBundle* b) {
       bundle_names.push_back(b->GetName());
       bundles.push_back(b);
+      is_indexed = false;
     }
 
     const vector<ParsedBundle*> GetBundles() {
@@ -3141,27 +3156,77 @@ namespace frontend {
     }
 
     Class* GetClass(const wstring &n) {
-      for(size_t i = 0; i < bundles.size(); ++i) {
-        Class* klass = bundles[i]->GetClass(n);
-        if(klass) {
-          return klass;
-        }
+      if(!is_indexed) {
+        BuildIndexes();
+      }
+      
+      unordered_map<wstring, Class*>::iterator result = class_index.find(n);
+      if(result != class_index.end()) {
+        return result->second;
       }
 
       return NULL;
     }
 
     Enum* GetEnum(const wstring &n) {
-      for(size_t i = 0; i < bundles.size(); ++i) {
-        Enum* e = bundles[i]->GetEnum(n);
-        if(e) {
-          return e;
-        }
+      if(!is_indexed) {
+        BuildIndexes();
+      }
+      
+      unordered_map<wstring, Enum*>::iterator result = enum_index.find(n);
+      if(result != enum_index.end()) {
+        return result->second;
       }
 
       return NULL;
     }
 
+    // finds a class qualified by a bundle in use, earlier uses win
+    Class* GetUseClass(const wstring &n) {
+      if(!is_indexed) {
+        BuildIndexes();
+      }
+      
+      Class* klass = NULL;
+      size_t position = uses.size();
+      unordered_map<wstring, vector<Class*> >::iterator result = class_names.find(n.substr(n.find_last_of(L'.') + 1));
+      if(result != class_names.end()) {
+        const vector<Class*> &klasses = result->second;
+        for(size_t i = 0; i < klasses.size(); ++i) {
+          const size_t use_position = GetUsePosition(klasses[i]->GetName(), n);
+          if(use_position < position) {
+            position = use_position;
+            klass = klasses[i];
+          }
+        }
+      }
+
+      return klass;
+    }
+
+    // finds an enum qualified by a bundle in use, earlier uses win
+    Enum* GetUseEnum(const wstring &n) {
+      if(!is_indexed) {
+        BuildIndexes();
+      }
+      
+      Enum* eenum = NULL;
+      size_t position = uses.size();
+      unordered_map<wstring, vector<Enum*> >::iterator result = enum_names.find(n.substr(n.find_last_of(L'.') + 1));
+      if(result != enum_names.end()) {
+        const vector<Enum*> &eenums = result->second;
+        for(size_t i = 0; i < eenums.size(); ++i) {
+          const size_t use_position = GetUsePosition(eenums[i]->GetName(), n);
+          if(use_position < position) {
+            position = use_position;
+            eenum = eenums[i];
+          }
+        }
+      }
+
+      return eenum;
+    }
+
     void SetLinker(Linker* l) {
       linker = l;
     }
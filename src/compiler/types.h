@@ -39,6 +39,7 @@
 #ifndef _WIN32
 #include <stdint.h>
 #include <stdlib.h>
+#include <pthread.h>
 #else
 #include <windows.h>
 #endif
@@ -217,51 +218,72 @@ namespace frontend {
   class TypeFactory {
     static TypeFactory* instance;
     vector<Type*> types;
+    // source files are parsed in parallel
+#ifdef _WIN32
+    CRITICAL_SECTION types_cs;
+#else
+    pthread_mutex_t types_mutex;
+#endif
 
     TypeFactory() {
+#ifdef _WIN32
+      InitializeCriticalSection(&types_cs);
+#else
+      pthread_mutex_init(&types_mutex, NULL);
+#endif
     }
 
     ~TypeFactory() {
+#ifdef _WIN32
+      DeleteCriticalSection(&types_cs);
+#else
+      pthread_mutex_destroy(&types_mutex);
+#endif
+    }
+
+    Type* AddType(Type* tmp) {
+#ifdef _WIN32
+      EnterCriticalSection(&types_cs);
+#else
+      pthread_mutex_lock(&types_mutex);
+#endif
+      types.push_back(tmp);
+#ifdef _WIN32
+      LeaveCriticalSection(&types_cs);
+#else
+      pthread_mutex_unlock(&types_mutex);
+#endif
+      return tmp;
     }
 
   public:
     static TypeFactory* Instance();
 
     void Clear() {
-      while(!types.empty()) {
-	Type* tmp = types.front();
-	types.erase(types.begin());
-	// delete
-	delete tmp;
-	tmp = NULL;
+      for(size_t i = 0; i < types.size(); ++i) {
+	delete types[i];
+	types[i] = NULL;
       }
+      types.clear();
 
       delete instance;
       instance = NULL;
     }
 
     Type* MakeType(EntryType type) {
-      Type* tmp = new Type(type);
-      types.push_back(tmp);
-      return tmp;
+      return AddType(new Type(type));
     }
 
     Type* MakeType(EntryType type, const wstring &name) {
-      Type* tmp = new Type(type, name);
-      types.push_back(tmp);
-      return tmp;
+      return AddType(new Type(type, name));
     }
     
     Type* MakeType(vector<Type*>& func_params, Type* rtrn_type) {
-      Type* tmp = new Type(func_params, rtrn_type);
-      types.push_back(tmp);
-      return tmp;
+      return AddType(new Type(func_params, rtrn_type));
     }
     
     Type* MakeType(Type* type) {
-      Type* tmp = new Type(type);
-      types.push_back(tmp);
-      return tmp;
+      return AddType(new Type(type));
     }
   };
   
@@ -327,13 +349,11 @@ namespace backend {
     }
   
     ~IntermediateDeclarations() {
-      while(!declarations.empty()) {
-	IntermediateDeclaration* tmp = declarations.front();
-	declarations.erase(declarations.begin());
-	// delete
-	delete tmp;
-	tmp = NULL;
+      for(size_t i = 0; i < declarations.size(); ++i) {
+	delete declarations[i];
+	declarations[i] = NULL;
       }
+      declarations.clear();
     }
 
     void AddParameter(IntermediateDeclaration* parameter) {
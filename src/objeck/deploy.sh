@@ -10,6 +10,9 @@ mkdir deploy/bin
 mkdir deploy/bin/lib
 mkdir deploy/bin/lib/odbc
 mkdir deploy/bin/lib/openssl
+mkdir deploy/bin/lib/regex
+mkdir deploy/bin/lib/json
+mkdir deploy/bin/lib/xml
 mkdir deploy/doc
 
 # build compiler
@@ -114,6 +117,45 @@ else
 	cp openssl.so ../../../objeck/deploy/bin/lib/openssl
 fi
 
+cd ../regex
+
+if [ ! -z "$1" ] && [ "$1" = "osx" ]; then
+	./build_osx_x64.sh regex
+	cp regex.dylib ../../../objeck/deploy/bin/lib/regex
+elif [ ! -z "$1" ] && [ "$1" = "mingw" ]; then
+	./build_win32.sh regex
+	cp regex.so ../../../objeck/deploy/bin/lib/regex
+else
+	./build_linux.sh regex
+	cp regex.so ../../../objeck/deploy/bin/lib/regex
+fi
+
+cd ../json
+
+if [ ! -z "$1" ] && [ "$1" = "osx" ]; then
+	./build_osx_x64.sh json
+	cp json.dylib ../../../objeck/deploy/bin/lib/json
+elif [ ! -z "$1" ] && [ "$1" = "mingw" ]; then
+	./build_win32.sh json
+	cp json.so ../../../objeck/deploy/bin/lib/json
+else
+	./build_linux.sh json
+	cp json.so ../../../objeck/deploy/bin/lib/json
+fi
+
+cd ../xml
+
+if [ ! -z "$1" ] && [ "$1" = "osx" ]; then
+	./build_osx_x64.sh xml
+	cp xml.dylib ../../../objeck/deploy/bin/lib/xml
+elif [ ! -z "$1" ] && [ "$1" = "mingw" ]; then
+	./build_win32.sh xml
+	cp xml.so ../../../objeck/deploy/bin/lib/xml
+else
+	./build_linux.sh xml
+	cp xml.so ../../../objeck/deploy/bin/lib/xml
+fi
+
 # copy guide
 cd ../../../..
 cp docs/guide/objeck_lang.pdf src/objeck/deploy/doc
@@ -155,6 +155,9 @@ namespace instructions {
     LIB_FUNC_DEF,
     // system directives
     END_STMTS,
+    // control, appended so existing libraries
+    // and executables keep their encodings
+    TBL_SWITCH,
   } 
   InstructionType;
 
@@ -142,6 +142,16 @@ static map<const wstring, wstring> ParseCommnadLine(const wstring &path_string)
  * native a unicode string
  ****************************/
 static bool BytesToUnicode(const string &in, wstring &out) {    
+  // ASCII fast path
+  size_t i = 0;
+  while(i < in.size() && in[i] && !(in[i] & 0x80)) {
+    i++;
+  }
+  if(i == in.size() || !in[i]) {
+    out.append(in.begin(), in.begin() + i);
+    return true;
+  }
+  
 #ifdef _WIN32
   // allocate space
   int wsize = MultiByteToWideChar(CP_UTF8, 0, in.c_str(), -1, NULL, 0);
@@ -224,6 +234,16 @@ static bool BytesToCharacter(const string &in, wchar_t &out) {
  * to UTF-8 bytes
  ****************************/
 static bool UnicodeToBytes(const wstring &in, string &out) {
+  // ASCII fast path
+  size_t i = 0;
+  while(i < in.size() && in[i] && (unsigned long)in[i] < 0x80) {
+    i++;
+  }
+  if(i == in.size() || !in[i]) {
+    out.append(in.begin(), in.begin() + i);
+    return true;
+  }
+  
 #ifdef _WIN32
   // allocate space
   int size = WideCharToMultiByte(CP_UTF8, 0, in.c_str(), -1, NULL, 0, NULL, NULL);
@@ -156,6 +156,62 @@ namespace instructions {
 		GET_SYS_PROP,
 		SET_SYS_PROP,
     EXIT,
+    // interned strings
+    LOAD_CHAR_STR_ARY,
+    // large file i/o
+    FILE_IN_LINE,
+    FILE_MAP_OPEN,
+    FILE_MAP_CLOSE,
+    FILE_MAP_IN_BYTE,
+    FILE_MAP_IN_BYTE_ARY,
+    FILE_MAP_IN_LINE,
+    FILE_MAP_IN_STRING,
+    FILE_MAP_SLICE,
+    // streamed serialization
+    SERL_OBJ_FILE,
+    SERL_OBJ_SOCK,
+    DESERL_OBJ_FILE,
+    DESERL_OBJ_SOCK,
+    // array operations
+    INT_ARY_SORT,
+    INT_ARY_SEARCH,
+    INT_ARY_FILL,
+    INT_ARY_MIN,
+    INT_ARY_MAX,
+    INT_ARY_SUM,
+    FLOAT_ARY_SORT,
+    FLOAT_ARY_SEARCH,
+    FLOAT_ARY_FILL,
+    FLOAT_ARY_MIN,
+    FLOAT_ARY_MAX,
+    FLOAT_ARY_SUM,
+    BYTE_ARY_SORT,
+    BYTE_ARY_SEARCH,
+    BYTE_ARY_FILL,
+    BYTE_ARY_MIN,
+    BYTE_ARY_MAX,
+    BYTE_ARY_SUM,
+    CHAR_ARY_SORT,
+    CHAR_ARY_SEARCH,
+    CHAR_ARY_FILL,
+    CHAR_ARY_MIN,
+    CHAR_ARY_MAX,
+    CHAR_ARY_SUM,
+    // string operations
+    BYTE_ARY_IS_UTF8,
+    CHAR_ARY_FIND,
+    CHAR_ARY_FIND_LAST,
+    CHAR_ARY_FIND_ARY,
+    CHAR_ARY_CMP,
+    CHAR_ARY_UPPER,
+    CHAR_ARY_LOWER,
+    CHAR_ARY_TO_BASE64,
+    CHAR_ARY_FROM_BASE64,
+    CHAR_ARY_APPEND_INT,
+    CHAR_ARY_APPEND_FLOAT,
+    BYTE_ARY_APPEND_INT,
+    BYTE_ARY_APPEND_FLOAT,
+    BYTE_ARY_APPEND_CHARS,
   } 
   Traps;
 }
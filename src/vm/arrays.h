@@ -0,0 +1,243 @@
+/***************************************************************************
+ * Native kernels for primitive arrays
+ *
+ * Copyright (c) 2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#ifndef __ARRAYS_H__
+#define __ARRAYS_H__
+
+#include <algorithm>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// arrays at least this large are sorted in parallel
+#define PARALLEL_SORT_SIZE 262144
+#define MAX_SORT_THREADS 8
+
+namespace arrays {
+  /********************************
+   * Parallel sort; chunks are
+   * sorted on worker threads and
+   * then merged pairwise
+   ********************************/
+  template<class T> struct SortTask {
+    T* begin;
+    T* end;
+  };
+
+  template<class T>
+#ifdef _WIN32
+  static unsigned int __stdcall SortChunk(void* arg) {
+#else
+  static void* SortChunk(void* arg) {
+#endif
+    SortTask<T>* task = (SortTask<T>*)arg;
+    std::sort(task->begin, task->end);
+    return 0;
+  }
+
+  static inline long GetSortThreads() {
+#ifdef _WIN32
+    SYSTEM_INFO sys_info;
+    GetSystemInfo(&sys_info);
+    long num_cores = sys_info.dwNumberOfProcessors;
+#else
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    // power of two, so chunks merge evenly
+    long num_threads = 1;
+    while(num_threads * 2 <= num_cores && num_threads * 2 <= MAX_SORT_THREADS) {
+      num_threads *= 2;
+    }
+
+    return num_threads;
+  }
+
+  template<class T> static void ParallelSort(T* values, const long size) {
+    const long num_threads = GetSortThreads();
+    if(num_threads < 2) {
+      std::sort(values, values + size);
+      return;
+    }
+
+    SortTask<T> tasks[MAX_SORT_THREADS];
+    const long chunk = size / num_threads;
+    for(long i = 0; i < num_threads; i++) {
+      tasks[i].begin = values + i * chunk;
+      tasks[i].end = i == num_threads - 1 ? values + size : values + (i + 1) * chunk;
+    }
+
+    // the calling thread sorts the first chunk
+#ifdef _WIN32
+    HANDLE threads[MAX_SORT_THREADS];
+    for(long i = 1; i < num_threads; i++) {
+      threads[i] = (HANDLE)_beginthreadex(NULL, 0, SortChunk<T>, &tasks[i], 0, NULL);
+      if(!threads[i]) {
+        SortChunk<T>(&tasks[i]);
+      }
+    }
+    SortChunk<T>(&tasks[0]);
+    for(long i = 1; i < num_threads; i++) {
+      if(threads[i]) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+      }
+    }
+#else
+    pthread_t threads[MAX_SORT_THREADS];
+    bool is_started[MAX_SORT_THREADS];
+    for(long i = 1; i < num_threads; i++) {
+      is_started[i] = pthread_create(&threads[i], NULL, SortChunk<T>, (void*)&tasks[i]) == 0;
+      if(!is_started[i]) {
+        SortChunk<T>(&tasks[i]);
+      }
+    }
+    SortChunk<T>(&tasks[0]);
+    for(long i = 1; i < num_threads; i++) {
+      if(is_started[i]) {
+        pthread_join(threads[i], NULL);
+      }
+    }
+#endif
+
+    // merge sorted runs
+    for(long width = 1; width < num_threads; width *= 2) {
+      for(long i = 0; i + width < num_threads; i += width * 2) {
+        const long last = i + width * 2 - 1 < num_threads ? i + width * 2 - 1 : num_threads - 1;
+        std::inplace_merge(tasks[i].begin, tasks[i + width].begin, tasks[last].end);
+      }
+    }
+  }
+
+  // introsort, in parallel for large arrays
+  template<class T> static void Sort(T* values, const long size) {
+    if(size < PARALLEL_SORT_SIZE) {
+      std::sort(values, values + size);
+    }
+    else {
+      ParallelSort(values, size);
+    }
+  }
+
+  // counting sort for bytes
+  static inline void Sort(char* values, const long size) {
+    long counts[256];
+    memset(counts, 0, sizeof(counts));
+    for(long i = 0; i < size; i++) {
+      counts[(unsigned char)values[i]]++;
+    }
+
+    // signed order: -128..-1 then 0..127
+    long pos = 0;
+    for(long i = 128; i < 384; i++) {
+      const long count = counts[i & 0xff];
+      memset(values + pos, (char)(i & 0xff), count);
+      pos += count;
+    }
+  }
+
+  // NaNs are moved to the end so the remainder has a strict ordering
+  static inline void Sort(double* values, const long size) {
+    double* end = values + size;
+    for(double* i = values; i < end;) {
+      if(*i != *i) {
+        --end;
+        std::swap(*i, *end);
+      }
+      else {
+        i++;
+      }
+    }
+
+    const long count = end - values;
+    if(count < PARALLEL_SORT_SIZE) {
+      std::sort(values, end);
+    }
+    else {
+      ParallelSort(values, count);
+    }
+  }
+
+  // index of 'value' in a sorted array or -1
+  template<class T> static long Search(const T* values, const long size, const T value) {
+    const T* found = std::lower_bound(values, values + size, value);
+    if(found != values + size && !(value < *found)) {
+      return found - values;
+    }
+
+    return -1;
+  }
+
+  template<class T> static void Fill(T* values, const long size, const T value) {
+    for(long i = 0; i < size; i++) {
+      values[i] = value;
+    }
+  }
+
+  static inline void Fill(char* values, const long size, const char value) {
+    memset(values, value, size);
+  }
+
+  // reductions are written as simple loops so the compiler can vectorize them
+  template<class T> static T Min(const T* values, const long size) {
+    T result = values[0];
+    for(long i = 1; i < size; i++) {
+      result = values[i] < result ? values[i] : result;
+    }
+
+    return result;
+  }
+
+  template<class T> static T Max(const T* values, const long size) {
+    T result = values[0];
+    for(long i = 1; i < size; i++) {
+      result = values[i] > result ? values[i] : result;
+    }
+
+    return result;
+  }
+
+  template<class R, class T> static R Sum(const T* values, const long size) {
+    R result = 0;
+    for(long i = 0; i < size; i++) {
+      result += values[i];
+    }
+
+    return result;
+  }
+}
+
+#endif
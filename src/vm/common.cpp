@@ -32,6 +32,8 @@
 #include "common.h"
 #include "loader.h"
 #include "interpreter.h"
+#include "arrays.h"
+#include "kernels.h"
 
 #ifdef _WIN32
 #ifndef _UTILS
@@ -55,8 +57,85 @@ pthread_mutex_t StackMethod::virtual_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t StackProgram::prop_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 unordered_map<wstring, StackMethod*> StackMethod::virutal_cache;
+bool StackMethod::is_profiling = false;
 map<wstring, wstring> StackProgram::properties_map;
 
+/********************************
+ * Writes the counts gathered when
+ * running with '-profile'. Counts
+ * are keyed by method name, branch
+ * label and called method, which
+ * the compiler can match to the
+ * code it emits.
+ ********************************/
+bool StackProgram::WriteProfile(const wstring &program_file, const wstring &profile_file)
+{
+  const string file_name = UnicodeToBytes(profile_file);
+  ofstream out(file_name.c_str(), ofstream::out | ofstream::trunc);
+  if(!out.is_open()) {
+    return false;
+  }
+  out << "# obr profile: " << UnicodeToBytes(program_file) << endl;
+  
+  for(int i = 0; i < class_num; i++) {
+    StackMethod** methods = classes[i]->GetMethods();
+    for(int j = 0; j < classes[i]->GetMethodCount(); j++) {
+      StackMethod* method = methods[j];
+      // statements that were never decoded have not run
+      ProfileSite* sites = method->GetProfileSites();
+      if(!sites || method->GetInvocations() == 0) {
+        continue;
+      }
+      out << "method " << UnicodeToBytes(method->GetName()) << " " 
+          << method->GetInvocations() << endl;
+      
+      // sites that share a label or called method are summed
+      map<long, pair<long, long> > branches;
+      map<StackMethod*, pair<long, long> > calls;
+      map<StackMethod*, map<long, long> > receivers;
+      StackInstr** instrs = method->GetInstructions();
+      for(long k = 0; k < method->GetInstructionCount(); k++) {
+        StackInstr* instr = instrs[k];
+        ProfileSite* site = sites + k;
+        if(instr->GetType() == JMP && instr->GetOperand2() > -1) {
+          pair<long, long> &counts = branches[instr->GetOperand()];
+          counts.first += site->count;
+          counts.second += site->other;
+        }
+        else if(instr->GetType() == MTHD_CALL && site->count > 0) {
+          StackMethod* called = GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+          pair<long, long> &counts = calls[called];
+          counts.first += site->count;
+          counts.second += site->other;
+          for(int l = 0; l < PROFILE_RECEIVER_MAX && site->receiver_counts[l] > 0; l++) {
+            receivers[called][site->receivers[l]] += site->receiver_counts[l];
+          }
+        }
+      }
+      
+      map<long, pair<long, long> >::iterator branch;
+      for(branch = branches.begin(); branch != branches.end(); ++branch) {
+        out << "branch " << branch->first << " " << branch->second.first << " " 
+            << branch->second.second << endl;
+      }
+      
+      map<StackMethod*, pair<long, long> >::iterator call;
+      for(call = calls.begin(); call != calls.end(); ++call) {
+        out << "call " << UnicodeToBytes(call->first->GetName()) << " " 
+            << call->second.first << " " << call->second.second;
+        map<long, long> &call_receivers = receivers[call->first];
+        for(map<long, long>::iterator receiver = call_receivers.begin(); receiver != call_receivers.end(); ++receiver) {
+          out << " " << UnicodeToBytes(GetClass(receiver->first)->GetName()) << " " << receiver->second;
+        }
+        out << endl;
+      }
+    }
+  }
+  out.close();
+  
+  return true;
+}
+
 /********************************
  * ObjectSerializer struct
  ********************************/
@@ -70,11 +149,7 @@ void ObjectSerializer::CheckObject(long* mem, bool is_obj, long depth) {
 
       if(!WasSerialized(mem)) {
 #ifdef _DEBUG
-        long mem_size = cls->GetInstanceMemorySize();
-
-#ifdef _X64
-        mem_size *= 2;
-#endif
+        const long mem_size = cls->GetInstanceMemorySize();
         for(int i = 0; i < depth; i++) {
           wcout << L"\t";
         }
@@ -238,8 +313,9 @@ void ObjectSerializer::CheckMemory(long* mem, StackDclr** dclrs, const long dcls
           SerializeInt(array[2]);
           long* array_ptr = array + 3;	
           // values
-          for(int i = 0; i < array_size; i++) {
-            SerializeInt(array_ptr[i]);
+          vector<INT_VALUE> ints(array_ptr, array_ptr + array_size);
+          if(array_size > 0) {
+            SerializeBytes(&ints[0], array_size * sizeof(INT_VALUE));
           }
         }
       }
@@ -308,14 +384,10 @@ long* ObjectDeserializer::DeserializeObject() {
     INT_VALUE mem_id = DeserializeInt();
     if(mem_id < 0) {
       instance = MemoryManager::AllocateObject(cls->GetId(), (long*)op_stack, *stack_pos, false);
-      mem_cache[-mem_id] = instance;
+      CacheMemory(-mem_id, instance);
     }
     else {
-      map<INT_VALUE, long*>::iterator found = mem_cache.find(mem_id);
-      if(found == mem_cache.end()) {
-        return NULL;
-      }      
-      return found->second;
+      return FindMemory(mem_id);
     }
   }
   else {
@@ -325,7 +397,7 @@ long* ObjectDeserializer::DeserializeObject() {
   long dclr_pos = 0;  
   StackDclr** dclrs = cls->GetInstanceDeclarations();
   const long dclr_num = cls->GetNumberInstanceDeclarations();
-  while(dclr_pos < dclr_num && buffer_offset < buffer_array_size) {
+  while(dclr_pos < dclr_num && HasData()) {
     ParamType type = dclrs[dclr_pos++]->type;
 
     switch(type) {
@@ -372,21 +444,20 @@ long* ObjectDeserializer::DeserializeObject() {
           byte_array[1] = byte_array_dim;
           byte_array[2] = byte_array_size_dim;	
           // copy content
-          memcpy(byte_array_ptr, buffer + buffer_offset, byte_array_size);
-          buffer_offset += byte_array_size;
+          DeserializeBytes(byte_array_ptr, byte_array_size);
 #ifdef _DEBUG
           wcout << L"--- deserialization: byte array; value=" << byte_array <<  ", size=" << byte_array_size << L" ---" << endl;
 #endif
           // update cache
-          mem_cache[-mem_id] = byte_array;
+          CacheMemory(-mem_id, byte_array);
           instance[instance_pos++] = (long)byte_array;
         }
         else {
-          map<INT_VALUE, long*>::iterator found = mem_cache.find(mem_id);
-          if(found == mem_cache.end()) {
+          long* found = FindMemory(mem_id);
+          if(!found) {
             return NULL;
           } 
-          instance[instance_pos++] = (long)found->second;
+          instance[instance_pos++] = (long)found;
         }
       }
     }
@@ -404,16 +475,11 @@ long* ObjectDeserializer::DeserializeObject() {
 					long char_array_size_dim = DeserializeInt();
 
           // copy content
-					char* in = new char[char_array_size + 1];
-          memcpy(in, buffer + buffer_offset, char_array_size);
-          buffer_offset += char_array_size;
-					in[char_array_size] = '\0';
-	  
+					string in(char_array_size, '\0');
+					if(char_array_size > 0) {
+						DeserializeBytes(&in[0], char_array_size);
+					}
 					const wstring out = BytesToUnicode(in);
-
-					// clean up
-					delete[] in;
-					in = NULL;
 	  
 #ifdef _DEBUG
           wcout << L"--- deserialization: char array; value=" << out <<  ", size=" << char_array_size << L" ---" << endl;
@@ -431,15 +497,15 @@ long* ObjectDeserializer::DeserializeObject() {
 					memcpy(char_array_ptr, out.c_str(), char_array_size * sizeof(wchar_t));
 	  
           // update cache
-          mem_cache[-mem_id] = char_array;
+          CacheMemory(-mem_id, char_array);
           instance[instance_pos++] = (long)char_array;
         }
         else {
-          map<INT_VALUE, long*>::iterator found = mem_cache.find(mem_id);
-          if(found == mem_cache.end()) {
+          long* found = FindMemory(mem_id);
+          if(!found) {
             return NULL;
           } 
-          instance[instance_pos++] = (long)found->second;
+          instance[instance_pos++] = (long)found;
         }
       }
     }
@@ -462,22 +528,26 @@ long* ObjectDeserializer::DeserializeObject() {
           array[2] = array_size_dim;
           long* array_ptr = array + 3;	
           // copy content
-          for(int i = 0; i < array_size; i++) {
-            array_ptr[i] = DeserializeInt();
+          if(array_size > 0) {
+            vector<INT_VALUE> ints(array_size);
+            DeserializeBytes(&ints[0], array_size * sizeof(INT_VALUE));
+            for(long i = 0; i < array_size; i++) {
+              array_ptr[i] = ints[i];
+            }
           }
 #ifdef _DEBUG
           wcout << L"--- deserialization: int array; value=" << array <<  ",  size=" << array_size << L" ---" << endl;
 #endif
           // update cache
-          mem_cache[-mem_id] = array;
+          CacheMemory(-mem_id, array);
           instance[instance_pos++] = (long)array;
         }
         else {
-          map<INT_VALUE, long*>::iterator found = mem_cache.find(mem_id);
-          if(found == mem_cache.end()) {
+          long* found = FindMemory(mem_id);
+          if(!found) {
             return NULL;
           } 
-          instance[instance_pos++] = (long)found->second;
+          instance[instance_pos++] = (long)found;
         }
       }
     }
@@ -501,21 +571,20 @@ long* ObjectDeserializer::DeserializeObject() {
           array[2] = array_size_dim;
           FLOAT_VALUE* array_ptr = (FLOAT_VALUE*)(array + 3);	
           // copy content
-          memcpy(array_ptr, buffer + buffer_offset, array_size * sizeof(FLOAT_VALUE));
-          buffer_offset += array_size * sizeof(FLOAT_VALUE);
+          DeserializeBytes(array_ptr, array_size * sizeof(FLOAT_VALUE));
 #ifdef _DEBUG
           wcout << L"--- deserialization: float array; value=" << array <<  ", size=" << array_size << L" ---" << endl;
 #endif
           // update cache
-          mem_cache[-mem_id] = array;
+          CacheMemory(-mem_id, array);
           instance[instance_pos++] = (long)array;
         }
         else {
-          map<INT_VALUE, long*>::iterator found = mem_cache.find(mem_id);
-          if(found == mem_cache.end()) {
+          long* found = FindMemory(mem_id);
+          if(!found) {
             return NULL;
           } 
-          instance[instance_pos++] = (long)found->second;
+          instance[instance_pos++] = (long)found;
         }
       }
     }
@@ -526,10 +595,9 @@ long* ObjectDeserializer::DeserializeObject() {
         instance[instance_pos++] = 0;
       }
       else {
-        ObjectDeserializer deserializer(buffer, buffer_offset, mem_cache, buffer_array_size, op_stack, stack_pos);
+        ObjectDeserializer deserializer(this);
         instance[instance_pos++] = (long)deserializer.DeserializeObject();
         buffer_offset = deserializer.GetOffset();
-        mem_cache = deserializer.GetMemoryCache();
       }
     }
       break;
@@ -809,6 +877,103 @@ long* TrapProcessor::CreateStringObject(const wstring &value_str, StackProgram*
   return str_obj;
 }
 
+/********************************
+ * Creates a byte array from a
+ * native buffer
+ ********************************/
+long* TrapProcessor::CreateByteArray(const char* buffer, const long size, 
+																		 long* &op_stack, long* &stack_pos) {
+  const long byte_array_dim = 1;
+  long* byte_array = (long*)MemoryManager::AllocateArray(size + 1 +
+																												 ((byte_array_dim + 2) *
+																													sizeof(long)),
+																												 BYTE_ARY_TYPE,
+																												 op_stack, *stack_pos,
+																												 false);
+  byte_array[0] = size + 1;
+  byte_array[1] = byte_array_dim;
+  byte_array[2] = size;
+  memcpy(byte_array + 3, buffer, size);
+
+  return byte_array;
+}
+
+long* TrapProcessor::CreateByteArray(const long size, long* &op_stack, long* &stack_pos) {
+  const long byte_array_dim = 1;
+  long* byte_array = (long*)MemoryManager::AllocateArray(size + 1 +
+																												 ((byte_array_dim + 2) *
+																													sizeof(long)),
+																												 BYTE_ARY_TYPE,
+																												 op_stack, *stack_pos,
+																												 false);
+  byte_array[0] = size + 1;
+  byte_array[1] = byte_array_dim;
+  byte_array[2] = size;
+
+  return byte_array;
+}
+
+long* TrapProcessor::CreateCharArray(const long size, long* &op_stack, long* &stack_pos) {
+  const long char_array_dim = 1;
+  long* char_array = (long*)MemoryManager::AllocateArray(size + 1 +
+																												 ((char_array_dim + 2) *
+																													sizeof(long)),
+																												 CHAR_ARY_TYPE,
+																												 op_stack, *stack_pos,
+																												 false);
+  char_array[0] = size + 1;
+  char_array[1] = char_array_dim;
+  char_array[2] = size;
+
+  return char_array;
+}
+
+/********************************
+ * Reads a line of any length,
+ * dropping the trailing newline
+ ********************************/
+bool TrapProcessor::ReadFileLine(FILE* file, string &line) {
+  char buffer[SMALL_BUFFER_MAX + 1];
+  bool is_read = false;
+  while(fgets(buffer, SMALL_BUFFER_MAX + 1, file)) {
+    is_read = true;
+    const size_t len = strlen(buffer);
+    if(len > 0 && buffer[len - 1] == '\n') {
+      line.append(buffer, len - 1);
+      return true;
+    }
+    line.append(buffer, len);
+  }
+  
+  return is_read;
+}
+
+/********************************
+ * Scans the next line of a mapped
+ * file and advances its position
+ ********************************/
+const char* TrapProcessor::ReadMappedLine(long* instance, long &size) {
+  const char* base = (char*)instance[0];
+  const long file_size = instance[1];
+  const long pos = instance[2];
+  if(!base || pos < 0 || pos >= file_size) {
+    return NULL;
+  }
+  
+  const char* start = base + pos;
+  const char* end = (const char*)memchr(start, '\n', file_size - pos);
+  if(end) {
+    size = end - start;
+    instance[2] = pos + size + 1;
+  }
+  else {
+    size = file_size - pos;
+    instance[2] = file_size;
+  }
+
+  return start;
+}
+
 /********************************
  * Creates a Date object with
  * current time
@@ -1136,21 +1301,106 @@ void TrapProcessor::SerializeObject(long* inst, StackFrame* frame, long* &op_sta
 {
   long* obj = (long*)frame->mem[1];
   ObjectSerializer serializer(obj);
-  vector<char> src_buffer = serializer.GetValues();
+  vector<char>& src_buffer = serializer.GetValues();
   const long src_buffer_size = src_buffer.size();
-  long* dest_buffer = (long*)inst[0];
-  long dest_pos = inst[1];
-  
-  // expand buffer, if needed
-  dest_buffer = ExpandSerialBuffer(src_buffer_size, dest_buffer, inst, op_stack, stack_pos);
-  inst[0] = (long)dest_buffer;
-  
-  // copy content
-  char* dest_buffer_ptr = ((char*)(dest_buffer + 3) + dest_pos);
-  for(int i = 0; i < src_buffer_size; i++, dest_pos++) {
-    dest_buffer_ptr[i] = src_buffer[i];
+  if(src_buffer_size > 0) {
+    // sized once for the whole graph
+    WriteSerializedBytes(&src_buffer[0], src_buffer_size, inst, op_stack, stack_pos);
+  }
+}
+
+/********************************
+ * Serialization streams for files
+ * and sockets
+ ********************************/
+class FileSerialWriter : public SerialWriter {
+  FILE* file;
+
+ public:
+  FileSerialWriter(FILE* f) {
+    file = f;
+  }
+
+  bool Write(const char* buffer, const long size) {
+    return fwrite(buffer, 1, size, file) == (size_t)size;
+  }
+};
+
+class FileSerialReader : public SerialReader {
+  FILE* file;
+
+ public:
+  FileSerialReader(FILE* f) {
+    file = f;
+  }
+
+  bool Read(char* buffer, const long size) {
+    return fread(buffer, 1, size, file) == (size_t)size;
+  }
+};
+
+class SocketSerialWriter : public SerialWriter {
+  SOCKET sock;
+
+ public:
+  SocketSerialWriter(SOCKET s) {
+    sock = s;
+  }
+
+  bool Write(const char* buffer, const long size) {
+    long offset = 0;
+    while(offset < size) {
+      const int written = IPSocket::WriteBytes(buffer + offset, size - offset, sock);
+      if(written <= 0) {
+        return false;
+      }
+      offset += written;
+    }
+
+    return true;
+  }
+};
+
+// reads exact lengths so that bytes following the object stay on the socket
+class SocketSerialReader : public SerialReader {
+  SOCKET sock;
+
+ public:
+  SocketSerialReader(SOCKET s) {
+    sock = s;
+  }
+
+  bool Read(char* buffer, const long size) {
+    long offset = 0;
+    while(offset < size) {
+      const int read = IPSocket::ReadBytes(buffer + offset, size - offset, sock);
+      if(read <= 0) {
+        return false;
+      }
+      offset += read;
+    }
+
+    return true;
+  }
+};
+
+/********************************
+ * Streams an object graph
+ ********************************/
+bool TrapProcessor::SerializeObject(long* obj, SerialWriter* writer) 
+{
+  ObjectSerializer serializer(obj, writer);
+  return serializer.IsWritten();
+}
+
+long* TrapProcessor::DeserializeObject(SerialReader* reader, long* &op_stack, long* &stack_pos) 
+{
+  ObjectDeserializer deserializer(reader, op_stack, stack_pos);
+  if(!deserializer.ReadByte()) {
+    return NULL;
   }
-  inst[1] = dest_pos;
+  
+  return deserializer.DeserializeObject();
 }
 
 /********************************
@@ -1166,7 +1416,7 @@ void TrapProcessor::DeserializeObject(long* inst, long* &op_stack, long* &stack_
     const long byte_array_dim_size = byte_array[2];  
     const char* byte_array_ptr = ((char*)(byte_array + 3) + dest_pos);
     
-    ObjectDeserializer deserializer(byte_array_ptr, byte_array_dim_size, op_stack, stack_pos);
+    ObjectDeserializer deserializer(byte_array_ptr, byte_array_dim_size - dest_pos, op_stack, stack_pos);
     PushInt((long)deserializer.DeserializeObject(), op_stack, stack_pos);
     inst[1] = dest_pos + deserializer.GetOffset();
   }
@@ -1229,26 +1479,15 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
       wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    const wstring out = BytesToUnicode((char*)(array + 3));
-    
-    // create character array
-    const long char_array_size = out.size();
-    const long char_array_dim = 1;
-    long* char_array = (long*)MemoryManager::AllocateArray(char_array_size + 1 +
-																													 ((char_array_dim + 2) *
-																														sizeof(long)),
-																													 CHAR_ARY_TYPE,
-																													 op_stack, *stack_pos,
-																													 false);
-    char_array[0] = char_array_size + 1;
-    char_array[1] = char_array_dim;
-    char_array[2] = char_array_size;
-    
-    // copy wstring
-    wchar_t* char_array_ptr = (wchar_t*)(char_array + 3);
-    wcsncpy(char_array_ptr, out.c_str(), char_array_size);
-
-    // push result
+    // input ends at the first null byte; invalid UTF-8 yields an empty array
+    const char* in = (char*)(array + 3);
+    const char* end = (const char*)memchr(in, '\0', array[2]);
+    const long in_size = end ? end - in : array[2];
+    const long out_size = kernels::Utf8Size(in, in_size);
+    long* char_array = CreateCharArray(out_size < 0 ? 0 : out_size, op_stack, stack_pos);
+    if(out_size > 0) {
+      kernels::Utf8ToUnicode(in, in_size, (wchar_t*)(char_array + 3));
+    }
     PushInt((long)char_array, op_stack, stack_pos);
   }
     break;
@@ -1259,161 +1498,694 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
       wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    const string out = UnicodeToBytes((wchar_t*)(array + 3));
-
-    // create byte array
-    const long byte_array_size = out.size();
-    const long byte_array_dim = 1;
-    long* byte_array = (long*)MemoryManager::AllocateArray(byte_array_size + 1 +
-																													 ((byte_array_dim + 2) *
-																														sizeof(long)),
-																													 BYTE_ARY_TYPE,
-																													 op_stack, *stack_pos,
-																													 false);
-    byte_array[0] = byte_array_size + 1;
-    byte_array[1] = byte_array_dim;
-    byte_array[2] = byte_array_size;
-    
-    // copy bytes
-    char* byte_array_ptr = (char*)(byte_array + 3);
-    strncpy(byte_array_ptr, out.c_str(), byte_array_size);
-    
-    // push result
+    // input ends at the first null character; invalid input yields an empty array
+    const wchar_t* in = (wchar_t*)(array + 3);
+    const long end = kernels::FindChar(in, array[2], L'\0');
+    const long in_size = end < 0 ? array[2] : end;
+    const long out_size = kernels::UnicodeUtf8Size(in, in_size);
+    long* byte_array = CreateByteArray(out_size < 0 ? 0 : out_size, op_stack, stack_pos);
+    if(out_size > 0) {
+      kernels::UnicodeToUtf8(in, in_size, (char*)(byte_array + 3));
+    }
     PushInt((long)byte_array, op_stack, stack_pos);
   }
     break;
 
-    // ---------------- array operations ----------------    
-  case LOAD_MULTI_ARY_SIZE: {
+  case BYTE_ARY_IS_UTF8: {
     long* array = (long*)PopInt(op_stack, stack_pos);
     if(!array) {
       wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    
-    // allocate 'size' array and copy metadata
-    long size = array[1];
-    long dim = 1;
-    long* mem = (long*)MemoryManager::AllocateArray(size + dim + 2, INT_TYPE,
-																										op_stack, *stack_pos);
-    int i, j;
-    for(i = 0, j = size + 2; i < size; i++) {
-      mem[i + 3] = array[--j];
-    }
-    mem[0] = size;
-    mem[1] = dim;
-    mem[2] = size;
-
-    PushInt((long)mem, op_stack, stack_pos);
+    PushInt(kernels::IsUtf8((char*)(array + 3), array[2]), op_stack, stack_pos);
   }
     break;
-  
-    // ---------------- memory copy operations ----------------
-  case CPY_CHAR_STR_ARY: {
-    long index = PopInt(op_stack, stack_pos);
-    const wchar_t* value_str = program->GetCharStrings()[index];
-    // copy array
+
+    // ---------------- character array operations ----------------
+  case CHAR_ARY_FIND: {
+    const wchar_t value = (wchar_t)PopInt(op_stack, stack_pos);
+    const long offset = PopInt(op_stack, stack_pos);
+    const long size = PopInt(op_stack, stack_pos);
     long* array = (long*)PopInt(op_stack, stack_pos);
     if(!array) {
-      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    const long size = array[2];
-    wchar_t* str = (wchar_t*)(array + 3);
-    memcpy(str, value_str, size * sizeof(wchar_t));
-#ifdef _DEBUG
-    wcout << L"stack oper: CPY_CHAR_STR_ARY: index=" << index << L", string='" << str << L"'" << endl;
-#endif
-    PushInt((long)array, op_stack, stack_pos);
+    long index = -1;
+    if(offset > -1 && offset < size && size <= array[2]) {
+      index = kernels::FindChar((wchar_t*)(array + 3) + offset, size - offset, value);
+      if(index > -1) {
+        index += offset;
+      }
+    }
+    PushInt(index, op_stack, stack_pos);
   }
     break;
 
-  case CPY_CHAR_STR_ARYS: {
-    // copy array
+  case CHAR_ARY_FIND_LAST: {
+    const wchar_t value = (wchar_t)PopInt(op_stack, stack_pos);
+    const long offset = PopInt(op_stack, stack_pos);
+    const long size = PopInt(op_stack, stack_pos);
     long* array = (long*)PopInt(op_stack, stack_pos);
     if(!array) {
-      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    const long size = array[0];
-    const long dim = array[1];
-    // copy elements
-    long* str = (long*)(array + dim + 2);
-    for(long i = 0; i < size; i++) {
-      str[i] = PopInt(op_stack, stack_pos);
+    long index = -1;
+    if(offset > -1 && offset < size && size <= array[2]) {
+      index = kernels::FindLastChar((wchar_t*)(array + 3) + offset, size - offset, value);
+      if(index > -1) {
+        index += offset;
+      }
     }
-#ifdef _DEBUG
-    wcout << L"stack oper: CPY_CHAR_STR_ARYS" << endl;
-#endif
-    PushInt((long)array, op_stack, stack_pos);
+    PushInt(index, op_stack, stack_pos);
   }
     break;
 
-  case CPY_INT_STR_ARY: {
-    long index = PopInt(op_stack, stack_pos);
-    int* value_str = program->GetIntStrings()[index];
-    // copy array
+  case CHAR_ARY_FIND_ARY: {
+    const long offset = PopInt(op_stack, stack_pos);
+    const long find_size = PopInt(op_stack, stack_pos);
+    long* find = (long*)PopInt(op_stack, stack_pos);
+    const long size = PopInt(op_stack, stack_pos);
     long* array = (long*)PopInt(op_stack, stack_pos);
-    if(!array) {
-      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+    if(!array || !find) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    const long size = array[0];
-    const long dim = array[1];
-    long* str = (long*)(array + dim + 2);
-    for(long i = 0; i < size; i++) {
-      str[i] = value_str[i];
+    long index = -1;
+    if(offset > -1 && offset < size && size <= array[2] && find_size <= find[2]) {
+      index = kernels::FindString((wchar_t*)(array + 3) + offset, size - offset,
+																	(wchar_t*)(find + 3), find_size);
+      if(index > -1) {
+        index += offset;
+      }
     }
-#ifdef _DEBUG
-    wcout << L"stack oper: CPY_INT_STR_ARY" << endl;
-#endif
-    PushInt((long)array, op_stack, stack_pos);
+    PushInt(index, op_stack, stack_pos);
   }
     break;
 
-  case CPY_FLOAT_STR_ARY: {
-    long index = PopInt(op_stack, stack_pos);
-    FLOAT_VALUE* value_str = program->GetFloatStrings()[index];
-    // copy array
-    long* array = (long*)PopInt(op_stack, stack_pos);
-    if(!array) {
-      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+  case CHAR_ARY_CMP: {
+    const long right_size = PopInt(op_stack, stack_pos);
+    long* right = (long*)PopInt(op_stack, stack_pos);
+    const long left_size = PopInt(op_stack, stack_pos);
+    long* left = (long*)PopInt(op_stack, stack_pos);
+    if(!left || !right) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
       return false;
     }
-    const long size = array[0];
-    const long dim = array[1];
-    FLOAT_VALUE* str = (FLOAT_VALUE*)(array + dim + 2);
-    for(long i = 0; i < size; i++) {
-      str[i] = value_str[i];
+    if(left_size > left[2] || right_size > right[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
     }
-
-#ifdef _DEBUG
-    wcout << L"stack oper: CPY_FLOAT_STR_ARY" << endl;
-#endif
-    PushInt((long)array, op_stack, stack_pos);
+    PushInt(kernels::Compare((wchar_t*)(left + 3), left_size, (wchar_t*)(right + 3), right_size), 
+						op_stack, stack_pos);
   }
     break;
 
-    // ---------------- standard i/o ----------------
-  case STD_OUT_BOOL:
-#ifdef _DEBUG
-    wcout << L"  STD_OUT_BOOL" << endl;
-#endif
-    wcout << ((PopInt(op_stack, stack_pos) == 0) ? L"false" : L"true");
-    break;
-    
-  case STD_OUT_BYTE:
-#ifdef _DEBUG
-    wcout << L"  STD_OUT_BYTE" << endl;
-#endif
-    wcout << (unsigned char)PopInt(op_stack, stack_pos);
+  case CHAR_ARY_UPPER:
+  case CHAR_ARY_LOWER: {
+    const long size = PopInt(op_stack, stack_pos);
+    long* out = (long*)PopInt(op_stack, stack_pos);
+    long* in = (long*)PopInt(op_stack, stack_pos);
+    if(!in || !out) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(size > in[2] || size > out[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
+    }
+    if(id == CHAR_ARY_UPPER) {
+      kernels::ToUpper((wchar_t*)(in + 3), (wchar_t*)(out + 3), size);
+    }
+    else {
+      kernels::ToLower((wchar_t*)(in + 3), (wchar_t*)(out + 3), size);
+    }
+  }
     break;
 
-  case STD_OUT_CHAR:
-#ifdef _DEBUG
-    wcout << L"  STD_OUT_CHAR" << endl;
-#endif
-    wcout << (wchar_t)PopInt(op_stack, stack_pos);
+  case CHAR_ARY_TO_BASE64: {
+    const long size = PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(size > array[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
+    }
+    long* char_array = CreateCharArray(kernels::Base64EncodedSize(size), op_stack, stack_pos);
+    kernels::Base64Encode((wchar_t*)(array + 3), size, (wchar_t*)(char_array + 3));
+    PushInt((long)char_array, op_stack, stack_pos);
+  }
+    break;
+
+  case CHAR_ARY_FROM_BASE64: {
+    const long size = PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(size > array[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
+    }
+    const wchar_t* in = (wchar_t*)(array + 3);
+    long* char_array = CreateCharArray(kernels::Base64DecodedSize(in, size), op_stack, stack_pos);
+    kernels::Base64Decode(in, size, (wchar_t*)(char_array + 3));
+    PushInt((long)char_array, op_stack, stack_pos);
+  }
+    break;
+
+    // ---------------- in-place appends ----------------
+    // values are written at 'pos' when they fit with room for a terminator,
+    // the new position is returned; otherwise the negated length is returned
+  case CHAR_ARY_APPEND_INT:
+  case CHAR_ARY_APPEND_FLOAT: {
+    wchar_t buffer[MAX_FLOAT_DIGITS];
+    long length;
+    if(id == CHAR_ARY_APPEND_INT) {
+      length = kernels::FormatInt(PopInt(op_stack, stack_pos), buffer);
+    }
+    else {
+      length = kernels::FormatFloat(PopFloat(op_stack, stack_pos), buffer);
+    }
+    const long pos = PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(pos < 0 || pos > array[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
+    }
+    if(pos + length < array[2]) {
+      memcpy((wchar_t*)(array + 3) + pos, buffer, length * sizeof(wchar_t));
+      PushInt(pos + length, op_stack, stack_pos);
+    }
+    else {
+      PushInt(-length, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case BYTE_ARY_APPEND_INT:
+  case BYTE_ARY_APPEND_FLOAT: {
+    char buffer[MAX_FLOAT_DIGITS];
+    long length;
+    if(id == BYTE_ARY_APPEND_INT) {
+      length = kernels::FormatInt(PopInt(op_stack, stack_pos), buffer);
+    }
+    else {
+      length = kernels::FormatFloat(PopFloat(op_stack, stack_pos), buffer);
+    }
+    const long pos = PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(pos < 0 || pos > array[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
+    }
+    if(pos + length < array[2]) {
+      memcpy((char*)(array + 3) + pos, buffer, length);
+      PushInt(pos + length, op_stack, stack_pos);
+    }
+    else {
+      PushInt(-length, op_stack, stack_pos);
+    }
+  }
+    break;
+
+    // characters are UTF-8 encoded; input ends at the first null character
+    // and invalid input is skipped
+  case BYTE_ARY_APPEND_CHARS: {
+    const long num = PopInt(op_stack, stack_pos);
+    const long offset = PopInt(op_stack, stack_pos);
+    long* chars = (long*)PopInt(op_stack, stack_pos);
+    const long pos = PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array || !chars) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(pos < 0 || pos > array[2] || offset < 0 || num < 0 || offset + num > chars[2]) {
+      wcerr << L">>> Index out of bounds <<<" << endl;
+      return false;
+    }
+    const wchar_t* in = (wchar_t*)(chars + 3) + offset;
+    const long end = kernels::FindChar(in, num, L'\0');
+    const long in_size = end < 0 ? num : end;
+    const long out_size = kernels::UnicodeUtf8Size(in, in_size);
+    if(out_size < 1) {
+      PushInt(pos, op_stack, stack_pos);
+    }
+    else if(pos + out_size < array[2]) {
+      kernels::UnicodeToUtf8(in, in_size, (char*)(array + 3) + pos);
+      PushInt(pos + out_size, op_stack, stack_pos);
+    }
+    else {
+      PushInt(-out_size, op_stack, stack_pos);
+    }
+  }
+    break;
+
+    // ---------------- array operations ----------------    
+  case LOAD_MULTI_ARY_SIZE: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    
+    // allocate 'size' array and copy metadata
+    long size = array[1];
+    long dim = 1;
+    long* mem = (long*)MemoryManager::AllocateArray(size + dim + 2, INT_TYPE,
+																										op_stack, *stack_pos);
+    int i, j;
+    for(i = 0, j = size + 2; i < size; i++) {
+      mem[i + 3] = array[--j];
+    }
+    mem[0] = size;
+    mem[1] = dim;
+    mem[2] = size;
+
+    PushInt((long)mem, op_stack, stack_pos);
+  }
+    break;
+
+    // ---------------- primitive array kernels ----------------
+  case INT_ARY_SORT: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Sort((long*)(array + 3), array[2]);
+  }
+    break;
+
+  case INT_ARY_SEARCH: {
+    const long value = (long)PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Search((long*)(array + 3), array[2], value), op_stack, stack_pos);
+  }
+    break;
+
+  case INT_ARY_FILL: {
+    const long value = (long)PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Fill((long*)(array + 3), array[2], value);
+  }
+    break;
+
+  case INT_ARY_MIN: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushInt(arrays::Min((long*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushInt(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case INT_ARY_MAX: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushInt(arrays::Max((long*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushInt(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case INT_ARY_SUM: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Sum<long>((long*)(array + 3), array[2]), op_stack, stack_pos);
+  }
+    break;
+
+  case FLOAT_ARY_SORT: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Sort((FLOAT_VALUE*)(array + 3), array[2]);
+  }
+    break;
+
+  case FLOAT_ARY_SEARCH: {
+    const FLOAT_VALUE value = (FLOAT_VALUE)PopFloat(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Search((FLOAT_VALUE*)(array + 3), array[2], value), op_stack, stack_pos);
+  }
+    break;
+
+  case FLOAT_ARY_FILL: {
+    const FLOAT_VALUE value = (FLOAT_VALUE)PopFloat(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Fill((FLOAT_VALUE*)(array + 3), array[2], value);
+  }
+    break;
+
+  case FLOAT_ARY_MIN: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushFloat(arrays::Min((FLOAT_VALUE*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushFloat(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case FLOAT_ARY_MAX: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushFloat(arrays::Max((FLOAT_VALUE*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushFloat(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case FLOAT_ARY_SUM: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushFloat(arrays::Sum<FLOAT_VALUE>((FLOAT_VALUE*)(array + 3), array[2]), op_stack, stack_pos);
+  }
+    break;
+
+  case BYTE_ARY_SORT: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Sort((char*)(array + 3), array[2]);
+  }
+    break;
+
+  case BYTE_ARY_SEARCH: {
+    const char value = (char)PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Search((char*)(array + 3), array[2], value), op_stack, stack_pos);
+  }
+    break;
+
+  case BYTE_ARY_FILL: {
+    const char value = (char)PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Fill((char*)(array + 3), array[2], value);
+  }
+    break;
+
+  case BYTE_ARY_MIN: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushInt(arrays::Min((char*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushInt(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case BYTE_ARY_MAX: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushInt(arrays::Max((char*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushInt(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case BYTE_ARY_SUM: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Sum<long>((char*)(array + 3), array[2]), op_stack, stack_pos);
+  }
+    break;
+
+  case CHAR_ARY_SORT: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Sort((wchar_t*)(array + 3), array[2]);
+  }
+    break;
+
+  case CHAR_ARY_SEARCH: {
+    const wchar_t value = (wchar_t)PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Search((wchar_t*)(array + 3), array[2], value), op_stack, stack_pos);
+  }
+    break;
+
+  case CHAR_ARY_FILL: {
+    const wchar_t value = (wchar_t)PopInt(op_stack, stack_pos);
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    arrays::Fill((wchar_t*)(array + 3), array[2], value);
+  }
+    break;
+
+  case CHAR_ARY_MIN: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushInt(arrays::Min((wchar_t*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushInt(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case CHAR_ARY_MAX: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    if(array[2] > 0) {
+      PushInt(arrays::Max((wchar_t*)(array + 3), array[2]), op_stack, stack_pos);
+    }
+    else {
+      PushInt(0, op_stack, stack_pos);
+    }
+  }
+    break;
+
+  case CHAR_ARY_SUM: {
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory instance <<<" << endl;
+      return false;
+    }
+    PushInt(arrays::Sum<long>((wchar_t*)(array + 3), array[2]), op_stack, stack_pos);
+  }
+    break;
+  
+    // ---------------- memory copy operations ----------------
+  case CPY_CHAR_STR_ARY: {
+    long index = PopInt(op_stack, stack_pos);
+    const wchar_t* value_str = program->GetCharStrings()[index];
+    // copy array
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+      return false;
+    }
+    const long size = array[2];
+    wchar_t* str = (wchar_t*)(array + 3);
+    memcpy(str, value_str, size * sizeof(wchar_t));
+#ifdef _DEBUG
+    wcout << L"stack oper: CPY_CHAR_STR_ARY: index=" << index << L", string='" << str << L"'" << endl;
+#endif
+    PushInt((long)array, op_stack, stack_pos);
+  }
+    break;
+
+  case LOAD_CHAR_STR_ARY: {
+    long index = PopInt(op_stack, stack_pos);
+    long* array = program->GetCharStringArrays()[index];
+#ifdef _DEBUG
+    wcout << L"stack oper: LOAD_CHAR_STR_ARY: index=" << index << L", string='" 
+					<< (wchar_t*)(array + 3) << L"'" << endl;
+#endif
+    PushInt((long)array, op_stack, stack_pos);
+  }
+    break;
+
+  case CPY_CHAR_STR_ARYS: {
+    // copy array
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+      return false;
+    }
+    const long size = array[0];
+    const long dim = array[1];
+    // copy elements
+    long* str = (long*)(array + dim + 2);
+    for(long i = 0; i < size; i++) {
+      str[i] = PopInt(op_stack, stack_pos);
+    }
+#ifdef _DEBUG
+    wcout << L"stack oper: CPY_CHAR_STR_ARYS" << endl;
+#endif
+    PushInt((long)array, op_stack, stack_pos);
+  }
+    break;
+
+  case CPY_INT_STR_ARY: {
+    long index = PopInt(op_stack, stack_pos);
+    int* value_str = program->GetIntStrings()[index];
+    // copy array
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+      return false;
+    }
+    const long size = array[0];
+    const long dim = array[1];
+    long* str = (long*)(array + dim + 2);
+    for(long i = 0; i < size; i++) {
+      str[i] = value_str[i];
+    }
+#ifdef _DEBUG
+    wcout << L"stack oper: CPY_INT_STR_ARY" << endl;
+#endif
+    PushInt((long)array, op_stack, stack_pos);
+  }
+    break;
+
+  case CPY_FLOAT_STR_ARY: {
+    long index = PopInt(op_stack, stack_pos);
+    FLOAT_VALUE* value_str = program->GetFloatStrings()[index];
+    // copy array
+    long* array = (long*)PopInt(op_stack, stack_pos);
+    if(!array) {
+      wcerr << L">>> Atempting to dereference a 'Nil' memory element <<<" << endl;
+      return false;
+    }
+    const long size = array[0];
+    const long dim = array[1];
+    FLOAT_VALUE* str = (FLOAT_VALUE*)(array + dim + 2);
+    for(long i = 0; i < size; i++) {
+      str[i] = value_str[i];
+    }
+
+#ifdef _DEBUG
+    wcout << L"stack oper: CPY_FLOAT_STR_ARY" << endl;
+#endif
+    PushInt((long)array, op_stack, stack_pos);
+  }
+    break;
+
+    // ---------------- standard i/o ----------------
+  case STD_OUT_BOOL:
+#ifdef _DEBUG
+    wcout << L"  STD_OUT_BOOL" << endl;
+#endif
+    wcout << ((PopInt(op_stack, stack_pos) == 0) ? L"false" : L"true");
+    break;
+    
+  case STD_OUT_BYTE:
+#ifdef _DEBUG
+    wcout << L"  STD_OUT_BYTE" << endl;
+#endif
+    wcout << (unsigned char)PopInt(op_stack, stack_pos);
+    break;
+
+  case STD_OUT_CHAR:
+#ifdef _DEBUG
+    wcout << L"  STD_OUT_CHAR" << endl;
+#endif
+    wcout << (wchar_t)PopInt(op_stack, stack_pos);
     break;
 
   case STD_OUT_INT:
@@ -2050,6 +2822,64 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
 					DeserializeObject(inst, op_stack, stack_pos);
 					break;
 
+				case SERL_OBJ_FILE: {
+					const long* file_inst = (long*)PopInt(op_stack, stack_pos);
+					long* obj = (long*)PopInt(op_stack, stack_pos);
+					if(file_inst && (FILE*)file_inst[0]) {
+						FileSerialWriter writer((FILE*)file_inst[0]);
+						PushInt(SerializeObject(obj, &writer), op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+
+				case SERL_OBJ_SOCK: {
+					const long* sock_inst = (long*)PopInt(op_stack, stack_pos);
+					long* obj = (long*)PopInt(op_stack, stack_pos);
+#ifdef _WIN32
+					if(sock_inst && (SOCKET)sock_inst[0] != INVALID_SOCKET) {
+#else
+					if(sock_inst && (SOCKET)sock_inst[0] > -1) {
+#endif
+						SocketSerialWriter writer((SOCKET)sock_inst[0]);
+						PushInt(SerializeObject(obj, &writer), op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+
+				case DESERL_OBJ_FILE: {
+					const long* file_inst = (long*)PopInt(op_stack, stack_pos);
+					if(file_inst && (FILE*)file_inst[0]) {
+						FileSerialReader reader((FILE*)file_inst[0]);
+						PushInt((long)DeserializeObject(&reader, op_stack, stack_pos), op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+
+				case DESERL_OBJ_SOCK: {
+					const long* sock_inst = (long*)PopInt(op_stack, stack_pos);
+#ifdef _WIN32
+					if(sock_inst && (SOCKET)sock_inst[0] != INVALID_SOCKET) {
+#else
+					if(sock_inst && (SOCKET)sock_inst[0] > -1) {
+#endif
+						SocketSerialReader reader((SOCKET)sock_inst[0]);
+						PushInt((long)DeserializeObject(&reader, op_stack, stack_pos), op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+
 				case DESERL_BYTE_ARY:
 #ifdef _DEBUG
 					wcout << L"# deserializing byte array #" << endl;
@@ -2184,19 +3014,10 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
 					const long* instance = (long*)PopInt(op_stack, stack_pos);
 					if(array && instance) {	    
 						FILE* file = (FILE*)instance[0];
-						char buffer[SMALL_BUFFER_MAX + 1];
-						if(file && fgets(buffer, SMALL_BUFFER_MAX, file)) {
-							long end_index = strlen(buffer) - 1;
-							if(end_index > -1) {
-								if(buffer[end_index] == '\n') {
-									buffer[end_index] = '\0';
-								}
-							}
-							else {
-								buffer[0] = '\0';
-							}
+						string line;
+						if(file && ReadFileLine(file, line)) {
 							// copy
-							const wstring in = BytesToUnicode(buffer);	      
+							const wstring in = BytesToUnicode(line);	      
 							wchar_t* out = (wchar_t*)(array + 3);
 							const long max = array[2]; 
 							wcsncpy(out, in.c_str(), max);
@@ -2226,6 +3047,126 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
 					}
 				}
 					break;
+
+				case FILE_IN_LINE: {
+					const long* instance = (long*)PopInt(op_stack, stack_pos);
+					string line;
+					if(instance && (FILE*)instance[0]) {
+						ReadFileLine((FILE*)instance[0], line);
+					}
+					PushInt((long)CreateStringObject(BytesToUnicode(line), program, op_stack, stack_pos), 
+									op_stack, stack_pos);
+				}
+					break;
+
+					// ---------------- mapped file i/o ----------------
+				case FILE_MAP_OPEN: {
+					long* array = (long*)PopInt(op_stack, stack_pos);
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					if(array && instance) {
+						array = (long*)array[0];
+						const wstring name((wchar_t*)(array + 3));
+						const string filename(name.begin(), name.end());
+						long size;
+						char* base = File::MapFile(filename.c_str(), size);
+#ifdef _DEBUG
+						wcout << L"# file map: name='" << name << L"'; instance=" << instance 
+									<< L"; addr=" << (long)base << L"; size=" << size << L" #" << endl;
+#endif
+						instance[0] = (long)base;
+						instance[1] = size;
+						instance[2] = 0;
+					}
+				}
+					break;
+	
+				case FILE_MAP_CLOSE: {
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					if(instance && instance[0]) {
+#ifdef _DEBUG
+						wcout << L"# file unmap: addr=" << instance[0] << L" #" << endl;
+#endif
+						File::UnmapFile((char*)instance[0], instance[1]);
+						instance[0] = instance[1] = instance[2] = 0;
+					}
+				}
+					break;
+
+				case FILE_MAP_IN_BYTE: {
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					if(instance && instance[0] && instance[2] < instance[1]) {
+						const char* base = (char*)instance[0];
+						PushInt(base[instance[2]++], op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+
+				case FILE_MAP_IN_BYTE_ARY: {
+					long* array = (long*)PopInt(op_stack, stack_pos);
+					const long num = PopInt(op_stack, stack_pos);
+					const long offset = PopInt(op_stack, stack_pos);
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					
+					if(array && instance && instance[0] && offset > -1 && num > -1 && offset + num <= array[2]) {
+						const char* base = (char*)instance[0];
+						const long pos = instance[2];
+						const long remaining = instance[1] - pos;
+						const long count = num < remaining ? num : remaining;
+						memcpy((char*)(array + 3) + offset, base + pos, count);
+						instance[2] = pos + count;
+						PushInt(count, op_stack, stack_pos);
+					}
+					else {
+						PushInt(-1, op_stack, stack_pos);
+					}
+				}
+					break;
+
+				case FILE_MAP_IN_LINE: {
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					long size;
+					const char* line = instance ? ReadMappedLine(instance, size) : NULL;
+					if(line) {
+						PushInt((long)CreateByteArray(line, size, op_stack, stack_pos), op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+
+				case FILE_MAP_IN_STRING: {
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					long size;
+					const char* line = instance ? ReadMappedLine(instance, size) : NULL;
+					if(line) {
+						const wstring in = BytesToUnicode(string(line, size));
+						PushInt((long)CreateStringObject(in, program, op_stack, stack_pos), op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
+					
+				case FILE_MAP_SLICE: {
+					const long num = PopInt(op_stack, stack_pos);
+					const long pos = PopInt(op_stack, stack_pos);
+					long* instance = (long*)PopInt(op_stack, stack_pos);
+					if(instance && instance[0] && pos > -1 && pos <= instance[1] && num > -1) {
+						const long remaining = instance[1] - pos;
+						const long count = num < remaining ? num : remaining;
+						PushInt((long)CreateByteArray((char*)instance[0] + pos, count, op_stack, stack_pos), 
+										op_stack, stack_pos);
+					}
+					else {
+						PushInt(0, op_stack, stack_pos);
+					}
+				}
+					break;
       
 					// ---------------- socket i/o ----------------
 				case SOCK_TCP_IS_CONNECTED: {
@@ -2263,9 +3204,9 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
 						long* instance = (long*)PopInt(op_stack, stack_pos);
       
 #ifdef _WIN32    
-						if(array && instance && (SOCKET)instance[0] != INVALID_SOCKET && offset + num < array[0]) {
+						if(array && instance && (SOCKET)instance[0] != INVALID_SOCKET && offset > -1 && offset + num <= array[2]) {
 #else
-							if(array && instance && (SOCKET)instance[0] > -1 && offset + num < array[0]) {
+							if(array && instance && (SOCKET)instance[0] > -1 && offset > -1 && offset + num <= array[2]) {
 #endif
 								SOCKET sock = (SOCKET)instance[0];
 								char* buffer = (char*)(array + 3);
@@ -2298,9 +3239,9 @@ bool TrapProcessor::ProcessTrap(StackProgram* program, long* inst,
 							long* instance = (long*)PopInt(op_stack, stack_pos);
       
 #ifdef _WIN32
-							if(array && instance && (SOCKET)instance[0] != INVALID_SOCKET && offset + num < array[0]) {
+							if(array && instance && (SOCKET)instance[0] != INVALID_SOCKET && offset > -1 && offset + num <= array[2]) {
 #else
-								if(array && instance && (SOCKET)instance[0] > -1 && offset + num < array[0]) {
+								if(array && instance && (SOCKET)instance[0] > -1 && offset > -1 && offset + num <= array[2]) {
 #endif
 									SOCKET sock = (SOCKET)instance[0];
 									char* buffer = (char*)(array + 3);
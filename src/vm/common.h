@@ -110,6 +110,7 @@ class StackInstr
   long operand2;
   long operand3;
   FLOAT_VALUE float_operand;
+  long* table;
   long native_offset;
   int line_num;
 
@@ -118,6 +119,7 @@ class StackInstr
     line_num = l;
     type = t;
     operand = operand3 = native_offset = 0;
+    table = NULL;
   }
 
   StackInstr(int l, InstructionType t, long o) {
@@ -125,6 +127,7 @@ class StackInstr
     type = t;
     operand = o;
     operand3 = native_offset = 0;
+    table = NULL;
   }
 
   StackInstr(int l, InstructionType t, FLOAT_VALUE fo) {
@@ -132,6 +135,7 @@ class StackInstr
     type = t;
     float_operand = fo;
     operand = operand3 = native_offset = 0;
+    table = NULL;
   }
 
   StackInstr(int l, InstructionType t, long o, long o2) {
@@ -140,6 +144,7 @@ class StackInstr
     operand = o;
     operand2 = o2;
     operand3 = native_offset = 0;
+    table = NULL;
   }
 
   StackInstr(int l, InstructionType t, long o, long o2, long o3) {
@@ -149,9 +154,27 @@ class StackInstr
     operand2 = o2;
     operand3 = o3;
     native_offset = 0;
+    table = NULL;
+  }
+
+  // jump table with 'o2' entries for the values starting at 'o', 
+  // 'o3' is taken by other values. Labels are resolved to 
+  // instruction indices once the method has been loaded.
+  StackInstr(int l, InstructionType t, long o, long o2, long o3, long* tbl) {
+    line_num = l;
+    type = t;
+    operand = o;
+    operand2 = o2;
+    operand3 = o3;
+    table = tbl;
+    native_offset = 0;
   }
 
   ~StackInstr() {
+    if(table) {
+      delete[] table;
+      table = NULL;
+    }
   }  
 
   inline InstructionType GetType() const {
@@ -194,6 +217,10 @@ class StackInstr
     return float_operand;
   }
 
+  inline long* GetTable() const {
+    return table;
+  }
+
   inline long GetOffset() const {
     return native_offset;
   }
@@ -203,6 +230,24 @@ class StackInstr
   }
 };
 
+/********************************
+ * Counts for a branch or call 
+ * site, gathered when running
+ * with '-profile'. Counts may 
+ * be lost when threads race.
+ ********************************/
+#define PROFILE_RECEIVER_MAX 4
+
+struct ProfileSite {
+  // taken branches or calls
+  long count;
+  // branches not taken or calls to
+  // receivers that were not recorded
+  long other;
+  long receivers[PROFILE_RECEIVER_MAX];
+  long receiver_counts[PROFILE_RECEIVER_MAX];
+};
+
 /********************************
  * JIT compile code
  ********************************/
@@ -264,11 +309,19 @@ class StackMethod {
   unordered_map<long, long> jump_table;
   long param_count;
   long mem_size;
+  long frame_size;
   NativeCode* native_code;
   MemoryType rtrn_type;
   StackDclr** dclrs;
   long num_dclrs;
   StackClass* cls;
+  // statements are decoded on first use
+  const char* volatile lazy_stmts;
+  bool lazy_debug;
+  // execution profile
+  long invocations;
+  ProfileSite* profile_sites;
+  static bool is_profiling;
 #ifdef _WIN32
   static CRITICAL_SECTION virutal_cs;
 #else 
@@ -475,6 +528,9 @@ class StackMethod {
 #else 
   pthread_mutex_t jit_mutex;
 #endif
+  
+  // decodes lazy statements, set by the loader
+  static void (*lazy_loader)(StackMethod* mthd);
 
   StackMethod(long i, const wstring &n, bool v, bool h, StackDclr** d, long nd,
 							long p, long m, MemoryType r, StackClass* k) {
@@ -492,10 +548,16 @@ class StackMethod {
 		num_dclrs = nd;
 		param_count = p;
 		mem_size = m;
+		// +1 is for the instance
+		frame_size = m / sizeof(INT_VALUE) + 1;
 		rtrn_type = r;
 		cls = k;
 		instrs = NULL;
 		instr_count = 0;
+		lazy_stmts = NULL;
+		lazy_debug = false;
+		invocations = 0;
+		profile_sites = NULL;
   }
 
   ~StackMethod() {
@@ -528,6 +590,11 @@ class StackMethod {
     }
     delete[] instrs;
     instrs = NULL;
+
+    if(profile_sites) {
+      delete[] profile_sites;
+      profile_sites = NULL;
+    }
   }
 
   inline const wstring& GetName() {
@@ -609,6 +676,54 @@ class StackMethod {
   void SetInstructions(StackInstr** ii, int ic) {
     instrs = ii;
     instr_count = ic;
+    lazy_stmts = NULL;
+    
+    // one site per instruction
+    if(is_profiling && !profile_sites) {
+      profile_sites = new ProfileSite[ic];
+      memset(profile_sites, 0, ic * sizeof(ProfileSite));
+    }
+  }
+
+  static void SetProfiling(bool p) {
+    is_profiling = p;
+  }
+
+  static inline bool IsProfiling() {
+    return is_profiling;
+  }
+
+  // note: called with the frame cache locked
+  inline void AddInvocation() {
+    invocations++;
+  }
+
+  inline long GetInvocations() const {
+    return invocations;
+  }
+
+  inline ProfileSite* GetProfileSites() const {
+    return profile_sites;
+  }
+
+  // marks the method's statements for decoding on first use
+  void SetLazyStatements(const char* s, bool d) {
+    lazy_stmts = s;
+    lazy_debug = d;
+  }
+
+  inline const char* GetLazyStatements() const {
+    return lazy_stmts;
+  }
+
+  inline bool IsLazyDebug() const {
+    return lazy_debug;
+  }
+
+  inline void LoadStatements() {
+    if(lazy_stmts) {
+      lazy_loader(this);
+    }
   }
 
   long GetId() const {
@@ -624,10 +739,8 @@ class StackMethod {
   }
 
   inline long* NewMemory() {
-    // +1 is for instance variable
-    const long size = mem_size + 2;
-    long* mem = new long[size];
-    memset(mem, 0, size * sizeof(long));
+    long* mem = new long[frame_size];
+    memset(mem, 0, frame_size * sizeof(long));
 
     return mem;
   }
@@ -636,15 +749,23 @@ class StackMethod {
     return mem_size;
   }
 
-  inline long GetInstructionCount() const {
+  // words in a frame, the instance followed by one word per local slot
+  inline long GetFrameSize() const {
+    return frame_size;
+  }
+
+  inline long GetInstructionCount() {
+    LoadStatements();
     return instr_count;
   }
 
-  inline StackInstr* GetInstruction(long i) const {
+  inline StackInstr* GetInstruction(long i) {
+    LoadStatements();
     return instrs[i];
   }
 
-  StackInstr** GetInstructions() const {
+  StackInstr** GetInstructions() {
+    LoadStatements();
     return instrs;
   }
 
@@ -763,10 +884,17 @@ class StackClass {
   long* cls_mem;
   bool is_debug;
 
+  // sizes are written as slots of sizeof(INT_VALUE) bytes, in
+  // memory each slot holds a machine word
+  static inline long SlotsToBytes(long size) {
+    return size / sizeof(INT_VALUE) * sizeof(long);
+  }
+
   long InitMemory(long size) {
-    cls_mem = new long[size];
-    memset(cls_mem, 0, size * sizeof(long));    
-    return size;
+    const long slots = size / sizeof(INT_VALUE);
+    cls_mem = new long[slots];
+    memset(cls_mem, 0, slots * sizeof(long));    
+    return SlotsToBytes(size);
   }
 
  public:
@@ -783,7 +911,7 @@ class StackClass {
 		inst_dclrs = idclr;
 		inst_num_dclrs = in;
 		cls_space = InitMemory(cs);
-		inst_space  = is;
+		inst_space  = SlotsToBytes(is);
 		is_debug = b;
   }
 
@@ -999,6 +1127,7 @@ class StackProgram {
 
   wchar_t** char_strings;
   int num_char_strings;
+  long** char_string_arrays;
 
 #ifdef _WIN32
   static list<HANDLE> thread_ids;
@@ -1016,6 +1145,7 @@ class StackProgram {
     cls_interfaces = NULL;
     classes = NULL;
     char_strings = NULL;
+    char_string_arrays = NULL;
     string_cls_id = cls_cls_id = mthd_cls_id = sock_cls_id = data_type_cls_id = -1;
 #ifdef _WIN32
     InitializeCriticalSection(&program_cs);
@@ -1078,6 +1208,12 @@ class StackProgram {
       char_strings = NULL;
     }
 
+    // note: array memory is owned by the memory manager
+    if(char_string_arrays) {
+      delete[] char_string_arrays;
+      char_string_arrays = NULL;
+    }
+
     if(init_method) {
       delete init_method;
       init_method = NULL;
@@ -1269,6 +1405,18 @@ class StackProgram {
     return char_strings;
   }
 
+  int GetNumberCharStrings() const {
+    return num_char_strings;
+  }
+
+  void SetCharStringArrays(long** a) {
+    char_string_arrays = a;
+  }
+
+  long** GetCharStringArrays() const {
+    return char_string_arrays;
+  }
+
   void SetClasses(StackClass** clss, const int num) {
     classes = clss;
     class_num = num;
@@ -1337,6 +1485,9 @@ class StackProgram {
     return class_num;
   }
 
+  // writes the counts gathered when running with '-profile'
+  bool WriteProfile(const wstring &program_file, const wstring &profile_file);
+
 #ifdef _DEBUGGER
   bool HasFile(const wstring &fn) {
     for(int i = 0; i < class_num; i++) {
@@ -1408,13 +1559,126 @@ class StackFrame {
 };
 **/
 
+/********************************
+ * Streams serialized bytes to
+ * and from files and sockets
+ ********************************/
+#define SERIAL_CHUNK_SIZE 65536
+
+class SerialWriter {
+ public:
+  virtual ~SerialWriter() {
+  }
+  
+  virtual bool Write(const char* buffer, const long size) = 0;
+};
+
+class SerialReader {
+ public:
+  virtual ~SerialReader() {
+  }
+  
+  virtual bool Read(char* buffer, const long size) = 0;
+};
+
+/********************************
+ * Open-addressing table that maps
+ * serialized memory to ids
+ ********************************/
+class SerialIdTable {
+  long** keys;
+  long* values;
+  size_t capacity;
+  size_t count;
+
+  static inline size_t Hash(long* key) {
+    size_t hash = (size_t)key >> 3;
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return hash;
+  }
+
+  void Insert(long* key, long value) {
+    const size_t mask = capacity - 1;
+    size_t index = Hash(key) & mask;
+    while(keys[index]) {
+      index = (index + 1) & mask;
+    }
+    keys[index] = key;
+    values[index] = value;
+    count++;
+  }
+
+  void Grow() {
+    long** old_keys = keys;
+    long* old_values = values;
+    const size_t old_capacity = capacity;
+
+    capacity *= 2;
+    count = 0;
+    keys = (long**)calloc(capacity, sizeof(long*));
+    values = (long*)malloc(capacity * sizeof(long));
+    for(size_t i = 0; i < old_capacity; i++) {
+      if(old_keys[i]) {
+        Insert(old_keys[i], old_values[i]);
+      }
+    }
+    
+    free(old_keys);
+    free(old_values);
+  }
+  
+ public:
+  SerialIdTable() {
+    capacity = 256;
+    count = 0;
+    keys = (long**)calloc(capacity, sizeof(long*));
+    values = (long*)malloc(capacity * sizeof(long));
+  }
+
+  ~SerialIdTable() {
+    free(keys);
+    keys = NULL;
+    free(values);
+    values = NULL;
+  }
+
+  // returns the id of known memory, otherwise adds it and returns 0
+  long FindOrInsert(long* key, long value) {
+    const size_t mask = capacity - 1;
+    size_t index = Hash(key) & mask;
+    while(keys[index]) {
+      if(keys[index] == key) {
+        return values[index];
+      }
+      index = (index + 1) & mask;
+    }
+
+    // keep load factor under 3/4
+    if((count + 1) * 4 > capacity * 3) {
+      Grow();
+      Insert(key, value);
+    }
+    else {
+      keys[index] = key;
+      values[index] = value;
+      count++;
+    }
+    
+    return 0;
+  }
+};
+
 /********************************
  * ObjectSerializer class
  ********************************/
 class ObjectSerializer 
 {
   vector<char> values;
-  map<long*, long> serial_ids;
+  SerialIdTable serial_ids;
+  SerialWriter* writer;
+  bool is_written;
   long next_id;
   long cur_id;
 
@@ -1423,70 +1687,92 @@ class ObjectSerializer
   void Serialize(long* inst);
 
   bool WasSerialized(long* mem) {
-    map<long*, long>::iterator find = serial_ids.find(mem);
-    if(find != serial_ids.end()) {
-      cur_id = find->second;
+    const long id = serial_ids.FindOrInsert(mem, next_id + 1);
+    if(id) {
+      cur_id = id;
       SerializeInt(cur_id);
 
       return true;
     }
     next_id++;
     cur_id = next_id * -1;
-    serial_ids.insert(pair<long*, long>(mem, next_id));
     SerializeInt(cur_id);
 
     return false;
   }
 
-  inline void SerializeByte(const char v) {
-    char* bp = (char*)&v;
-    for(size_t i = 0; i < sizeof(v); i++) {
-      values.push_back(*(bp + i));
+  inline void Flush() {
+    if(writer && !values.empty()) {
+      if(!writer->Write(&values[0], values.size())) {
+        is_written = false;
+      }
+      values.clear();
     }
   }
+  
+  inline void SerializeBytes(const void* array, const long len) {
+    const char* bp = (const char*)array;
+    if(writer && len >= SERIAL_CHUNK_SIZE) {
+      // large blocks bypass the chunk buffer
+      Flush();
+      if(!writer->Write(bp, len)) {
+        is_written = false;
+      }
+      return;
+    }
+    
+    values.insert(values.end(), bp, bp + len);
+    if(writer && (long)values.size() >= SERIAL_CHUNK_SIZE) {
+      Flush();
+    }
+  }
+  
+  inline void SerializeByte(const char v) {
+    SerializeBytes(&v, sizeof(v));
+  }
 
   // TODO: unicode 
   inline void SerializeChar(const wchar_t v) {
     string out;
     CharacterToBytes(v, out);
     SerializeInt(out.size());
-    for(size_t i = 0; i < out.size(); i++) {
-      values.push_back(out[i]); 
-    }
+    SerializeBytes(out.c_str(), out.size());
   }
 
   inline void SerializeInt(const INT_VALUE v) {
-    char* bp = (char*)&v;
-    for(size_t i = 0; i < sizeof(v); i++) {
-      values.push_back(*(bp + i));
-    }
+    SerializeBytes(&v, sizeof(v));
   }
 
   inline void SerializeFloat(const FLOAT_VALUE v) {
-    char* bp = (char*)&v;
-    for(size_t i = 0; i < sizeof(v); i++) {
-      values.push_back(*(bp + i));
-    }
-  }
-
-  inline void SerializeBytes(const void* array, const long len) {
-    char* bp = (char*)array;
-    for(long i = 0; i < len; i++) {
-      values.push_back(*(bp + i));
-    }
+    SerializeBytes(&v, sizeof(v));
   }
 
  public:
   ObjectSerializer(long* i) {
+    writer = NULL;
+    is_written = true;
+    values.reserve(SMALL_BUFFER_MAX + 1);
     Serialize(i);
   }
 
+  ObjectSerializer(long* i, SerialWriter* w) {
+    writer = w;
+    is_written = true;
+    values.reserve(SERIAL_CHUNK_SIZE);
+    Serialize(i);
+    Flush();
+  }
+
   ~ObjectSerializer() {
   }
 
   vector<char>& GetValues() {
     return values;
   }
+
+  bool IsWritten() const {
+    return is_written;
+  }
 };
 
 /********************************
@@ -1497,18 +1783,37 @@ class ObjectDeserializer
   const char* buffer;
   long buffer_offset;
   long buffer_array_size;
+  SerialReader* reader;
   long* op_stack;
   long* stack_pos;
   StackClass* cls;
   long* instance;
   long instance_pos;
-  map<INT_VALUE, long*> mem_cache;
+  vector<long*> local_cache;
+  vector<long*>* mem_cache;
 
+  inline bool HasData() const {
+    return reader || buffer_offset < buffer_array_size;
+  }
+  
+  inline void DeserializeBytes(void* value, const long size) {
+    if(reader) {
+      if(!reader->Read((char*)value, size)) {
+        memset(value, 0, size);
+      }
+    }
+    else if(buffer_offset + size <= buffer_array_size) {
+      memcpy(value, buffer + buffer_offset, size);
+    }
+    else {
+      memset(value, 0, size);
+    }
+    buffer_offset += size;
+  }
+  
   char DeserializeByte() {
     char value;
-    memcpy(&value, buffer + buffer_offset, sizeof(value));
-    buffer_offset += sizeof(value);
-
+    DeserializeBytes(&value, sizeof(value));
     return value;
   }
 
@@ -1516,36 +1821,43 @@ class ObjectDeserializer
   wchar_t DeserializeChar() {
     // read
     const int num = DeserializeInt();
-    char* in = new char[num + 1];
-    memcpy(in, buffer + buffer_offset, num);
-    in[num] = '\0';
-
+    string in(num > 0 ? num : 0, '\0');
+    if(num > 0) {
+      DeserializeBytes(&in[0], num);
+    }
+    
     // convert
     wchar_t out = L'\0';
     BytesToCharacter(in, out);
-    delete[] in;
-    in = NULL;
-
-    buffer_offset += num;
     return out;
   }
 
   INT_VALUE DeserializeInt() {
     INT_VALUE value;
-    memcpy(&value, buffer + buffer_offset, sizeof(value));
-    buffer_offset += sizeof(value);
-
+    DeserializeBytes(&value, sizeof(value));
     return value;
   }
 
   FLOAT_VALUE DeserializeFloat() {
     FLOAT_VALUE value;
-    memcpy(&value, buffer + buffer_offset, sizeof(value));
-    buffer_offset += sizeof(value);
-
+    DeserializeBytes(&value, sizeof(value));
     return value;
   }
 
+  inline long* FindMemory(const INT_VALUE mem_id) {
+    if(mem_id > 0 && mem_id < (INT_VALUE)mem_cache->size()) {
+      return (*mem_cache)[mem_id];
+    }
+    return NULL;
+  }
+
+  inline void CacheMemory(const INT_VALUE mem_id, long* mem) {
+    if(mem_id >= (INT_VALUE)mem_cache->size()) {
+      mem_cache->resize(mem_id + 1, NULL);
+    }
+    (*mem_cache)[mem_id] = mem;
+  }
+  
  public:
   ObjectDeserializer(const char* b, long s, long* stack, long* pos) {
     op_stack = stack;
@@ -1553,19 +1865,35 @@ class ObjectDeserializer
     buffer = b;
     buffer_array_size = s;
     buffer_offset = 0;
+    reader = NULL;
+    mem_cache = &local_cache;
+    cls = NULL;
+    instance = NULL;
+    instance_pos = 0;
+  }
+
+  ObjectDeserializer(SerialReader* r, long* stack, long* pos) {
+    op_stack = stack;
+    stack_pos = pos;
+    buffer = NULL;
+    buffer_array_size = 0;
+    buffer_offset = 0;
+    reader = r;
+    mem_cache = &local_cache;
     cls = NULL;
     instance = NULL;
     instance_pos = 0;
   }
 
-  ObjectDeserializer(const char* b, long o, map<INT_VALUE, long*> &c, 
-										 long s, long* stack, long* pos) {
-		op_stack = stack;
-		stack_pos = pos;
-		buffer = b;
-		buffer_array_size = s;
-		buffer_offset = o;
-		mem_cache = c;
+  // nested object; shares the parent's input and memory cache
+  ObjectDeserializer(ObjectDeserializer* parent) {
+		op_stack = parent->op_stack;
+		stack_pos = parent->stack_pos;
+		buffer = parent->buffer;
+		buffer_array_size = parent->buffer_array_size;
+		buffer_offset = parent->buffer_offset;
+		reader = parent->reader;
+		mem_cache = parent->mem_cache;
 		cls = NULL;
 		instance = NULL;
 		instance_pos = 0;
@@ -1578,8 +1906,8 @@ class ObjectDeserializer
     return buffer_offset;
   }
 
-  map<INT_VALUE, long*> GetMemoryCache() {
-    return mem_cache;
+  char ReadByte() {
+    return DeserializeByte();
   }
 
   long* DeserializeObject();
@@ -2014,6 +2342,8 @@ class TrapProcessor {
   //
   static void SerializeObject(long* inst, StackFrame* frame, long* &op_stack, long* &stack_pos);
   static void DeserializeObject(long* inst, long* &op_stack, long* &stack_pos);
+  static bool SerializeObject(long* obj, SerialWriter* writer);
+  static long* DeserializeObject(SerialReader* reader, long* &op_stack, long* &stack_pos);
 
   //
   // time functions
@@ -2051,6 +2381,28 @@ class TrapProcessor {
   //
   static inline long* CreateStringObject(const wstring &value_str, StackProgram* program, 
 																				 long* &op_stack, long* &stack_pos);
+
+  //
+  // creates a byte array from a native buffer
+  //
+  static inline long* CreateByteArray(const char* buffer, const long size, 
+																			long* &op_stack, long* &stack_pos);
+
+  //
+  // allocates empty byte and character arrays
+  //
+  static inline long* CreateByteArray(const long size, long* &op_stack, long* &stack_pos);
+  static inline long* CreateCharArray(const long size, long* &op_stack, long* &stack_pos);
+
+  //
+  // reads a line of any length from a file
+  //
+  static bool ReadFileLine(FILE* file, string &line);
+
+  //
+  // scans the next line of a mapped file
+  //
+  static const char* ReadMappedLine(long* instance, long &size);
  public:
 
   static bool ProcessTrap(StackProgram* program, long* inst, 
@@ -33,8 +33,33 @@
 #include "fcgiapp.h"
 #include "vm.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #define SUCCESS 0
 #define USAGE_ERROR -1
+#define REPORT_INTERVAL 1000
+
+// holds the state of a request worker
+struct FcgiWorker {
+  int id;
+  StackMethod* method;
+  long requests;
+#ifdef _WIN32
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+};
+
+// serializes calls to accept, per the FastCGI threading model
+#ifdef _WIN32
+static CRITICAL_SECTION accept_cs;
+#else
+static pthread_mutex_t accept_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static long report_interval = REPORT_INTERVAL;
 
 void PrintEnv(FCGX_Stream* out, const char* label, char** envp)
 {
@@ -44,6 +69,132 @@ void PrintEnv(FCGX_Stream* out, const char* label, char** envp)
   }
 }
 
+//
+// reads a positive integer runtime property
+//
+long GetIntProperty(const wstring &name, long default_value)
+{
+  const wstring value = Loader::GetProgram()->GetProperty(name);
+  if(value.size() > 0) {
+    const long int_value = wcstol(value.c_str(), NULL, 10);
+    if(int_value > 0) {
+      return int_value;
+    }
+  }
+  
+  return default_value;
+}
+
+//
+// executes the 'Request(args)' function for a single request
+//
+bool ProcessRequest(Runtime::StackInterpreter &intpr, StackMethod* mthd, FCGX_Request &request,
+                    long* op_stack, long* stack_pos)
+{
+  (*stack_pos) = 0;
+  
+  // create request
+  long* req_obj = MemoryManager::AllocateObject(L"FastCgi.Request", op_stack, *stack_pos, false);
+  if(!req_obj) {
+    cerr << ">>> DLL call: Unable to allocate object FastCgi.Request <<<" << endl;
+    return false;
+  }
+  req_obj[0] = (long)request.in;
+  req_obj[1] = (long)request.envp;
+  
+  // create response
+  long* res_obj = MemoryManager::AllocateObject(L"FastCgi.Response", op_stack, *stack_pos, false);
+  if(!res_obj) {
+    cerr << ">>> DLL call: Unable to allocate object FastCgi.Response <<" << endl;
+    return false;
+  }
+  res_obj[0] = (long)request.out;
+  res_obj[1] = (long)request.err;
+  
+  // set calling parameters
+  op_stack[0] = (long)req_obj;
+  op_stack[1] = (long)res_obj;
+  (*stack_pos) = 2;
+  
+  // execute method
+  intpr.Execute(op_stack, stack_pos, 0, mthd, NULL, false);
+  
+#ifdef _DEBUG
+  cout << "# final stack: pos=" << (*stack_pos) << " #" << endl;
+  if((*stack_pos) > 0) {
+    for(int i = 0; i < (*stack_pos); i++) {
+      cout << "dump: value=" << (void*)(*stack_pos) << endl;
+    } 
+  }
+  PrintEnv(request.out, "Request environment", request.envp);
+  PrintEnv(request.out, "Initial environment", environ);
+#endif
+  
+  return true;
+}
+
+//
+// worker accept loop, the interpreter and operand
+// stack are reused across requests
+//
+#ifdef _WIN32
+uintptr_t WINAPI RunWorker(LPVOID arg)
+#else
+void* RunWorker(void* arg)
+#endif
+{
+  FcgiWorker* worker = (FcgiWorker*)arg;
+  
+  FCGX_Request request;
+  if(FCGX_InitRequest(&request, 0, 0)) {
+    cerr << ">>> Unable to initialize FCGI request for worker=" << worker->id << " <<<" << endl;
+    exit(1);
+  }
+  
+  long* op_stack = new long[CALC_STACK_SIZE];
+  long* stack_pos = new long;
+  Runtime::StackInterpreter intpr;
+  
+  while(true) {
+#ifdef _WIN32
+    EnterCriticalSection(&accept_cs);
+#else
+    pthread_mutex_lock(&accept_mutex);
+#endif
+    const int status = FCGX_Accept_r(&request);
+#ifdef _WIN32
+    LeaveCriticalSection(&accept_cs);
+#else
+    pthread_mutex_unlock(&accept_mutex);
+#endif
+    if(status < 0) {
+      break;
+    }
+    
+    const bool processed = ProcessRequest(intpr, worker->method, request, op_stack, stack_pos);
+    FCGX_Finish_r(&request);
+    if(!processed) {
+      // TODO: error
+      exit(1);
+    }
+    
+    // report request counters
+    worker->requests++;
+    if(worker->requests % report_interval == 0) {
+      cerr << "### FCGI worker=" << worker->id << ", requests=" << worker->requests << " ###" << endl;
+    }
+  }
+  
+  // clean up
+  delete[] op_stack;
+  op_stack = NULL;
+  
+  delete stack_pos;
+  stack_pos = NULL;
+  
+  return 0;
+}
+
 int main(const int argc, const char* argv[])
 {
   const char* prgm_path = FCGX_GetParam("PROGRAM_PATH", environ);
@@ -54,7 +205,8 @@ int main(const int argc, const char* argv[])
   
   // load program
   srand(time(NULL)); rand();
-  Loader loader(prgm_path);
+  wstring prgm_name = BytesToUnicode(prgm_path);
+  Loader loader((wchar_t*)prgm_name.c_str());
   loader.Load();
 
   // ignore web applications
@@ -63,10 +215,6 @@ int main(const int argc, const char* argv[])
     exit(1);
   }
   
-#ifdef _TIMING
-  clock_t start = clock();
-#endif
-  
   // locate starting class and method
   StackMethod* mthd = loader.GetStartMethod();
   if(!mthd) {
@@ -78,74 +226,67 @@ int main(const int argc, const char* argv[])
   cerr << "### Loaded method: " << mthd->GetName() << " ###" << endl;
 #endif
   
-  Runtime::StackInterpreter intpr(Loader::GetProgram());
+  // initialize the runtime, worker interpreters share the program
+  Runtime::StackInterpreter::Initialize(Loader::GetProgram());
   
-  // go into accept loop...
-  FCGX_Stream*in;
-  FCGX_Stream* out;
-  FCGX_Stream* err;
-  FCGX_ParamArray envp;
+  // size the worker pool, defaults to one worker per core
+#ifdef _WIN32
+  SYSTEM_INFO sys_info;
+  GetSystemInfo(&sys_info);
+  long num_cores = sys_info.dwNumberOfProcessors;
+#else
+  long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  const long num_workers = GetIntProperty(L"fcgi-workers", num_cores > 0 ? num_cores : 1);
+  report_interval = GetIntProperty(L"fcgi-report-interval", REPORT_INTERVAL);
   
-  while(mthd && (FCGX_Accept(&in, &out, &err, &envp) >= 0)) {    
-    // execute method
-    long* op_stack = new long[CALC_STACK_SIZE];
-    long* stack_pos = new long;
-    
-    // create request
-    long* req_obj = MemoryManager::Instance()->AllocateObject("FastCgi.Request", 
-							      op_stack, *stack_pos, false);
-    if(req_obj) {
-      req_obj[0] = (long)in;
-      req_obj[1] = (long)envp;
-      
-      // create response
-      long* res_obj = MemoryManager::Instance()->AllocateObject("FastCgi.Response", 
-								op_stack, *stack_pos, false);
-      if(res_obj) { 	
-	res_obj[0] = (long)out;
-	res_obj[1] = (long)err;
-	
-	// set calling parameters
-	op_stack[0] = (long)req_obj;
-	op_stack[1] = (long)res_obj;
-	*stack_pos = 2;
- 	
-	// execute method
-	intpr.Execute((long*)op_stack, (long*)stack_pos, 0, mthd, NULL, false);
-      }
-      else {
-	cerr << ">>> DLL call: Unable to allocate object FastCgi.Response <<" << endl;
-	// TODO: error
-	return 1;
-      }
-    }
-    else {
-      cerr << ">>> DLL call: Unable to allocate object FastCgi.Request <<<" << endl;
-      // TODO: error
-      return 1;
-    }
-    
-#ifdef _DEBUG
-    cout << "# final stack: pos=" << (*stack_pos) << " #" << endl;
-    if((*stack_pos) > 0) {
-      for(int i = 0; i < (*stack_pos); i++) {
-	cout << "dump: value=" << (void*)(*stack_pos) << endl;
-      } 
-    }
+  cerr << "### FCGI workers=" << num_workers << " ###" << endl;
+  
+  if(FCGX_Init()) {
+    cerr << ">>> Unable to initialize FCGI library <<<" << endl;
+    exit(1);
+  }
+  
+#ifdef _WIN32
+  InitializeCriticalSection(&accept_cs);
 #endif
-    
-    // clean up
-    delete[] op_stack;
-    op_stack = NULL;
 
-    delete stack_pos;
-    stack_pos = NULL;
-    
-#ifdef _DEBUG
-    PrintEnv(out, "Request environment", envp);
-    PrintEnv(out, "Initial environment", environ);
+  // start workers
+  FcgiWorker* workers = new FcgiWorker[num_workers];
+  for(long i = 0; i < num_workers; i++) {
+    FcgiWorker* worker = &workers[i];
+    worker->id = i;
+    worker->method = mthd;
+    worker->requests = 0;
+#ifdef _WIN32
+    worker->thread = (HANDLE)_beginthreadex(NULL, 0, RunWorker, worker, 0, NULL);
+    if(!worker->thread) {
+#else
+    if(pthread_create(&worker->thread, NULL, RunWorker, (void*)worker)) {
 #endif
+      cerr << ">>> Internal error: Unable to create FCGI worker thread! <<<" << endl;
+      exit(1);
+    }
   }
   
-  return 0;
+  // wait for workers
+  long total_requests = 0;
+  for(long i = 0; i < num_workers; i++) {
+    FcgiWorker* worker = &workers[i];
+#ifdef _WIN32
+    WaitForSingleObject(worker->thread, INFINITE);
+    CloseHandle(worker->thread);
+#else
+    void* status;
+    pthread_join(worker->thread, &status);
+#endif
+    cerr << "### FCGI worker=" << worker->id << ", requests=" << worker->requests << " ###" << endl;
+    total_requests += worker->requests;
+  }
+  cerr << "### FCGI total requests=" << total_requests << " ###" << endl;
+  
+  delete[] workers;
+  workers = NULL;
+  
+  return SUCCESS;
 }
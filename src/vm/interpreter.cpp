@@ -55,7 +55,7 @@
 using namespace Runtime;
 
 StackProgram* StackInterpreter::program;
-stack<StackFrame*> StackInterpreter::cached_frames;
+stack<StackFrame*> StackInterpreter::cached_frames[FRAME_CACHE_NUM];
 #ifdef _WIN32
 	CRITICAL_SECTION StackInterpreter::cached_frames_cs;
 #else
@@ -98,11 +98,14 @@ void StackInterpreter::Initialize(StackProgram* p)
 #endif
 
 #ifndef _SANITIZE
-  // allocate 256K frames
-	for(int i = 0; i < CALL_STACK_SIZE * 16; i++) {
-		StackFrame* frame = new StackFrame();
-		frame->mem = (long*)calloc(LOCAL_SIZE, sizeof(long));
-		cached_frames.push(frame);
+  // allocate 1K frames of each size
+	for(int i = 0; i < FRAME_CACHE_NUM; i++) {
+		const long cache_size = FRAME_CACHE_MIN << i;
+		for(int j = 0; j < CALL_STACK_SIZE; j++) {
+			StackFrame* frame = new StackFrame();
+			frame->mem = (long*)calloc(cache_size, sizeof(long));
+			cached_frames[i].push(frame);
+		}
 	}
 #endif
   
@@ -118,6 +121,24 @@ void StackInterpreter::Initialize(StackProgram* p)
 #endif
 #endif
   MemoryManager::Initialize(program);
+
+  // intern character string literals, these arrays live outside
+  // of the collected heap for the life of the program
+  const int num_char_strings = program->GetNumberCharStrings();
+  wchar_t** char_strings = program->GetCharStrings();
+  long** char_string_arrays = new long*[num_char_strings];
+  for(int i = 0; i < num_char_strings; i++) {
+    const long size = wcslen(char_strings[i]);
+    const long dim = 1;
+    long* array = MemoryManager::AllocateImmortalArray(size + 1 + ((dim + 2) * sizeof(long)), 
+																											 CHAR_ARY_TYPE);
+    array[0] = size;
+    array[1] = dim;
+    array[2] = size;
+    memcpy(array + 3, char_strings[i], size * sizeof(wchar_t));
+    char_string_arrays[i] = array;
+  }
+  program->SetCharStringArrays(char_string_arrays);
 }
 
 /********************************
@@ -1129,7 +1150,10 @@ void StackInterpreter::Execute(long* op_stack, long* stack_pos, long i, StackMet
 #ifdef _DEBUG
       wcout << L"stack oper: JMP; call_pos=" << (*call_stack_pos) << endl;
 #endif
-      if(!instr->GetOperand3()) {
+      if(instr->GetOperand2() > -1 && StackMethod::IsProfiling()) {
+        ProfileBranch(instr, ip, op_stack, stack_pos);
+      }
+      else if(!instr->GetOperand3()) {
 				if(instr->GetOperand2() < 0) {
 					ip = (*frame)->method->GetLabelIndex(instr->GetOperand()) + 1;
 					instr->SetOperand3(ip);
@@ -1149,6 +1173,21 @@ void StackInterpreter::Execute(long* op_stack, long* stack_pos, long i, StackMet
       }
       break;
 
+    case TBL_SWITCH: {
+#ifdef _DEBUG
+      wcout << L"stack oper: TBL_SWITCH; call_pos=" << (*call_stack_pos) << endl;
+#endif
+      // note: values below the table wrap around and are also out of range
+      const unsigned long index = PopInt(op_stack, stack_pos) - instr->GetOperand();
+      if(index < (unsigned long)instr->GetOperand2()) {
+				ip = instr->GetTable()[index];
+      }
+      else {
+				ip = instr->GetOperand3();
+      }
+    }
+      break;
+
       // note: just for debugger
     case END_STMTS:
       break;
@@ -1656,6 +1695,10 @@ void StackInterpreter::ProcessMethodCall(StackInstr* instr, StackInstr** &instrs
 
   // make call
   StackMethod* called = program->GetClass(instr->GetOperand())->GetMethod(instr->GetOperand2());
+  if(StackMethod::IsProfiling()) {
+    ProfileCall((*frame)->method, ip - 1, called->IsVirtual() ? MemoryManager::GetClass(instance) : NULL);
+  }
+  
   // dynamically bind class for virutal method
   if(called->IsVirtual()) {
     StackClass* impl_class = MemoryManager::GetClass((long*)instance);
@@ -1722,6 +1765,12 @@ void StackInterpreter::ProcessJitMethodCall(StackMethod* called, long* instance,
 #ifdef _DEBUGGER
   ProcessInterpretedMethodCall(called, instance, instrs, ip);
 #else
+  // profiles are gathered by the interpreter
+  if(StackMethod::IsProfiling()) {
+    ProcessInterpretedMethodCall(called, instance, instrs, ip);
+    return;
+  }
+  
   if(called->GetNativeCode()) {
     JitExecutorIA32 jit_executor;
     long status = jit_executor.Execute(called, (long*)instance, op_stack, stack_pos, call_stack, call_stack_pos);
@@ -1792,6 +1841,59 @@ void StackInterpreter::ProcessJitMethodCall(StackMethod* called, long* instance,
 #endif
 }
 
+/********************************
+ * Processes a conditional jump
+ * and counts the outcome
+ ********************************/
+void StackInterpreter::ProfileBranch(StackInstr* instr, long &ip, long* &op_stack, long* &stack_pos)
+{
+  ProfileSite* site = (*frame)->method->GetProfileSites();
+  if(site) {
+    site += ip - 1;
+  }
+  
+  if(PopInt(op_stack, stack_pos) == instr->GetOperand2()) {
+    ip = (*frame)->method->GetLabelIndex(instr->GetOperand()) + 1;
+    if(site) {
+      site->count++;
+    }
+  }
+  else if(site) {
+    site->other++;
+  }
+}
+
+/********************************
+ * Counts a method call and the
+ * class of a virtual call's 
+ * receiver
+ ********************************/
+void StackInterpreter::ProfileCall(StackMethod* caller, long index, StackClass* receiver)
+{
+  ProfileSite* site = caller->GetProfileSites();
+  if(!site) {
+    return;
+  }
+  site += index;
+  site->count++;
+  
+  if(receiver) {
+    const long cls_id = receiver->GetId();
+    for(int i = 0; i < PROFILE_RECEIVER_MAX; i++) {
+      if(site->receiver_counts[i] == 0) {
+        site->receivers[i] = cls_id;
+        site->receiver_counts[i] = 1;
+        return;
+      }
+      else if(site->receivers[i] == cls_id) {
+        site->receiver_counts[i]++;
+        return;
+      }
+    }
+    site->other++;
+  }
+}
+
 /********************************
  * Processes an interpreted
  * synchronous method call.
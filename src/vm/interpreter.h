@@ -54,6 +54,8 @@ namespace Runtime {
   
 #define CALL_STACK_SIZE 1024
 #define CALC_STACK_SIZE 512
+#define FRAME_CACHE_MIN 8
+#define FRAME_CACHE_NUM 4
 	
   // holds the calling context for async
   // method calls
@@ -66,7 +68,7 @@ namespace Runtime {
   class StackInterpreter {
     // program
     static StackProgram* program;
-		static stack<StackFrame*> cached_frames;
+		static stack<StackFrame*> cached_frames[FRAME_CACHE_NUM];
 #ifdef _WIN32
 		static CRITICAL_SECTION cached_frames_cs;
 #else
@@ -84,26 +86,50 @@ namespace Runtime {
     Debugger* debugger;
 #endif
 		
+		//
+		// frames are cached by size, in classes of
+		// 8, 16, 32 and 64 words
+		//
+		static inline int GetFrameCache(long size) {
+			int cache = 0;
+			while((FRAME_CACHE_MIN << cache) < size) {
+				cache++;
+			}
+			
+			return cache;
+		}
+		
 		//
 		// get stack frame
 		//
 		static inline StackFrame* GetStackFrame(StackMethod* method, long* instance) {
-#ifndef _SANITIZE
+			const long size = method->GetFrameSize();
 #ifdef _WIN32
 			EnterCriticalSection(&cached_frames_cs);
 #else
 			pthread_mutex_lock(&cached_frames_mutex);
 #endif
-      if(cached_frames.empty()) {
-				// allocate 256K frames
-				for(int i = 0; i < CALL_STACK_SIZE; i++) {
-					StackFrame* frame = new StackFrame();
-					frame->mem = (long*)calloc(LOCAL_SIZE, sizeof(long));
-					cached_frames.push(frame);
+
+#ifndef _SANITIZE
+			StackFrame* frame;
+			const int cache = GetFrameCache(size);
+			if(cache < FRAME_CACHE_NUM) {
+				if(cached_frames[cache].empty()) {
+					// allocate 1K frames
+					const long cache_size = FRAME_CACHE_MIN << cache;
+					for(int i = 0; i < CALL_STACK_SIZE; i++) {
+						frame = new StackFrame();
+						frame->mem = (long*)calloc(cache_size, sizeof(long));
+						cached_frames[cache].push(frame);
+					}
 				}
-      }
-			StackFrame* frame = cached_frames.top();
-			cached_frames.pop();
+				frame = cached_frames[cache].top();
+				cached_frames[cache].pop();
+			}
+			else {
+				frame = new StackFrame();
+				frame->mem = (long*)calloc(size, sizeof(long));
+			}
       
 			frame->method = method;
 			frame->mem[0] = (long)instance;
@@ -117,11 +143,16 @@ namespace Runtime {
 #else      
       StackFrame* frame = new StackFrame;
 			frame->method = method;
-      frame->mem = (long*)calloc(LOCAL_SIZE, sizeof(long));
+      frame->mem = (long*)calloc(size, sizeof(long));
 			frame->mem[0] = (long)instance;
 			frame->ip = -1;
 			frame->jit_called = false;
 #endif
+
+      // invocations are counted under the lock
+      if(StackMethod::IsProfiling()) {
+        method->AddInvocation();
+      }
  
 #ifdef _WIN32
 			LeaveCriticalSection(&cached_frames_cs);
@@ -142,8 +173,10 @@ namespace Runtime {
 #endif
       
 #ifndef _SANITIZE
-       // cache up to 256k frames
-       if(cached_frames.size() > CALL_STACK_SIZE * 256) {
+       // cache up to 256k frames of each size
+       const long size = frame->method->GetFrameSize();
+       const int cache = GetFrameCache(size);
+       if(cache >= FRAME_CACHE_NUM || cached_frames[cache].size() > CALL_STACK_SIZE * 256) {
          free(frame->mem);
          delete frame;
 #ifdef _DEBUG
@@ -151,8 +184,9 @@ namespace Runtime {
 #endif
        }
        else {
-         memset(frame->mem, 0, LOCAL_SIZE);
-         cached_frames.push(frame);
+         // only the method's words were used
+         memset(frame->mem, 0, size * sizeof(long));
+         cached_frames[cache].push(frame);
 
 #ifdef _DEBUG
          wcout << L"caching frame=" << frame << endl;
@@ -463,6 +497,8 @@ namespace Runtime {
     inline void ProcessMethodCall(StackInstr* instr, StackInstr** &instrs, long &ip, long* &op_stack, long* &stack_pos);
     inline void ProcessDynamicMethodCall(StackInstr* instr, StackInstr** &instrs, long &ip, long* &op_stack, long* &stack_pos);
     inline void ProcessJitMethodCall(StackMethod* called, long* instance, StackInstr** &instrs, long &ip, long* &op_stack, long* &stack_pos);
+    inline void ProfileBranch(StackInstr* instr, long &ip, long* &op_stack, long* &stack_pos);
+    inline void ProfileCall(StackMethod* caller, long index, StackClass* receiver);
     inline void ProcessAsyncMethodCall(StackMethod* called, long* param);
 
     inline void ProcessInterpretedMethodCall(StackMethod* called, long* instance, StackInstr** &instrs, long &ip);
@@ -491,11 +527,13 @@ namespace Runtime {
 
     // free static resources
     static void Clear() {
-      while(!cached_frames.empty()) {
-        StackFrame* frame = cached_frames.top();
-        cached_frames.pop();
-        free(frame->mem);
-        delete frame;
+      for(int i = 0; i < FRAME_CACHE_NUM; i++) {
+        while(!cached_frames[i].empty()) {
+          StackFrame* frame = cached_frames[i].top();
+          cached_frames[i].pop();
+          free(frame->mem);
+          delete frame;
+        }
       }
     }
 
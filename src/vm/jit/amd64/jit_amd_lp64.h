@@ -255,7 +255,7 @@ namespace Runtime {
     stack<RegisterHolder*> aux_regs;
     vector<RegisterHolder*> aval_xregs;
     list<RegisterHolder*> used_xregs;
-    unordered_map<int, StackInstr*> jump_table; // jump addresses are 64-bits
+    unordered_map<int, long> jump_table; // jump addresses to instruction indices
     long org_local_space, local_space;
     StackMethod* method;
     long instr_count;
@@ -301,6 +301,7 @@ namespace Runtime {
     void ProcessLoadFloatElement(StackInstr* instr);
     void ProcessStoreFloatElement(StackInstr* instr);
     void ProcessJump(StackInstr* instr);
+    void ProcessJumpTable(StackInstr* instr);
     void ProcessLogic(StackInstr* instr);
     void ProcessFloor(StackInstr* instr);
     void ProcessCeiling(StackInstr* instr);
@@ -1037,6 +1038,9 @@ namespace Runtime {
     // function call instruction
     void call_reg(Register reg);
 
+    // indirect jump instruction
+    void jmp_reg(Register reg);
+
     // generates a conditional jump
     bool cond_jmp(InstructionType type);
 
@@ -1791,11 +1795,10 @@ namespace Runtime {
 	}
 
 	// show content
-	unordered_map<int, StackInstr*>::iterator iter;
+	unordered_map<int, long>::iterator iter;
 	for(iter = jump_table.begin(); iter != jump_table.end(); ++iter) {
-	  StackInstr* instr = iter->second;
 	  long src_offset = iter->first;
-	  long dest_index = method->GetLabelIndex(instr->GetOperand()) + 1;
+	  long dest_index = iter->second;
 	  long dest_offset = method->GetInstruction(dest_index)->GetOffset();
 	  long offset = dest_offset - src_offset - 4; // 64-bit jump offset
 	  memcpy(&code[src_offset], &offset, 4); 
@@ -744,6 +744,10 @@ void JitCompilerIA32::ProcessInstructions() {
     case JMP:
       ProcessJump(instr);
       break;
+
+    case TBL_SWITCH:
+      ProcessJumpTable(instr);
+      break;
       
     case LBL:
 #ifdef _DEBUG
@@ -870,7 +874,7 @@ void JitCompilerIA32::ProcessJump(StackInstr* instr) {
       left = NULL;
     }
     // store update index
-    jump_table.insert(pair<int32_t, StackInstr*>(code_index, instr));
+    jump_table.insert(pair<int32_t, int32_t>(code_index, method->GetLabelIndex(instr->GetOperand()) + 1));
     // temp offset, updated in next pass
     AddImm(0);
   }
@@ -890,6 +894,75 @@ void JitCompilerIA32::ProcessJump(StackInstr* instr) {
   }
 }
 
+void JitCompilerIA32::ProcessJumpTable(StackInstr* instr) {
+#ifdef _DEBUG
+  wcout << L"TBL_SWITCH: low=" << instr->GetOperand() << L", size=" << instr->GetOperand2() 
+       << L", regs=" << aval_regs.size() << L"," << aux_regs.size() << endl;
+#endif
+  RegInstr* left = working_stack.front();
+  working_stack.pop_front();
+  
+  RegisterHolder* holder = NULL;
+  switch(left->GetType()) {
+  case IMM_INT:
+    holder = GetRegister();
+    move_imm_reg(left->GetOperand(), holder->GetRegister());
+    break;
+    
+  case REG_INT:
+    holder = left->GetRegister();
+    break;
+    
+  case MEM_INT:
+    holder = GetRegister();
+    move_mem_reg(left->GetOperand(), EBP, holder->GetRegister());
+    break;
+    
+  default:
+    wcerr << L">>> Should never occur (compiler bug?) type=" << left->GetType() << L" <<<" << endl;
+    exit(1);
+    break;
+  }
+  
+  // table index, values below the table wrap around
+  if(instr->GetOperand() != 0) {
+    sub_imm_reg(instr->GetOperand(), holder->GetRegister());
+  }
+  cmp_imm_reg(instr->GetOperand2(), holder->GetRegister());
+  
+  // jae, unsigned compare for values outside of the table
+  AddMachineCode(0x0f);
+  AddMachineCode(0x83);
+  jump_table.insert(pair<int32_t, int32_t>(code_index, instr->GetOperand3()));
+  AddImm(0);
+  
+  // table address, updated once the code is in place
+  RegisterHolder* table_holder = GetRegister();
+  move_imm_reg(0, table_holder->GetRegister());
+  const int32_t address_offset = code_index - 4;
+  
+  // table entries are 5-byte jumps
+  add_reg_reg(holder->GetRegister(), table_holder->GetRegister());
+  shl_imm_reg(2, holder->GetRegister());
+  add_reg_reg(holder->GetRegister(), table_holder->GetRegister());
+  jmp_reg(table_holder->GetRegister());
+  table_addresses.insert(pair<int32_t, int32_t>(address_offset, code_index));
+  
+  // table of jumps, updated in next pass
+  long* table = instr->GetTable();
+  for(int32_t i = 0; i < instr->GetOperand2(); ++i) {
+    AddMachineCode(0xe9);
+    jump_table.insert(pair<int32_t, int32_t>(code_index, table[i]));
+    AddImm(0);
+  }
+  
+  // clean up
+  ReleaseRegister(holder);
+  ReleaseRegister(table_holder);
+  delete left;
+  left = NULL;
+}
+
 void JitCompilerIA32::ProcessReturnParameters(MemoryType type) {
   switch(type) {
   case INT_TYPE:
@@ -2465,7 +2538,7 @@ bool JitCompilerIA32::cond_jmp(InstructionType type) {
       }  
     }    
     // store update index
-		jump_table.insert(pair<int32_t, StackInstr*>(code_index, next_instr));
+		jump_table.insert(pair<int32_t, int32_t>(code_index, method->GetLabelIndex(next_instr->GetOperand()) + 1));
     // temp offset
     AddImm(0);
     skip_jump = true;
@@ -3516,6 +3589,17 @@ void JitCompilerIA32::call_reg(Register reg) {
 #endif
 }
 
+void JitCompilerIA32::jmp_reg(Register reg) {
+  AddMachineCode(0xff);
+  unsigned char code = 0xe0;
+  RegisterEncode3(code, 5, reg);
+  AddMachineCode(code);
+#ifdef _DEBUG
+  wcout << L"  " << (++instr_count) << L": [jmp *%" << GetRegisterName(reg)
+       << L"]" << endl;
+#endif
+}
+
 void JitCompilerIA32::cmp_xreg_xreg(Register src, Register dest) {
 #ifdef _DEBUG
   wcout << L"  " << (++instr_count) << L": [ucomisd %" << GetRegisterName(src) 
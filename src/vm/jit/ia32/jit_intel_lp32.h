@@ -246,7 +246,8 @@ namespace Runtime {
     stack<RegisterHolder*> aux_regs;
     vector<RegisterHolder*> aval_xregs;
     list<RegisterHolder*> used_xregs;
-    unordered_map<int32_t, StackInstr*> jump_table;
+    unordered_map<int32_t, int32_t> jump_table; // jump addresses to instruction indices
+    unordered_map<int32_t, int32_t> table_addresses; // jump table addresses to table offsets
     int32_t local_space;
     StackMethod* method;
     int32_t instr_count;
@@ -292,6 +293,7 @@ namespace Runtime {
     void ProcessLoadFloatElement(StackInstr* instr);
     void ProcessStoreFloatElement(StackInstr* instr);
     void ProcessJump(StackInstr* instr);
+    void ProcessJumpTable(StackInstr* instr);
     void ProcessLogic(StackInstr* instr);
     void ProcessFloor(StackInstr* instr);
     void ProcessCeiling(StackInstr* instr);
@@ -827,6 +829,9 @@ namespace Runtime {
     // function call instruction
     void call_reg(Register reg);
 
+    // indirect jump instruction
+    void jmp_reg(Register reg);
+
     // generates a conditional jump
     bool cond_jmp(InstructionType type);
 
@@ -1600,11 +1605,10 @@ namespace Runtime {
         }
 
         // show content
-        unordered_map<int32_t, StackInstr*>::iterator iter;
+        unordered_map<int32_t, int32_t>::iterator iter;
         for(iter = jump_table.begin(); iter != jump_table.end(); ++iter) {
-          StackInstr* instr = iter->second;
           int32_t src_offset = iter->first;
-          int32_t dest_index = method->GetLabelIndex(instr->GetOperand()) + 1;
+          int32_t dest_index = iter->second;
           int32_t dest_offset = method->GetInstruction(dest_index)->GetOffset();
           int32_t offset = dest_offset - src_offset - 4;
           memcpy(&code[src_offset], &offset, 4); 
@@ -1613,6 +1617,11 @@ namespace Runtime {
             << L"; dest=" << dest_offset << endl;
 #endif
         }
+        // jump table addresses, the code buffer no longer moves
+        for(iter = table_addresses.begin(); iter != table_addresses.end(); ++iter) {
+          int32_t address = (int32_t)(code + iter->second);
+          memcpy(&code[iter->first], &address, 4); 
+        }
 #ifdef _DEBUG
         wcout << L"Caching JIT code: actual=" << code_index 
           << L", buffer=" << code_buf_max << L" byte(s)" << endl;
@@ -0,0 +1,877 @@
+/***************************************************************************
+ * Vectorized kernels for character and byte arrays
+ *
+ * Copyright (c) 2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+
+#include <math.h>
+#include <string.h>
+#include <wchar.h>
+
+// SSE2 is part of the x64 baseline; AVX2 is selected at runtime
+#ifdef _WIN32
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <intrin.h>
+#include <immintrin.h>
+#define _SIMD_SSE2
+#define _SIMD_AVX2
+#define AVX2_TARGET
+#endif
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define _SIMD_SSE2
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#include <immintrin.h>
+#define _SIMD_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// lane operations for the native character width
+#if WCHAR_MAX > 0xffff
+#define SSE_SET_CHAR(c) _mm_set1_epi32((int)(c))
+#define SSE_CMPEQ_CHAR _mm_cmpeq_epi32
+#define SSE_CMPGT_CHAR _mm_cmpgt_epi32
+#define AVX_SET_CHAR(c) _mm256_set1_epi32((int)(c))
+#define AVX_CMPEQ_CHAR _mm256_cmpeq_epi32
+#define AVX_CMPGT_CHAR _mm256_cmpgt_epi32
+#else
+#define SSE_SET_CHAR(c) _mm_set1_epi16((short)(c))
+#define SSE_CMPEQ_CHAR _mm_cmpeq_epi16
+#define SSE_CMPGT_CHAR _mm_cmpgt_epi16
+#define AVX_SET_CHAR(c) _mm256_set1_epi16((short)(c))
+#define AVX_CMPEQ_CHAR _mm256_cmpeq_epi16
+#define AVX_CMPGT_CHAR _mm256_cmpgt_epi16
+#endif
+
+#define SSE_CHARS (long)(16 / sizeof(wchar_t))
+#define AVX_CHARS (long)(32 / sizeof(wchar_t))
+
+namespace kernels {
+  /********************************
+   * Bit scanning helpers
+   ********************************/
+  static inline int FirstBit(unsigned int mask) {
+#ifdef _WIN32
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+  static inline int LastBit(unsigned int mask) {
+#ifdef _WIN32
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return (int)index;
+#else
+    return 31 - __builtin_clz(mask);
+#endif
+  }
+
+  /********************************
+   * Portable kernels
+   ********************************/
+  static long FindCharScalar(const wchar_t* str, long size, wchar_t c) {
+    for(long i = 0; i < size; i++) {
+      if(str[i] == c) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  static long FindLastCharScalar(const wchar_t* str, long size, wchar_t c) {
+    for(long i = size - 1; i > -1; i--) {
+      if(str[i] == c) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  static long MismatchScalar(const wchar_t* left, const wchar_t* right, long size) {
+    for(long i = 0; i < size; i++) {
+      if(left[i] != right[i]) {
+        return i;
+      }
+    }
+
+    return size;
+  }
+
+  static long FindStringScalar(const wchar_t* str, long size, const wchar_t* find, long find_size) {
+    for(long i = 0; i + find_size <= size; i++) {
+      if(str[i] == find[0] && !memcmp(str + i, find, find_size * sizeof(wchar_t))) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  static void ToUpperScalar(const wchar_t* in, wchar_t* out, long size) {
+    for(long i = 0; i < size; i++) {
+      const wchar_t c = in[i];
+      out[i] = c >= L'a' && c <= L'z' ? c - 32 : c;
+    }
+  }
+
+  static void ToLowerScalar(const wchar_t* in, wchar_t* out, long size) {
+    for(long i = 0; i < size; i++) {
+      const wchar_t c = in[i];
+      out[i] = c >= L'A' && c <= L'Z' ? c + 32 : c;
+    }
+  }
+
+#ifdef _SIMD_SSE2
+  /********************************
+   * SSE2 kernels
+   ********************************/
+  static long FindCharSse2(const wchar_t* str, long size, wchar_t c) {
+    const __m128i match = SSE_SET_CHAR(c);
+    long i = 0;
+    for(; i + SSE_CHARS <= size; i += SSE_CHARS) {
+      const __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+      const int mask = _mm_movemask_epi8(SSE_CMPEQ_CHAR(block, match));
+      if(mask) {
+        return i + FirstBit(mask) / sizeof(wchar_t);
+      }
+    }
+
+    const long found = FindCharScalar(str + i, size - i, c);
+    return found < 0 ? -1 : i + found;
+  }
+
+  static long FindLastCharSse2(const wchar_t* str, long size, wchar_t c) {
+    const __m128i match = SSE_SET_CHAR(c);
+    long i = size;
+    for(; i - SSE_CHARS >= 0; i -= SSE_CHARS) {
+      const __m128i block = _mm_loadu_si128((const __m128i*)(str + i - SSE_CHARS));
+      const int mask = _mm_movemask_epi8(SSE_CMPEQ_CHAR(block, match));
+      if(mask) {
+        return i - SSE_CHARS + LastBit(mask) / sizeof(wchar_t);
+      }
+    }
+
+    return FindLastCharScalar(str, i, c);
+  }
+
+  static long MismatchSse2(const wchar_t* left, const wchar_t* right, long size) {
+    long i = 0;
+    for(; i + SSE_CHARS <= size; i += SSE_CHARS) {
+      const __m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+      const __m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+      const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) ^ 0xffff;
+      if(mask) {
+        return i + FirstBit(mask) / sizeof(wchar_t);
+      }
+    }
+
+    return i + MismatchScalar(left + i, right + i, size - i);
+  }
+
+  // candidates must match the first and last characters before the body is compared
+  static long FindStringSse2(const wchar_t* str, long size, const wchar_t* find, long find_size) {
+    const __m128i first = SSE_SET_CHAR(find[0]);
+    const __m128i last = SSE_SET_CHAR(find[find_size - 1]);
+    const size_t body_size = (find_size - 1) * sizeof(wchar_t);
+
+    long i = 0;
+    for(; i + find_size - 1 + SSE_CHARS <= size; i += SSE_CHARS) {
+      const __m128i head = _mm_loadu_si128((const __m128i*)(str + i));
+      const __m128i tail = _mm_loadu_si128((const __m128i*)(str + i + find_size - 1));
+      unsigned int mask = _mm_movemask_epi8(_mm_and_si128(SSE_CMPEQ_CHAR(head, first),
+                                                          SSE_CMPEQ_CHAR(tail, last)));
+      while(mask) {
+        const int bit = FirstBit(mask);
+        const long index = i + bit / sizeof(wchar_t);
+        if(!memcmp(str + index + 1, find + 1, body_size)) {
+          return index;
+        }
+        mask &= ~(((1u << sizeof(wchar_t)) - 1) << bit);
+      }
+    }
+
+    const long found = FindStringScalar(str + i, size - i, find, find_size);
+    return found < 0 ? -1 : i + found;
+  }
+
+  static void ToUpperSse2(const wchar_t* in, wchar_t* out, long size) {
+    const __m128i lower = SSE_SET_CHAR(L'a' - 1);
+    const __m128i upper = SSE_SET_CHAR(L'z' + 1);
+    const __m128i delta = SSE_SET_CHAR(32);
+
+    long i = 0;
+    for(; i + SSE_CHARS <= size; i += SSE_CHARS) {
+      const __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+      const __m128i is_lower = _mm_and_si128(SSE_CMPGT_CHAR(block, lower), SSE_CMPGT_CHAR(upper, block));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(block, _mm_and_si128(is_lower, delta)));
+    }
+    ToUpperScalar(in + i, out + i, size - i);
+  }
+
+  static void ToLowerSse2(const wchar_t* in, wchar_t* out, long size) {
+    const __m128i lower = SSE_SET_CHAR(L'A' - 1);
+    const __m128i upper = SSE_SET_CHAR(L'Z' + 1);
+    const __m128i delta = SSE_SET_CHAR(32);
+
+    long i = 0;
+    for(; i + SSE_CHARS <= size; i += SSE_CHARS) {
+      const __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+      const __m128i is_upper = _mm_and_si128(SSE_CMPGT_CHAR(block, lower), SSE_CMPGT_CHAR(upper, block));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(block, _mm_and_si128(is_upper, delta)));
+    }
+    ToLowerScalar(in + i, out + i, size - i);
+  }
+#endif
+
+#ifdef _SIMD_AVX2
+  /********************************
+   * AVX2 kernels
+   ********************************/
+  AVX2_TARGET static long FindCharAvx2(const wchar_t* str, long size, wchar_t c) {
+    const __m256i match = AVX_SET_CHAR(c);
+    long i = 0;
+    for(; i + AVX_CHARS <= size; i += AVX_CHARS) {
+      const __m256i block = _mm256_loadu_si256((const __m256i*)(str + i));
+      const unsigned int mask = _mm256_movemask_epi8(AVX_CMPEQ_CHAR(block, match));
+      if(mask) {
+        return i + FirstBit(mask) / sizeof(wchar_t);
+      }
+    }
+
+    const long found = FindCharSse2(str + i, size - i, c);
+    return found < 0 ? -1 : i + found;
+  }
+
+  AVX2_TARGET static long FindLastCharAvx2(const wchar_t* str, long size, wchar_t c) {
+    const __m256i match = AVX_SET_CHAR(c);
+    long i = size;
+    for(; i - AVX_CHARS >= 0; i -= AVX_CHARS) {
+      const __m256i block = _mm256_loadu_si256((const __m256i*)(str + i - AVX_CHARS));
+      const unsigned int mask = _mm256_movemask_epi8(AVX_CMPEQ_CHAR(block, match));
+      if(mask) {
+        return i - AVX_CHARS + LastBit(mask) / sizeof(wchar_t);
+      }
+    }
+
+    return FindLastCharSse2(str, i, c);
+  }
+
+  AVX2_TARGET static long MismatchAvx2(const wchar_t* left, const wchar_t* right, long size) {
+    long i = 0;
+    for(; i + AVX_CHARS <= size; i += AVX_CHARS) {
+      const __m256i l = _mm256_loadu_si256((const __m256i*)(left + i));
+      const __m256i r = _mm256_loadu_si256((const __m256i*)(right + i));
+      const unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(l, r));
+      if(mask) {
+        return i + FirstBit(mask) / sizeof(wchar_t);
+      }
+    }
+
+    return i + MismatchSse2(left + i, right + i, size - i);
+  }
+
+  AVX2_TARGET static long FindStringAvx2(const wchar_t* str, long size, const wchar_t* find, long find_size) {
+    const __m256i first = AVX_SET_CHAR(find[0]);
+    const __m256i last = AVX_SET_CHAR(find[find_size - 1]);
+    const size_t body_size = (find_size - 1) * sizeof(wchar_t);
+
+    long i = 0;
+    for(; i + find_size - 1 + AVX_CHARS <= size; i += AVX_CHARS) {
+      const __m256i head = _mm256_loadu_si256((const __m256i*)(str + i));
+      const __m256i tail = _mm256_loadu_si256((const __m256i*)(str + i + find_size - 1));
+      unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(AVX_CMPEQ_CHAR(head, first),
+                                                                AVX_CMPEQ_CHAR(tail, last)));
+      while(mask) {
+        const int bit = FirstBit(mask);
+        const long index = i + bit / sizeof(wchar_t);
+        if(!memcmp(str + index + 1, find + 1, body_size)) {
+          return index;
+        }
+        mask &= ~(((1u << sizeof(wchar_t)) - 1) << bit);
+      }
+    }
+
+    const long found = FindStringSse2(str + i, size - i, find, find_size);
+    return found < 0 ? -1 : i + found;
+  }
+
+  AVX2_TARGET static void ToUpperAvx2(const wchar_t* in, wchar_t* out, long size) {
+    const __m256i lower = AVX_SET_CHAR(L'a' - 1);
+    const __m256i upper = AVX_SET_CHAR(L'z' + 1);
+    const __m256i delta = AVX_SET_CHAR(32);
+
+    long i = 0;
+    for(; i + AVX_CHARS <= size; i += AVX_CHARS) {
+      const __m256i block = _mm256_loadu_si256((const __m256i*)(in + i));
+      const __m256i is_lower = _mm256_and_si256(AVX_CMPGT_CHAR(block, lower), AVX_CMPGT_CHAR(upper, block));
+      _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(block, _mm256_and_si256(is_lower, delta)));
+    }
+    ToUpperSse2(in + i, out + i, size - i);
+  }
+
+  AVX2_TARGET static void ToLowerAvx2(const wchar_t* in, wchar_t* out, long size) {
+    const __m256i lower = AVX_SET_CHAR(L'A' - 1);
+    const __m256i upper = AVX_SET_CHAR(L'Z' + 1);
+    const __m256i delta = AVX_SET_CHAR(32);
+
+    long i = 0;
+    for(; i + AVX_CHARS <= size; i += AVX_CHARS) {
+      const __m256i block = _mm256_loadu_si256((const __m256i*)(in + i));
+      const __m256i is_upper = _mm256_and_si256(AVX_CMPGT_CHAR(block, lower), AVX_CMPGT_CHAR(upper, block));
+      _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(block, _mm256_and_si256(is_upper, delta)));
+    }
+    ToLowerSse2(in + i, out + i, size - i);
+  }
+
+  static bool HasAvx2() {
+#ifdef _WIN32
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7) {
+      return false;
+    }
+    // OS must save the upper YMM state
+    __cpuid(info, 1);
+    if(!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6) {
+      return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+  }
+#endif
+
+  /********************************
+   * Dispatch table, selected once
+   * from the host CPU features
+   ********************************/
+  struct Dispatch {
+    long (*find_char)(const wchar_t*, long, wchar_t);
+    long (*find_last_char)(const wchar_t*, long, wchar_t);
+    long (*mismatch)(const wchar_t*, const wchar_t*, long);
+    long (*find_string)(const wchar_t*, long, const wchar_t*, long);
+    void (*to_upper)(const wchar_t*, wchar_t*, long);
+    void (*to_lower)(const wchar_t*, wchar_t*, long);
+
+    Dispatch() {
+#if defined(_SIMD_AVX2)
+      if(HasAvx2()) {
+        find_char = FindCharAvx2;
+        find_last_char = FindLastCharAvx2;
+        mismatch = MismatchAvx2;
+        find_string = FindStringAvx2;
+        to_upper = ToUpperAvx2;
+        to_lower = ToLowerAvx2;
+        return;
+      }
+#endif
+#if defined(_SIMD_SSE2)
+      find_char = FindCharSse2;
+      find_last_char = FindLastCharSse2;
+      mismatch = MismatchSse2;
+      find_string = FindStringSse2;
+      to_upper = ToUpperSse2;
+      to_lower = ToLowerSse2;
+#else
+      find_char = FindCharScalar;
+      find_last_char = FindLastCharScalar;
+      mismatch = MismatchScalar;
+      find_string = FindStringScalar;
+      to_upper = ToUpperScalar;
+      to_lower = ToLowerScalar;
+#endif
+    }
+  };
+
+  static const Dispatch& GetDispatch() {
+    static const Dispatch dispatch;
+    return dispatch;
+  }
+
+  /********************************
+   * Character array operations
+   ********************************/
+  static inline long FindChar(const wchar_t* str, long size, wchar_t c) {
+    return GetDispatch().find_char(str, size, c);
+  }
+
+  static inline long FindLastChar(const wchar_t* str, long size, wchar_t c) {
+    return GetDispatch().find_last_char(str, size, c);
+  }
+
+  static inline long FindString(const wchar_t* str, long size, const wchar_t* find, long find_size) {
+    if(find_size < 1 || find_size > size) {
+      return -1;
+    }
+
+    if(find_size == 1) {
+      return FindChar(str, size, find[0]);
+    }
+
+    return GetDispatch().find_string(str, size, find, find_size);
+  }
+
+  // returns <0, 0 or >0 like 'wcscmp'
+  static inline long Compare(const wchar_t* left, long left_size, const wchar_t* right, long right_size) {
+    const long size = left_size < right_size ? left_size : right_size;
+    const long index = GetDispatch().mismatch(left, right, size);
+    if(index < size) {
+      return left[index] < right[index] ? -1 : 1;
+    }
+
+    if(left_size == right_size) {
+      return 0;
+    }
+
+    return left_size < right_size ? -1 : 1;
+  }
+
+  static inline void ToUpper(const wchar_t* in, wchar_t* out, long size) {
+    GetDispatch().to_upper(in, out, size);
+  }
+
+  static inline void ToLower(const wchar_t* in, wchar_t* out, long size) {
+    GetDispatch().to_lower(in, out, size);
+  }
+
+  /********************************
+   * UTF-8 validation and
+   * transcoding; ASCII runs are
+   * processed 16 bytes at a time
+   ********************************/
+  static inline long AsciiPrefix(const char* in, long size) {
+    long i = 0;
+#ifdef _SIMD_SSE2
+    for(; i + 16 <= size; i += 16) {
+      const int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(in + i)));
+      if(mask) {
+        return i + FirstBit(mask);
+      }
+    }
+#endif
+    while(i < size && !(in[i] & 0x80)) {
+      i++;
+    }
+
+    return i;
+  }
+
+  // decodes one multi-byte sequence, returns its length or 0 if invalid
+  static inline int DecodeUtf8(const unsigned char* in, long size, unsigned long &code) {
+    const unsigned char lead = in[0];
+    int length;
+    unsigned long min;
+    if(lead >= 0xc2 && lead <= 0xdf) {
+      length = 2; min = 0x80; code = lead & 0x1f;
+    }
+    else if(lead >= 0xe0 && lead <= 0xef) {
+      length = 3; min = 0x800; code = lead & 0x0f;
+    }
+    else if(lead >= 0xf0 && lead <= 0xf4) {
+      length = 4; min = 0x10000; code = lead & 0x07;
+    }
+    else {
+      return 0;
+    }
+
+    if(length > size) {
+      return 0;
+    }
+
+    for(int i = 1; i < length; i++) {
+      if((in[i] & 0xc0) != 0x80) {
+        return 0;
+      }
+      code = (code << 6) | (in[i] & 0x3f);
+    }
+
+    // overlong forms, surrogates and out of range values
+    if(code < min || (code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff) {
+      return 0;
+    }
+
+    return length;
+  }
+
+  // number of characters needed for 'in' or -1 if it's not valid UTF-8
+  static long Utf8Size(const char* in, long size) {
+    const unsigned char* bytes = (const unsigned char*)in;
+    long count = 0;
+    long i = 0;
+    while(i < size) {
+      const long ascii = AsciiPrefix(in + i, size - i);
+      i += ascii;
+      count += ascii;
+      if(i < size) {
+        unsigned long code;
+        const int length = DecodeUtf8(bytes + i, size - i, code);
+        if(!length) {
+          return -1;
+        }
+        i += length;
+#if WCHAR_MAX > 0xffff
+        count++;
+#else
+        count += code > 0xffff ? 2 : 1;
+#endif
+      }
+    }
+
+    return count;
+  }
+
+  static inline bool IsUtf8(const char* in, long size) {
+    return Utf8Size(in, size) > -1;
+  }
+
+  // 'out' must hold Utf8Size(in, size) characters
+  static void Utf8ToUnicode(const char* in, long size, wchar_t* out) {
+    const unsigned char* bytes = (const unsigned char*)in;
+    long i = 0;
+    while(i < size) {
+#ifdef _SIMD_SSE2
+      const __m128i zero = _mm_setzero_si128();
+      for(; i + 16 <= size; i += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+        if(_mm_movemask_epi8(block)) {
+          break;
+        }
+        const __m128i low = _mm_unpacklo_epi8(block, zero);
+        const __m128i high = _mm_unpackhi_epi8(block, zero);
+#if WCHAR_MAX > 0xffff
+        _mm_storeu_si128((__m128i*)(out), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(high, zero));
+#else
+        _mm_storeu_si128((__m128i*)(out), low);
+        _mm_storeu_si128((__m128i*)(out + 8), high);
+#endif
+        out += 16;
+      }
+#endif
+      for(; i < size && !(bytes[i] & 0x80); i++) {
+        *out++ = bytes[i];
+      }
+
+      if(i < size) {
+        unsigned long code;
+        const int length = DecodeUtf8(bytes + i, size - i, code);
+        if(!length) {
+          return;
+        }
+        i += length;
+#if WCHAR_MAX > 0xffff
+        *out++ = (wchar_t)code;
+#else
+        if(code > 0xffff) {
+          code -= 0x10000;
+          *out++ = (wchar_t)(0xd800 + (code >> 10));
+          *out++ = (wchar_t)(0xdc00 + (code & 0x3ff));
+        }
+        else {
+          *out++ = (wchar_t)code;
+        }
+#endif
+      }
+    }
+  }
+
+  // reads one code point, returns the characters consumed or 0 if invalid
+  static inline int ReadCodePoint(const wchar_t* in, long size, unsigned long &code) {
+#if WCHAR_MAX > 0xffff
+    code = (unsigned long)in[0];
+    if((code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff) {
+      return 0;
+    }
+    return 1;
+#else
+    code = (unsigned short)in[0];
+    if(code >= 0xd800 && code <= 0xdbff) {
+      if(size < 2 || (unsigned short)in[1] < 0xdc00 || (unsigned short)in[1] > 0xdfff) {
+        return 0;
+      }
+      code = 0x10000 + ((code - 0xd800) << 10) + ((unsigned short)in[1] - 0xdc00);
+      return 2;
+    }
+    if(code >= 0xdc00 && code <= 0xdfff) {
+      return 0;
+    }
+    return 1;
+#endif
+  }
+
+  // number of bytes needed to encode 'in' or -1 if it's not valid Unicode
+  static long UnicodeUtf8Size(const wchar_t* in, long size) {
+    long count = 0;
+    long i = 0;
+    while(i < size) {
+      if((unsigned long)in[i] < 0x80) {
+        count++;
+        i++;
+      }
+      else {
+        unsigned long code;
+        const int length = ReadCodePoint(in + i, size - i, code);
+        if(!length) {
+          return -1;
+        }
+        i += length;
+        count += code < 0x800 ? 2 : (code < 0x10000 ? 3 : 4);
+      }
+    }
+
+    return count;
+  }
+
+  // 'out' must hold UnicodeUtf8Size(in, size) bytes
+  static void UnicodeToUtf8(const wchar_t* in, long size, char* out) {
+    long i = 0;
+    while(i < size) {
+#ifdef _SIMD_SSE2
+      // narrow blocks of ASCII characters
+      const __m128i high_bits = SSE_SET_CHAR(~0x7f);
+      const __m128i zero = _mm_setzero_si128();
+      for(; i + 16 <= size; i += 16) {
+#if WCHAR_MAX > 0xffff
+        const __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(in + i + 4));
+        const __m128i c = _mm_loadu_si128((const __m128i*)(in + i + 8));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(in + i + 12));
+        const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(all, high_bits), zero)) != 0xffff) {
+          break;
+        }
+        const __m128i low = _mm_packs_epi32(a, b);
+        const __m128i high = _mm_packs_epi32(c, d);
+#else
+        const __m128i low = _mm_loadu_si128((const __m128i*)(in + i));
+        const __m128i high = _mm_loadu_si128((const __m128i*)(in + i + 8));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(low, high), high_bits), zero)) != 0xffff) {
+          break;
+        }
+#endif
+        _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(low, high));
+        out += 16;
+      }
+#endif
+      for(; i < size && (unsigned long)in[i] < 0x80; i++) {
+        *out++ = (char)in[i];
+      }
+
+      if(i < size) {
+        unsigned long code;
+        const int length = ReadCodePoint(in + i, size - i, code);
+        if(!length) {
+          return;
+        }
+        i += length;
+
+        if(code < 0x800) {
+          *out++ = (char)(0xc0 | (code >> 6));
+        }
+        else if(code < 0x10000) {
+          *out++ = (char)(0xe0 | (code >> 12));
+          *out++ = (char)(0x80 | ((code >> 6) & 0x3f));
+        }
+        else {
+          *out++ = (char)(0xf0 | (code >> 18));
+          *out++ = (char)(0x80 | ((code >> 12) & 0x3f));
+          *out++ = (char)(0x80 | ((code >> 6) & 0x3f));
+        }
+        *out++ = (char)(0x80 | (code & 0x3f));
+      }
+    }
+  }
+
+  /********************************
+   * Base64 encoding; the low byte
+   * of each character is encoded
+   ********************************/
+  static inline long Base64EncodedSize(long size) {
+    return (size + 2) / 3 * 4;
+  }
+
+  static void Base64Encode(const wchar_t* in, long size, wchar_t* out) {
+    static const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    long i = 0;
+    for(; i + 3 <= size; i += 3) {
+      const unsigned long block = ((in[i] & 0xff) << 16) | ((in[i + 1] & 0xff) << 8) | (in[i + 2] & 0xff);
+      out[0] = digits[(block >> 18) & 0x3f];
+      out[1] = digits[(block >> 12) & 0x3f];
+      out[2] = digits[(block >> 6) & 0x3f];
+      out[3] = digits[block & 0x3f];
+      out += 4;
+    }
+
+    const long extra = size - i;
+    if(extra) {
+      unsigned long block = (in[i] & 0xff) << 16;
+      if(extra == 2) {
+        block |= (in[i + 1] & 0xff) << 8;
+      }
+      out[0] = digits[(block >> 18) & 0x3f];
+      out[1] = digits[(block >> 12) & 0x3f];
+      out[2] = extra == 2 ? digits[(block >> 6) & 0x3f] : L'=';
+      out[3] = L'=';
+    }
+  }
+
+  static inline int Base64Digit(wchar_t c) {
+    if(c >= L'A' && c <= L'Z') {
+      return c - L'A';
+    }
+    if(c >= L'a' && c <= L'z') {
+      return c - L'a' + 26;
+    }
+    if(c >= L'0' && c <= L'9') {
+      return c - L'0' + 52;
+    }
+    if(c == L'+' || c == L'-') {
+      return 62;
+    }
+    if(c == L'/' || c == L'_') {
+      return 63;
+    }
+
+    return -1;
+  }
+
+  // decoding stops at padding; whitespace and other characters are skipped
+  static long Base64DecodedSize(const wchar_t* in, long size) {
+    long digits = 0;
+    for(long i = 0; i < size && in[i] != L'='; i++) {
+      if(Base64Digit(in[i]) > -1) {
+        digits++;
+      }
+    }
+
+    return digits * 3 / 4;
+  }
+
+  static void Base64Decode(const wchar_t* in, long size, wchar_t* out) {
+    unsigned long block = 0;
+    int count = 0;
+    for(long i = 0; i < size && in[i] != L'='; i++) {
+      const int digit = Base64Digit(in[i]);
+      if(digit > -1) {
+        block = (block << 6) | digit;
+        if(++count == 4) {
+          out[0] = (wchar_t)((block >> 16) & 0xff);
+          out[1] = (wchar_t)((block >> 8) & 0xff);
+          out[2] = (wchar_t)(block & 0xff);
+          out += 3;
+          block = 0;
+          count = 0;
+        }
+      }
+    }
+
+    if(count == 2) {
+      out[0] = (wchar_t)((block >> 4) & 0xff);
+    }
+    else if(count == 3) {
+      out[0] = (wchar_t)((block >> 10) & 0xff);
+      out[1] = (wchar_t)((block >> 2) & 0xff);
+    }
+  }
+
+  /********************************
+   * Number formatting, output
+   * matches Int->ToString and
+   * Float->ToString
+   ********************************/
+#define MAX_INT_DIGITS 24
+#define MAX_FLOAT_DIGITS 512
+
+  // returns the number of characters written
+  template<class T> static long FormatInt(long value, T* out) {
+    char digits[MAX_INT_DIGITS];
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    long count = 0;
+    do {
+      digits[count++] = (char)('0' + magnitude % 10);
+      magnitude /= 10;
+    }
+    while(magnitude);
+
+    long length = 0;
+    if(value < 0) {
+      out[length++] = (T)'-';
+    }
+    while(count > 0) {
+      out[length++] = (T)digits[--count];
+    }
+
+    return length;
+  }
+
+  // leading fraction zeros followed by three significant digits
+  template<class T> static long FormatFloat(double value, T* out) {
+    long length = 0;
+    if(value < 0.0) {
+      out[length++] = (T)'-';
+      value *= -1.0;
+    }
+
+    long zeros = 0;
+    double remainder = value - floor(value);
+    if(remainder != 0.0) {
+      while(remainder < 0.099) {
+        value *= 10.0;
+        remainder = value - floor(value);
+        zeros++;
+      }
+    }
+
+    length += FormatInt((long)floor(value), out + length);
+    out[length++] = (T)'.';
+    for(long i = 0; i < zeros; i++) {
+      out[length++] = (T)'0';
+    }
+    length += FormatInt((long)(1001.0 * remainder), out + length);
+
+    return length;
+  }
+}
+
+#endif
@@ -0,0 +1,771 @@
+/***************************************************************************
+ * JSON stream scanner for Objeck
+ *
+ * Copyright (c) 2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#include <string.h>
+#include <locale.h>
+#include "../../../vm/lib_api.h"
+
+using namespace std;
+
+// must match the values of JSON.JSONEvent
+enum JsonEvent {
+  JSON_START_OBJECT = -300,
+  JSON_END_OBJECT,
+  JSON_START_ARRAY,
+  JSON_END_ARRAY,
+  JSON_FIELD_NAME,
+  JSON_STRING,
+  JSON_INT,
+  JSON_FLOAT,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL,
+  JSON_END,
+  JSON_ERROR
+};
+
+enum JsonExpect {
+  EXPECT_DOCUMENT = 0,
+  EXPECT_VALUE,
+  EXPECT_VALUE_OR_END,
+  EXPECT_KEY,
+  EXPECT_KEY_OR_END,
+  EXPECT_COLON,
+  EXPECT_COMMA_OR_END
+};
+
+// result of scanning a single token
+enum JsonToken {
+  TOKEN_OK = 0,
+  TOKEN_MORE,
+  TOKEN_BAD
+};
+
+/****************************
+ * Event buffers shared with
+ * the Objeck reader
+ ****************************/
+struct JsonEvents {
+  VMContext* context;
+  long* types;
+  long* ints;
+  long* floats;
+  long* strings;
+  long count;
+  long max;
+
+  inline bool IsFull() {
+    return count >= max;
+  }
+
+  inline void Add(JsonEvent type) {
+    APITools_SetIntArrayElement(types, count, type);
+    count++;
+  }
+
+  inline void AddInt(long value) {
+    APITools_SetIntArrayElement(types, count, JSON_INT);
+    APITools_SetIntArrayElement(ints, count, value);
+    count++;
+  }
+
+  inline void AddFloat(double value) {
+    APITools_SetIntArrayElement(types, count, JSON_FLOAT);
+    // doubles span two slots when longs are 32-bit
+    memcpy(floats + 3 + count * (sizeof(double) / sizeof(long)), &value, sizeof(value));
+    count++;
+  }
+
+  void AddString(JsonEvent type, const wstring &value) {
+    // create character array
+    const long char_array_size = value.size();
+    long* char_array = APITools_MakeCharArray(*context, char_array_size);
+    wchar_t* char_array_ptr = (wchar_t*)(char_array + 3);
+    memcpy(char_array_ptr, value.c_str(), char_array_size * sizeof(wchar_t));
+    char_array_ptr[char_array_size] = L'\0';
+
+    // create 'System.String' object instance
+    long* str_obj = context->alloc_obj(L"System.String", (long*)context->op_stack,
+                                       *context->stack_pos, false);
+    str_obj[0] = (long)char_array;
+    str_obj[1] = char_array_size;
+    str_obj[2] = char_array_size;
+
+    APITools_SetIntArrayElement(types, count, type);
+    APITools_SetIntArrayElement(strings, count, (long)str_obj);
+    count++;
+  }
+};
+
+/****************************
+ * Incremental scanner; keeps
+ * container state between
+ * buffer fills
+ ****************************/
+class JsonScanner {
+  vector<char> containers;
+  JsonExpect expect;
+  bool is_done;
+  wstring value;
+
+  inline static bool IsWhitespace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  inline static bool IsDigit(unsigned char c) {
+    return c >= '0' && c <= '9';
+  }
+
+  inline static int HexValue(unsigned char c) {
+    if(c >= '0' && c <= '9') {
+      return c - '0';
+    }
+
+    if(c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+    }
+
+    if(c >= 'A' && c <= 'F') {
+      return c - 'A' + 10;
+    }
+
+    return -1;
+  }
+
+  void EndValue() {
+    expect = containers.empty() ? EXPECT_DOCUMENT : EXPECT_COMMA_OR_END;
+  }
+
+  void Error(JsonEvents &events, const wstring &message) {
+    is_done = true;
+    events.AddString(JSON_ERROR, message);
+  }
+
+  // reads 4 hex digits at 'pos'
+  long ReadHex(const unsigned char* buffer, long pos) {
+    long code = 0;
+    for(long i = 0; i < 4; i++) {
+      const int digit = HexValue(buffer[pos + i]);
+      if(digit < 0) {
+        return -1;
+      }
+      code = (code << 4) | digit;
+    }
+
+    return code;
+  }
+
+  // scans and decodes a string, 'pos' is just past the opening quote
+  JsonToken ScanString(const unsigned char* buffer, long &pos, const long end) {
+    // find the closing quote before decoding anything
+    long close = pos;
+    bool is_plain = true;
+    while(close < end && buffer[close] != '"') {
+      if(buffer[close] == '\\') {
+        is_plain = false;
+        close++;
+      }
+      else if(buffer[close] < 0x20) {
+        return TOKEN_BAD;
+      }
+      close++;
+    }
+
+    if(close >= end) {
+      return TOKEN_MORE;
+    }
+
+    value.clear();
+    if(is_plain) {
+      // ASCII runs are copied directly
+      long i = pos;
+      while(i < close && buffer[i] < 0x80) {
+        value += (wchar_t)buffer[i++];
+      }
+
+      if(i < close) {
+        const string bytes((const char*)buffer + i, close - i);
+        value += BytesToUnicode(bytes);
+      }
+      pos = close + 1;
+
+      return TOKEN_OK;
+    }
+
+    string bytes;
+    long i = pos;
+    while(i < close) {
+      const unsigned char c = buffer[i];
+      if(c != '\\') {
+        bytes += c;
+        i++;
+        continue;
+      }
+
+      // escape sequence
+      if(!bytes.empty()) {
+        value += BytesToUnicode(bytes);
+        bytes.clear();
+      }
+
+      i++;
+      switch(buffer[i]) {
+      case '"':
+        value += L'"';
+        break;
+
+      case '\\':
+        value += L'\\';
+        break;
+
+      case '/':
+        value += L'/';
+        break;
+
+      case 'b':
+        value += L'\b';
+        break;
+
+      case 'f':
+        value += L'\f';
+        break;
+
+      case 'n':
+        value += L'\n';
+        break;
+
+      case 'r':
+        value += L'\r';
+        break;
+
+      case 't':
+        value += L'\t';
+        break;
+
+      case 'u': {
+        if(i + 4 >= close) {
+          return TOKEN_BAD;
+        }
+
+        long code = ReadHex(buffer, i + 1);
+        if(code < 0) {
+          return TOKEN_BAD;
+        }
+        i += 4;
+
+        // surrogate pair
+        if(code >= 0xd800 && code <= 0xdbff && i + 6 < close &&
+           buffer[i + 1] == '\\' && buffer[i + 2] == 'u') {
+          const long low = ReadHex(buffer, i + 3);
+          if(low >= 0xdc00 && low <= 0xdfff) {
+            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            i += 6;
+          }
+        }
+
+        if(sizeof(wchar_t) == 2 && code > 0xffff) {
+          code -= 0x10000;
+          value += (wchar_t)(0xd800 + (code >> 10));
+          value += (wchar_t)(0xdc00 + (code & 0x3ff));
+        }
+        else {
+          value += (wchar_t)code;
+        }
+      }
+        break;
+
+      default:
+        return TOKEN_BAD;
+      }
+      i++;
+    }
+
+    if(!bytes.empty()) {
+      value += BytesToUnicode(bytes);
+    }
+    pos = close + 1;
+
+    return TOKEN_OK;
+  }
+
+  JsonToken ScanNumber(const unsigned char* buffer, long &pos, const long end, const bool is_last,
+                       JsonEvents &events) {
+    long i = pos;
+    while(i < end && (IsDigit(buffer[i]) || buffer[i] == '-' || buffer[i] == '+' ||
+                      buffer[i] == '.' || buffer[i] == 'e' || buffer[i] == 'E')) {
+      i++;
+    }
+
+    if(i == end && !is_last) {
+      return TOKEN_MORE;
+    }
+
+    // validate: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    long j = pos;
+    if(buffer[j] == '-') {
+      j++;
+    }
+
+    const long int_start = j;
+    if(j < i && buffer[j] == '0') {
+      j++;
+    }
+    else {
+      while(j < i && IsDigit(buffer[j])) {
+        j++;
+      }
+    }
+    const long int_digits = j - int_start;
+    if(int_digits == 0) {
+      return TOKEN_BAD;
+    }
+
+    bool is_float = false;
+    if(j < i && buffer[j] == '.') {
+      is_float = true;
+      j++;
+      const long frac_start = j;
+      while(j < i && IsDigit(buffer[j])) {
+        j++;
+      }
+      if(j == frac_start) {
+        return TOKEN_BAD;
+      }
+    }
+
+    if(j < i && (buffer[j] == 'e' || buffer[j] == 'E')) {
+      is_float = true;
+      j++;
+      if(j < i && (buffer[j] == '+' || buffer[j] == '-')) {
+        j++;
+      }
+      const long exp_start = j;
+      while(j < i && IsDigit(buffer[j])) {
+        j++;
+      }
+      if(j == exp_start) {
+        return TOKEN_BAD;
+      }
+    }
+
+    if(j != i) {
+      return TOKEN_BAD;
+    }
+
+    // integers that fit are converted directly
+    if(!is_float && int_digits < 19) {
+      long number = 0;
+      for(long k = int_start; k < i; k++) {
+        number = number * 10 + (buffer[k] - '0');
+      }
+      events.AddInt(buffer[pos] == '-' ? -number : number);
+    }
+    else {
+      string digits((const char*)buffer + pos, i - pos);
+      const char decimal_point = localeconv()->decimal_point[0];
+      if(decimal_point != '.') {
+        const size_t dot = digits.find('.');
+        if(dot != string::npos) {
+          digits[dot] = decimal_point;
+        }
+      }
+      events.AddFloat(strtod(digits.c_str(), NULL));
+    }
+    pos = i;
+
+    return TOKEN_OK;
+  }
+
+  JsonToken ScanLiteral(const unsigned char* buffer, long &pos, const long end, const bool is_last,
+                        const char* literal, const long length) {
+    const long available = end - pos < length ? end - pos : length;
+    if(strncmp((const char*)buffer + pos, literal, available)) {
+      return TOKEN_BAD;
+    }
+
+    if(available < length) {
+      return is_last ? TOKEN_BAD : TOKEN_MORE;
+    }
+    pos += length;
+
+    return TOKEN_OK;
+  }
+
+  // scans a value; returns false if more input is needed
+  bool ScanValue(const unsigned char* buffer, long &pos, const long end, const bool is_last,
+                 JsonEvents &events) {
+    JsonToken result;
+    const unsigned char c = buffer[pos];
+    switch(c) {
+    case '{':
+      pos++;
+      containers.push_back('{');
+      expect = EXPECT_KEY_OR_END;
+      events.Add(JSON_START_OBJECT);
+      return true;
+
+    case '[':
+      pos++;
+      containers.push_back('[');
+      expect = EXPECT_VALUE_OR_END;
+      events.Add(JSON_START_ARRAY);
+      return true;
+
+    case '"': {
+      long next = pos + 1;
+      result = ScanString(buffer, next, end);
+      if(result == TOKEN_OK) {
+        pos = next;
+        events.AddString(JSON_STRING, value);
+      }
+    }
+      break;
+
+    case 't':
+      result = ScanLiteral(buffer, pos, end, is_last, "true", 4);
+      if(result == TOKEN_OK) {
+        events.Add(JSON_TRUE);
+      }
+      break;
+
+    case 'f':
+      result = ScanLiteral(buffer, pos, end, is_last, "false", 5);
+      if(result == TOKEN_OK) {
+        events.Add(JSON_FALSE);
+      }
+      break;
+
+    case 'n':
+      result = ScanLiteral(buffer, pos, end, is_last, "null", 4);
+      if(result == TOKEN_OK) {
+        events.Add(JSON_NULL);
+      }
+      break;
+
+    default:
+      if(c == '-' || IsDigit(c)) {
+        result = ScanNumber(buffer, pos, end, is_last, events);
+      }
+      else {
+        result = TOKEN_BAD;
+      }
+      break;
+    }
+
+    if(result == TOKEN_MORE) {
+      if(is_last) {
+        Error(events, L"unexpected end of input");
+      }
+      return false;
+    }
+
+    if(result == TOKEN_BAD) {
+      Error(events, L"invalid value");
+      return false;
+    }
+    EndValue();
+
+    return true;
+  }
+
+  bool EndContainer(char type, JsonEvents &events) {
+    if(containers.empty() || containers.back() != type) {
+      Error(events, L"mismatched closing bracket");
+      return false;
+    }
+
+    containers.pop_back();
+    events.Add(type == '{' ? JSON_END_OBJECT : JSON_END_ARRAY);
+    EndValue();
+
+    return true;
+  }
+
+ public:
+  JsonScanner() {
+    expect = EXPECT_DOCUMENT;
+    is_done = false;
+  }
+
+  // scans events from buffer[pos..end), 'pos' is updated to the first unconsumed byte
+  void Scan(const unsigned char* buffer, long &pos, const long end, const bool is_last,
+            JsonEvents &events) {
+    while(!is_done && !events.IsFull()) {
+      while(pos < end && IsWhitespace(buffer[pos])) {
+        pos++;
+      }
+
+      if(pos >= end) {
+        if(is_last) {
+          is_done = true;
+          if(expect == EXPECT_DOCUMENT) {
+            events.Add(JSON_END);
+          }
+          else {
+            events.AddString(JSON_ERROR, L"unexpected end of input");
+          }
+        }
+        return;
+      }
+
+      const unsigned char c = buffer[pos];
+      switch(expect) {
+      case EXPECT_DOCUMENT:
+      case EXPECT_VALUE:
+        if(!ScanValue(buffer, pos, end, is_last, events)) {
+          return;
+        }
+        break;
+
+      case EXPECT_VALUE_OR_END:
+        if(c == ']') {
+          pos++;
+          if(!EndContainer('[', events)) {
+            return;
+          }
+        }
+        else if(!ScanValue(buffer, pos, end, is_last, events)) {
+          return;
+        }
+        break;
+
+      case EXPECT_KEY_OR_END:
+      case EXPECT_KEY:
+        if(c == '}' && expect == EXPECT_KEY_OR_END) {
+          pos++;
+          if(!EndContainer('{', events)) {
+            return;
+          }
+        }
+        else if(c == '"') {
+          long next = pos + 1;
+          const JsonToken result = ScanString(buffer, next, end);
+          if(result == TOKEN_MORE) {
+            if(is_last) {
+              Error(events, L"unexpected end of input");
+            }
+            return;
+          }
+
+          if(result == TOKEN_BAD) {
+            Error(events, L"invalid field name");
+            return;
+          }
+          pos = next;
+          events.AddString(JSON_FIELD_NAME, value);
+          expect = EXPECT_COLON;
+        }
+        else {
+          Error(events, L"expected field name");
+          return;
+        }
+        break;
+
+      case EXPECT_COLON:
+        if(c != ':') {
+          Error(events, L"expected ':'");
+          return;
+        }
+        pos++;
+        expect = EXPECT_VALUE;
+        break;
+
+      case EXPECT_COMMA_OR_END:
+        if(c == ',') {
+          pos++;
+          expect = containers.back() == '{' ? EXPECT_KEY : EXPECT_VALUE;
+        }
+        else if(c == '}' || c == ']') {
+          pos++;
+          if(!EndContainer(c == '}' ? '{' : '[', events)) {
+            return;
+          }
+        }
+        else {
+          Error(events, L"expected ',' or closing bracket");
+          return;
+        }
+        break;
+      }
+    }
+  }
+};
+
+// scanners are referenced from Objeck by table index
+static vector<JsonScanner*> scanner_table;
+#ifdef _WIN32
+static CRITICAL_SECTION scanner_cs;
+#else
+static pthread_mutex_t scanner_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static JsonScanner* GetScanner(long handle) {
+  JsonScanner* scanner = NULL;
+#ifdef _WIN32
+  EnterCriticalSection(&scanner_cs);
+#else
+  pthread_mutex_lock(&scanner_mutex);
+#endif
+  if(handle > 0 && handle <= (long)scanner_table.size()) {
+    scanner = scanner_table[handle - 1];
+  }
+#ifdef _WIN32
+  LeaveCriticalSection(&scanner_cs);
+#else
+  pthread_mutex_unlock(&scanner_mutex);
+#endif
+
+  return scanner;
+}
+
+extern "C" {
+  //
+  // initialize library
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void load_lib() {
+#ifdef _WIN32
+    InitializeCriticalSection(&scanner_cs);
+#endif
+  }
+
+  //
+  // release library
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void unload_lib() {
+    for(size_t i = 0; i < scanner_table.size(); i++) {
+      JsonScanner* tmp = scanner_table[i];
+      if(tmp) {
+        delete tmp;
+        tmp = NULL;
+      }
+    }
+    scanner_table.clear();
+#ifdef _WIN32
+    DeleteCriticalSection(&scanner_cs);
+#endif
+  }
+
+  //
+  // creates a scanner
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void json_scanner_new(VMContext& context) {
+#ifdef _WIN32
+    EnterCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_lock(&scanner_mutex);
+#endif
+    // reuse released slots
+    long handle = 0;
+    for(size_t i = 0; !handle && i < scanner_table.size(); i++) {
+      if(!scanner_table[i]) {
+        scanner_table[i] = new JsonScanner;
+        handle = i + 1;
+      }
+    }
+
+    if(!handle) {
+      scanner_table.push_back(new JsonScanner);
+      handle = scanner_table.size();
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_unlock(&scanner_mutex);
+#endif
+
+    APITools_SetIntValue(context, 0, handle);
+  }
+
+  //
+  // releases a scanner
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void json_scanner_free(VMContext& context) {
+    const long handle = APITools_GetIntValue(context, 0);
+#ifdef _WIN32
+    EnterCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_lock(&scanner_mutex);
+#endif
+    if(handle > 0 && handle <= (long)scanner_table.size() && scanner_table[handle - 1]) {
+      delete scanner_table[handle - 1];
+      scanner_table[handle - 1] = NULL;
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_unlock(&scanner_mutex);
+#endif
+  }
+
+  //
+  // scans a batch of events from a byte buffer
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void json_scan(VMContext& context) {
+    JsonScanner* scanner = GetScanner(APITools_GetIntValue(context, 1));
+    long* buffer_array = (long*)APITools_GetIntAddress(context, 2)[0];
+    long* pos_holder = APITools_GetIntAddress(context, 3);
+    const long end = APITools_GetIntValue(context, 4);
+    const bool is_last = APITools_GetIntValue(context, 5) != 0;
+
+    JsonEvents events;
+    events.context = &context;
+    events.types = (long*)APITools_GetIntAddress(context, 6)[0];
+    events.ints = (long*)APITools_GetIntAddress(context, 7)[0];
+    events.floats = (long*)APITools_GetIntAddress(context, 8)[0];
+    events.strings = APITools_GetObjectValue(context, 9);
+    events.count = 0;
+    events.max = APITools_GetArraySize(events.types);
+
+    long pos = pos_holder[0];
+    if(scanner && buffer_array && pos > -1 && end <= APITools_GetArraySize(buffer_array)) {
+      const unsigned char* buffer = APITools_GetByteArray(buffer_array);
+      scanner->Scan(buffer, pos, end, is_last, events);
+    }
+    pos_holder[0] = pos;
+
+    APITools_SetIntValue(context, 0, events.count);
+  }
+}
@@ -33,6 +33,57 @@
 using namespace std;
 
 extern "C" {
+  //
+  // reads a value from a fetched block
+  //
+  static long GetBlockInt(ColumnBuffer &column, SQLULEN row) {
+    const char* cell = column.data + row * column.width;
+    switch(column.type) {
+    case SQL_C_SBIGINT:
+      return (long)*(SQLBIGINT*)cell;
+
+    case SQL_C_DOUBLE:
+      return (long)*(double*)cell;
+
+    default:
+      return strtol(cell, NULL, 10);
+    }
+  }
+
+  static double GetBlockDouble(ColumnBuffer &column, SQLULEN row) {
+    const char* cell = column.data + row * column.width;
+    switch(column.type) {
+    case SQL_C_SBIGINT:
+      return (double)*(SQLBIGINT*)cell;
+
+    case SQL_C_DOUBLE:
+      return *(double*)cell;
+
+    default:
+      return strtod(cell, NULL);
+    }
+  }
+
+  static wstring GetBlockString(ColumnBuffer &column, SQLULEN row) {
+    const char* cell = column.data + row * column.width;
+    switch(column.type) {
+    case SQL_C_SBIGINT: {
+      wostringstream out;
+      out << (long)*(SQLBIGINT*)cell;
+      return out.str();
+    }
+
+    case SQL_C_DOUBLE: {
+      wostringstream out;
+      out << *(double*)cell;
+      return out.str();
+    }
+
+    default:
+      return BytesToUnicode(cell);
+    }
+  }
+
   //
   // initialize odbc environment
   //
@@ -331,6 +382,218 @@ extern "C" {
       APITools_SetIntValue(context, 0, 0);
   }
 
+  //
+  // binds column buffers for block fetches
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_result_bind_block(VMContext& context) {
+      SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 1);
+      const long max_rows = APITools_GetIntValue(context, 2);
+
+#ifdef _DEBUG
+      wcout << L"### bind_block: stmt=" << stmt << L", rows=" << max_rows << L" ###" << endl;
+#endif
+
+      if(!stmt || max_rows < 1) {
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      SQLSMALLINT columns;
+      SQLRETURN status = SQLNumResultCols(stmt, &columns);
+      if((SQL_FAIL) || columns < 1) {
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      RowBlock* block = new RowBlock;
+      block->max_rows = max_rows;
+      block->num_rows = 0;
+      block->num_columns = 0;
+      block->columns = new ColumnBuffer[columns];
+
+      status = SQLSetStmtAttr(stmt, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+      if(SQL_OK) {
+        status = SQLSetStmtAttr(stmt, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)max_rows, 0);
+      }
+      if(SQL_OK) {
+        status = SQLSetStmtAttr(stmt, SQL_ATTR_ROWS_FETCHED_PTR, &block->num_rows, 0);
+      }
+
+      for(SQLSMALLINT i = 1; i <= columns; i++) {
+        if(SQL_FAIL) {
+          break;
+        }
+
+        ColumnDescription description;
+        status = SQLDescribeCol(stmt, i, (SQLCHAR*)&description.column_name, COL_NAME_MAX, 
+          &description.column_name_size, &description.type, 
+          &description.column_size, &description.decimal_length, 
+          &description.nullable);
+        if(SQL_OK) {
+          // integer and floating point columns are fetched in binary form
+          ColumnBuffer &column = block->columns[block->num_columns++];
+          switch(description.type) {
+          case SQL_BIT:
+          case SQL_TINYINT:
+          case SQL_SMALLINT:
+          case SQL_INTEGER:
+          case SQL_BIGINT:
+            column.type = SQL_C_SBIGINT;
+            column.width = sizeof(SQLBIGINT);
+            break;
+
+          case SQL_REAL:
+          case SQL_FLOAT:
+          case SQL_DOUBLE:
+            column.type = SQL_C_DOUBLE;
+            column.width = sizeof(double);
+            break;
+
+          default:
+            column.type = SQL_C_CHAR;
+            column.width = description.column_size > 0 && description.column_size < VARCHAR_MAX ? 
+              description.column_size + 1 : VARCHAR_MAX;
+            break;
+          }
+          column.data = new char[column.width * max_rows];
+          column.lengths = new SQLLEN[max_rows];
+
+          status = SQLBindCol(stmt, i, column.type, column.data, column.width, column.lengths);
+        }
+      }
+
+      if(SQL_FAIL) {
+        ShowError(SQL_HANDLE_STMT, stmt);
+        FreeRowBlock(stmt, block);
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      APITools_SetIntValue(context, 0, (long)block);
+  }
+
+  //
+  // fetches the next block of rows in a resultset
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_result_fetch_block(VMContext& context) {
+      SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 1);
+      RowBlock* block = (RowBlock*)APITools_GetIntValue(context, 2);
+      if(!stmt || !block) {
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      block->num_rows = 0;
+      SQLRETURN status = SQLFetch(stmt);
+      if(SQL_OK) {
+#ifdef _DEBUG
+        wcout << L"### fetch_block: stmt=" << stmt << L", rows=" << block->num_rows << L" ###" << endl;
+#endif
+        APITools_SetIntValue(context, 0, block->num_rows);
+        return;
+      }
+
+      block->num_rows = 0;
+      APITools_SetIntValue(context, 0, 0);
+  }
+
+  //
+  // gets an int column from a fetched block
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_result_get_int_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 0);
+      const long i = APITools_GetIntValue(context, 1);
+      RowBlock* block = (RowBlock*)APITools_GetIntValue(context, 2);
+      if(!holder || !block || i < 1 || i > block->num_columns) {
+        return;
+      }
+
+      ColumnBuffer &column = block->columns[i - 1];
+      long* array = APITools_MakeIntArray(context, block->num_rows);
+      long* values = array + 3;
+      for(SQLULEN j = 0; j < block->num_rows; j++) {
+        values[j] = column.lengths[j] == SQL_NULL_DATA ? 0 : GetBlockInt(column, j);
+      }
+      holder[0] = (long)array;
+  }
+
+  //
+  // gets a double column from a fetched block
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_result_get_double_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 0);
+      const long i = APITools_GetIntValue(context, 1);
+      RowBlock* block = (RowBlock*)APITools_GetIntValue(context, 2);
+      if(!holder || !block || i < 1 || i > block->num_columns) {
+        return;
+      }
+
+      ColumnBuffer &column = block->columns[i - 1];
+      long* array = APITools_MakeFloatArray(context, block->num_rows);
+      for(SQLULEN j = 0; j < block->num_rows; j++) {
+        APITools_SetFloatArrayElement(array, j, column.lengths[j] == SQL_NULL_DATA ? 0.0 : GetBlockDouble(column, j));
+      }
+      holder[0] = (long)array;
+  }
+
+  //
+  // gets a string column from a fetched block
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_result_get_varchar_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 0);
+      const long i = APITools_GetIntValue(context, 1);
+      RowBlock* block = (RowBlock*)APITools_GetIntValue(context, 2);
+      if(!holder || !block || i < 1 || i > block->num_columns) {
+        return;
+      }
+
+      ColumnBuffer &column = block->columns[i - 1];
+      long* array = APITools_MakeIntArray(context, block->num_rows);
+      long* values = array + 3;
+      for(SQLULEN j = 0; j < block->num_rows; j++) {
+        values[j] = column.lengths[j] == SQL_NULL_DATA ? 0 : (long)APITools_MakeStringObject(context, GetBlockString(column, j));
+      }
+      holder[0] = (long)array;
+  }
+
+  //
+  // gets null flags for a column of a fetched block
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_result_get_null_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 0);
+      const long i = APITools_GetIntValue(context, 1);
+      RowBlock* block = (RowBlock*)APITools_GetIntValue(context, 2);
+      if(!holder || !block || i < 1 || i > block->num_columns) {
+        return;
+      }
+
+      ColumnBuffer &column = block->columns[i - 1];
+      long* array = APITools_MakeIntArray(context, block->num_rows);
+      long* values = array + 3;
+      for(SQLULEN j = 0; j < block->num_rows; j++) {
+        values[j] = column.lengths[j] == SQL_NULL_DATA;
+      }
+      holder[0] = (long)array;
+  }
+
   //
   // updates a prepared statement
   //
@@ -781,6 +1044,170 @@ extern "C" {
       APITools_SetIntValue(context, 0, 0);
   }
 
+  //
+  // binds an int column for a batch update, values are read in place
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_stmt_set_int_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 1);
+      long i = APITools_GetIntValue(context, 2);
+      SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 3);
+      long* array = holder ? (long*)holder[0] : NULL;
+
+#ifdef _DEBUG
+      wcout << L"### set_int_column: stmt=" << stmt << L", column=" << i << L" ###" << endl;
+#endif
+
+      if(!stmt || !array) {
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      SQLRETURN status = SQLBindParameter(stmt, i, SQL_PARAM_INPUT, SQL_C_SBIGINT, 
+        SQL_BIGINT, 0, 0, array + 3, sizeof(long), NULL);
+      if(SQL_OK) { 
+        APITools_SetIntValue(context, 0, 1);
+        return;
+      }
+
+      APITools_SetIntValue(context, 0, 0);
+  }
+
+  //
+  // binds a double column for a batch update, values are read in place
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_stmt_set_double_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 1);
+      long i = APITools_GetIntValue(context, 2);
+      SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 3);
+      long* array = holder ? (long*)holder[0] : NULL;
+
+#ifdef _DEBUG
+      wcout << L"### set_double_column: stmt=" << stmt << L", column=" << i << L" ###" << endl;
+#endif
+
+      if(!stmt || !array) {
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      SQLRETURN status = SQLBindParameter(stmt, i, SQL_PARAM_INPUT, SQL_C_DOUBLE, 
+        SQL_DOUBLE, 0, 0, array + 3, sizeof(double), NULL);
+      if(SQL_OK) { 
+        APITools_SetIntValue(context, 0, 1);
+        return;
+      }
+
+      APITools_SetIntValue(context, 0, 0);
+  }
+
+  //
+  // binds a string column for a batch update; strings are encoded into
+  // a byte buffer that's returned so it lives as long as the statement
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_stmt_set_varchar_column(VMContext& context) {
+      long* holder = APITools_GetObjectValue(context, 1);
+      long i = APITools_GetIntValue(context, 2);
+      SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 3);
+      long* buffer_holder = APITools_GetObjectValue(context, 4);
+      long* lengths_holder = APITools_GetObjectValue(context, 5);
+      long* array = holder ? (long*)holder[0] : NULL;
+
+#ifdef _DEBUG
+      wcout << L"### set_varchar_column: stmt=" << stmt << L", column=" << i << L" ###" << endl;
+#endif
+
+      if(!stmt || !array || !buffer_holder || !lengths_holder) {
+        APITools_SetIntValue(context, 0, 0);
+        return;
+      }
+
+      // encode strings
+      const long rows = array[2];
+      long** strings = (long**)(array + 3);
+      vector<string> values;
+      SQLLEN width = 2;
+      for(long j = 0; j < rows; j++) {
+        if(strings[j]) {
+          const wstring wvalue((wchar_t*)(((long*)strings[j][0]) + 3), strings[j][2]);
+          values.push_back(UnicodeToBytes(wvalue));
+          if((SQLLEN)values.back().size() >= width) {
+            width = values.back().size() + 1;
+          }
+        }
+        else {
+          values.push_back("");
+        }
+      }
+
+      // copy into column-wise buffers
+      long* byte_array = APITools_MakeByteArray(context, rows * width);
+      long* lengths_array = APITools_MakeIntArray(context, rows);
+      char* data = (char*)(byte_array + 3);
+      SQLLEN* lengths = (SQLLEN*)(lengths_array + 3);
+      for(long j = 0; j < rows; j++) {
+        memcpy(data + j * width, values[j].c_str(), values[j].size() + 1);
+        lengths[j] = strings[j] ? (SQLLEN)values[j].size() : SQL_NULL_DATA;
+      }
+      buffer_holder[0] = (long)byte_array;
+      lengths_holder[0] = (long)lengths_array;
+
+      SQLRETURN status = SQLBindParameter(stmt, i, SQL_PARAM_INPUT, SQL_C_CHAR, 
+        SQL_VARCHAR, width - 1, 0, data, width, lengths);
+      if(SQL_OK) { 
+        APITools_SetIntValue(context, 0, 1);
+        return;
+      }
+
+      APITools_SetIntValue(context, 0, 0);
+  }
+
+  //
+  // executes a prepared statement once for each row of the bound columns
+  //
+#ifdef _WIN32
+  __declspec(dllexport) 
+#endif
+    void odbc_stmt_update_batch(VMContext& context) {
+      SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 1);
+      const long rows = APITools_GetIntValue(context, 2);
+
+#ifdef _DEBUG
+      wcout << L"### stmt_update_batch: stmt=" << stmt << L", rows=" << rows << L" ###" << endl;
+#endif
+
+      if(!stmt || rows < 1) {
+        APITools_SetIntValue(context, 0, -1);
+        return;
+      }
+
+      SQLLEN count = -1;
+      SQLRETURN status = SQLSetStmtAttr(stmt, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)rows, 0);
+      if(SQL_OK) {
+        status = SQLExecute(stmt);
+        if(SQL_OK) {
+          status = SQLRowCount(stmt, &count);
+          if(SQL_FAIL) {
+            count = -1;
+          }
+        }
+        else {
+          ShowError(SQL_HANDLE_STMT, stmt);
+        }
+        SQLSetStmtAttr(stmt, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, 0);
+      }
+
+      APITools_SetIntValue(context, 0, count);
+  }
+
   //
   // gets a string from a result set
   //
@@ -983,6 +1410,15 @@ extern "C" {
 #endif
     void odbc_result_close(VMContext& context) {
       SQLHSTMT stmt = (SQLHDBC)APITools_GetIntValue(context, 0);
+
+      // block fetch buffers
+      if(APITools_GetArgumentCount(context) > 2) {
+        RowBlock* block = (RowBlock*)APITools_GetIntValue(context, 2);
+        if(block) {
+          FreeRowBlock(stmt, block);
+        }
+      }
+      
       if(stmt) {
         SQLFreeStmt(stmt, SQL_CLOSE);
       }
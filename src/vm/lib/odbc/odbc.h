@@ -56,6 +56,36 @@ extern "C" {
     SQLSMALLINT nullable;
   } ColumnDescription;
 
+  // column-wise buffers for block fetches
+  typedef struct _ColumnBuffer {
+    SQLSMALLINT type;
+    SQLLEN width;
+    char* data;
+    SQLLEN* lengths;
+  } ColumnBuffer;
+
+  typedef struct _RowBlock {
+    SQLULEN max_rows;
+    SQLULEN num_rows;
+    SQLSMALLINT num_columns;
+    ColumnBuffer* columns;
+  } RowBlock;
+
+  void FreeRowBlock(SQLHSTMT stmt, RowBlock* block) {
+    if(stmt) {
+      SQLFreeStmt(stmt, SQL_UNBIND);
+      SQLSetStmtAttr(stmt, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)1, 0);
+      SQLSetStmtAttr(stmt, SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0);
+    }
+
+    for(SQLSMALLINT i = 0; i < block->num_columns; i++) {
+      delete[] block->columns[i].data;
+      delete[] block->columns[i].lengths;
+    }
+    delete[] block->columns;
+    delete block;
+  }
+
   void ShowError(SQLSMALLINT type, SQLHSTMT hstmt) {
     SQLCHAR SqlState[6];
     SQLCHAR SQLStmt[100];
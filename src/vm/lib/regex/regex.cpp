@@ -0,0 +1,1193 @@
+/***************************************************************************
+ * Regular expression support for Objeck
+ *
+ * Copyright (c) 2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#include <string.h>
+#include <wctype.h>
+#include "../../../vm/lib_api.h"
+
+using namespace std;
+
+// limits that keep compiled programs and DFA caches bounded
+#define MAX_REGEX_REPEAT 1000
+#define MAX_REGEX_PROGRAM 65536
+#define MAX_DFA_STATES 4096
+#define DFA_ASCII_SIZE 128
+
+namespace regex {
+  /****************************
+   * Parse tree
+   ****************************/
+  enum NodeType {
+    NODE_EMPTY = 0,
+    NODE_CHAR,
+    NODE_ANY,
+    NODE_CLASS,
+    NODE_BOL,
+    NODE_EOL,
+    NODE_CAT,
+    NODE_ALT,
+    NODE_REPEAT
+  };
+
+  struct Node {
+    NodeType type;
+    wchar_t value;
+    int char_class;
+    int least;
+    int most;
+    vector<Node*> children;
+  };
+
+  // character class flags for \d, \w, \s and their negations
+  enum ClassFlags {
+    CLASS_DIGIT = 1,
+    CLASS_WORD = 2,
+    CLASS_SPACE = 4,
+    CLASS_NOT_DIGIT = 8,
+    CLASS_NOT_WORD = 16,
+    CLASS_NOT_SPACE = 32
+  };
+
+  struct CharClass {
+    vector<pair<wchar_t, wchar_t> > ranges;
+    int flags;
+    bool negate;
+
+    CharClass() {
+      flags = 0;
+      negate = false;
+    }
+
+    inline static bool IsDigit(wchar_t c) {
+      return c >= L'0' && c <= L'9';
+    }
+
+    inline static bool IsWord(wchar_t c) {
+      return iswalnum(c) || c == L'_';
+    }
+
+    inline static bool IsSpace(wchar_t c) {
+      return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n';
+    }
+
+    bool Matches(wchar_t c) const {
+      bool found = false;
+      for(size_t i = 0; !found && i < ranges.size(); i++) {
+        found = c >= ranges[i].first && c <= ranges[i].second;
+      }
+
+      if(!found && flags) {
+        found = ((flags & CLASS_DIGIT) && IsDigit(c)) ||
+          ((flags & CLASS_WORD) && IsWord(c)) ||
+          ((flags & CLASS_SPACE) && IsSpace(c)) ||
+          ((flags & CLASS_NOT_DIGIT) && !IsDigit(c)) ||
+          ((flags & CLASS_NOT_WORD) && !IsWord(c)) ||
+          ((flags & CLASS_NOT_SPACE) && !IsSpace(c));
+      }
+
+      return negate ? !found : found;
+    }
+  };
+
+  /****************************
+   * Pattern parser
+   ****************************/
+  class Parser {
+    const wstring pattern;
+    size_t pos;
+    vector<Node*> nodes;
+    vector<CharClass>& classes;
+    wstring error;
+
+    Node* MakeNode(NodeType type) {
+      Node* node = new Node;
+      node->type = type;
+      node->value = L'\0';
+      node->char_class = -1;
+      node->least = node->most = 0;
+      nodes.push_back(node);
+
+      return node;
+    }
+
+    inline bool IsEnd() {
+      return pos >= pattern.size();
+    }
+
+    inline wchar_t Peek() {
+      return IsEnd() ? L'\0' : pattern[pos];
+    }
+
+    int MakeClass(int flags) {
+      CharClass char_class;
+      char_class.flags = flags;
+      classes.push_back(char_class);
+      return (int)classes.size() - 1;
+    }
+
+    // maps an escaped character to a literal, -1 if not a literal escape
+    int EscapeLiteral(wchar_t c) {
+      switch(c) {
+      case L'n':
+        return L'\n';
+
+      case L'r':
+        return L'\r';
+
+      case L't':
+        return L'\t';
+
+      case L'b':
+        return L'\b';
+
+      case L'd':
+      case L'w':
+      case L's':
+      case L'D':
+      case L'W':
+      case L'S':
+        return -1;
+
+      default:
+        return c;
+      }
+    }
+
+    int EscapeFlags(wchar_t c) {
+      switch(c) {
+      case L'd':
+        return CLASS_DIGIT;
+
+      case L'w':
+        return CLASS_WORD;
+
+      case L's':
+        return CLASS_SPACE;
+
+      case L'D':
+        return CLASS_NOT_DIGIT;
+
+      case L'W':
+        return CLASS_NOT_WORD;
+
+      case L'S':
+        return CLASS_NOT_SPACE;
+      }
+
+      return 0;
+    }
+
+    bool ParseNumber(int &value) {
+      if(!CharClass::IsDigit(Peek())) {
+        error = L"invalid number";
+        return false;
+      }
+
+      value = 0;
+      while(CharClass::IsDigit(Peek())) {
+        value = value * 10 + (Peek() - L'0');
+        if(value > MAX_REGEX_REPEAT) {
+          error = L"repeat count too large";
+          return false;
+        }
+        pos++;
+      }
+
+      return true;
+    }
+
+    Node* ParseClass() {
+      // skip '['
+      pos++;
+
+      CharClass char_class;
+      if(Peek() == L'^') {
+        char_class.negate = true;
+        pos++;
+      }
+
+      bool is_empty = true;
+      while(!IsEnd() && Peek() != L']') {
+        wchar_t start = pattern[pos++];
+        if(start == L'\\') {
+          if(IsEnd()) {
+            error = L"invalid escape";
+            return NULL;
+          }
+
+          const wchar_t escape = pattern[pos++];
+          const int literal = EscapeLiteral(escape);
+          if(literal < 0) {
+            char_class.flags |= EscapeFlags(escape);
+            is_empty = false;
+            continue;
+          }
+          start = (wchar_t)literal;
+        }
+
+        wchar_t end = start;
+        if(Peek() == L'-' && pos + 1 < pattern.size() && pattern[pos + 1] != L']') {
+          pos++;
+          end = pattern[pos++];
+          if(end == L'\\') {
+            const int literal = IsEnd() ? -1 : EscapeLiteral(pattern[pos++]);
+            if(literal < 0) {
+              error = L"invalid character class";
+              return NULL;
+            }
+            end = (wchar_t)literal;
+          }
+
+          if(end < start) {
+            error = L"invalid character class";
+            return NULL;
+          }
+        }
+
+        char_class.ranges.push_back(pair<wchar_t, wchar_t>(start, end));
+        is_empty = false;
+      }
+
+      if(Peek() != L']') {
+        error = L"expected ']'";
+        return NULL;
+      }
+      pos++;
+
+      if(is_empty) {
+        error = L"invalid character class";
+        return NULL;
+      }
+
+      classes.push_back(char_class);
+      Node* node = MakeNode(NODE_CLASS);
+      node->char_class = (int)classes.size() - 1;
+
+      return node;
+    }
+
+    Node* ParseAtom() {
+      const wchar_t c = Peek();
+      switch(c) {
+      case L'(': {
+        pos++;
+        Node* node = ParseAlternate();
+        if(!node) {
+          return NULL;
+        }
+
+        if(Peek() != L')') {
+          error = L"expected ')'";
+          return NULL;
+        }
+        pos++;
+
+        return node;
+      }
+
+      case L'[':
+        return ParseClass();
+
+      case L'.':
+        pos++;
+        return MakeNode(NODE_ANY);
+
+      case L'^':
+        pos++;
+        return MakeNode(NODE_BOL);
+
+      case L'$':
+        pos++;
+        return MakeNode(NODE_EOL);
+
+      case L'*':
+      case L'+':
+      case L'?':
+      case L'{':
+        error = L"missing left-hand side operand";
+        return NULL;
+
+      case L'\\': {
+        pos++;
+        if(IsEnd()) {
+          error = L"invalid escape";
+          return NULL;
+        }
+
+        const wchar_t escape = pattern[pos++];
+        const int literal = EscapeLiteral(escape);
+        if(literal < 0) {
+          Node* node = MakeNode(NODE_CLASS);
+          node->char_class = MakeClass(EscapeFlags(escape));
+          return node;
+        }
+
+        Node* node = MakeNode(NODE_CHAR);
+        node->value = (wchar_t)literal;
+        return node;
+      }
+
+      default: {
+        pos++;
+        Node* node = MakeNode(NODE_CHAR);
+        node->value = c;
+        return node;
+      }
+      }
+    }
+
+    Node* ParseRepeat() {
+      Node* node = ParseAtom();
+      if(!node) {
+        return NULL;
+      }
+
+      while(!IsEnd()) {
+        int least, most;
+        const wchar_t c = Peek();
+        if(c == L'*') {
+          least = 0; most = -1;
+          pos++;
+        }
+        else if(c == L'+') {
+          least = 1; most = -1;
+          pos++;
+        }
+        else if(c == L'?') {
+          least = 0; most = 1;
+          pos++;
+        }
+        else if(c == L'{') {
+          pos++;
+          if(!ParseNumber(least)) {
+            return NULL;
+          }
+
+          most = least;
+          if(Peek() == L',') {
+            pos++;
+            if(Peek() == L'}') {
+              most = -1;
+            }
+            else if(!ParseNumber(most)) {
+              return NULL;
+            }
+          }
+
+          if(Peek() != L'}') {
+            error = L"expected '}'";
+            return NULL;
+          }
+          pos++;
+
+          if(most > -1 && most < least) {
+            error = L"invalid repeat range";
+            return NULL;
+          }
+        }
+        else {
+          break;
+        }
+
+        Node* repeat = MakeNode(NODE_REPEAT);
+        repeat->least = least;
+        repeat->most = most;
+        repeat->children.push_back(node);
+        node = repeat;
+      }
+
+      return node;
+    }
+
+    Node* ParseConcat() {
+      Node* node = MakeNode(NODE_CAT);
+      while(!IsEnd() && Peek() != L'|' && Peek() != L')') {
+        Node* child = ParseRepeat();
+        if(!child) {
+          return NULL;
+        }
+        node->children.push_back(child);
+      }
+
+      return node;
+    }
+
+    Node* ParseAlternate() {
+      Node* node = ParseConcat();
+      if(!node) {
+        return NULL;
+      }
+
+      while(Peek() == L'|') {
+        pos++;
+        Node* right = ParseConcat();
+        if(!right) {
+          return NULL;
+        }
+
+        Node* alternate = MakeNode(NODE_ALT);
+        alternate->children.push_back(node);
+        alternate->children.push_back(right);
+        node = alternate;
+      }
+
+      return node;
+    }
+
+  public:
+    Parser(const wstring &p, vector<CharClass> &c) : pattern(p), classes(c) {
+      pos = 0;
+    }
+
+    ~Parser() {
+      while(!nodes.empty()) {
+        Node* tmp = nodes.back();
+        nodes.pop_back();
+        delete tmp;
+        tmp = NULL;
+      }
+    }
+
+    Node* Parse() {
+      Node* root = ParseAlternate();
+      if(root && !IsEnd()) {
+        error = L"stray token";
+        return NULL;
+      }
+
+      return root;
+    }
+
+    const wstring& GetError() {
+      return error;
+    }
+  };
+
+  /****************************
+   * NFA program
+   ****************************/
+  enum OpCode {
+    OP_CHAR = 0,
+    OP_ANY,
+    OP_CLASS,
+    OP_SPLIT,
+    OP_JMP,
+    OP_BOL,
+    OP_EOL,
+    OP_MATCH
+  };
+
+  struct Instruction {
+    OpCode op;
+    wchar_t value;
+    int x;
+    int y;
+  };
+
+  class Program {
+    bool is_reverse;
+
+    int Add(OpCode op) {
+      Instruction instr;
+      instr.op = op;
+      instr.value = L'\0';
+      instr.x = instr.y = -1;
+      instrs.push_back(instr);
+
+      return (int)instrs.size() - 1;
+    }
+
+    bool Emit(Node* node) {
+      if(instrs.size() > MAX_REGEX_PROGRAM) {
+        return false;
+      }
+
+      switch(node->type) {
+      case NODE_EMPTY:
+        break;
+
+      case NODE_CHAR:
+        instrs[Add(OP_CHAR)].value = node->value;
+        break;
+
+      case NODE_ANY:
+        Add(OP_ANY);
+        break;
+
+      case NODE_CLASS:
+        instrs[Add(OP_CLASS)].x = node->char_class;
+        break;
+
+      // anchors trade places when matching backwards
+      case NODE_BOL:
+        Add(is_reverse ? OP_EOL : OP_BOL);
+        break;
+
+      case NODE_EOL:
+        Add(is_reverse ? OP_BOL : OP_EOL);
+        break;
+
+      case NODE_CAT:
+        if(is_reverse) {
+          for(int i = (int)node->children.size() - 1; i > -1; i--) {
+            if(!Emit(node->children[i])) {
+              return false;
+            }
+          }
+        }
+        else {
+          for(size_t i = 0; i < node->children.size(); i++) {
+            if(!Emit(node->children[i])) {
+              return false;
+            }
+          }
+        }
+        break;
+
+      case NODE_ALT: {
+        const int split = Add(OP_SPLIT);
+        instrs[split].x = (int)instrs.size();
+        if(!Emit(node->children[0])) {
+          return false;
+        }
+        const int jump = Add(OP_JMP);
+        instrs[split].y = (int)instrs.size();
+        if(!Emit(node->children[1])) {
+          return false;
+        }
+        instrs[jump].x = (int)instrs.size();
+      }
+        break;
+
+      case NODE_REPEAT: {
+        Node* child = node->children[0];
+        for(int i = 0; i < node->least; i++) {
+          if(!Emit(child)) {
+            return false;
+          }
+        }
+
+        if(node->most < 0) {
+          const int loop = Add(OP_SPLIT);
+          instrs[loop].x = (int)instrs.size();
+          if(!Emit(child)) {
+            return false;
+          }
+          instrs[Add(OP_JMP)].x = loop;
+          instrs[loop].y = (int)instrs.size();
+        }
+        else {
+          vector<int> splits;
+          for(int i = node->least; i < node->most; i++) {
+            const int split = Add(OP_SPLIT);
+            instrs[split].x = (int)instrs.size();
+            splits.push_back(split);
+            if(!Emit(child)) {
+              return false;
+            }
+          }
+
+          for(size_t i = 0; i < splits.size(); i++) {
+            instrs[splits[i]].y = (int)instrs.size();
+          }
+        }
+      }
+        break;
+      }
+
+      return true;
+    }
+
+  public:
+    vector<Instruction> instrs;
+    const vector<CharClass>* classes;
+
+    Program(bool r, const vector<CharClass>* c) {
+      is_reverse = r;
+      classes = c;
+    }
+
+    bool Compile(Node* root) {
+      if(!Emit(root) || instrs.size() > MAX_REGEX_PROGRAM) {
+        return false;
+      }
+      Add(OP_MATCH);
+
+      return true;
+    }
+
+    inline bool Consumes(int pc, wchar_t c) const {
+      const Instruction &instr = instrs[pc];
+      switch(instr.op) {
+      case OP_CHAR:
+        return instr.value == c;
+
+      case OP_ANY:
+        return true;
+
+      case OP_CLASS:
+        return (*classes)[instr.x].Matches(c);
+
+      default:
+        return false;
+      }
+    }
+  };
+
+  /****************************
+   * Lazily built DFA; states are
+   * sets of NFA instructions that
+   * are created on first use
+   ****************************/
+  struct DState {
+    vector<int> instrs;
+    bool is_match;
+    bool is_match_at_end;
+    bool is_dead;
+    DState* next[DFA_ASCII_SIZE];
+    map<wchar_t, DState*> wide_next;
+  };
+
+  class Dfa {
+    const Program* program;
+    // unanchored scans restart the program at every position
+    bool is_unanchored;
+    map<vector<int>, DState*> states;
+    DState* starts[2];
+    vector<int> marks;
+    int mark_id;
+    vector<int> work;
+
+    void AddInstruction(vector<int> &set, int pc, bool is_edge) {
+      work.clear();
+      work.push_back(pc);
+      while(!work.empty()) {
+        const int cur = work.back();
+        work.pop_back();
+        if(marks[cur] == mark_id) {
+          continue;
+        }
+        marks[cur] = mark_id;
+
+        const Instruction &instr = program->instrs[cur];
+        switch(instr.op) {
+        case OP_JMP:
+          work.push_back(instr.x);
+          break;
+
+        case OP_SPLIT:
+          work.push_back(instr.y);
+          work.push_back(instr.x);
+          break;
+
+        case OP_BOL:
+          if(is_edge) {
+            work.push_back(cur + 1);
+          }
+          break;
+
+        default:
+          set.push_back(cur);
+          break;
+        }
+      }
+    }
+
+    inline void NextMark() {
+      if(++mark_id == 0) {
+        fill(marks.begin(), marks.end(), 0);
+        mark_id = 1;
+      }
+    }
+
+    DState* Intern(vector<int> &set) {
+      sort(set.begin(), set.end());
+      map<vector<int>, DState*>::iterator result = states.find(set);
+      if(result != states.end()) {
+        return result->second;
+      }
+
+      DState* state = new DState;
+      state->instrs = set;
+      state->is_match = state->is_match_at_end = false;
+      state->is_dead = set.empty();
+      memset(state->next, 0, sizeof(state->next));
+
+      // matches that only hold at the end of the scan
+      vector<int> end_set;
+      NextMark();
+      for(size_t i = 0; i < set.size(); i++) {
+        const Instruction &instr = program->instrs[set[i]];
+        if(instr.op == OP_MATCH) {
+          state->is_match = true;
+        }
+        else if(instr.op == OP_EOL) {
+          AddInstruction(end_set, set[i] + 1, false);
+        }
+      }
+      for(size_t i = 0; !state->is_match_at_end && i < end_set.size(); i++) {
+        state->is_match_at_end = program->instrs[end_set[i]].op == OP_MATCH;
+      }
+      state->is_match_at_end = state->is_match_at_end || state->is_match;
+
+      states.insert(pair<vector<int>, DState*>(state->instrs, state));
+      return state;
+    }
+
+    DState* Transition(DState* state, wchar_t c) {
+      vector<int> set;
+      NextMark();
+      for(size_t i = 0; i < state->instrs.size(); i++) {
+        const int pc = state->instrs[i];
+        if(program->Consumes(pc, c)) {
+          AddInstruction(set, pc + 1, false);
+        }
+      }
+
+      if(is_unanchored) {
+        AddInstruction(set, 0, false);
+      }
+
+      return Intern(set);
+    }
+
+  public:
+    Dfa(const Program* p, bool u) {
+      program = p;
+      is_unanchored = u;
+      marks.resize(program->instrs.size(), 0);
+      mark_id = 0;
+      starts[0] = starts[1] = NULL;
+    }
+
+    ~Dfa() {
+      Clear();
+    }
+
+    void Clear() {
+      map<vector<int>, DState*>::iterator iter;
+      for(iter = states.begin(); iter != states.end(); ++iter) {
+        DState* tmp = iter->second;
+        delete tmp;
+        tmp = NULL;
+      }
+      states.clear();
+      starts[0] = starts[1] = NULL;
+    }
+
+    DState* Start(bool is_edge) {
+      if(states.size() > MAX_DFA_STATES) {
+        Clear();
+      }
+
+      const int index = is_edge ? 1 : 0;
+      if(!starts[index]) {
+        vector<int> set;
+        NextMark();
+        AddInstruction(set, 0, is_edge);
+        starts[index] = Intern(set);
+      }
+
+      return starts[index];
+    }
+
+    inline DState* Next(DState* state, wchar_t c) {
+      // flush a full cache, keeping the current state
+      if(states.size() > MAX_DFA_STATES) {
+        vector<int> set = state->instrs;
+        Clear();
+        state = Intern(set);
+      }
+
+      if(c > -1 && c < DFA_ASCII_SIZE) {
+        DState* next = state->next[c];
+        if(!next) {
+          next = state->next[c] = Transition(state, c);
+        }
+        return next;
+      }
+
+      map<wchar_t, DState*>::iterator result = state->wide_next.find(c);
+      if(result != state->wide_next.end()) {
+        return result->second;
+      }
+
+      DState* next = Transition(state, c);
+      state->wide_next.insert(pair<wchar_t, DState*>(c, next));
+      return next;
+    }
+  };
+
+  /****************************
+   * Compiled expression
+   ****************************/
+  class Regex {
+    vector<CharClass> classes;
+    Program* forward_program;
+    Program* reverse_program;
+    Dfa* forward;
+    Dfa* reverse;
+    wstring error;
+#ifdef _WIN32
+    CRITICAL_SECTION regex_cs;
+#else
+    pthread_mutex_t regex_mutex;
+#endif
+
+    // returns the longest match that starts at 'pos' or -1
+    long MatchAt(const wchar_t* text, const long len, const long pos) {
+      DState* state = forward->Start(pos == 0);
+      long last = state->is_match ? pos : -1;
+
+      long i = pos;
+      for(; i < len && !state->is_dead; i++) {
+        state = forward->Next(state, text[i]);
+        if(state->is_match) {
+          last = i + 1;
+        }
+      }
+
+      if(i == len && state->is_match_at_end) {
+        last = len;
+      }
+
+      return last;
+    }
+
+    // marks every position from 'offset' where a match can start
+    void MatchStarts(const wchar_t* text, const long len, const long offset, vector<char> &starts) {
+      DState* state = reverse->Start(true);
+      starts[len - offset] = state->is_match || (offset == len && len == 0 && state->is_match_at_end);
+
+      for(long i = len; i > offset; i--) {
+        state = reverse->Next(state, text[i - 1]);
+        if(state->is_match || (i - 1 == 0 && state->is_match_at_end)) {
+          starts[i - 1 - offset] = 1;
+        }
+      }
+    }
+
+    void Lock() {
+#ifdef _WIN32
+      EnterCriticalSection(&regex_cs);
+#else
+      pthread_mutex_lock(&regex_mutex);
+#endif
+    }
+
+    void Unlock() {
+#ifdef _WIN32
+      LeaveCriticalSection(&regex_cs);
+#else
+      pthread_mutex_unlock(&regex_mutex);
+#endif
+    }
+
+  public:
+    Regex(const wstring &pattern) {
+      forward_program = reverse_program = NULL;
+      forward = reverse = NULL;
+#ifdef _WIN32
+      InitializeCriticalSection(&regex_cs);
+#else
+      pthread_mutex_init(&regex_mutex, NULL);
+#endif
+
+      Parser parser(pattern, classes);
+      Node* root = parser.Parse();
+      if(!root) {
+        error = parser.GetError();
+        return;
+      }
+
+      forward_program = new Program(false, &classes);
+      reverse_program = new Program(true, &classes);
+      if(!forward_program->Compile(root) || !reverse_program->Compile(root)) {
+        error = L"pattern too large";
+        return;
+      }
+
+      forward = new Dfa(forward_program, false);
+      reverse = new Dfa(reverse_program, true);
+    }
+
+    ~Regex() {
+      if(forward) {
+        delete forward;
+        forward = NULL;
+      }
+
+      if(reverse) {
+        delete reverse;
+        reverse = NULL;
+      }
+
+      if(forward_program) {
+        delete forward_program;
+        forward_program = NULL;
+      }
+
+      if(reverse_program) {
+        delete reverse_program;
+        reverse_program = NULL;
+      }
+
+#ifdef _WIN32
+      DeleteCriticalSection(&regex_cs);
+#else
+      pthread_mutex_destroy(&regex_mutex);
+#endif
+    }
+
+    bool IsValid() {
+      return forward != NULL;
+    }
+
+    const wstring& GetError() {
+      return error;
+    }
+
+    long Match(const wchar_t* text, const long len, const long offset) {
+      if(offset < 0 || offset > len) {
+        return -1;
+      }
+
+      Lock();
+      const long end = MatchAt(text, len, offset);
+      Unlock();
+
+      return end;
+    }
+
+    // finds up to 'max' non-overlapping matches as start/end pairs
+    void Find(const wchar_t* text, const long len, const long offset, const long max,
+              const bool allow_empty, vector<long> &matches) {
+      if(offset < 0 || offset > len) {
+        return;
+      }
+
+      Lock();
+      vector<char> starts(len - offset + 1, 0);
+      MatchStarts(text, len, offset, starts);
+
+      long pos = offset;
+      while(pos <= len && (max < 0 || (long)matches.size() < max * 2)) {
+        if(!starts[pos - offset]) {
+          pos++;
+          continue;
+        }
+
+        const long end = MatchAt(text, len, pos);
+        if(end > pos || (allow_empty && end == pos)) {
+          matches.push_back(pos);
+          matches.push_back(end);
+          pos = end > pos ? end : pos + 1;
+        }
+        else {
+          pos++;
+        }
+      }
+      Unlock();
+    }
+  };
+}
+
+using namespace regex;
+
+// compiled patterns are shared by all RegEx instances
+static vector<Regex*> regex_table;
+static map<wstring, long> regex_cache;
+#ifdef _WIN32
+static CRITICAL_SECTION regex_cache_cs;
+#else
+static pthread_mutex_t regex_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static Regex* GetRegex(long handle) {
+  Regex* regex = NULL;
+#ifdef _WIN32
+  EnterCriticalSection(&regex_cache_cs);
+#else
+  pthread_mutex_lock(&regex_cache_mutex);
+#endif
+  if(handle > 0 && handle <= (long)regex_table.size()) {
+    regex = regex_table[handle - 1];
+  }
+#ifdef _WIN32
+  LeaveCriticalSection(&regex_cache_cs);
+#else
+  pthread_mutex_unlock(&regex_cache_mutex);
+#endif
+
+  return regex;
+}
+
+static const wchar_t* GetStringChars(VMContext& context, int index, long &len) {
+  long* str_obj = APITools_GetObjectValue(context, index);
+  if(!str_obj) {
+    len = 0;
+    return NULL;
+  }
+
+  long* char_array = (long*)str_obj[0];
+  len = str_obj[2];
+  return (wchar_t*)(char_array + 3);
+}
+
+extern "C" {
+  //
+  // initialize library
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void load_lib() {
+#ifdef _WIN32
+    InitializeCriticalSection(&regex_cache_cs);
+#endif
+  }
+
+  //
+  // release library
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void unload_lib() {
+    while(!regex_table.empty()) {
+      Regex* tmp = regex_table.back();
+      regex_table.pop_back();
+      delete tmp;
+      tmp = NULL;
+    }
+    regex_cache.clear();
+#ifdef _WIN32
+    DeleteCriticalSection(&regex_cache_cs);
+#endif
+  }
+
+  //
+  // compiles a pattern, reusing a cached program when one exists
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void regex_compile(VMContext& context) {
+    long len;
+    const wchar_t* chars = GetStringChars(context, 1, len);
+    const wstring pattern = chars ? wstring(chars, len) : wstring();
+
+#ifdef _WIN32
+    EnterCriticalSection(&regex_cache_cs);
+#else
+    pthread_mutex_lock(&regex_cache_mutex);
+#endif
+    long handle = 0;
+    map<wstring, long>::iterator result = regex_cache.find(pattern);
+    if(result != regex_cache.end()) {
+      handle = result->second;
+    }
+    else {
+      Regex* regex = new Regex(pattern);
+      if(regex->IsValid()) {
+        regex_table.push_back(regex);
+        handle = (long)regex_table.size();
+        regex_cache.insert(pair<wstring, long>(pattern, handle));
+      }
+      else {
+        APITools_SetStringValue(context, 2, regex->GetError());
+        delete regex;
+        regex = NULL;
+      }
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&regex_cache_cs);
+#else
+    pthread_mutex_unlock(&regex_cache_mutex);
+#endif
+
+    APITools_SetIntValue(context, 0, handle);
+  }
+
+  //
+  // anchored match, returns the end of the longest match or -1
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void regex_match(VMContext& context) {
+    Regex* regex = GetRegex(APITools_GetIntValue(context, 1));
+    long len;
+    const wchar_t* text = GetStringChars(context, 2, len);
+    const long offset = APITools_GetIntValue(context, 3);
+
+    long end = -1;
+    if(regex && text) {
+      end = regex->Match(text, len, offset);
+    }
+    APITools_SetIntValue(context, 0, end);
+  }
+
+  //
+  // finds leftmost-longest matches, returns start/end pairs
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void regex_find(VMContext& context) {
+    Regex* regex = GetRegex(APITools_GetIntValue(context, 1));
+    long len;
+    const wchar_t* text = GetStringChars(context, 2, len);
+    const long offset = APITools_GetIntValue(context, 3);
+    const long max = APITools_GetIntValue(context, 4);
+    const bool allow_empty = APITools_GetIntValue(context, 5) != 0;
+
+    vector<long> matches;
+    if(regex && text) {
+      regex->Find(text, len, offset, max, allow_empty, matches);
+    }
+
+    // copy start/end pairs
+    const long array_size = matches.size();
+    const long array_dim = 1;
+    long* array = (long*)context.alloc_array(array_size + array_dim + 2, INT_TYPE,
+                                             context.op_stack, *context.stack_pos, false);
+    array[0] = array_size;
+    array[1] = array_dim;
+    array[2] = array_size;
+    for(long i = 0; i < array_size; i++) {
+      array[i + 3] = matches[i];
+    }
+
+    long* array_holder = APITools_GetIntAddress(context, 0);
+    array_holder[0] = (long)array;
+  }
+}
@@ -0,0 +1,6 @@
+#/bin/sh
+rm -rf *.o
+rm -rf *.so
+# g++ -g -Wall -fPIC -c *$1.cpp; g++ -g -shared -D_DEBUG -Wl,-soname,$1.so.1 -o $1.so *.o
+g++ -O3 -Wall -fPIC -c *$1.cpp
+g++ -O3 -shared -Wl,-soname,$1.so.1 -o $1.so *.o
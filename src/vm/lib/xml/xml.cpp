@@ -0,0 +1,807 @@
+/***************************************************************************
+ * XML stream tokenizer for Objeck
+ *
+ * Copyright (c) 2013, Randy Hollines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the Objeck Team nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ***************************************************************************/
+
+#include <string.h>
+#include <wctype.h>
+#include "../../../vm/lib_api.h"
+
+using namespace std;
+
+// must match the values of XML.XmlEvent
+enum XmlEvent {
+  XML_START_ELEMENT = -400,
+  XML_END_ELEMENT,
+  XML_TEXT,
+  XML_CDATA,
+  XML_COMMENT,
+  XML_PROCESSING_INSTRUCTION,
+  XML_END,
+  XML_ERROR
+};
+
+// result of scanning a single token
+enum XmlToken {
+  TOKEN_OK = 0,
+  TOKEN_MORE,
+  TOKEN_BAD
+};
+
+// text runs longer than this are reported in pieces
+#define MAX_TEXT_RUN 32768
+
+/****************************
+ * Event buffers shared with
+ * the Objeck reader
+ ****************************/
+struct XmlEvents {
+  VMContext* context;
+  long* types;
+  long* offsets;
+  long* counts;
+  long* names;
+  long* values;
+  long* attribs;
+  long count;
+  long max;
+  long attrib_count;
+  long attrib_max;
+  long attrib_needed;
+
+  inline bool IsFull() {
+    return count >= max;
+  }
+
+  long* MakeString(const wstring &value) {
+    // create character array
+    const long char_array_size = value.size();
+    long* char_array = APITools_MakeCharArray(*context, char_array_size);
+    wchar_t* char_array_ptr = (wchar_t*)(char_array + 3);
+    memcpy(char_array_ptr, value.c_str(), char_array_size * sizeof(wchar_t));
+    char_array_ptr[char_array_size] = L'\0';
+
+    // create 'System.String' object instance
+    long* str_obj = context->alloc_obj(L"System.String", (long*)context->op_stack,
+                                       *context->stack_pos, false);
+    str_obj[0] = (long)char_array;
+    str_obj[1] = char_array_size;
+    str_obj[2] = char_array_size;
+
+    return str_obj;
+  }
+
+  void Add(XmlEvent type, const wstring* name, const wstring* value) {
+    APITools_SetIntArrayElement(types, count, type);
+    APITools_SetIntArrayElement(offsets, count, attrib_count);
+    APITools_SetIntArrayElement(counts, count, 0);
+    APITools_SetIntArrayElement(names, count, name ? (long)MakeString(*name) : 0);
+    APITools_SetIntArrayElement(values, count, value ? (long)MakeString(*value) : 0);
+    count++;
+  }
+
+  // adds attribute name/value pairs to the last event
+  void AddAttributes(const vector<wstring> &pairs) {
+    for(size_t i = 0; i < pairs.size(); i++) {
+      APITools_SetIntArrayElement(attribs, attrib_count++, (long)MakeString(pairs[i]));
+    }
+    APITools_SetIntArrayElement(counts, count - 1, pairs.size() / 2);
+  }
+};
+
+/****************************
+ * Incremental tokenizer;
+ * keeps the open element
+ * stack between buffer fills
+ ****************************/
+class XmlScanner {
+  vector<string> elements;
+  bool is_done;
+  bool is_latin1;
+  wstring name;
+  wstring value;
+  vector<wstring> pairs;
+
+  inline static bool IsWhitespace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  inline static bool IsNameChar(unsigned char c) {
+    return !IsWhitespace(c) && c != '>' && c != '/' && c != '=' && c != '<' &&
+      c != '"' && c != '\'' && c != '?';
+  }
+
+  inline static bool StartsWith(const unsigned char* buffer, long pos, const long end, const char* prefix) {
+    for(; *prefix; prefix++, pos++) {
+      if(pos >= end || buffer[pos] != (unsigned char)*prefix) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // finds 'terminal' at or after 'pos', returns -1 if not buffered
+  inline static long Find(const unsigned char* buffer, long pos, const long end, const char* terminal) {
+    const long len = strlen(terminal);
+    for(; pos + len <= end; pos++) {
+      if(buffer[pos] == (unsigned char)terminal[0] && !memcmp(buffer + pos, terminal, len)) {
+        return pos;
+      }
+    }
+
+    return -1;
+  }
+
+  void Error(XmlEvents &events, const wstring &message) {
+    is_done = true;
+    events.Add(XML_ERROR, NULL, &message);
+  }
+
+  // appends raw bytes, ASCII runs are copied directly
+  void AppendBytes(wstring &out, const unsigned char* buffer, long start, const long end) {
+    while(start < end && buffer[start] < 0x80) {
+      out += (wchar_t)buffer[start++];
+    }
+
+    if(start < end) {
+      if(is_latin1) {
+        while(start < end) {
+          out += (wchar_t)buffer[start++];
+        }
+      }
+      else {
+        const string bytes((const char*)buffer + start, end - start);
+        out += BytesToUnicode(bytes);
+      }
+    }
+  }
+
+  // appends bytes while decoding character and entity references
+  void AppendDecoded(wstring &out, const unsigned char* buffer, long start, const long end) {
+    long i = start;
+    while(i < end) {
+      if(buffer[i] != '&') {
+        i++;
+        continue;
+      }
+
+      AppendBytes(out, buffer, start, i);
+      start = i;
+
+      long semi = i + 1;
+      while(semi < end && semi - i < 12 && buffer[semi] != ';') {
+        semi++;
+      }
+
+      if(semi >= end || buffer[semi] != ';') {
+        i++;
+        continue;
+      }
+
+      const char* ref = (const char*)buffer + i + 1;
+      const long len = semi - i - 1;
+      long code = -1;
+      if(len == 2 && !strncmp(ref, "lt", 2)) {
+        code = '<';
+      }
+      else if(len == 2 && !strncmp(ref, "gt", 2)) {
+        code = '>';
+      }
+      else if(len == 3 && !strncmp(ref, "amp", 3)) {
+        code = '&';
+      }
+      else if(len == 4 && !strncmp(ref, "apos", 4)) {
+        code = '\'';
+      }
+      else if(len == 4 && !strncmp(ref, "quot", 4)) {
+        code = '"';
+      }
+      else if(len > 1 && ref[0] == '#') {
+        char* stop;
+        if(ref[1] == 'x' || ref[1] == 'X') {
+          code = strtol(ref + 2, &stop, 16);
+        }
+        else {
+          code = strtol(ref + 1, &stop, 10);
+        }
+
+        if(stop != ref + len || (len == 2 && (ref[1] == 'x' || ref[1] == 'X'))) {
+          code = -1;
+        }
+      }
+
+      // unknown references are kept as written
+      if(code < 0) {
+        i++;
+        continue;
+      }
+
+      if(sizeof(wchar_t) == 2 && code > 0xffff) {
+        code -= 0x10000;
+        out += (wchar_t)(0xd800 + (code >> 10));
+        out += (wchar_t)(0xdc00 + (code & 0x3ff));
+      }
+      else {
+        out += (wchar_t)code;
+      }
+      i = start = semi + 1;
+    }
+
+    AppendBytes(out, buffer, start, end);
+  }
+
+  // scans a name starting at 'pos'
+  XmlToken ScanName(const unsigned char* buffer, long &pos, const long end, wstring &out) {
+    long i = pos;
+    while(i < end && IsNameChar(buffer[i])) {
+      i++;
+    }
+
+    if(i >= end) {
+      return TOKEN_MORE;
+    }
+
+    if(i == pos) {
+      return TOKEN_BAD;
+    }
+
+    out.clear();
+    AppendBytes(out, buffer, pos, i);
+    pos = i;
+
+    return TOKEN_OK;
+  }
+
+  // scans 'name="value"' pairs up to 'close' ('>', '/>' or '?>')
+  XmlToken ScanAttributes(const unsigned char* buffer, long &pos, const long end) {
+    pairs.clear();
+    while(true) {
+      const long start = pos;
+      while(pos < end && IsWhitespace(buffer[pos])) {
+        pos++;
+      }
+
+      if(pos >= end) {
+        return TOKEN_MORE;
+      }
+
+      const unsigned char c = buffer[pos];
+      if(c == '>' || c == '/' || c == '?') {
+        return TOKEN_OK;
+      }
+
+      // attributes must be separated by whitespace
+      if(start == pos && !pairs.empty()) {
+        return TOKEN_BAD;
+      }
+
+      wstring attrib_name;
+      const XmlToken result = ScanName(buffer, pos, end, attrib_name);
+      if(result != TOKEN_OK) {
+        return result;
+      }
+
+      while(pos < end && IsWhitespace(buffer[pos])) {
+        pos++;
+      }
+      if(pos >= end) {
+        return TOKEN_MORE;
+      }
+      if(buffer[pos] != '=') {
+        return TOKEN_BAD;
+      }
+      pos++;
+
+      while(pos < end && IsWhitespace(buffer[pos])) {
+        pos++;
+      }
+      if(pos >= end) {
+        return TOKEN_MORE;
+      }
+
+      const unsigned char quote = buffer[pos];
+      if(quote != '"' && quote != '\'') {
+        return TOKEN_BAD;
+      }
+
+      const unsigned char* close = (const unsigned char*)memchr(buffer + pos + 1, quote, end - pos - 1);
+      if(!close) {
+        return TOKEN_MORE;
+      }
+
+      const long close_pos = close - buffer;
+      wstring attrib_value;
+      AppendDecoded(attrib_value, buffer, pos + 1, close_pos);
+      pos = close_pos + 1;
+
+      pairs.push_back(attrib_name);
+      pairs.push_back(attrib_value);
+    }
+  }
+
+  bool IsBlank(const unsigned char* buffer, long start, const long end) {
+    for(; start < end; start++) {
+      if(!IsWhitespace(buffer[start])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // checks the declared encoding of the document
+  void CheckEncoding() {
+    for(size_t i = 0; i + 1 < pairs.size(); i += 2) {
+      if(pairs[i] == L"encoding") {
+        wstring encoding;
+        for(size_t j = 0; j < pairs[i + 1].size(); j++) {
+          encoding += towlower(pairs[i + 1][j]);
+        }
+        is_latin1 = encoding == L"iso-8859-1" || encoding == L"latin1" || encoding == L"us-ascii";
+      }
+    }
+  }
+
+  // scans markup starting at '<', returns false if no progress could be made
+  bool ScanMarkup(const unsigned char* buffer, long &pos, const long end, const bool is_last,
+                  XmlEvents &events) {
+    const long remaining = end - pos;
+
+    // comment
+    if(StartsWith(buffer, pos, end, "<!--")) {
+      const long close = Find(buffer, pos + 4, end, "-->");
+      if(close < 0) {
+        return More(events, is_last);
+      }
+
+      value.clear();
+      AppendBytes(value, buffer, pos + 4, close);
+      events.Add(XML_COMMENT, NULL, &value);
+      pos = close + 3;
+
+      return true;
+    }
+
+    // character data
+    if(StartsWith(buffer, pos, end, "<![CDATA[")) {
+      const long close = Find(buffer, pos + 9, end, "]]>");
+      if(close < 0) {
+        return More(events, is_last);
+      }
+
+      if(elements.empty()) {
+        Error(events, L"character data outside of root element");
+        return false;
+      }
+
+      value.clear();
+      AppendBytes(value, buffer, pos + 9, close);
+      events.Add(XML_CDATA, NULL, &value);
+      pos = close + 3;
+
+      return true;
+    }
+
+    // document type and other declarations are skipped
+    if(remaining > 1 && buffer[pos + 1] == '!') {
+      long depth = 0;
+      unsigned char quote = 0;
+      for(long i = pos + 2; i < end; i++) {
+        const unsigned char c = buffer[i];
+        if(quote) {
+          if(c == quote) {
+            quote = 0;
+          }
+        }
+        else if(c == '"' || c == '\'') {
+          quote = c;
+        }
+        else if(c == '[') {
+          depth++;
+        }
+        else if(c == ']') {
+          depth--;
+        }
+        else if(c == '>' && depth <= 0) {
+          pos = i + 1;
+          return true;
+        }
+      }
+
+      return More(events, is_last);
+    }
+
+    // processing instruction
+    if(remaining > 1 && buffer[pos + 1] == '?') {
+      const long close = Find(buffer, pos + 2, end, "?>");
+      if(close < 0) {
+        return More(events, is_last);
+      }
+
+      long i = pos + 2;
+      if(ScanName(buffer, i, close + 1, name) != TOKEN_OK) {
+        Error(events, L"invalid processing instruction");
+        return false;
+      }
+
+      while(i < close && IsWhitespace(buffer[i])) {
+        i++;
+      }
+      value.clear();
+      AppendBytes(value, buffer, i, close);
+
+      // pseudo-attributes, such as the version and encoding, are parsed when well-formed
+      long attrib_pos = i;
+      if(ScanAttributes(buffer, attrib_pos, close + 1) != TOKEN_OK || attrib_pos != close) {
+        pairs.clear();
+      }
+
+      if(!Reserve(events)) {
+        return false;
+      }
+
+      if(name == L"xml") {
+        CheckEncoding();
+      }
+      events.Add(XML_PROCESSING_INSTRUCTION, &name, &value);
+      events.AddAttributes(pairs);
+      pos = close + 2;
+
+      return true;
+    }
+
+    // end tag
+    if(remaining > 1 && buffer[pos + 1] == '/') {
+      const unsigned char* close = (const unsigned char*)memchr(buffer + pos + 2, '>', remaining - 2);
+      if(!close) {
+        return More(events, is_last);
+      }
+
+      long i = pos + 2;
+      long j = close - buffer;
+      while(j > i && IsWhitespace(buffer[j - 1])) {
+        j--;
+      }
+
+      const string tag((const char*)buffer + i, j - i);
+      if(elements.empty() || elements.back() != tag) {
+        Error(events, L"mismatched end tag");
+        return false;
+      }
+      elements.pop_back();
+
+      name.clear();
+      AppendBytes(name, buffer, i, j);
+      events.Add(XML_END_ELEMENT, &name, NULL);
+      pos = close - buffer + 1;
+
+      return true;
+    }
+
+    // start tag
+    long i = pos + 1;
+    XmlToken result = ScanName(buffer, i, end, name);
+    const long name_end = i;
+    if(result == TOKEN_OK) {
+      result = ScanAttributes(buffer, i, end);
+    }
+
+    if(result == TOKEN_OK) {
+      if(buffer[i] == '/') {
+        if(i + 1 >= end) {
+          result = TOKEN_MORE;
+        }
+        else if(buffer[i + 1] != '>') {
+          result = TOKEN_BAD;
+        }
+      }
+      else if(buffer[i] != '>') {
+        result = TOKEN_BAD;
+      }
+    }
+
+    if(result == TOKEN_MORE) {
+      return More(events, is_last);
+    }
+
+    if(result == TOKEN_BAD) {
+      Error(events, L"invalid element");
+      return false;
+    }
+
+    // an empty element reports both a start and end event
+    const bool is_empty = buffer[i] == '/';
+    if(!Reserve(events) || (is_empty && events.count + 2 > events.max)) {
+      return false;
+    }
+
+    events.Add(XML_START_ELEMENT, &name, NULL);
+    events.AddAttributes(pairs);
+    if(is_empty) {
+      events.Add(XML_END_ELEMENT, &name, NULL);
+      pos = i + 2;
+    }
+    else {
+      elements.push_back(string((const char*)buffer + pos + 1, name_end - pos - 1));
+      pos = i + 1;
+    }
+
+    return true;
+  }
+
+  // ensures the attribute buffer can hold the scanned pairs
+  bool Reserve(XmlEvents &events) {
+    if(events.attrib_count + (long)pairs.size() <= events.attrib_max) {
+      return true;
+    }
+
+    // ask the reader for a larger buffer if this event alone does not fit
+    if(events.count == 0) {
+      events.attrib_needed = pairs.size();
+    }
+
+    return false;
+  }
+
+  bool More(XmlEvents &events, const bool is_last) {
+    if(is_last) {
+      Error(events, L"unexpected end of input");
+    }
+
+    return false;
+  }
+
+ public:
+  XmlScanner() {
+    is_done = false;
+    is_latin1 = false;
+  }
+
+  // scans events from buffer[pos..end), 'pos' is updated to the first unconsumed byte
+  void Scan(const unsigned char* buffer, long &pos, const long end, const bool is_last,
+            const bool skip_blank, XmlEvents &events) {
+    while(!is_done && !events.IsFull()) {
+      if(pos >= end) {
+        if(is_last) {
+          is_done = true;
+          if(elements.empty()) {
+            events.Add(XML_END, NULL, NULL);
+          }
+          else {
+            Error(events, L"unexpected end of input");
+          }
+        }
+        return;
+      }
+
+      if(buffer[pos] == '<') {
+        if(!ScanMarkup(buffer, pos, end, is_last, events)) {
+          return;
+        }
+        continue;
+      }
+
+      // character data up to the next tag
+      const unsigned char* next = (const unsigned char*)memchr(buffer + pos, '<', end - pos);
+      long stop = next ? next - buffer : end;
+      if(!next && !is_last) {
+        if(stop - pos < MAX_TEXT_RUN) {
+          return;
+        }
+
+        // report long runs in pieces, without splitting references or characters
+        long cut = stop;
+        for(long i = stop - 1; i > stop - 12 && i > pos; i--) {
+          if(buffer[i] == '&') {
+            cut = i;
+            break;
+          }
+        }
+        while(cut > pos && (buffer[cut] & 0xc0) == 0x80) {
+          cut--;
+        }
+        stop = cut;
+      }
+
+      if(skip_blank && IsBlank(buffer, pos, stop)) {
+        pos = stop;
+        continue;
+      }
+
+      if(elements.empty()) {
+        Error(events, L"text outside of root element");
+        return;
+      }
+
+      value.clear();
+      AppendDecoded(value, buffer, pos, stop);
+      events.Add(XML_TEXT, NULL, &value);
+      pos = stop;
+    }
+  }
+};
+
+// scanners are referenced from Objeck by table index
+static vector<XmlScanner*> scanner_table;
+#ifdef _WIN32
+static CRITICAL_SECTION scanner_cs;
+#else
+static pthread_mutex_t scanner_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static XmlScanner* GetScanner(long handle) {
+  XmlScanner* scanner = NULL;
+#ifdef _WIN32
+  EnterCriticalSection(&scanner_cs);
+#else
+  pthread_mutex_lock(&scanner_mutex);
+#endif
+  if(handle > 0 && handle <= (long)scanner_table.size()) {
+    scanner = scanner_table[handle - 1];
+  }
+#ifdef _WIN32
+  LeaveCriticalSection(&scanner_cs);
+#else
+  pthread_mutex_unlock(&scanner_mutex);
+#endif
+
+  return scanner;
+}
+
+extern "C" {
+  //
+  // initialize library
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void load_lib() {
+#ifdef _WIN32
+    InitializeCriticalSection(&scanner_cs);
+#endif
+  }
+
+  //
+  // release library
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void unload_lib() {
+    for(size_t i = 0; i < scanner_table.size(); i++) {
+      XmlScanner* tmp = scanner_table[i];
+      if(tmp) {
+        delete tmp;
+        tmp = NULL;
+      }
+    }
+    scanner_table.clear();
+#ifdef _WIN32
+    DeleteCriticalSection(&scanner_cs);
+#endif
+  }
+
+  //
+  // creates a scanner
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void xml_scanner_new(VMContext& context) {
+#ifdef _WIN32
+    EnterCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_lock(&scanner_mutex);
+#endif
+    // reuse released slots
+    long handle = 0;
+    for(size_t i = 0; !handle && i < scanner_table.size(); i++) {
+      if(!scanner_table[i]) {
+        scanner_table[i] = new XmlScanner;
+        handle = i + 1;
+      }
+    }
+
+    if(!handle) {
+      scanner_table.push_back(new XmlScanner);
+      handle = scanner_table.size();
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_unlock(&scanner_mutex);
+#endif
+
+    APITools_SetIntValue(context, 0, handle);
+  }
+
+  //
+  // releases a scanner
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void xml_scanner_free(VMContext& context) {
+    const long handle = APITools_GetIntValue(context, 0);
+#ifdef _WIN32
+    EnterCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_lock(&scanner_mutex);
+#endif
+    if(handle > 0 && handle <= (long)scanner_table.size() && scanner_table[handle - 1]) {
+      delete scanner_table[handle - 1];
+      scanner_table[handle - 1] = NULL;
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&scanner_cs);
+#else
+    pthread_mutex_unlock(&scanner_mutex);
+#endif
+  }
+
+  //
+  // scans a batch of events from a byte buffer
+  //
+#ifdef _WIN32
+  __declspec(dllexport)
+#endif
+  void xml_scan(VMContext& context) {
+    XmlScanner* scanner = GetScanner(APITools_GetIntValue(context, 1));
+    long* buffer_array = (long*)APITools_GetIntAddress(context, 2)[0];
+    long* pos_holder = APITools_GetIntAddress(context, 3);
+    const long end = APITools_GetIntValue(context, 4);
+    const bool is_last = APITools_GetIntValue(context, 5) != 0;
+    const bool skip_blank = APITools_GetIntValue(context, 6) != 0;
+
+    XmlEvents events;
+    events.context = &context;
+    events.types = (long*)APITools_GetIntAddress(context, 7)[0];
+    events.offsets = (long*)APITools_GetIntAddress(context, 8)[0];
+    events.counts = (long*)APITools_GetIntAddress(context, 9)[0];
+    events.names = APITools_GetObjectValue(context, 10);
+    events.values = APITools_GetObjectValue(context, 11);
+    events.attribs = APITools_GetObjectValue(context, 12);
+    events.count = 0;
+    events.max = APITools_GetArraySize(events.types);
+    events.attrib_count = 0;
+    events.attrib_max = APITools_GetArraySize(events.attribs);
+    events.attrib_needed = 0;
+
+    long pos = pos_holder[0];
+    if(scanner && buffer_array && pos > -1 && end <= APITools_GetArraySize(buffer_array)) {
+      const unsigned char* buffer = APITools_GetByteArray(buffer_array);
+      scanner->Scan(buffer, pos, end, is_last, skip_blank, events);
+    }
+    pos_holder[0] = pos;
+
+    APITools_SetIntValue(context, 0, events.count);
+    APITools_SetIntValue(context, 13, events.attrib_needed);
+  }
+}
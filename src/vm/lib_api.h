@@ -188,6 +188,64 @@ long* APITools_MakeCharArray(VMContext &context, const long char_array_size) {
   return char_array;
 }
 
+long* APITools_MakeIntArray(VMContext &context, const long int_array_size) {
+  // create integer array
+  const long int_array_dim = 1;
+  long* int_array = (long*)context.alloc_array(int_array_size + int_array_dim + 2,
+					       INT_TYPE, context.op_stack, *context.stack_pos, false);
+  int_array[0] = int_array_size;
+  int_array[1] = int_array_dim;
+  int_array[2] = int_array_size;
+
+  return int_array;
+}
+
+long* APITools_MakeFloatArray(VMContext &context, const long float_array_size) {
+  // create float array
+  const long float_array_dim = 1;
+#ifdef _X64
+  long* float_array = (long*)context.alloc_array(float_array_size + float_array_dim + 2,
+						 INT_TYPE, context.op_stack, *context.stack_pos, false);
+#else
+  // doubles are twice the size of integers for 32-bit target
+  long* float_array = (long*)context.alloc_array(float_array_size * 2 + float_array_dim + 2,
+						 INT_TYPE, context.op_stack, *context.stack_pos, false);
+#endif
+  float_array[0] = float_array_size;
+  float_array[1] = float_array_dim;
+  float_array[2] = float_array_size;
+
+  return float_array;
+}
+
+// creates a 'System.String' object instance
+long* APITools_MakeStringObject(VMContext &context, const wstring &value) {
+  // create character array
+  const long char_array_size = value.size();
+  const long char_array_dim = 1;
+  long* char_array = (long*)context.alloc_array(char_array_size + 1 +
+						((char_array_dim + 2) *
+						 sizeof(long)),
+						CHAR_ARY_TYPE,
+						context.op_stack, *context.stack_pos, false);
+  char_array[0] = char_array_size + 1;
+  char_array[1] = char_array_dim;
+  char_array[2] = char_array_size;
+  
+  // copy string
+  wchar_t* char_array_ptr = (wchar_t*)(char_array + 3);
+  wcsncpy(char_array_ptr, value.c_str(), char_array_size);
+  
+  // create 'System.String' object instance
+  long* str_obj = context.alloc_obj(L"System.String", (long*)context.op_stack, 
+				    *context.stack_pos, false);
+  str_obj[0] = (long)char_array;
+  str_obj[1] = char_array_size;
+  str_obj[2] = char_array_size;
+
+  return str_obj;
+}
+
 // gets the requested function ID from an Object[]
 int APITools_GetFunctionValue(VMContext &context, int index, FunctionId id) {
   long* data_array = context.data_array;
@@ -329,30 +387,7 @@ void APITools_SetObjectValue(VMContext &context, int index, long* obj) {
 // sets the requested String object for an Object[].  Please note, that 
 // memory should be allocated for this element prior to array access.
 void APITools_SetStringValue(VMContext &context, int index, const wstring &value) {
-  // create character array
-  const long char_array_size = value.size();
-  const long char_array_dim = 1;
-  long* char_array = (long*)context.alloc_array(char_array_size + 1 +
-						((char_array_dim + 2) *
-						 sizeof(long)),
-						CHAR_ARY_TYPE,
-						context.op_stack, *context.stack_pos, false);
-  char_array[0] = char_array_size + 1;
-  char_array[1] = char_array_dim;
-  char_array[2] = char_array_size;
-  
-  // copy string
-  wchar_t* char_array_ptr = (wchar_t*)(char_array + 3);
-  wcsncpy(char_array_ptr, value.c_str(), char_array_size);
-  
-  // create 'System.String' object instance
-  long* str_obj = context.alloc_obj(L"System.String", (long*)context.op_stack, 
-				    *context.stack_pos, false);
-  str_obj[0] = (long)char_array;
-  str_obj[1] = char_array_size;
-  str_obj[2] = char_array_size;
-  
-  APITools_SetObjectValue(context, index, str_obj);
+  APITools_SetObjectValue(context, index, APITools_MakeStringObject(context, value));
 }
 
 // get the requested string value from an Object[].
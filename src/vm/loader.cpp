@@ -34,6 +34,13 @@
 #include "../shared/version.h"
 
 StackProgram* Loader::program;
+Loader* Loader::lazy_instance;
+#ifdef _WIN32
+CRITICAL_SECTION Loader::lazy_cs;
+#else
+pthread_mutex_t Loader::lazy_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+void (*StackMethod::lazy_loader)(StackMethod* mthd);
 
 StackProgram* Loader::GetProgram() {
   return program;
@@ -60,6 +67,16 @@ void Loader::LoadConfiguration()
 
 void Loader::Load()
 {
+  // validate header
+  if(buffer_size < sizeof(int32_t) * 3) {
+    wcerr << L"This executable appears to be invalid or compiled with a different version of the toolchain." << endl;
+    exit(1);
+  }
+  
+#ifdef _WIN32
+  InitializeCriticalSection(&lazy_cs);
+#endif
+  
   const int ver_num = ReadInt();
   if(ver_num != VER_NUM) {
     wcerr << L"This executable appears to be invalid or compiled with a different version of the toolchain." << endl;
@@ -138,14 +155,7 @@ void Loader::Load()
   num_char_strings = ReadInt();
   wchar_t** char_strings = new wchar_t*[num_char_strings + arguments.size()];
   for(i = 0; i < num_char_strings; i++) {
-    const wstring value = ReadString();
-    wchar_t* char_string = new wchar_t[value.size() + 1];
-    // copy string
-    size_t j = 0;
-    for(; j < value.size(); j++) {
-      char_string[j] = value[j];
-    }
-    char_string[j] = L'\0';
+    wchar_t* char_string = ReadCharString();
 #ifdef _DEBUG
     wcout << L"Loaded static character string[" << i << L"]: '" << char_string << L"'" << endl;
 #endif
@@ -187,7 +197,7 @@ void Loader::Load()
   dclrs[0]->name = L"args";
   dclrs[0]->type = OBJ_ARY_PARM;
 
-  init_method = new StackMethod(-1, name, false, false, dclrs,	1, 0, 1, NIL_TYPE, NULL);
+  init_method = new StackMethod(-1, name, false, false, dclrs,	1, 0, sizeof(INT_VALUE), NIL_TYPE, NULL);
   LoadInitializationCode(init_method);
   program->SetInitializationMethod(init_method);
   program->SetStringObjectId(string_cls_id);
@@ -414,7 +424,9 @@ void Loader::LoadMethods(StackClass* cls, bool is_debug)
 	  << rtrn_name << L"'; params=" << params << L"; bytes=" 
 	  << mem_size << endl;
 #endif    
-    LoadStatements(mthd, is_debug);
+    // statements are decoded on first invocation
+    mthd->SetLazyStatements(buffer, is_debug);
+    SkipStatements(is_debug);
 
     // add method
 #ifdef _DEBUG
@@ -425,6 +437,123 @@ void Loader::LoadMethods(StackClass* cls, bool is_debug)
   cls->SetMethods(methods, number);
 }
 
+/********************************
+ * Skips over a method's statements
+ * without decoding them
+ ********************************/
+void Loader::SkipStatements(bool is_debug)
+{
+  int type = ReadByte();
+  while(type != END_STMTS) {
+    if(is_debug) {
+      ReadInt();
+    }
+    switch(type) {
+    case LOAD_CHAR_LIT:
+      buffer += ReadInt();
+      break;
+      
+    case LOAD_FLOAT_LIT:
+      ReadDouble();
+      break;
+      
+    case LOAD_INT_LIT:
+    case NEW_FLOAT_ARY:
+    case NEW_INT_ARY:
+    case NEW_BYTE_ARY:
+    case NEW_CHAR_ARY:
+    case NEW_OBJ_INST:
+    case LBL:
+    case OBJ_INST_CAST:
+    case OBJ_TYPE_OF:
+    case TRAP:
+    case TRAP_RTRN:
+      ReadInt();
+      break;
+      
+    case LOAD_INT_VAR:
+    case LOAD_FUNC_VAR:
+    case LOAD_FLOAT_VAR:
+    case STOR_INT_VAR:
+    case STOR_FUNC_VAR:
+    case STOR_FLOAT_VAR:
+    case COPY_INT_VAR:
+    case COPY_FLOAT_VAR:
+    case LOAD_BYTE_ARY_ELM:
+    case LOAD_CHAR_ARY_ELM:
+    case LOAD_INT_ARY_ELM:
+    case LOAD_FLOAT_ARY_ELM:
+    case STOR_BYTE_ARY_ELM:
+    case STOR_CHAR_ARY_ELM:
+    case STOR_INT_ARY_ELM:
+    case STOR_FLOAT_ARY_ELM:
+    case DYN_MTHD_CALL:
+    case JMP:
+      ReadInt();
+      ReadInt();
+      break;
+      
+    case MTHD_CALL:
+    case ASYNC_MTHD_CALL:
+      ReadInt();
+      ReadInt();
+      ReadInt();
+      break;
+
+    case TBL_SWITCH: {
+      ReadInt();
+      ReadInt();
+      const long size = ReadInt();
+      buffer += size * sizeof(int32_t);
+    }
+      break;
+      
+    default:
+      // no operands
+      break;
+    }
+    
+    if((size_t)(buffer - alloc_buffer) > buffer_size) {
+      wcerr << L">>> Unexpected end of file: '" << filename << L"' <<<" << endl;
+      exit(1);
+    }
+    type = ReadByte();
+  }
+}
+
+/********************************
+ * Decodes a method's statements
+ * on first invocation
+ ********************************/
+void Loader::LoadLazyStatements(StackMethod* method)
+{
+#ifdef _WIN32
+  EnterCriticalSection(&lazy_cs);
+#else
+  pthread_mutex_lock(&lazy_mutex);
+#endif
+  
+  // check again, another thread may have loaded the method
+  const char* stmts = method->GetLazyStatements();
+  if(stmts) {
+    if(!lazy_instance) {
+      wcerr << L">>> Unable to load method statements: " << method->GetName() << L" <<<" << endl;
+      exit(1);
+    }
+    
+    char* save_buffer = lazy_instance->buffer;
+    lazy_instance->buffer = (char*)stmts;
+    lazy_instance->LoadStatements(method, method->IsLazyDebug());
+    lazy_instance->buffer = save_buffer;
+  }
+  
+#ifdef _WIN32
+  LeaveCriticalSection(&lazy_cs);
+#else
+  pthread_mutex_unlock(&lazy_mutex);
+#endif
+}
+
 void Loader::LoadInitializationCode(StackMethod* method)
 {
   vector<StackInstr*> instrs;
@@ -464,6 +593,7 @@ void Loader::LoadInitializationCode(StackMethod* method)
 void Loader::LoadStatements(StackMethod* method, bool is_debug)
 {
   vector<StackInstr*> instrs;
+  vector<StackInstr*> switches;
 
   int index = 0;
   int type = ReadByte();
@@ -688,6 +818,20 @@ void Loader::LoadStatements(StackMethod* method, bool is_debug)
     }
       break;
 
+    case TBL_SWITCH: {
+      long low = ReadInt();
+      long other = ReadInt();
+      long size = ReadInt();
+      long* table = new long[size];
+      for(long i = 0; i < size; ++i) {
+        table[i] = ReadInt();
+      }
+      StackInstr* instr = new StackInstr(line_num, TBL_SWITCH, low, size, other, table);
+      instrs.push_back(instr);
+      switches.push_back(instr);
+    }
+      break;
+
     case OBJ_INST_CAST: {
       long to = ReadInt();
       instrs.push_back(new StackInstr(line_num, OBJ_INST_CAST, to));
@@ -973,6 +1117,22 @@ void Loader::LoadStatements(StackMethod* method, bool is_debug)
     index++;
   }
 
+  // resolve jump table labels to the instructions that follow them
+  for(size_t i = 0; i < switches.size(); ++i) {
+    StackInstr* instr = switches[i];
+    long* table = instr->GetTable();
+    for(long j = 0; j < instr->GetOperand2(); ++j) {
+      table[j] = method->GetLabelIndex(table[j]) + 1;
+    }
+    instr->SetOperand3(method->GetLabelIndex(instr->GetOperand3()) + 1);
+  }
+
+  // the compiler drops the statements of unreachable methods
+  if(instrs.empty() && !method->IsVirtual()) {
+    wcerr << L">>> Method was removed as unreachable: " << method->GetName() << L" <<<" << endl;
+    exit(1);
+  }
+
   // copy and set instructions
   StackInstr** mthd_instrs = new StackInstr*[instrs.size()];
   copy(instrs.begin(), instrs.end(), mthd_instrs);
@@ -35,10 +35,24 @@
 #include "common.h"
 #include <string.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 using namespace std;
 
 class Loader {
   static StackProgram* program;
+  // loader that owns the image used for lazy method decoding
+  static Loader* lazy_instance;
+#ifdef _WIN32
+  static CRITICAL_SECTION lazy_cs;
+#else
+  static pthread_mutex_t lazy_mutex;
+#endif
   vector<wstring> arguments;
   int num_float_strings;
   int num_int_strings;
@@ -83,6 +97,40 @@ class Loader {
     return out;
   }
 
+  // reads a string literal, ASCII strings are widened
+  // directly from the image
+  wchar_t* ReadCharString() {
+    const int size = ReadInt();
+    const unsigned char* in = (const unsigned char*)buffer;
+    
+    int i = 0;
+    while(i < size && in[i] < 0x80) {
+      i++;
+    }
+    
+    wchar_t* out;
+    if(i == size) {
+      out = new wchar_t[size + 1];
+      for(i = 0; i < size; i++) {
+        out[i] = in[i];
+      }
+      out[size] = L'\0';
+    }
+    else {
+      const string bytes(buffer, size);
+      wstring value;
+      if(!BytesToUnicode(bytes, value)) {
+        wcerr << L">>> Unable to read unicode string <<<" << endl;
+        exit(1);
+      }
+      out = new wchar_t[value.size() + 1];
+      memcpy(out, value.c_str(), (value.size() + 1) * sizeof(wchar_t));
+    }
+    buffer += size;
+    
+    return out;
+  }
+
   wchar_t ReadChar() {
     wchar_t out;
     
@@ -109,11 +157,27 @@ class Loader {
     return value;
   }
 
-  // loads a file into memory
+  // maps a file into memory
   char* LoadFileBuffer(wstring filename, size_t &buffer_size) {
     char* buffer;
     string open_filename(filename.begin(), filename.end());
     
+#ifndef _WIN32
+    struct stat file_info;
+    const int fd = open(open_filename.c_str(), O_RDONLY);
+    if(fd < 0 || fstat(fd, &file_info) < 0) {
+      wcerr << L"Unable to open source file: " << filename << endl;
+      exit(1);
+    }
+    
+    buffer_size = (size_t)file_info.st_size;
+    buffer = (char*)mmap(NULL, buffer_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(buffer == MAP_FAILED) {
+      wcerr << L"Unable to open source file: " << filename << endl;
+      exit(1);
+    }
+#else
     ifstream in(open_filename.c_str(), ios_base::in | ios_base::binary | ios_base::ate);
     if(in.good()) {
       // get file size
@@ -129,6 +193,7 @@ class Loader {
       wcerr << L"Unable to open source file: " << filename << endl;
       exit(1);
     }
+#endif
     
     return buffer;
   }
@@ -144,7 +209,9 @@ class Loader {
   void LoadMethods(StackClass* cls, bool is_debug);
   void LoadInitializationCode(StackMethod* mthd);
   void LoadStatements(StackMethod* mthd, bool is_debug);
+  void SkipStatements(bool is_debug);
   void LoadConfiguration();
+  static void LoadLazyStatements(StackMethod* mthd);
   
 public:
   Loader(wchar_t* arg) {
@@ -153,6 +220,8 @@ public:
     is_web = false;
     ReadFile();
     program = new StackProgram;
+    lazy_instance = this;
+    StackMethod::lazy_loader = LoadLazyStatements;
   }
 
   Loader(const int argc, wchar_t** argv) {
@@ -164,13 +233,23 @@ public:
     is_web = false;
     ReadFile();
     program = new StackProgram;
+    lazy_instance = this;
+    StackMethod::lazy_loader = LoadLazyStatements;
   }
 
   ~Loader() {
     if(alloc_buffer) {
+#ifdef _WIN32
       free(alloc_buffer);
+#else
+      munmap(alloc_buffer, buffer_size);
+#endif
       alloc_buffer = NULL;
     }
+    
+    if(lazy_instance == this) {
+      lazy_instance = NULL;
+    }
 
     delete program;
     program = NULL;
@@ -286,13 +286,8 @@ long* MemoryManager::AllocateObject(const long obj_id, long* op_stack,
 
   long* mem = NULL;
   if(cls) {
-    long size = cls->GetInstanceMemorySize();
-#ifdef _X64
-    // TODO: memory size is doubled the compiler assumes that integers are 4-bytes.
-    // In 64-bit mode integers and floats are 8-bytes.  This approach allocates more
-    // memory for floats (a.k.a doubles) than needed.
-    size *= 2;
-#endif
+    // one word per slot
+    const long size = cls->GetInstanceMemorySize();
 
     // collect memory
     if(collect && allocation_size + size > mem_max_size) {
@@ -304,7 +299,7 @@ long* MemoryManager::AllocateObject(const long obj_id, long* op_stack,
 #endif
     
     // allocate memory
-    const long alloc_size = size * 2 + sizeof(long) * EXTRA_BUF_SIZE;
+    const long alloc_size = size + sizeof(long) * EXTRA_BUF_SIZE;
 
     if(cache_pool_512.size() > 0 && alloc_size <= 512 && alloc_size > 256) {
       mem = (long*)cache_pool_512.top();
@@ -376,6 +371,47 @@ long* MemoryManager::AllocateObject(const long obj_id, long* op_stack,
   return mem;
 }
 
+/********************************
+ * Allocates an array outside of
+ * the collected heap. Used for
+ * program constants.
+ ********************************/
+long* MemoryManager::AllocateImmortalArray(const long size, const MemoryType type)
+{
+  long calc_size;
+  switch(type) {
+  case BYTE_ARY_TYPE:
+    calc_size = size * sizeof(char);
+    break;
+    
+  case CHAR_ARY_TYPE:
+    calc_size = size * sizeof(wchar_t);
+    break;
+
+  case INT_TYPE:
+    calc_size = size * sizeof(long);
+    break;
+
+  case FLOAT_TYPE:
+    calc_size = size * sizeof(FLOAT_VALUE);
+    break;
+
+  default:
+    wcerr << L"internal error" << endl;
+    exit(1);
+    break;
+  }
+  
+  long* mem = (long*)calloc(calc_size + sizeof(long) * EXTRA_BUF_SIZE, sizeof(char));
+  mem[EXTRA_BUF_SIZE + CACHE_SIZE] = -1;
+  mem[EXTRA_BUF_SIZE + TYPE] = type;
+  mem[EXTRA_BUF_SIZE + SIZE_OR_CLS] = calc_size;
+  // always marked, never traced or swept
+  mem[EXTRA_BUF_SIZE + MARKED_FLAG] = 1L;
+  
+  return mem + EXTRA_BUF_SIZE;
+}
+
 long* MemoryManager::AllocateArray(const long size, const MemoryType type,
                                    long* op_stack, long stack_pos, bool collect)
 {
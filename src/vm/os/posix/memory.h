@@ -216,6 +216,7 @@ class MemoryManager {
                               long stack_pos, bool collect = true);
   static long* AllocateArray(const long size, const MemoryType type, 
                              long* op_stack, long stack_pos, bool collect = true);
+  static long* AllocateImmortalArray(const long size, const MemoryType type);
   
   // object verification
   static long* ValidObjectCast(long* mem, long to_id, int* cls_hierarchy, int** cls_interfaces);
@@ -41,9 +41,11 @@
 #include <dirent.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 
 #define SOCKET int
@@ -107,6 +109,37 @@ class File {
     return file;
   }
 
+  // maps a file read-only into memory
+  static char* MapFile(const char* name, long &size) {
+    size = 0;
+    int fd = open(name, O_RDONLY);
+    if(fd < 0) {
+      return NULL;
+    }
+
+    struct stat buf;
+    if(fstat(fd, &buf) || buf.st_size <= 0) {
+      close(fd);
+      return NULL;
+    }
+
+    void* base = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) {
+      return NULL;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(base, buf.st_size, MADV_SEQUENTIAL);
+#endif
+    size = buf.st_size;
+    
+    return (char*)base;
+  }
+
+  static void UnmapFile(char* base, long size) {
+    munmap(base, size);
+  }
+
   static bool MakeDir(const char* name) {
     if(mkdir(name, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) < 0) {
       return false;
@@ -218,6 +251,10 @@ class IPSocket {
     strncpy(client_address, inet_ntoa(pin.sin_addr), 255);
     client_port = ntohs(pin.sin_port);
     
+    // replies to pipelined requests are not held back waiting for acks
+    int no_delay = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (char*)&no_delay, sizeof(no_delay));
+    
     return client;
   }
 
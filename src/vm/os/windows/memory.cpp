@@ -288,7 +288,8 @@ long* MemoryManager::AllocateObject(const long obj_id, long* op_stack, long stac
 
   long* mem = NULL;
   if(cls) {
-    long size = cls->GetInstanceMemorySize();
+    // one word per slot
+    const long size = cls->GetInstanceMemorySize();
 
     // collect memory
     if(collect && allocation_size + size > mem_max_size) {
@@ -299,7 +300,7 @@ long* MemoryManager::AllocateObject(const long obj_id, long* op_stack, long stac
 #ifdef _DEBUG
     bool is_cached = false;
 #endif
-    const long alloc_size = size * 2 + sizeof(long) * EXTRA_BUF_SIZE;
+    const long alloc_size = size + sizeof(long) * EXTRA_BUF_SIZE;
     if(cache_pool_512.size() > 0 && alloc_size <= 512 && alloc_size > 256) {
       mem = (long*)cache_pool_512.top();
       cache_pool_512.pop();
@@ -368,6 +369,47 @@ long* MemoryManager::AllocateObject(const long obj_id, long* op_stack, long stac
   return mem;
 }
 
+/********************************
+ * Allocates an array outside of
+ * the collected heap. Used for
+ * program constants.
+ ********************************/
+long* MemoryManager::AllocateImmortalArray(const long size, const MemoryType type)
+{
+  long calc_size;
+  switch(type) {
+  case BYTE_ARY_TYPE:
+    calc_size = size * sizeof(char);
+    break;
+    
+  case CHAR_ARY_TYPE:
+    calc_size = size * sizeof(wchar_t);
+    break;
+
+  case INT_TYPE:
+    calc_size = size * sizeof(long);
+    break;
+
+  case FLOAT_TYPE:
+    calc_size = size * sizeof(FLOAT_VALUE);
+    break;
+
+  default:
+    wcerr << L"internal error" << endl;
+    exit(1);
+    break;
+  }
+  
+  long* mem = (long*)calloc(calc_size + sizeof(long) * EXTRA_BUF_SIZE, sizeof(char));
+  mem[EXTRA_BUF_SIZE + CACHE_SIZE] = -1;
+  mem[EXTRA_BUF_SIZE + TYPE] = type;
+  mem[EXTRA_BUF_SIZE + SIZE_OR_CLS] = calc_size;
+  // always marked, never traced or swept
+  mem[EXTRA_BUF_SIZE + MARKED_FLAG] = 1L;
+  
+  return mem + EXTRA_BUF_SIZE;
+}
+
 long* MemoryManager::AllocateArray(const long size, const MemoryType type,
                                    long* op_stack, long stack_pos, bool collect)
 {
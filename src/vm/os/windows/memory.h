@@ -232,6 +232,7 @@ public:
   //
   static long* AllocateObject(const long obj_id, long* op_stack, long stack_pos, bool collect = true);
   static long* AllocateArray(const long size, const MemoryType type, long* op_stack, long stack_pos, bool collect = true);
+  static long* AllocateImmortalArray(const long size, const MemoryType type);
 
   //
   // object verification
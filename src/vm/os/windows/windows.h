@@ -110,6 +110,42 @@ public:
     return file;
   }
 
+  // maps a file read-only into memory
+  static char* MapFile(const char* name, long &size) {
+    size = 0;
+    HANDLE file = CreateFile(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 
+                             FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+      return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+      CloseHandle(file);
+      return NULL;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(!mapping) {
+      return NULL;
+    }
+
+    // view remains valid after the mapping handle is closed
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if(!base) {
+      return NULL;
+    }
+    size = (long)file_size.QuadPart;
+    
+    return (char*)base;
+  }
+
+  static void UnmapFile(char* base, long size) {
+    UnmapViewOfFile(base);
+  }
+
   static bool MakeDir(const char* name) {
     if(CreateDirectory(name, NULL) == 0) {
       return false;
@@ -263,6 +299,10 @@ public:
     strncpy(client_address, inet_ntoa(pin.sin_addr), 255);
     client_port = ntohs(pin.sin_port);
 
+    // replies to pipelined requests are not held back waiting for acks
+    int no_delay = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (char*)&no_delay, sizeof(no_delay));
+
     return client;
   }
 };
@@ -33,6 +33,7 @@
 #include "../shared/version.h"
 #include <iostream>
 #include <string>
+#include <signal.h>
 
 using namespace std;
 
@@ -47,6 +48,10 @@ int main(const int argc, const char* argv[])
     CRYPTO_malloc_init();
     SSL_library_init();
     
+    // writes to sockets closed by the peer (i.e. stale pooled 
+    // connections) return errors rather than ending the process
+    signal(SIGPIPE, SIG_IGN);
+    
     return Execute(argc, argv);
   } 
   else {
@@ -56,8 +61,10 @@ int main(const int argc, const char* argv[])
     usage += L"FOR MORE INFORMATION.\n\n";
     usage += VERSION_STRING;
     usage += L"\n\n";
-    usage += L"usage: obr <program>\n\n";
-    usage += L"example: \"obr hello.obe\"";
+    usage += L"usage: obr [-profile] <program>\n\n";
+    usage += L"example: \"obr hello.obe\"\n\n";
+    usage += L"options:\n";
+    usage += L"  -profile: count calls and branches into '<program>.obp' for 'obc -profile'";
     wcerr << usage << endl << endl;
 
     return 1;
@@ -34,14 +34,46 @@
 #define SUCCESS 0
 #define USAGE_ERROR -1
 
+// profile output, written once when the program ends
+static wstring profile_program;
+static wstring profile_file;
+
+static void WriteProfile()
+{
+  StackProgram* program = Loader::GetProgram();
+  if(program && profile_file.size() > 0) {
+    if(!program->WriteProfile(profile_program, profile_file)) {
+      wcerr << L"Unable to write profile: '" << profile_file << L"'" << endl;
+    }
+    profile_file.clear();
+  }
+}
+
 // common execution point for all platforms
 int Execute(const int argc, const char* argv[])
 {
-  if(argc > 1) {
+  // '-profile' counts calls and branches for 'obc -profile'
+  int first_arg = 0;
+  if(argc > 2 && !strcmp(argv[1], "-profile")) {
+    StackMethod::SetProfiling(true);
+    first_arg = 1;
+  }
+  
+  if(argc - first_arg > 1) {
     srand((unsigned int)time(NULL)); rand(); // calling rand() once improves random number generation
-    wchar_t** commands = ProcessCommandLine(argc, argv);
-    Loader loader(argc, commands);
+    wchar_t** commands = ProcessCommandLine(argc - first_arg, argv + first_arg);
+    Loader loader(argc - first_arg, commands);
     loader.Load();
+    
+    // profile is named after the program, programs may end by calling exit()
+    if(StackMethod::IsProfiling()) {
+      profile_program = commands[1];
+      const size_t ext = profile_program.rfind(L".obe");
+      profile_file = ext != wstring::npos && ext + 4 == profile_program.size() ? 
+        profile_program.substr(0, ext) : profile_program;
+      profile_file += L".obp";
+      atexit(WriteProfile);
+    }
 
     // ignore web applications
     if(loader.IsWeb()) {
@@ -60,6 +92,7 @@ int Execute(const int argc, const char* argv[])
     // start the interpreter...
     Runtime::StackInterpreter intpr(Loader::GetProgram());
     intpr.Execute(op_stack, stack_pos, 0, loader.GetProgram()->GetInitializationMethod(), NULL, false);
+    WriteProfile();
 
 #ifdef _DEBUG
     wcout << L"# final stack: pos=" << (*stack_pos) << L" #" << endl;
@@ -121,7 +154,7 @@ int Execute(const int argc, const char* argv[])
          << L" second(s)." << endl;
 #endif
 
-    CleanUpCommandLine(argc, commands);
+    CleanUpCommandLine(argc - first_arg, commands);
     return SUCCESS;
   } 
   else {
@@ -76,8 +76,10 @@ int main(const int argc, const char* argv[])
     usage += L"FOR MORE INFORMATION.\n\n";
     usage += VERSION_STRING;
     usage += L"\n\n";
-    usage += L"usage: obr <program>\n\n";
-    usage += L"example: \"obr hello.obe\"";
+    usage += L"usage: obr [-profile] <program>\n\n";
+    usage += L"example: \"obr hello.obe\"\n\n";
+    usage += L"options:\n";
+    usage += L"  -profile: count calls and branches into '<program>.obp' for 'obc -profile'";
     wcerr << usage << endl << endl;
   }
 
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Compares the -opt s3 and -opt s4 tiers over the rc/ sample programs.
+# Reports target file size and best-of-3 run time for each sample.
+#
+# usage: opt_bench.sh [compiler dir] [vm dir]
+
+OBC_DIR=${1:-../../../src/compiler}
+OBR_DIR=${2:-../../../src/vm}
+LIBS=collect.obl,xml.obl,json.obl,regex.obl,encrypt.obl
+OUT=${TMPDIR:-/tmp}/opt_bench
+# interactive, networked or non-deterministic samples
+SKIP="loop pig thread http https json_web scrape soap_http sleep_sort random guess guess_fb create_html date chat_server"
+# long running servers and randomized searches
+SKIP="$SKIP evol server http_server perfect"
+
+mkdir -p $OUT
+OBC_DIR=$(cd $OBC_DIR && pwd)
+OBR_DIR=$(cd $OBR_DIR && pwd)
+
+best_time() {
+  best=
+  for i in 1 2 3; do
+    start=$(date +%s%N)
+    (cd $OBR_DIR && timeout 30 ./obr $1 </dev/null >/dev/null 2>&1)
+    end=$(date +%s%N)
+    t=$(( (end - start) / 1000000 ))
+    if [ -z "$best" ] || [ $t -lt $best ]; then
+      best=$t
+    fi
+  done
+  echo $best
+}
+
+printf "%-28s %10s %10s %10s %10s\n" sample s3_bytes s4_bytes s3_ms s4_ms
+total_s3_size=0; total_s4_size=0; total_s3_time=0; total_s4_time=0
+for src in $OBC_DIR/rc/*.obs; do
+  name=$(basename $src .obs)
+  case " $SKIP " in *" $name "*) continue;; esac
+  
+  (cd $OBC_DIR && ./obc -src $src -opt s3 -lib $LIBS -dest $OUT/$name.s3.obe >/dev/null 2>&1) || continue
+  (cd $OBC_DIR && ./obc -src $src -opt s4 -lib $LIBS -dest $OUT/$name.s4.obe >/dev/null 2>&1) || continue
+  
+  s3_size=$(wc -c < $OUT/$name.s3.obe); s4_size=$(wc -c < $OUT/$name.s4.obe)
+  s3_time=$(best_time $OUT/$name.s3.obe); s4_time=$(best_time $OUT/$name.s4.obe)
+  printf "%-28s %10d %10d %10d %10d\n" $name $s3_size $s4_size $s3_time $s4_time
+  
+  total_s3_size=$((total_s3_size + s3_size)); total_s4_size=$((total_s4_size + s4_size))
+  total_s3_time=$((total_s3_time + s3_time)); total_s4_time=$((total_s4_time + s4_time))
+done
+printf "%-28s %10d %10d %10d %10d\n" total $total_s3_size $total_s4_size $total_s3_time $total_s4_time